@@ -0,0 +1,69 @@
+`include "buscmd.vh"
+
+// accelerator l2 port arbiter: bfs_core and hash_core share bfsl2
+// bfs requests have priority. Read and mark responses come back in order as
+// 8-beat bursts, so a fifo of owners steers each burst to its requester.
+module accarb(
+  input         clk,
+  input         rst,
+
+  // bfs interface
+  input         bfs_dc_req,
+  input [1:0]   bfs_dc_op,
+  input [31:0]  bfs_dc_addr,
+  input [7:0]   bfs_dc_wmask,
+  input [63:0]  bfs_dc_wdata,
+  output        bfs_dc_ready,
+  output        bfs_dc_valid,
+
+  // hash interface
+  input         hash_dc_req,
+  input [1:0]   hash_dc_op,
+  input [31:0]  hash_dc_addr,
+  input [7:0]   hash_dc_wmask,
+  input [63:0]  hash_dc_wdata,
+  output        hash_dc_ready,
+  output        hash_dc_valid,
+
+  // l2 interface
+  output        acc_l2_req,
+  output [1:0]  acc_l2_op,
+  output [31:0] acc_l2_addr,
+  output [7:0]  acc_l2_wmask,
+  output [63:0] acc_l2_wdata,
+  input         l2_acc_ready,
+  input         l2_acc_valid);
+
+  reg [2:0] beat;
+  always @(posedge clk)
+    if(rst)
+      beat <= 0;
+    else if(l2_acc_valid)
+      beat <= beat + 1;
+
+  // owner of each outstanding burst (1: hash)
+  wire own_ready, own_valid, own_hash;
+  fifo #(1,16) own_fifo(
+    .clk(clk),
+    .rst(rst),
+    .wr_valid(acc_l2_req & l2_acc_ready & acc_l2_op[0]),
+    .wr_ready(own_ready),
+    .wr_data(~bfs_dc_req),
+    .rd_valid(own_valid),
+    .rd_ready(l2_acc_valid & (beat == 3'd7)),
+    .rd_data(own_hash));
+
+  // hash_dc_req must not depend on hash_dc_ready
+  assign bfs_dc_ready = l2_acc_ready & own_ready;
+  assign hash_dc_ready = l2_acc_ready & own_ready & ~bfs_dc_req;
+
+  assign acc_l2_req = (bfs_dc_req | hash_dc_req) & own_ready;
+  assign acc_l2_op = bfs_dc_req ? bfs_dc_op : hash_dc_op;
+  assign acc_l2_addr = bfs_dc_req ? bfs_dc_addr : hash_dc_addr;
+  assign acc_l2_wmask = bfs_dc_req ? bfs_dc_wmask : hash_dc_wmask;
+  assign acc_l2_wdata = bfs_dc_req ? bfs_dc_wdata : hash_dc_wdata;
+
+  assign bfs_dc_valid = l2_acc_valid & own_valid & ~own_hash;
+  assign hash_dc_valid = l2_acc_valid & own_valid & own_hash;
+
+endmodule
@@ -4,7 +4,7 @@ cd "$(dirname $0)"
 exec emacs -Q --batch --eval="(progn $(tail -n+6 $0))" "$@"
 
 (require 'verilog-mode)
-(dolist (path '(".." "../bfs"))
+(dolist (path '(".." "../bfs" "../hash"))
   (push path verilog-library-directories))
 
 (dolist (file command-line-args-left)
@@ -0,0 +1,383 @@
+#include "dramsim_verilator.h"
+
+#include <verilated.h>
+#include "Vtop.h"
+#include "Vtop_top.h"
+
+#include <svdpi.h>
+#include "Vtop__Dpi.h"
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#define RAM_BASE 0x20000000
+
+// memory layout (offsets from RAM_BASE)
+#define NODE_OFFSET  0x01000000
+#define OBASE_OFFSET 0x01000000
+#define EBASE_OFFSET 0x02000000
+#define VBASE_OFFSET 0x03000000
+#define BLOCK_OFFSET 0x04000000
+#define QBASE_OFFSET 0x06000000
+#define QSIZE        (8*1024*1024)
+
+#define N_MAX 14
+#define LINE_OVERFLOW 0x01
+
+// bfs csr registers (csr_bfs_addr)
+#define REG_STAT  0
+#define REG_ROOT  1
+#define REG_TARG  2
+#define REG_QBASE 3
+#define REG_QSIZE 4
+#define REG_NBASE 6
+#define REG_OBASE 8
+#define REG_EBASE 9
+#define REG_VBASE 10
+
+#define STAT_START 0x001
+#define STAT_CSR   0x200
+
+#define TIMEOUT_CYCLES 100000000ull
+#define SETTLE_CYCLES 2000
+
+// accelerator node layout (see tests/graph.h), also used for overflow
+// edge blocks, whose first word is unused
+struct Node {
+  uint32_t value;
+  uint16_t numEdges;
+  uint8_t flags;
+  uint8_t marked;
+  uint32_t edges[N_MAX];
+};
+static_assert(sizeof(Node) == 64, "accelerator nodes are one cache line");
+
+struct Counters {
+  uint64_t deq, enq, marked, spill, restore, qstall, dcwait, cycles, prefetches;
+  bool valid;
+};
+
+static VerilatedContext* context;
+static Vtop* top;
+static DRAM* dram;
+static Counters counters;
+
+static std::string get_plusarg(const char* name, const char* dflt) {
+  std::string match = context->commandArgsPlusMatch(name);
+  size_t len = strlen(name);
+  if(match.length() <= len + 1) {return dflt;}
+  return match.substr(len + 2);
+}
+
+static std::vector<uint32_t> get_plusarg_list(const char* name, const char* dflt) {
+  std::vector<uint32_t> list;
+  std::string str = get_plusarg(name, dflt);
+  size_t pos = 0;
+  while(pos < str.length()) {
+    size_t next = str.find(',', pos);
+    if(next == std::string::npos) {next = str.length();}
+    list.push_back(strtoul(str.substr(pos, next - pos).c_str(), nullptr, 0));
+    pos = next + 1;
+  }
+  return list;
+}
+
+static void tick() {
+  top->top->clk = 1;
+  top->eval();
+  top->top->clk = 0;
+  top->eval();
+  dram->tick();
+  context->timeInc(1);
+}
+
+static void csr_write(uint32_t addr, uint32_t data) {
+  top->top->csr_valid = 1;
+  top->top->csr_addr = addr;
+  top->top->csr_wen = 1;
+  top->top->csr_wdata = data;
+  tick();
+  top->top->csr_valid = 0;
+  top->top->csr_wen = 0;
+  tick();
+}
+
+// uniform random directed graph, at most one copy of each edge
+struct Graph {
+  uint32_t size;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> edges;
+  uint32_t blocks; // overflow edge blocks in the node format
+};
+
+static void build_graph(Graph* graph, uint32_t size, uint32_t degree, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<std::vector<uint32_t>> adj(size);
+  for(uint64_t i = 0; i < (uint64_t) size * degree; i++) {
+    uint32_t from = rng() % size;
+    uint32_t to = rng() % size;
+    if(from == to) {continue;}
+    bool dup = false;
+    for(uint32_t e : adj[from]) {dup |= (e == to);}
+    if(!dup) {adj[from].push_back(to);}
+  }
+
+  graph->size = size;
+  graph->blocks = 0;
+  graph->offsets.assign(size + 1, 0);
+  graph->edges.clear();
+  for(uint32_t v = 0; v < size; v++) {
+    graph->offsets[v] = graph->edges.size();
+    graph->edges.insert(graph->edges.end(), adj[v].begin(), adj[v].end());
+  }
+  graph->offsets[size] = graph->edges.size();
+}
+
+// copies the graph into dram in the requested format, clearing all marks
+static void load_graph(Graph* graph, bool csr) {
+  if(csr) {
+    std::vector<uint8_t> visited(graph->size, 0);
+    dram->memwrite(OBASE_OFFSET, graph->offsets.data(), graph->offsets.size() * 4);
+    dram->memwrite(EBASE_OFFSET, graph->edges.data(), graph->edges.size() * 4);
+    dram->memwrite(VBASE_OFFSET, visited.data(), visited.size());
+    return;
+  }
+
+  // a line that overflows holds N_MAX-1 edges and chains through its last slot
+  graph->blocks = 0;
+  for(uint32_t v = 0; v < graph->size; v++) {
+    uint64_t offset = NODE_OFFSET + v * sizeof(Node);
+    uint32_t i = graph->offsets[v];
+    uint32_t end = graph->offsets[v+1];
+    while(true) {
+      Node line;
+      memset(&line, 0, sizeof(line));
+      line.value = v;
+      uint32_t count = end - i;
+      uint64_t next = 0;
+      if(count > N_MAX) {
+        count = N_MAX - 1;
+        next = BLOCK_OFFSET + (graph->blocks++) * sizeof(Node);
+        line.flags = LINE_OVERFLOW;
+        line.edges[N_MAX-1] = RAM_BASE + next;
+      }
+      for(line.numEdges = 0; line.numEdges < count; line.numEdges++) {
+        line.edges[line.numEdges] = RAM_BASE + NODE_OFFSET + graph->edges[i++] * sizeof(Node);
+      }
+      dram->memwrite(offset, &line, sizeof(line));
+      if(!next) {break;}
+      offset = next;
+    }
+  }
+}
+
+// host reference: number of reachable vertices and edges traversed from root
+static void host_bfs(const Graph* graph, uint32_t root,
+                     uint64_t* vertices, uint64_t* edges) {
+  std::vector<uint8_t> visited(graph->size, 0);
+  std::vector<uint32_t> queue;
+  queue.push_back(root);
+  visited[root] = 1;
+  *edges = 0;
+  for(size_t head = 0; head < queue.size(); head++) {
+    uint32_t v = queue[head];
+    for(uint32_t i = graph->offsets[v]; i < graph->offsets[v+1]; i++) {
+      (*edges)++;
+      if(!visited[graph->edges[i]]) {
+        visited[graph->edges[i]] = 1;
+        queue.push_back(graph->edges[i]);
+      }
+    }
+  }
+  *vertices = queue.size();
+}
+
+// runs a full traversal (target never matches), returns false on timeout
+static bool run_search(const Graph* graph, uint32_t root, bool csr) {
+  top->top->rst = 1;
+  for(int i = 0; i < 10; i++) {tick();}
+  top->top->rst = 0;
+  tick();
+
+  csr_write(REG_QBASE, RAM_BASE + QBASE_OFFSET);
+  csr_write(REG_QSIZE, QSIZE);
+  if(csr) {
+    csr_write(REG_OBASE, RAM_BASE + OBASE_OFFSET);
+    csr_write(REG_EBASE, RAM_BASE + EBASE_OFFSET);
+    csr_write(REG_VBASE, RAM_BASE + VBASE_OFFSET);
+    csr_write(REG_ROOT, root);
+  } else {
+    csr_write(REG_NBASE, RAM_BASE + NODE_OFFSET);
+    csr_write(REG_ROOT, RAM_BASE + NODE_OFFSET + root * sizeof(Node));
+  }
+  csr_write(REG_TARG, 0xffffffff);
+
+  counters.valid = false;
+  csr_write(REG_STAT, csr ? (STAT_CSR | STAT_START) : STAT_START);
+
+  for(uint64_t i = 0; !top->top->bfs_csr_irq; i++) {
+    if(i == TIMEOUT_CYCLES) {return false;}
+    tick();
+  }
+  for(int i = 0; i < SETTLE_CYCLES && !counters.valid; i++) {tick();}
+  return counters.valid;
+}
+
+int main(int argc, char** argv) {
+  bool error = false;
+
+  context = new VerilatedContext;
+  context->commandArgs(argc, argv);
+  context->timeunit(-9);
+  context->timeprecision(-9);
+
+  std::vector<uint32_t> sizes = get_plusarg_list("sizes", "1024,4096");
+  std::vector<uint32_t> degrees = get_plusarg_list("degrees", "4,8");
+  uint32_t searches = strtoul(get_plusarg("searches", "4").c_str(), nullptr, 0);
+  uint32_t seed = strtoul(get_plusarg("seed", "1").c_str(), nullptr, 0);
+  double clock_mhz = strtod(get_plusarg("clock_mhz", "1000").c_str(), nullptr);
+  std::string format = get_plusarg("format", "node");
+  std::string mainq = get_plusarg("mainq", "?");
+  std::string bufq = get_plusarg("bufq", "?");
+  std::string early = get_plusarg("early", "?");
+  bool csv = context->commandArgsPlusMatch("csv")[0] != '\0';
+  bool csr = (format == "csr");
+
+  top = new Vtop(context);
+  dram = new DRAM(context, -9);
+  if(!dram->initialized()) {
+    fprintf(stderr, "ERROR: dramsim failed to initialize\n");
+    error = true;
+    goto cleanup;
+  }
+
+  context->time(0);
+  top->top->clk = 0;
+  top->top->rst = 1;
+  top->top->csr_valid = 0;
+  top->top->csr_wen = 0;
+
+  for(uint32_t size : sizes) {
+    for(uint32_t degree : degrees) {
+      Graph graph;
+      build_graph(&graph, size, degree, seed);
+      std::mt19937 rng(seed ^ size ^ (degree << 16));
+
+      uint64_t total_cycles = 0, total_edges = 0, total_spill = 0, total_restore = 0;
+      for(uint32_t s = 0; s < searches; s++) {
+        uint32_t root = rng() % size;
+        uint64_t vertices, edges;
+        load_graph(&graph, csr);
+        host_bfs(&graph, root, &vertices, &edges);
+
+        if(!run_search(&graph, root, csr)) {
+          fprintf(stderr, "ERROR: search from %u timed out (size %u, degree %u)\n",
+                  root, size, degree);
+          error = true;
+          goto cleanup;
+        }
+        if(counters.deq - counters.marked != vertices) {
+          fprintf(stderr, "ERROR: visited %lu vertices, expected %lu (size %u, degree %u, root %u)\n",
+                  counters.deq - counters.marked, vertices, size, degree, root);
+          error = true;
+        }
+        total_cycles += counters.cycles;
+        total_edges += edges;
+        total_spill += counters.spill;
+        total_restore += counters.restore;
+      }
+
+      double edges_per_kcycle = total_cycles ? (1000.0 * total_edges / total_cycles) : 0;
+      double mteps = edges_per_kcycle * clock_mhz / 1000.0;
+      if(csv) {
+        printf("%s,%u,%u,%s,%s,%s,%u,%lu,%lu,%.2f,%.2f,%lu,%lu\n", format.c_str(),
+               size, degree, mainq.c_str(), bufq.c_str(), early.c_str(), searches,
+               total_cycles, total_edges, edges_per_kcycle, mteps, total_spill,
+               total_restore);
+      } else {
+        printf("size %u degree %u: %lu edges in %lu cycles, %.2f edges/kcycle, "
+               "%.2f MTEPS @ %.0fMHz, %lu spills, %lu restores", size, degree,
+               total_edges, total_cycles, edges_per_kcycle, mteps, clock_mhz,
+               total_spill, total_restore);
+        if(!csr && graph.blocks) {printf(", %u overflow blocks", graph.blocks);}
+        putchar('\n');
+      }
+    }
+  }
+
+ cleanup:
+  top->final();
+  delete dram;
+  delete top;
+  delete context;
+  return error ? 1 : 0;
+}
+
+// DPI functions
+extern "C" {
+
+// dramctl <-> dramsim interface
+svBit dramsim_cmdready(const svBit write, const svBitVecVal* addr) {
+  return dram->cmdready(write, *addr << 2);
+}
+
+void dramsim_cmddata(const svBit write, const svBitVecVal* tag,
+                     const svBitVecVal* addr, const svBitVecVal* data) {
+  dram->cmddata(write, *tag, *addr << 2, data);
+}
+
+svBit dramsim_respready() {
+  return dram->respready();
+}
+
+void dramsim_respdata(svBitVecVal* tag, svBitVecVal* addr, svBitVecVal* data) {
+  resp_t resp;
+  dram->respdata(&resp);
+
+  *tag = resp.tag;
+  *addr = resp.addr >> 2;
+  for(int i = 0; i < 8; i++) {
+    data[(i*2)] = resp.line.data[i];
+    data[(i*2)+1] = resp.line.data[i] >> 32;
+  }
+}
+
+// testbench functions
+int tb_log_bfs_done(const svBitVecVal* deq, const svBitVecVal* enq,
+                    const svBitVecVal* marked, const svBitVecVal* spill,
+                    const svBitVecVal* restore, const svBitVecVal* qstall,
+                    const svBitVecVal* dcwait, const svBitVecVal* cycles,
+                    const svBitVecVal* prefetches) {
+  counters.deq = *deq;
+  counters.enq = *enq;
+  counters.marked = *marked;
+  counters.spill = *spill;
+  counters.restore = *restore;
+  counters.qstall = *qstall;
+  counters.dcwait = *dcwait;
+  counters.cycles = *cycles;
+  counters.prefetches = *prefetches;
+  counters.valid = true;
+  return 0;
+}
+
+int tb_log_bus_cycle(svBit nack, svBit hit, const svBitVecVal* cmd,
+                     const svBitVecVal* tag, const svBitVecVal* addr) {
+  return 0;
+}
+
+int tb_log_bus_data(const svBitVecVal* index, const svBitVecVal* data) {
+  return 0;
+}
+
+int tb_log_l2bank(const svBitVecVal* busid, const svBitVecVal* bank,
+                  const svBitVecVal* busy, const svBitVecVal* stall) {
+  return 0;
+}
+
+}
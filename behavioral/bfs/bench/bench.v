@@ -0,0 +1,210 @@
+`include "buscmd.vh"
+
+// standalone bfs accelerator bench: bfs_core and its l2 on the main bus,
+// with dramctl as the only other agent (driven by bench.cc)
+module top #(
+  parameter MAINQ_SIZE = 128,
+  parameter BUFQ_SIZE = 64,
+  parameter EARLY_RESTORE = 1
+  )();
+
+  reg clk/*verilator public*/;
+  reg rst/*verilator public*/;
+
+  // csr port
+  reg        csr_valid/*verilator public*/;
+  reg [4:0]  csr_addr/*verilator public*/;
+  reg        csr_wen/*verilator public*/;
+  reg [31:0] csr_wdata/*verilator public*/;
+
+  wire        bfs_csr_valid/*verilator public*/;
+  wire        bfs_csr_error/*verilator public*/;
+  wire [31:0] bfs_csr_rdata/*verilator public*/;
+  wire        bfs_csr_irq/*verilator public*/;
+
+  import "DPI-C" task tb_log_bfs_done(input bit [31:0] deq, input bit [31:0] enq, input bit [31:0] marked, input bit [31:0] spill, input bit [31:0] restore, input bit [31:0] qstall, input bit [31:0] dcwait, input bit [31:0] cycles, input bit [31:0] prefetches);
+  import "DPI-C" task tb_log_bus_cycle(input bit nack, input bit hit, input bit [2:0] cmd, input bit [4:0] tag, input bit [31:6] addr);
+  import "DPI-C" task tb_log_bus_data(input bit [2:0] index, input bit [63:0] data);
+  import "DPI-C" task tb_log_l2bank(input bit [1:0] busid, input bit [1:0] bank, input bit [31:0] busy, input bit [31:0] stall);
+
+  // accelerator <-> l2
+  wire        bfs_dc_req;
+  wire [1:0]  bfs_dc_op;
+  wire [31:0] bfs_dc_addr;
+  wire [7:0]  bfs_dc_wmask;
+  wire [63:0] bfs_dc_wdata;
+  wire        dc_ready;
+  wire        dc_valid;
+  wire [1:0]  dc_op;
+  wire [31:6] dc_addr;
+  wire [63:0] dc_rdata;
+  wire        dc_rbuf_empty;
+
+  // bus
+  wire        bfs_bus_req;
+  wire [2:0]  bfs_bus_cmd;
+  wire [4:0]  bfs_bus_tag;
+  wire [31:6] bfs_bus_addr;
+  wire [63:0] bfs_bus_data;
+  wire        bfs_bus_hit;
+  wire        bfs_bus_nack;
+  wire        bus_bfs_grant;
+
+  wire        dramctl_bus_req;
+  wire [2:0]  dramctl_bus_cmd;
+  wire [4:0]  dramctl_bus_tag;
+  wire [31:6] dramctl_bus_addr;
+  wire [63:0] dramctl_bus_data;
+  wire        dramctl_bus_nack;
+  wire        bus_dramctl_grant;
+
+  wire        bus_valid;
+  wire        bus_nack;
+  wire        bus_hit;
+  wire [2:0]  bus_cmd;
+  wire [4:0]  bus_tag;
+  wire [31:6] bus_addr;
+  wire [63:0] bus_data;
+
+  bfs_core #(.MAINQ_SIZE(MAINQ_SIZE), .BUFQ_SIZE(BUFQ_SIZE),
+             .EARLY_RESTORE(EARLY_RESTORE)) bfs(
+    .clk(clk),
+    .rst(rst),
+    .csr_bfs_valid(csr_valid),
+    .csr_bfs_addr(csr_addr),
+    .csr_bfs_wen(csr_wen),
+    .csr_bfs_wdata(csr_wdata),
+    .bfs_csr_valid(bfs_csr_valid),
+    .bfs_csr_error(bfs_csr_error),
+    .bfs_csr_rdata(bfs_csr_rdata),
+    .bfs_csr_irq(bfs_csr_irq),
+    .bfs_dc_req(bfs_dc_req),
+    .bfs_dc_op(bfs_dc_op),
+    .bfs_dc_addr(bfs_dc_addr),
+    .bfs_dc_wmask(bfs_dc_wmask),
+    .bfs_dc_wdata(bfs_dc_wdata),
+    .dc_ready(dc_ready),
+    .dc_valid(dc_valid),
+    .dc_op(dc_op),
+    .dc_addr(dc_addr),
+    .dc_rdata(dc_rdata),
+    .dc_rbuf_empty(dc_rbuf_empty),
+    .cpu_st_pending(1'b0),
+    .bus_valid(bus_valid));
+
+  // bfs_core takes each line from beat 0 and matches responses to requests
+  // in order, which only one bank keeps
+  l2 #(.BUSID(`BUSID_BFS), .BANKS(1), .CWF(0)) bfsl2(
+    .clk(clk),
+    .rst(rst),
+    .req_valid(bfs_dc_req),
+    .req_pf(1'b0),
+    .req_ifetch(1'b0),
+    .req_op(bfs_dc_op),
+    .req_addr(bfs_dc_addr[31:2]),
+    .req_wmask(bfs_dc_wmask),
+    .req_wdata(bfs_dc_wdata),
+    .l2_req_ready(dc_ready),
+    .l2_resp_valid(dc_valid),
+    .l2_resp_error(),
+    .l2_resp_ifetch(),
+    .l2_resp_op(dc_op),
+    .l2_resp_addr(dc_addr),
+    .l2_resp_beat(),
+    .l2_resp_rdata(dc_rdata),
+    .resp_ready(1'b1),
+    .l2_inv_valid(),
+    .l2_inv_addr(),
+    .inv_ready(1'b1),
+    .l2_idle(dc_rbuf_empty),
+    .l2_rd_miss(),
+    .l2_pf_fill(),
+    .l2_pf_hit(),
+    .l2_pf_late(),
+    .l2_bus_req(bfs_bus_req),
+    .l2_bus_cmd(bfs_bus_cmd),
+    .l2_bus_tag(bfs_bus_tag),
+    .l2_bus_addr(bfs_bus_addr),
+    .l2_bus_data(bfs_bus_data),
+    .l2_bus_hit(bfs_bus_hit),
+    .l2_bus_nack(bfs_bus_nack),
+    .bus_l2_grant(bus_bfs_grant),
+    .bus_valid(bus_valid),
+    .bus_nack(bus_nack),
+    .bus_cmd(bus_cmd),
+    .bus_tag(bus_tag),
+    .bus_addr(bus_addr),
+    .bus_data(bus_data));
+
+  // core l2s and rom are not present
+  bus bus(
+    .clk(clk),
+    .rst(rst),
+    .l2_bus_req(1'b0),
+    .l2_bus_cmd(3'b0),
+    .l2_bus_tag(5'b0),
+    .l2_bus_addr(26'b0),
+    .l2_bus_data(64'b0),
+    .l2_bus_hit(1'b0),
+    .l2_bus_nack(1'b0),
+    .bus_l2_grant(),
+    .bfs_bus_req(bfs_bus_req),
+    .bfs_bus_cmd(bfs_bus_cmd),
+    .bfs_bus_tag(bfs_bus_tag),
+    .bfs_bus_addr(bfs_bus_addr),
+    .bfs_bus_data(bfs_bus_data),
+    .bfs_bus_hit(bfs_bus_hit),
+    .bfs_bus_nack(bfs_bus_nack),
+    .bus_bfs_grant(bus_bfs_grant),
+    .l2_1_bus_req(1'b0),
+    .l2_1_bus_cmd(3'b0),
+    .l2_1_bus_tag(5'b0),
+    .l2_1_bus_addr(26'b0),
+    .l2_1_bus_data(64'b0),
+    .l2_1_bus_hit(1'b0),
+    .l2_1_bus_nack(1'b0),
+    .bus_l2_1_grant(),
+    .dramctl_bus_req(dramctl_bus_req),
+    .dramctl_bus_cmd(dramctl_bus_cmd),
+    .dramctl_bus_tag(dramctl_bus_tag),
+    .dramctl_bus_addr(dramctl_bus_addr),
+    .dramctl_bus_data(dramctl_bus_data),
+    .dramctl_bus_nack(dramctl_bus_nack),
+    .bus_dramctl_grant(bus_dramctl_grant),
+    .rom_bus_req(1'b0),
+    .rom_bus_cmd(3'b0),
+    .rom_bus_tag(5'b0),
+    .rom_bus_addr(26'b0),
+    .rom_bus_data(64'b0),
+    .rom_bus_nack(1'b0),
+    .bus_rom_grant(),
+    .bus_valid(bus_valid),
+    .bus_nack(bus_nack),
+    .bus_hit(bus_hit),
+    .bus_cmd(bus_cmd),
+    .bus_tag(bus_tag),
+    .bus_addr(bus_addr),
+    .bus_data(bus_data),
+    .bus_l2_fill(),
+    .bus_l2_1_fill(),
+    .bus_bfs_win());
+
+  dramctl dramctl(
+    .clk(clk),
+    .rst(rst),
+    .bus_valid(bus_valid),
+    .bus_nack(bus_nack),
+    .bus_hit(bus_hit),
+    .bus_cmd(bus_cmd),
+    .bus_tag(bus_tag),
+    .bus_addr(bus_addr),
+    .bus_data(bus_data),
+    .dramctl_bus_req(dramctl_bus_req),
+    .dramctl_bus_cmd(dramctl_bus_cmd),
+    .dramctl_bus_tag(dramctl_bus_tag),
+    .dramctl_bus_addr(dramctl_bus_addr),
+    .dramctl_bus_data(dramctl_bus_data),
+    .dramctl_bus_nack(dramctl_bus_nack),
+    .bus_dramctl_grant(bus_dramctl_grant));
+
+endmodule
@@ -1,23 +1,37 @@
 `include "buscmd.vh"
 
-module bfs_core (
+// queue depths (rows of two entries), set from the build
+`ifndef BFS_MAINQ_SIZE
+`define BFS_MAINQ_SIZE 128
+`endif
+`ifndef BFS_BUFQ_SIZE
+`define BFS_BUFQ_SIZE 64
+`endif
+
+module bfs_core #(
+  parameter MAINQ_SIZE = `BFS_MAINQ_SIZE,
+  parameter BUFQ_SIZE = `BFS_BUFQ_SIZE,
+  parameter EARLY_RESTORE = 1
+  )(
   input             clk,
   input             rst,
 
   // csr interface
   input             csr_bfs_valid,
-  input [3:0]       csr_bfs_addr,
+  input [4:0]       csr_bfs_addr,
   input             csr_bfs_wen,
   input [31:0]      csr_bfs_wdata,
   output reg        bfs_csr_valid,
   output reg        bfs_csr_error,
   output reg [31:0] bfs_csr_rdata,
+  output reg        bfs_csr_irq,
 
   // cache interface
   output            bfs_dc_req,
   output reg [1:0]  bfs_dc_op,
   output reg [31:0] bfs_dc_addr,
-  output [63:0]     bfs_dc_wdata,
+  output reg [7:0]  bfs_dc_wmask,
+  output reg [63:0] bfs_dc_wdata,
   input             dc_ready,
 
   input             dc_valid,
@@ -25,7 +39,13 @@ module bfs_core (
   input [31:6]      dc_addr,
   input [63:0]      dc_rdata,
 
-  input             dc_rbuf_empty);
+  input             dc_rbuf_empty,
+
+  // cpu store interface: stores still on their way to the cpu's l2
+  input             cpu_st_pending,
+
+  // bus occupancy, for the prefetch throttle
+  input             bus_valid);
 
   localparam
     IDLE = 2'b00,
@@ -34,12 +54,45 @@ module bfs_core (
     ADD_NEIGHS = 2'b11;
 
   localparam
-    REG_STAT  = 4'd0,
-    REG_ROOT  = 4'd1,
-    REG_TARG  = 4'd2,
-    REG_QBASE = 4'd3,
-    REG_QSIZE = 4'd4,
-    REG_RESULT = 4'd5;
+    REG_STAT  = 5'd0,
+    REG_ROOT  = 5'd1,
+    REG_TARG  = 5'd2,
+    REG_QBASE = 5'd3,
+    REG_QSIZE = 5'd4,
+    REG_RESULT = 5'd5,
+    REG_NBASE = 5'd6,
+    REG_PBASE = 5'd7,
+    REG_OBASE = 5'd8,
+    REG_EBASE = 5'd9,
+    REG_VBASE = 5'd10,
+    REG_PFCFG = 5'd11;
+
+  // performance counters (read-only, cleared on start)
+  localparam
+    REG_CTR_DEQ     = 5'h10,
+    REG_CTR_ENQ     = 5'h11,
+    REG_CTR_MARKED  = 5'h12,
+    REG_CTR_SPILL   = 5'h13,
+    REG_CTR_RESTORE = 5'h14,
+    REG_CTR_QSTALL  = 5'h15,
+    REG_CTR_DCWAIT  = 5'h16,
+    REG_CTR_CYCLES  = 5'h17,
+    REG_CTR_PF      = 5'h18;
+
+  // stat write bits
+  localparam
+    CTL_START = 0,
+    CTL_PARENTS = 8,
+    CTL_CSR = 9;
+
+  // csr-format expansion states
+  localparam
+    X_IDLE = 3'd0,
+    X_OFF = 3'd1,
+    X_OFF2 = 3'd2,
+    X_OFF2_WAIT = 3'd3,
+    X_EDGE = 3'd4,
+    X_EDGE_WAIT = 3'd5;
 
   reg[2:0] dc_beat;
   always @(posedge clk)
@@ -65,18 +118,83 @@ module bfs_core (
   wire q_full, rq_empty;
   wire pend_empty;
   wire spill_req;
+  wire spill_hold;
+  wire restore_busy;
   wire spill_done;
   wire spill_init;
   wire spill_op;
   wire [63:0] spill_data;
 
+  // Software queue (spilled lines between swq_head and swq_tail)
+  reg[31:0] swq_tail;
+  reg[31:0] swq_head;
+
+  // Parent tracking (pq: in-flight marks, pw: pending parent writes)
+  wire pq_ready, pq_valid;
+  wire [31:0] pq_data;
+  wire pw_valid;
+  wire [31:0] pw_data;
+  wire pw_req;
+  wire pw_room;
+
+  // Marks issued and not yet answered
+  reg [4:0] mark_ct;
+
+  // Level order (node parent mode): lvl_deq entries are left in the level
+  // being dequeued, lvl_enq entries have been added for the next one
+  reg [31:0] lvl_deq;
+  reg [31:0] lvl_enq;
+  wire lvl_order;
+  wire lvl_next;
+
+  // CSR-format expansion (xq: unvisited vertices waiting to be expanded)
+  wire xq_valid;
+  wire [31:0] xq_data;
+  wire x_req;
+  wire x_idle;
+  wire rd_busy;
+  reg [5:0] rd_ct;
+
+  // Overflow edge blocks (ovq: {owner id, block address} to read,
+  // ovp: owner ids of block reads in flight)
+  wire ovq_valid;
+  wire ovq_push;
+  wire [47:0] ovq_data;
+  wire ovp_ready, ovp_valid;
+  wire [15:0] ovp_data;
+  wire ov_req;
+  wire blk_resp;
+  wire ov_room;
+
+  // Line being added: overflow flag and owner node id (for parent entries)
+  reg add_ovf;
+  reg [15:0] add_owner;
+
+  // Neighbor prefetch (pf: enqueued entries waiting to be prefetched)
+  wire pf_valid;
+  wire [65:0] pf_data;
+  wire pf_req;
+
+  // Read kinds in issue order (rdk_pf: the next non-restore OP_RD response
+  // is a prefetch; pf_beat: the current beat belongs to one)
+  wire rdk_ready, rdk_valid;
+  wire rdk_pf;
+  wire pf_beat;
+
+  // Mark responses (rdata_valid: node was not yet visited)
+  wire mark_resp;
+  wire rdata_valid;
+
   assign q_rst = rst | done;
-  assign deq_req = (~rq_empty & dc_ready & ~spill_req);
 
-  bfs_queue #(.MAINQ_SIZE(16), .BUFQ_SIZE(16)) q (
+  bfs_queue #(.MAINQ_SIZE(MAINQ_SIZE), .BUFQ_SIZE(BUFQ_SIZE),
+              .EARLY_RESTORE(EARLY_RESTORE)) q (
     .clk (clk),
     .bfs_rst (q_rst),
     .active (active),
+    .rd_busy (rd_busy),
+    .rd_ahead (rd_ct - {5'b0,dc_fs}),
+    .swq_empty (swq_head === swq_tail),
     .enqueue_req (enq_req),
     .wdata_in (enq_data),
     .dequeue_req (deq_req),
@@ -85,10 +203,13 @@ module bfs_core (
     .rqueue_empty (rq_empty),
     .pend_empty (pend_empty),
     .spill_req (spill_req),
+    .spill_hold (spill_hold),
+    .restore_busy (restore_busy),
     .spill_done (spill_done),
     .spill_op (spill_op),
     .spill_data (spill_data),
     .dc_valid (dc_valid),
+    .dc_first (dc_fs),
     .dc_op (dc_op),
     .dc_ready (dc_ready),
     .dc_rdata (dc_rdata),
@@ -100,12 +221,54 @@ module bfs_core (
   reg[31:0] sw_queue_base;
   reg[31:0] sw_queue_size;
   reg[31:0] result;
+  reg[31:0] node_base;
+  reg[31:0] parent_base;
+  reg[31:0] offset_base;
+  reg[31:0] edge_base;
+  reg[31:0] visited_base;
+  reg[31:0] pf_cfg;
+  reg       parent_mode;
+  reg       csr_mode;
+
+  // writing 1 to stat starts a search, any write acknowledges the irq
+  wire stat_write;
+  assign stat_write = csr_bfs_valid & csr_bfs_wen & (csr_bfs_addr == REG_STAT);
 
   wire start;
-  assign start = csr_bfs_valid & csr_bfs_wen & (csr_bfs_addr == REG_STAT);
+  assign start = stat_write & csr_bfs_wdata[CTL_START];
+
+  always @(posedge clk)
+    if (rst) begin
+      parent_mode <= 0;
+      csr_mode <= 0;
+    end else if (start) begin
+      parent_mode <= csr_bfs_wdata[CTL_PARENTS];
+      csr_mode <= csr_bfs_wdata[CTL_CSR];
+    end
+
+  // The l1 is write-through, so the only cpu data the bus cannot see yet are
+  // stores still draining from the lsq, dcache and l2fifo. Hold the first
+  // dequeue after a start until they have reached the l2, which makes them
+  // visible to bfsl2 through the bus (no ML2STAT flush needed before a search).
+  reg st_fence;
+  always @(posedge clk)
+    if (rst)
+      st_fence <= 0;
+    else if (start)
+      st_fence <= 1;
+    else if (~cpu_st_pending)
+      st_fence <= 0;
+
+  assign deq_req = (~rq_empty & dc_ready & ~spill_hold & ~st_fence & pw_room & pq_ready &
+                    ~pf_req & ~ovq_valid & ov_room & (~lvl_order | (lvl_deq != 0)) &
+                    (~csr_mode | (x_idle & ~xq_valid)));
+
+  always @(posedge clk)
+    if (rst)
+      mark_ct <= 0;
+    else
+      mark_ct <= mark_ct + {4'b0,deq_req} - {4'b0,dc_fs & (dc_op == `OP_MARK)};
 
-  reg[31:0] swq_tail;
-  reg[31:0] swq_head;
   always @(posedge clk)
     if (q_rst | start) begin
       swq_head <= sw_queue_base;
@@ -117,21 +280,355 @@ module bfs_core (
         swq_tail <= swq_tail + 64;
     end
 
+  // In parent mode, queue entries are {parent id, node id} (16 bits each)
+  // where a node's id is its offset from node_base in 64-byte lines
+  // (or its vertex number in csr mode)
+  function [15:0] node_id(input [31:0] addr);
+    reg [31:0] offset;
+    begin
+      offset = addr - node_base;
+      node_id = offset[21:6];
+    end
+  endfunction
+
+  // In csr mode, queue entries are vertex numbers and marks go to a bytemap
+  function [31:0] entry_id(input [31:0] entry);
+    entry_id = parent_mode ? {16'b0,entry[15:0]} : entry;
+  endfunction
+
+  // Address marked when an entry is dequeued
+  function [31:0] entry_addr(input [31:0] entry);
+    entry_addr = csr_mode ? visited_base + entry_id(entry) :
+                 parent_mode ? node_base + {entry[15:0],6'b0} : entry;
+  endfunction
+
+  wire [31:0] deq_addr;
+  assign deq_addr = entry_addr(deq_data);
+
+  wire [15:0] cur_id;
+  assign cur_id = node_id({dc_addr,6'b0});
+
+  // Entries of in-flight marks (dequeue limited by depth)
+  fifo #(.WIDTH(32), .DEPTH(8)) pq (
+    .clk (clk),
+    .rst (q_rst),
+    .wr_valid (deq_req & (parent_mode | csr_mode)),
+    .wr_ready (pq_ready),
+    .wr_data (deq_data),
+    .rd_valid (pq_valid),
+    .rd_ready (mark_resp),
+    .rd_data (pq_data));
+
+  wire [31:0] pq_id;
+  assign pq_id = entry_id(pq_data);
+
+  // Mark response: the header beat, or the beat holding the bytemap entry
+  // (mark_taken: the entry for this burst has already been handled)
+  reg mark_taken;
+  always @(posedge clk)
+    if (rst)
+      mark_taken <= 0;
+    else if (dc_valid)
+      mark_taken <= (dc_beat != 3'd7) & (mark_taken | mark_resp);
+
+  assign mark_resp = dc_valid & (dc_op == `OP_MARK) &
+                     (csr_mode ? (dc_beat == pq_id[5:3]) & ~mark_taken : dc_fs);
+
+  // CSR-format expansion: read offsets[v], offsets[v+1], then stream the
+  // edge lines between them into the queue
+  reg [2:0]  x_state;
+  reg [31:0] x_entry;
+  reg [31:0] x_start;
+  reg [31:0] x_end;
+
+  wire [31:0] x_id;
+  assign x_id = entry_id(x_entry);
+
+  wire [31:0] xq_id;
+  assign xq_id = entry_id(xq_data);
+
+  fifo #(.WIDTH(32), .DEPTH(8)) xq (
+    .clk (clk),
+    .rst (q_rst),
+    .wr_valid (rdata_valid & active & csr_mode),
+    .wr_ready (),
+    .wr_data (pq_data),
+    .rd_valid (xq_valid),
+    .rd_ready (x_idle & x_req & dc_ready),
+    .rd_data (xq_data));
+
+  assign x_idle = (x_state == X_IDLE);
+  assign x_req = ~spill_hold & rdk_ready &
+                 ((x_idle & xq_valid) | (x_state == X_OFF2) |
+                  ((x_state == X_EDGE) & (x_start < x_end)));
+  assign rd_busy = pq_valid | xq_valid | ~x_idle | ovq_push | ovq_valid | ovp_valid |
+                   rdk_valid;
+
+  // Reads (marks, expansion, block, prefetch and restore reads) whose
+  // response has not started yet; a restore skips that many bursts to find
+  // its data
+  always @(posedge clk)
+    if (rst)
+      rd_ct <= 0;
+    else
+      rd_ct <= rd_ct + {5'b0,dc_ready & (deq_req | x_req | ov_req | pf_req | (spill_req & spill_op))} -
+               {5'b0,dc_fs};
+
+  // restore and prefetch data is also OP_RD; restore_busy and pf_beat mark
+  // their beats
+  wire x_resp;
+  assign x_resp = dc_valid & (dc_op == `OP_RD) & ~restore_busy & ~pf_beat;
+
+  // offsets[v+1] is in the next beat, or the next line if v is last in its line
+  wire [2:0] x_off_beat;
+  assign x_off_beat = x_id[3:1];
+
+  // edge indices held by the current beat of an edge line
+  wire [31:0] edge_idx_lo, edge_idx_hi;
+  assign edge_idx_lo = {x_start[31:4], dc_beat, 1'b0};
+  assign edge_idx_hi = {x_start[31:4], dc_beat, 1'b1};
+
+  wire edge_lo, edge_hi;
+  assign edge_lo = (edge_idx_lo >= x_start) & (edge_idx_lo < x_end);
+  assign edge_hi = (edge_idx_hi >= x_start) & (edge_idx_hi < x_end);
+
+  wire [31:0] edge_entry_lo, edge_entry_hi;
+  assign edge_entry_lo = parent_mode ? {x_id[15:0], dc_rdata[15:0]} : dc_rdata[31:0];
+  assign edge_entry_hi = parent_mode ? {x_id[15:0], dc_rdata[47:32]} : dc_rdata[63:32];
+
+  wire edge_beat;
+  assign edge_beat = (x_state == X_EDGE_WAIT) & x_resp;
+
+  always @(posedge clk)
+    if (q_rst)
+      x_state <= X_IDLE;
+    else
+      case(x_state)
+        X_IDLE:
+          if (x_req & dc_ready) begin
+            x_entry <= xq_data;
+            x_state <= X_OFF;
+          end
+        X_OFF:
+          if (x_resp) begin
+            if (dc_beat == x_off_beat) begin
+              x_start <= x_id[0] ? dc_rdata[63:32] : dc_rdata[31:0];
+              if (~x_id[0])
+                x_end <= dc_rdata[63:32];
+            end
+            if (x_id[0] & (x_off_beat != 3'd7) & (dc_beat == x_off_beat + 3'd1))
+              x_end <= dc_rdata[31:0];
+            if (dc_beat == 3'd7)
+              x_state <= (x_id[3:0] == 4'hf) ? X_OFF2 : X_EDGE;
+          end
+        X_OFF2:
+          if (x_req & dc_ready)
+            x_state <= X_OFF2_WAIT;
+        X_OFF2_WAIT:
+          if (x_resp) begin
+            if (dc_beat == 3'd0)
+              x_end <= dc_rdata[31:0];
+            if (dc_beat == 3'd7)
+              x_state <= X_EDGE;
+          end
+        X_EDGE:
+          if (x_start >= x_end)
+            x_state <= X_IDLE;
+          else if (x_req & dc_ready)
+            x_state <= X_EDGE_WAIT;
+        X_EDGE_WAIT:
+          if (x_resp & (dc_beat == 3'd7)) begin
+            x_start <= {x_start[31:4] + 28'd1, 4'b0};
+            x_state <= X_EDGE;
+          end
+        default:
+          x_state <= X_IDLE;
+      endcase
+
+  reg [31:0] x_addr;
+  always @(*)
+    case(x_state)
+      X_IDLE: x_addr = offset_base + {xq_id[29:0],2'b0};
+      X_OFF2: x_addr = offset_base + {x_id[29:0] + 30'd1,2'b0};
+      default: x_addr = edge_base + {x_start[29:0],2'b0};
+    endcase
+
+  // Neighbor prefetch: newly enqueued entries are fetched into the l2 with
+  // a plain OP_RD, so the line is already present when its OP_MARK arrives.
+  // The line is only read shared, so a prefetch never takes it away from
+  // the core l2; the response burst is dropped.
+  // pf_cfg[4:0]: distance, entries buffered for prefetch (0 disables)
+  // pf_cfg[15:8]: throttle, no prefetches while the bus was busy more than
+  // this many of the last 64 cycles (0: unthrottled)
+  wire [4:0] pf_dist;
+  wire [7:0] pf_busy_max;
+  assign pf_dist = pf_cfg[4:0];
+  assign pf_busy_max = pf_cfg[15:8];
+
+  reg [4:0] pf_count;
+  reg       pf_slot;
+
+  // bus occupancy over the current and the last 64-cycle window
+  reg [5:0] win_cycle;
+  reg [6:0] win_busy;
+  reg [6:0] bus_busy;
+
+  wire pf_throttle;
+  assign pf_throttle = (pf_busy_max != 0) & ({1'b0,bus_busy} > pf_busy_max);
+
+  wire pf_push, pf_pop, pf_issue;
+  assign pf_push = active & (|enq_req) & (pf_count < pf_dist) & ~pf_count[4];
+  assign pf_issue = pf_req & dc_ready;
+  assign pf_pop = pf_issue & (~&pf_data[65:64] | pf_slot);
+
+  fifo #(.WIDTH(66), .DEPTH(16)) pf (
+    .clk (clk),
+    .rst (q_rst),
+    .wr_valid (pf_push),
+    .wr_ready (),
+    .wr_data ({enq_req, enq_data}),
+    .rd_valid (pf_valid),
+    .rd_ready (pf_pop),
+    .rd_data (pf_data));
+
+  // Prefetch takes priority over dequeue while the bus has room for it
+  assign pf_req = pf_valid & ~pf_throttle & ~spill_hold & rdk_ready & ~x_req & ~ov_req;
+
+  // Responses come back in order, so each non-restore read records whether
+  // it was a prefetch; its first beat pops the record, and the rest of the
+  // burst follows pf_burst
+  wire rd_first;
+  assign rd_first = dc_fs & (dc_op == `OP_RD) & ~restore_busy;
+
+  fifo #(.WIDTH(1), .DEPTH(32)) rdk (
+    .clk (clk),
+    .rst (rst),
+    .wr_valid (dc_ready & (x_req | ov_req | pf_req)),
+    .wr_ready (rdk_ready),
+    .wr_data (pf_req),
+    .rd_valid (rdk_valid),
+    .rd_ready (rd_first),
+    .rd_data (rdk_pf));
+
+  reg pf_burst;
+
+  always @(posedge clk)
+    if (rst)
+      pf_burst <= 0;
+    else if (dc_fs)
+      pf_burst <= rd_first & rdk_pf;
+
+  assign pf_beat = dc_valid & (dc_fs ? rd_first & rdk_pf : pf_burst);
+
+  wire [31:0] pf_addr;
+  assign pf_addr = entry_addr((&pf_data[65:64] & ~pf_slot) ? pf_data[63:32] : pf_data[31:0]);
+
+  // prefetch is off unless configured
+  always @(posedge clk)
+    if (rst)
+      pf_cfg <= 0;
+    else if (csr_bfs_valid & csr_bfs_wen & (csr_bfs_addr == REG_PFCFG))
+      pf_cfg <= csr_bfs_wdata;
+
+  always @(posedge clk)
+    if (q_rst) begin
+      pf_count <= 0;
+      pf_slot <= 0;
+    end else begin
+      pf_count <= pf_count + {4'b0,pf_push} - {4'b0,pf_pop};
+      if (pf_issue)
+        pf_slot <= ~pf_pop;
+    end
+
+  always @(posedge clk)
+    if (rst) begin
+      win_cycle <= 0;
+      win_busy <= 0;
+      bus_busy <= 0;
+    end else begin
+      win_cycle <= win_cycle + 1;
+      if (win_cycle == 63) begin
+        win_busy <= 0;
+        bus_busy <= win_busy + {6'b0,bus_valid};
+      end else
+        win_busy <= win_busy + {6'b0,bus_valid};
+    end
+
+  // Overflow edge blocks: a node line with the overflow flag holds
+  // N_MAX-1 edges and a pointer to a 64-byte block in its last slot. The
+  // block has the same header layout (edge count and flag in word 1), so
+  // blocks chain the same way. Block reads are plain OP_RD, which tells
+  // their responses apart from node marks.
+  fifo #(.WIDTH(48), .DEPTH(16)) ovq (
+    .clk (clk),
+    .rst (q_rst),
+    .wr_valid (ovq_push),
+    .wr_ready (),
+    .wr_data ({add_owner, dc_rdata[63:32]}),
+    .rd_valid (ovq_valid),
+    .rd_ready (ov_req & dc_ready),
+    .rd_data (ovq_data));
+
+  fifo #(.WIDTH(16), .DEPTH(16)) ovp (
+    .clk (clk),
+    .rst (q_rst),
+    .wr_valid (ov_req & dc_ready),
+    .wr_ready (ovp_ready),
+    .wr_data (ovq_data[47:32]),
+    .rd_valid (ovp_valid),
+    .rd_ready (blk_resp),
+    .rd_data (ovp_data));
+
+  assign ov_req = ovq_valid & ovp_ready & rdk_ready & ~spill_hold & ~x_req;
+  assign blk_resp = dc_fs & (dc_op == `OP_RD) & ~restore_busy & ~csr_mode & ~pf_beat;
+
+  // Responses cannot be held off, so ovq always has room for the pushes that
+  // can still come: one per mark in flight and per block queued or being
+  // read, plus one for the line being added, whose mark has already
+  // returned. Dequeues wait while that could exceed its depth.
+  reg [4:0] ov_blocks;
+
+  always @(posedge clk)
+    if (q_rst)
+      ov_blocks <= 0;
+    else
+      ov_blocks <= ov_blocks + {4'b0,ovq_push} - {4'b0,blk_resp & ovp_valid};
+
+  wire [5:0] ov_used;
+  assign ov_used = {1'b0,mark_ct} + {1'b0,ov_blocks};
+  assign ov_room = ov_used < 6'd15;
+
   // Cache
-  assign bfs_dc_req = deq_req | spill_req;
-  assign bfs_dc_wdata = spill_data;
+  assign bfs_dc_req = deq_req | spill_req | pw_req | x_req | ov_req | pf_req;
   // Address
   always @(*) begin
-    casez({spill_req, spill_op})
-      2'b0?: bfs_dc_addr = deq_data;
-      2'b10: bfs_dc_addr = swq_tail;
-      2'b11: bfs_dc_addr = swq_head;
+    casez({spill_req, spill_op, pw_req, x_req, ov_req, pf_req})
+      6'b0?0000: bfs_dc_addr = deq_addr;
+      6'b0?0001: bfs_dc_addr = pf_addr;
+      6'b0?001?: bfs_dc_addr = ovq_data[31:0];
+      6'b0?01??: bfs_dc_addr = x_addr;
+      6'b0?1???: bfs_dc_addr = parent_base + {pw_data[15:0],2'b0};
+      6'b10????: bfs_dc_addr = swq_tail;
+      6'b11????: bfs_dc_addr = swq_head;
     endcase
 
-    if (spill_req)
+    if (spill_req) begin
       bfs_dc_op = spill_op ? `OP_RD : `OP_WR64;
-    else
+      bfs_dc_wmask = 8'b11111111;
+      bfs_dc_wdata = spill_data;
+    end else if (pw_req) begin
+      bfs_dc_op = `OP_WR4;
+      bfs_dc_wmask = bfs_dc_addr[2] ? 8'b11110000 : 8'b00001111;
+      bfs_dc_wdata = {2{16'b0,pw_data[31:16]}};
+    end else if (x_req | ov_req | pf_req) begin
+      bfs_dc_op = `OP_RD;
+      bfs_dc_wmask = 8'b00000000;
+      bfs_dc_wdata = 64'b0;
+    end else begin
       bfs_dc_op = `OP_MARK;
+      bfs_dc_wmask = csr_mode ? 8'b00000001 << bfs_dc_addr[2:0] : 8'b10000000;
+      bfs_dc_wdata = csr_mode ? {8{8'h01}} : 64'h01000000_00000000;
+    end
   end
 
   // State Machine: Queue insertion
@@ -142,23 +639,90 @@ module bfs_core (
   
   assign active = (state == NODE_HEADER | state == ADD_NEIGHS);
 
-  wire [31:0] rdata_value = dc_rdata[31:0];
+  wire [31:0] rdata_value = csr_mode ? pq_id : dc_rdata[31:0];
   wire [3:0]  rdata_neigh_ct = dc_rdata[32+:4];
-  wire        rdata_marked = dc_rdata[32+24];
+  wire        rdata_overflow = dc_rdata[32+16];
+  wire        rdata_marked = csr_mode ? dc_rdata[{pq_id[2:0],3'b0}] : dc_rdata[32+24];
 
-  wire rdata_valid;
-  assign rdata_valid = dc_fs & (dc_op == `OP_MARK) & ~rdata_marked;
+  assign rdata_valid = mark_resp & ~rdata_marked & (~csr_mode | pq_valid);
 
   wire init_add_neighs; // If it has neighbors, unmarked, and frame start
-  assign init_add_neighs = rdata_valid & (|rdata_neigh_ct);
+  assign init_add_neighs = rdata_valid & ~csr_mode & (|rdata_neigh_ct);
+
+  wire init_add_blk; // Overflow block header
+  assign init_add_blk = blk_resp & (|rdata_neigh_ct);
+
+  always @(posedge clk)
+    if (init_add_neighs | init_add_blk) begin
+      add_ovf <= rdata_overflow;
+      add_owner <= blk_resp ? ovp_data : cur_id;
+    end
   
   wire last_neigh_iter; // Either 1 or 2 neighs left
   assign last_neigh_iter = (~|neigh_ct[3:2] & ~(neigh_ct[1] & neigh_ct[0]));
 
+  // The last slot of an overflowing line is the next block's address
+  assign ovq_push = (state == ADD_NEIGHS) & last_neigh_iter & add_ovf;
+
   wire rdata_hit;
   assign rdata_hit = rdata_valid & (rdata_value == target_val);
   assign done = rdata_hit | (pend_empty & (swq_head === swq_tail));
 
+  // Parent writes for newly marked nodes (drained after completion). They
+  // take the l2 port only when nothing else wants it, so marks keep
+  // issuing behind them; dequeues wait only while the marks in flight
+  // could overfill pw.
+  wire pw_push;
+  assign pw_push = rdata_valid & active & parent_mode;
+
+  fifo #(.WIDTH(32), .DEPTH(16)) pw (
+    .clk (clk),
+    .rst (rst),
+    .wr_valid (pw_push),
+    .wr_ready (),
+    .wr_data (pq_data),
+    .rd_valid (pw_valid),
+    .rd_ready (pw_req & dc_ready),
+    .rd_data (pw_data));
+
+  assign pw_req = pw_valid & ~spill_hold & ~x_req & ~ov_req & ~pf_req & ~deq_req;
+
+  reg [4:0] pw_ct;
+  always @(posedge clk)
+    if (rst)
+      pw_ct <= 0;
+    else
+      pw_ct <= pw_ct + {4'b0,pw_push} - {4'b0,pw_req & dc_ready};
+
+  wire [5:0] pw_used;
+  assign pw_used = {1'b0,pw_ct} + {1'b0,mark_ct};
+  assign pw_room = ~parent_mode | (pw_used < 6'd16);
+
+  // Overflow blocks are read after the lines dequeued behind their node,
+  // and would add a level's entries behind the next level's. In node parent
+  // mode the next level is dequeued only once the current one has been
+  // added in full, so every node is first marked from a parent one level up.
+  assign lvl_order = parent_mode & ~csr_mode;
+  assign lvl_next = (lvl_deq == 0) & (state == NODE_HEADER) & (mark_ct == 0) &
+                    (ov_blocks == 0);
+
+  always @(posedge clk)
+    if (q_rst | start) begin
+      lvl_deq <= 0;
+      lvl_enq <= 0;
+    end else if (lvl_next) begin
+      lvl_deq <= lvl_enq;
+      lvl_enq <= 0;
+    end else begin
+      lvl_deq <= lvl_deq - {31'b0,deq_req};
+      lvl_enq <= lvl_enq + {31'b0,enq_req[1]} + {31'b0,enq_req[0]};
+    end
+
+  // Search has ended but parent writes are still in flight
+  reg draining;
+  wire drained;
+  assign drained = ~pw_valid & dc_rbuf_empty;
+
   always @(posedge clk) begin
     if (rst) begin
       state <= IDLE;
@@ -170,7 +734,7 @@ module bfs_core (
       if (rdata_hit) begin
         state <= IDLE;
         found <= 1;
-        result <= {dc_addr,6'b0};
+        result <= csr_mode ? pq_id : {dc_addr,6'b0};
       end else if (state == INIT)
         found <= 0;
     end
@@ -186,23 +750,33 @@ module bfs_core (
         if(start)
           next_state = INIT;
       INIT: begin
-        // Queue init: Insert from_node
+        // Queue init: Insert from_node (the root is its own parent)
         enq_req = 2'b01;
-        enq_data = {32'b0, from_node};
+        if (parent_mode)
+          enq_data = {32'b0, {2{csr_mode ? from_node[15:0] : node_id(from_node)}}};
+        else
+          enq_data = {32'b0, from_node};
         // Next
         next_state = NODE_HEADER;
       end
       NODE_HEADER: begin
         // Next
         next_neigh_ct = rdata_neigh_ct;
+        // Queue insertion from csr-format edge lines
+        if(edge_beat) begin
+          enq_req = (edge_lo & edge_hi) ? 2'b11 : {1'b0, edge_lo | edge_hi};
+          enq_data = (edge_lo & edge_hi) ? {edge_entry_hi, edge_entry_lo} :
+                     {32'b0, edge_hi ? edge_entry_hi : edge_entry_lo};
+        end
         if(done)
           next_state = IDLE;
-        else if(init_add_neighs)
+        else if(init_add_neighs | init_add_blk)
           next_state = ADD_NEIGHS;
       end
       ADD_NEIGHS: begin
         enq_req = {|neigh_ct[3:1], 1'b1};
-        enq_data = dc_rdata;
+        enq_data = parent_mode ? {add_owner, node_id(dc_rdata[63:32]),
+                                  add_owner, node_id(dc_rdata[31:0])} : dc_rdata;
         // Next
         next_neigh_ct = {neigh_ct[3:1] - 3'd1,neigh_ct[0]};
         if(last_neigh_iter)
@@ -213,17 +787,93 @@ module bfs_core (
     endcase
   end
 
+  // Performance counters
+  reg [31:0] ctr_deq;
+  reg [31:0] ctr_enq;
+  reg [31:0] ctr_marked;
+  reg [31:0] ctr_spill;
+  reg [31:0] ctr_restore;
+  reg [31:0] ctr_qstall;
+  reg [31:0] ctr_dcwait;
+  reg [31:0] ctr_cycles;
+  reg [31:0] ctr_pf;
+
+  // queue stall: spill/restore traffic (queues full) holds off dequeues
+  // cache wait: work is pending on l2 ready or on outstanding reads
+  wire ctr_qstall_inc, ctr_dcwait_inc;
+  assign ctr_qstall_inc = spill_hold;
+  assign ctr_dcwait_inc = ~spill_hold & ((~dc_ready & (~rq_empty | pw_req | x_req)) |
+                                        (rq_empty & ~dc_rbuf_empty));
+
+  always @(posedge clk)
+    if (rst | start) begin
+      ctr_deq <= 0;
+      ctr_enq <= 0;
+      ctr_marked <= 0;
+      ctr_spill <= 0;
+      ctr_restore <= 0;
+      ctr_qstall <= 0;
+      ctr_dcwait <= 0;
+      ctr_cycles <= 0;
+      ctr_pf <= 0;
+    end else if (active) begin
+      ctr_deq <= ctr_deq + {31'b0,deq_req};
+      ctr_enq <= ctr_enq + {31'b0,enq_req[1]} + {31'b0,enq_req[0]};
+      ctr_marked <= ctr_marked + {31'b0,mark_resp & rdata_marked & (~csr_mode | pq_valid)};
+      ctr_spill <= ctr_spill + {31'b0,spill_done & ~spill_op};
+      ctr_restore <= ctr_restore + {31'b0,spill_done & spill_op};
+      ctr_qstall <= ctr_qstall + {31'b0,ctr_qstall_inc};
+      ctr_dcwait <= ctr_dcwait + {31'b0,ctr_dcwait_inc};
+      ctr_cycles <= ctr_cycles + 1;
+      ctr_pf <= ctr_pf + {31'b0,pf_issue};
+    end
+
+  // Completion interrupt (raised once parent writes have drained)
+  always @(posedge clk)
+    if (rst | start)
+      draining <= 0;
+    else if (done & active)
+      draining <= 1;
+    else if (drained)
+      draining <= 0;
+
+  always @(posedge clk)
+    if (rst | stat_write)
+      bfs_csr_irq <= 0;
+    else if (draining & drained)
+      bfs_csr_irq <= 1;
+
+  always @(posedge clk)
+    if (draining & drained)
+      top.tb_log_bfs_done(ctr_deq, ctr_enq, ctr_marked, ctr_spill, ctr_restore,
+                          ctr_qstall, ctr_dcwait, ctr_cycles, ctr_pf);
+
   // CSR interface
   always @(posedge clk) begin
     bfs_csr_valid <= csr_bfs_valid;
     bfs_csr_error <= 0;
     case(csr_bfs_addr)
-      REG_STAT: bfs_csr_rdata <= {30'b0,~active,found};
+      REG_STAT: bfs_csr_rdata <= {22'b0,csr_mode,parent_mode,5'b0,bfs_csr_irq,~active&~draining,found};
       REG_ROOT: bfs_csr_rdata <= from_node;
       REG_TARG: bfs_csr_rdata <= target_val;
       REG_QBASE: bfs_csr_rdata <= sw_queue_base;
       REG_QSIZE: bfs_csr_rdata <= sw_queue_size;
       REG_RESULT: bfs_csr_rdata <= result;
+      REG_NBASE: bfs_csr_rdata <= node_base;
+      REG_PBASE: bfs_csr_rdata <= parent_base;
+      REG_OBASE: bfs_csr_rdata <= offset_base;
+      REG_EBASE: bfs_csr_rdata <= edge_base;
+      REG_VBASE: bfs_csr_rdata <= visited_base;
+      REG_PFCFG: bfs_csr_rdata <= pf_cfg;
+      REG_CTR_DEQ: bfs_csr_rdata <= ctr_deq;
+      REG_CTR_ENQ: bfs_csr_rdata <= ctr_enq;
+      REG_CTR_MARKED: bfs_csr_rdata <= ctr_marked;
+      REG_CTR_SPILL: bfs_csr_rdata <= ctr_spill;
+      REG_CTR_RESTORE: bfs_csr_rdata <= ctr_restore;
+      REG_CTR_QSTALL: bfs_csr_rdata <= ctr_qstall;
+      REG_CTR_DCWAIT: bfs_csr_rdata <= ctr_dcwait;
+      REG_CTR_CYCLES: bfs_csr_rdata <= ctr_cycles;
+      REG_CTR_PF: bfs_csr_rdata <= ctr_pf;
       default: bfs_csr_error <= 1;
     endcase
   end
@@ -236,6 +886,11 @@ module bfs_core (
         REG_QBASE: sw_queue_base <= csr_bfs_wdata;
         REG_QSIZE: sw_queue_size <= csr_bfs_wdata;
         REG_RESULT: result <= csr_bfs_wdata;
+        REG_NBASE: node_base <= csr_bfs_wdata;
+        REG_PBASE: parent_base <= csr_bfs_wdata;
+        REG_OBASE: offset_base <= csr_bfs_wdata;
+        REG_EBASE: edge_base <= csr_bfs_wdata;
+        REG_VBASE: visited_base <= csr_bfs_wdata;
         default: ;
       endcase
 
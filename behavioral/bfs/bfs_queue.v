@@ -2,13 +2,17 @@
 
 module bfs_queue #(
   parameter MAINQ_SIZE = 128,
-  parameter BUFQ_SIZE = 64
+  parameter BUFQ_SIZE = 64,
+  parameter EARLY_RESTORE = 1
   )(
   input        clk,
   input        bfs_rst,
 
   // core interface
   input        active,
+  input        rd_busy,
+  input [5:0]  rd_ahead,
+  input        swq_empty,
   input [1:0]  enqueue_req,
   input [63:0] wdata_in,
   input        dequeue_req,
@@ -18,12 +22,15 @@ module bfs_queue #(
   output       pend_empty,
   // spill signals
   output       spill_req,
+  output       spill_hold,
+  output       restore_busy,
   output       spill_done,
   output       spill_op,
   output [63:0] spill_data,
 
   // cache interface
   input       dc_valid,
+  input       dc_first,
   input [1:0] dc_op,
   input       dc_ready,
   input [63:0]  dc_rdata,
@@ -51,6 +58,7 @@ module bfs_queue #(
   wire       outq_sat;
   wire       outq_full;
   wire       outq_empty;
+  wire [$clog2(BUFQ_SIZE):0] outq_count;
 
   // In Q: Enq from memory, deq to core
   reg [1:0]  inq_enq_req;
@@ -59,10 +67,16 @@ module bfs_queue #(
   wire [31:0] inq_deq_data;
   wire       inq_full;
   wire       inq_empty;
+  wire       inq_room;
 
 
 
-  assign mq_enq_req = enqueue_req;
+  // Entries leave in order: main q, in q, spilled lines, out q. New
+  // entries only go to the main q when everything behind it is empty.
+  wire mq_open;
+  assign mq_open = ~mq_full & inq_empty & outq_empty & swq_empty;
+
+  assign mq_enq_req = mq_open ? enqueue_req : 2'b00;
   assign mq_deq_req = dequeue_req;
   queue_main #(.Q_SIZE(MAINQ_SIZE)) main_q (
     .clk(clk),
@@ -72,9 +86,10 @@ module bfs_queue #(
     .dequeue_req (mq_deq_req),
     .rdata_out (mq_deq_data),
     .queue_full (mq_full),
+    .queue_room (),
     .queue_empty (mq_empty));
 
-  assign outq_enq_req = (mq_full ? enqueue_req : 2'b00);
+  assign outq_enq_req = (mq_open ? 2'b00 : enqueue_req);
   //assign outq_deq_req = ~inq_full & ~outq_empty;
   queue_out #(.Q_SIZE(BUFQ_SIZE)) out_q (
     .clk(clk),
@@ -86,7 +101,8 @@ module bfs_queue #(
     .rdata_filled(outq_filled),
     .queue_sat (outq_sat),
     .queue_full (outq_full),
-    .queue_empty (outq_empty));
+    .queue_empty (outq_empty),
+    .queue_count (outq_count));
 
   assign inq_deq_req = (mq_empty ? dequeue_req : 1'b0);
   queue_main #(.Q_SIZE(BUFQ_SIZE)) in_q (
@@ -97,26 +113,51 @@ module bfs_queue #(
     .dequeue_req (inq_deq_req),
     .rdata_out (inq_deq_data),
     .queue_full (inq_full),
+    .queue_room (inq_room),
     .queue_empty (inq_empty));
 
 
   /* State machine controller for spilling */
   reg[2:0] qstate, next_qstate;
   reg[2:0] ct, next_ct;
+  reg[5:0] skip, next_skip;
 
   wire restore_valid;
   assign restore_valid = dc_valid & (dc_op == `OP_RD);
 
+  // Spilled lines are older than the out q, so it only forwards to the
+  // in q when none are pending
   wire spill_cond;
-  assign spill_cond = outq_sat & inq_full;
+  assign spill_cond = outq_sat & (inq_full | ~swq_empty);
+
+  // Early restore: fetch the next spilled line as soon as the in q has room
+  // for it, overlapping the fetch with the entries still queued on chip
+  wire restore_cond;
+  assign restore_cond = pend_empty | ((EARLY_RESTORE != 0) & ~swq_empty & inq_room);
+
+  // Responses come back in request order, so the restore data is the burst
+  // that starts after the skip reads issued ahead of it have started theirs.
+  // The core keeps dequeuing the resident entries while the read is out.
+  wire restore_beat;
+  assign restore_beat = (qstate == RESTORE) & ((ct != 3'd7) | (dc_first & (skip == 0)));
+
+  // With spilled lines still ahead of them, entries added during a restore
+  // all go to the out q, which cannot spill until the restore is done. Hold
+  // the reads that add entries while it lacks room for a line of neighbours
+  // (up to 8 rows) from each read in flight, the line being added and one
+  // more.
+  wire outq_room;
+  assign outq_room = (BUFQ_SIZE - 1 - outq_count) >= ({rd_ahead,3'b0} + 16);
 
   always @(posedge clk) begin
     if (bfs_rst) begin
       qstate <= CORE;
       ct <= 0;
+      skip <= 0;
     end else begin
       qstate <= next_qstate;
       ct <= next_ct;
+      skip <= next_skip;
     end
   end
 
@@ -129,16 +170,18 @@ module bfs_queue #(
     inq_enq_data = 0;
     next_qstate = qstate;
     next_ct = ct;
+    next_skip = skip;
     case(qstate)
       CORE: begin
         // FORWARDING
-        outq_deq_req = ~inq_full & (outq_filled | single_final);
+        outq_deq_req = swq_empty & ~inq_full & (outq_filled | single_final);
         inq_enq_req = outq_deq_req ? {~single_final, 1'b1} : 2'b00;
         inq_enq_data = outq_deq_data;
-        // Spill only when inq full and outq saturated, restore when queues empty
+        // Spill when outq saturated and unable to forward, restore when
+        // the in q has room for a line
         case(1)
           spill_cond: next_qstate = INIT_SPILL;
-          pend_empty: next_qstate = INIT_RESTORE;
+          restore_cond: next_qstate = INIT_RESTORE;
         endcase
       end
       INIT_SPILL: begin
@@ -149,14 +192,17 @@ module bfs_queue #(
       end
       INIT_RESTORE: begin
         next_ct = 7;
+        next_skip = rd_ahead;
         if(dc_ready)
           next_qstate = RESTORE;
       end
       RESTORE: begin
-        next_ct = dc_valid ? (ct - 1) : ct;
-        inq_enq_req = {2{dc_valid}};
+        next_ct = (dc_valid & restore_beat) ? (ct - 1) : ct;
+        if(dc_valid & dc_first & (skip != 0))
+          next_skip = skip - 1;
+        inq_enq_req = {2{dc_valid & restore_beat}};
         inq_enq_data = dc_rdata;
-        if(dc_valid & (ct == 0))
+        if(dc_valid & restore_beat & (ct == 0))
           next_qstate = CORE;
       end
       SPILL: begin
@@ -172,10 +218,13 @@ module bfs_queue #(
 
   assign queue_full = mq_full; // Debugging
   assign rqueue_empty = mq_empty & inq_empty;
-  assign pend_empty = active & inq_empty & mq_empty & outq_empty & dc_rbuf_empty;
+  // rd_busy: core reads in flight that a restore would otherwise consume
+  assign pend_empty = active & ~rd_busy & inq_empty & mq_empty & outq_empty & dc_rbuf_empty;
   
   assign spill_req = (qstate == INIT_SPILL) | (qstate == INIT_RESTORE) | (qstate == SPILL);
-  assign spill_done = (ct == 0) & (((qstate == SPILL) & dc_ready) | ((qstate == RESTORE) & dc_valid));
+  assign spill_hold = spill_req | ((qstate == RESTORE) & ~outq_room);
+  assign restore_busy = restore_beat;
+  assign spill_done = (ct == 0) & (((qstate == SPILL) & dc_ready) | (restore_beat & dc_valid));
   assign spill_op = qstate[0]; // 0 for spill, 1 for restore
   assign spill_data = outq_deq_data;
 
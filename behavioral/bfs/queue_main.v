@@ -12,6 +12,7 @@ module queue_main #(
   input        dequeue_req,
   output [31:0] rdata_out,
   output       queue_full,
+  output       queue_room,
   output       queue_empty);
 
   // Main Queue
@@ -72,5 +73,10 @@ module queue_main #(
   assign queue_full = (wraparound & pt_eq);
   assign queue_empty = (~wraparound & pt_eq);
 
+  // Room for a full line (8 rows)
+  wire [$clog2(Q_SIZE):0] buf_count;
+  assign buf_count = {buf_tail_pol, buf_tail} - {buf_head_pol, buf_head};
+  assign queue_room = (Q_SIZE - buf_count) >= 8;
+
 
 endmodule 
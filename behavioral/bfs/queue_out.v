@@ -14,7 +14,8 @@ module queue_out #(
   output        rdata_filled,
   output       queue_sat,
   output       queue_full,
-  output       queue_empty);
+  output       queue_empty,
+  output [$clog2(Q_SIZE):0] queue_count);
 
   // Main Queue
   reg [31:0]      buf_addr0[Q_SIZE-1:0];
@@ -99,6 +100,7 @@ module queue_out #(
 
   assign queue_full = pt_full;
   assign queue_empty = ~buf_valid0[buf_head];
+  assign queue_count = {buf_tail_pol, buf_tail} - {buf_head_pol, buf_head};
   
   assign rdata_out = {buf_addr1[buf_head], buf_addr0[buf_head]};
   assign rdata_filled = buf_valid01[buf_head];
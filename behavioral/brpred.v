@@ -1,4 +1,5 @@
-// two-level adaptive branch predictor
+// two-level adaptive branch predictor (gshare), or TAGE when built with
+// BRPRED_TAGE defined (see brpred_tage.v)
 module brpred(
   input         clk,
   input         rst,
@@ -13,8 +14,23 @@ module brpred(
   input         rob_flush,
   input         rob_ret_branch,
   input [15:0]  rob_ret_bptag,
-  input         rob_ret_bptaken);
-
+  input         rob_ret_bptaken,
+  input [31:2]  rob_ret_addr);
+
+`ifdef BRPRED_TAGE
+  brpred_tage tage(
+    .clk(clk),
+    .rst(rst),
+    .fetch_bp_req(fetch_bp_req),
+    .fetch_bp_addr(fetch_bp_addr),
+    .brpred_bptag(brpred_bptag),
+    .brpred_bptaken(brpred_bptaken),
+    .rob_flush(rob_flush),
+    .rob_ret_branch(rob_ret_branch),
+    .rob_ret_bptag(rob_ret_bptag),
+    .rob_ret_bptaken(rob_ret_bptaken),
+    .rob_ret_addr(rob_ret_addr));
+`else
   reg [1:0]   pht [0:16383];
 
   reg         req_r;
@@ -88,5 +104,6 @@ module brpred(
   always @(posedge clk)
     if(fetch_bp_req)
       pht_rd_addr_r <= pht_rd_addr;
+`endif
 
 endmodule
@@ -0,0 +1,248 @@
+// TAGE branch predictor: a bimodal base table backed by four tagged tables
+// indexed by geometrically longer global histories. The longest-history
+// table whose tag matches provides the prediction. Same interface as the
+// gshare predictor in brpred.v; perf/bpeval.cc models the same tables.
+module brpred_tage(
+  input         clk,
+  input         rst,
+
+  // fetch interface
+  input         fetch_bp_req,
+  input [31:2]  fetch_bp_addr,
+  output [15:0] brpred_bptag,
+  output        brpred_bptaken,
+
+  // rob interface
+  input         rob_flush,
+  input         rob_ret_branch,
+  input [15:0]  rob_ret_bptag,
+  input         rob_ret_bptaken,
+  input [31:2]  rob_ret_addr);
+
+  localparam NTAB = 4;
+
+  // 4K-entry base table, 512 entries per tagged table
+  reg [1:0]   base [0:4095];
+  reg [2047:0] valid;
+  reg [7:0]   tag [0:2047];
+  reg [2:0]   ctr [0:2047];
+  reg [1:0]   u [0:2047];
+
+  reg [63:0]  arch_hist, spec_hist;
+  reg [4:0]   pred_r;
+
+  wire [63:0] arch_hist_next, spec_hist_next;
+
+  reg         req_r;
+
+  function automatic integer hist_len(
+    input integer t);
+
+    case(t)
+      0: hist_len = 5;
+      1: hist_len = 12;
+      2: hist_len = 28;
+      default: hist_len = 64;
+    endcase
+  endfunction
+
+  // xor the newest len history bits down to w bits
+  function automatic [15:0] fold(
+    input [63:0]  h,
+    input integer len,
+    input integer w);
+
+    integer i;
+    begin
+      fold = 0;
+      for(i = 0; i < 64; i=i+1)
+        if(i < len)
+          fold[i % w] = fold[i % w] ^ h[i];
+    end
+  endfunction
+
+  // {table, row}
+  function automatic [10:0] tab_index(
+    input integer t,
+    input [31:2]  pc,
+    input [63:0]  h);
+
+    reg [15:0] f;
+    begin
+      f = fold(h, hist_len(t), 9);
+      tab_index = {t[1:0], pc[10:2] ^ pc[19:11] ^ f[8:0]};
+    end
+  endfunction
+
+  function automatic [7:0] tab_tag(
+    input integer t,
+    input [31:2]  pc,
+    input [63:0]  h);
+
+    reg [15:0] f1, f2;
+    begin
+      f1 = fold(h, hist_len(t), 8);
+      f2 = fold(h, hist_len(t), 7);
+      tab_tag = pc[17:10] ^ f1[7:0] ^ {f2[6:0],1'b0};
+    end
+  endfunction
+
+  // {provider, altpred, pred}: provider is 1 + the longest-history table
+  // that hits, or 0 for the base table
+  function automatic [4:0] lookup(
+    input [31:2] pc,
+    input [63:0] h);
+
+    integer t;
+    reg [10:0] idx;
+    reg [2:0]  prov;
+    reg        alt, pred;
+    begin
+      prov = 0;
+      pred = base[pc[13:2]][1];
+      alt = pred;
+      for(t = 0; t < NTAB; t=t+1) begin
+        idx = tab_index(t, pc, h);
+        if(valid[idx] & (tag[idx] == tab_tag(t, pc, h))) begin
+          prov = t + 1;
+          alt = pred;
+          pred = ctr[idx][2];
+        end
+      end
+      lookup = {prov, alt, pred};
+    end
+  endfunction
+
+  function automatic [2:0] sat3(
+    input [2:0] c,
+    input       up);
+
+    sat3 = up ? ((c == 7) ? c : c + 1) : ((c == 0) ? c : c - 1);
+  endfunction
+
+  function automatic [1:0] sat2(
+    input [1:0] c,
+    input       up);
+
+    sat2 = up ? ((c == 3) ? c : c + 1) : ((c == 0) ? c : c - 1);
+  endfunction
+
+  assign arch_hist_next = {arch_hist[62:0],rob_ret_bptaken};
+  assign spec_hist_next = {spec_hist[62:0],brpred_bptaken};
+
+  // we must forward the history during consecutive branch predictions
+  wire [63:0] pred_hist;
+  assign pred_hist = req_r ? spec_hist_next : spec_hist;
+
+  assign brpred_bptag = {11'b0,pred_r};
+  assign brpred_bptaken = pred_r[0];
+
+  // update: the retiring branch saw arch_hist when it was predicted (fetch
+  // drops requests while it redirects, and rob_flush restores spec_hist, so
+  // only correct-path predictions are in it), so the entries are found
+  // again from its address; the decisions use what was predicted at the
+  // time (carried in the tag)
+  wire [2:0] ret_prov;
+  wire       ret_alt, ret_pred;
+  assign {ret_prov,ret_alt,ret_pred} = rob_ret_bptag[4:0];
+
+  wire [10:0]     upd_idx [0:NTAB-1];
+  wire [7:0]      upd_tag [0:NTAB-1];
+  wire [NTAB-1:0] upd_hit;
+
+  genvar g;
+  generate
+    for(g = 0; g < NTAB; g=g+1) begin : upd
+      assign upd_idx[g] = tab_index(g, rob_ret_addr, arch_hist);
+      assign upd_tag[g] = tab_tag(g, rob_ret_addr, arch_hist);
+      assign upd_hit[g] = valid[upd_idx[g]] & (tag[upd_idx[g]] == upd_tag[g]);
+    end
+  endgenerate
+
+  // provider entry, if it is still there
+  wire [1:0] ret_pt;
+  wire       ret_prov_hit;
+  assign ret_pt = ret_prov[1:0] - 2'd1;
+  assign ret_prov_hit = (ret_prov != 0) & upd_hit[ret_pt];
+
+  // on a misprediction, allocate in the shortest-history table above the
+  // provider with a free or useless entry
+  reg [1:0] alloc_t;
+  reg       alloc_ok;
+  integer   t;
+  always @(*) begin
+    alloc_ok = 0;
+    alloc_t = 0;
+    for(t = NTAB-1; t >= 0; t=t-1)
+      if((t >= ret_prov) & (~valid[upd_idx[t]] | (u[upd_idx[t]] == 0))) begin
+        alloc_ok = 1;
+        alloc_t = t;
+      end
+  end
+
+  wire ret_alloc;
+  assign ret_alloc = rob_ret_branch & (ret_pred != rob_ret_bptaken) & (ret_prov != NTAB);
+
+  // for simulation only
+  integer i;
+  initial
+    for(i = 0; i < 4096; i=i+1)
+      base[i] = 0;
+
+  // base
+  always @(posedge clk)
+    if(rob_ret_branch & ~ret_prov_hit)
+      base[rob_ret_addr[13:2]] <= sat2(base[rob_ret_addr[13:2]], rob_ret_bptaken);
+
+  // tagged tables
+  integer j;
+  always @(posedge clk)
+    if(rst)
+      valid <= 0;
+    else begin
+      if(rob_ret_branch & ret_prov_hit) begin
+        ctr[upd_idx[ret_pt]] <= sat3(ctr[upd_idx[ret_pt]], rob_ret_bptaken);
+        if(ret_pred != ret_alt)
+          u[upd_idx[ret_pt]] <= sat2(u[upd_idx[ret_pt]], ret_pred == rob_ret_bptaken);
+      end
+      if(ret_alloc & alloc_ok) begin
+        valid[upd_idx[alloc_t]] <= 1;
+        tag[upd_idx[alloc_t]] <= upd_tag[alloc_t];
+        ctr[upd_idx[alloc_t]] <= rob_ret_bptaken ? 3'd4 : 3'd3;
+        u[upd_idx[alloc_t]] <= 0;
+      end else if(ret_alloc)
+        // age the candidates so a later misprediction finds room
+        for(j = 0; j < NTAB; j=j+1)
+          if(j >= ret_prov)
+            u[upd_idx[j]] <= sat2(u[upd_idx[j]], 0);
+    end
+
+  // pred_r
+  always @(posedge clk)
+    if(fetch_bp_req)
+      pred_r <= lookup(fetch_bp_addr, pred_hist);
+
+  // req_r
+  always @(posedge clk)
+    if(rst)
+      req_r <= 0;
+    else
+      req_r <= fetch_bp_req;
+
+  // arch_hist
+  always @(posedge clk)
+    if(rst)
+      arch_hist <= 0;
+    else if(rob_ret_branch)
+      arch_hist <= arch_hist_next;
+
+  // spec_hist
+  always @(posedge clk)
+    if(rst)
+      spec_hist <= 0;
+    else if(rob_flush)
+      spec_hist <= rob_ret_branch ? arch_hist_next : arch_hist;
+    else if(req_r)
+      spec_hist <= spec_hist_next;
+
+endmodule
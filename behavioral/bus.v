@@ -25,6 +25,16 @@ module bus(
   input             bfs_bus_nack,
   output reg        bus_bfs_grant,
 
+  // hart 1 l2 interface (tied off in the single core build)
+  input             l2_1_bus_req,
+  input [2:0]       l2_1_bus_cmd,
+  input [4:0]       l2_1_bus_tag,
+  input [31:6]      l2_1_bus_addr,
+  input [63:0]      l2_1_bus_data,
+  input             l2_1_bus_hit,
+  input             l2_1_bus_nack,
+  output reg        bus_l2_1_grant,
+
   // dramctl interface
   input             dramctl_bus_req,
   input [2:0]       dramctl_bus_cmd,
@@ -50,7 +60,12 @@ module bus(
   output reg [2:0]  bus_cmd,
   output reg [4:0]  bus_tag,
   output reg [31:6] bus_addr,
-  output reg [63:0] bus_data);
+  output reg [63:0] bus_data,
+
+  // performance events, one pulse per bus window
+  output            bus_l2_fill,
+  output            bus_l2_1_fill,
+  output            bus_bfs_win);
 
   // positive amount = left shift
   function integer rotate(
@@ -75,54 +90,59 @@ module bus(
   // responses have precedence over requests
   wire       l2_req, l2_resp;
   wire       bfs_req, bfs_resp;
-  wire [1:0] reqs;
-  wire [3:0] resps;
+  wire       l2_1_req, l2_1_resp;
+  wire [2:0] reqs;
+  wire [4:0] resps;
   assign l2_req = l2_bus_req & ~l2_bus_cmd[2];
   assign l2_resp = l2_bus_req & l2_bus_cmd[2];
   assign bfs_req = bfs_bus_req & ~bfs_bus_cmd[2];
   assign bfs_resp = bfs_bus_req & bfs_bus_cmd[2];
-  assign reqs = {bfs_req,l2_req};
-  assign resps = {rom_bus_req,dramctl_bus_req,bfs_resp,l2_resp};
+  assign l2_1_req = l2_1_bus_req & ~l2_1_bus_cmd[2];
+  assign l2_1_resp = l2_1_bus_req & l2_1_bus_cmd[2];
+  assign reqs = {l2_1_req,bfs_req,l2_req};
+  assign resps = {rom_bus_req,dramctl_bus_req,l2_1_resp,bfs_resp,l2_resp};
 
-  reg       req_pri_r;
-  reg [1:0] resp_pri_r;
+  // the priority counters wrap at the number of agents
+  reg [1:0] req_pri_r;
+  reg [2:0] resp_pri_r;
 
   /*verilator lint_off WIDTH*/
-  wire [1:0] reqs_rot;
-  wire [3:0] resps_rot;
-  assign reqs_rot = rotate(reqs, req_pri_r, 2);
-  assign resps_rot = rotate(resps, resp_pri_r, 4);
+  wire [2:0] reqs_rot;
+  wire [4:0] resps_rot;
+  assign reqs_rot = rotate(reqs, req_pri_r, 3);
+  assign resps_rot = rotate(resps, resp_pri_r, 5);
   /*verilator lint_on WIDTH*/
 
   wire       reqarb_valid, resparb_valid;
-  wire [1:0] reqarb_out;
-  wire [3:0] resparb_out;
-  priarb #(2) reqarb(
+  wire [2:0] reqarb_out;
+  wire [4:0] resparb_out;
+  priarb #(3) reqarb(
     .req(reqs_rot),
     .grant_valid(reqarb_valid),
     .grant(reqarb_out));
-  priarb #(4) resparb(
+  priarb #(5) resparb(
     .req(resps_rot),
     .grant_valid(resparb_valid),
     .grant(resparb_out));
 
+  // rotating back left by width - pri (a rotate by the full width is none)
   /*verilator lint_off WIDTH*/
-  wire [1:0] reqarb_rot;
-  wire [3:0] resparb_rot;
-  assign reqarb_rot = rotate(reqarb_out, -req_pri_r, 2);
-  assign resparb_rot = rotate(resparb_out, -resp_pri_r, 4);
+  wire [2:0] reqarb_rot;
+  wire [4:0] resparb_rot;
+  assign reqarb_rot = rotate(reqarb_out, 3 - req_pri_r, 3);
+  assign resparb_rot = rotate(resparb_out, 5 - resp_pri_r, 5);
   /*verilator lint_on WIDTH*/
 
-  reg [3:0] arb_out;
+  reg [4:0] arb_out;
   always @(*) begin
     if(resparb_valid)
       arb_out = resparb_rot;
     else if(reqarb_valid)
       arb_out = {2'b00,reqarb_rot};
     else
-      arb_out = 4'b0000;
+      arb_out = 5'b00000;
 
-    {bus_rom_grant,bus_dramctl_grant,bus_bfs_grant,bus_l2_grant} = arb_out;
+    {bus_rom_grant,bus_dramctl_grant,bus_l2_1_grant,bus_bfs_grant,bus_l2_grant} = arb_out;
   end
 
   always @(posedge clk)
@@ -131,31 +151,40 @@ module bus(
       resp_pri_r <= 0;
     end else if(bus_cycle_r == 7)
       if(resparb_valid)
-        resp_pri_r <= resp_pri_r + 1;
+        resp_pri_r <= (resp_pri_r == 4) ? 0 : resp_pri_r + 1;
       else if(reqarb_valid)
-        req_pri_r <= req_pri_r + 1;
+        req_pri_r <= (req_pri_r == 2) ? 0 : req_pri_r + 1;
 
-  reg l2_grant_r, bfs_grant_r, dramctl_grant_r, rom_grant_r;
+  reg l2_grant_r, bfs_grant_r, l2_1_grant_r, dramctl_grant_r, rom_grant_r;
   always @(posedge clk)
     if(rst) begin
       l2_grant_r <= 0;
       bfs_grant_r <= 0;
+      l2_1_grant_r <= 0;
       dramctl_grant_r <= 0;
       rom_grant_r <= 0;
     end else if(bus_cycle_r == 7) begin
       l2_grant_r <= bus_l2_grant;
       bfs_grant_r <= bus_bfs_grant;
+      l2_1_grant_r <= bus_l2_1_grant;
       dramctl_grant_r <= bus_dramctl_grant;
       rom_grant_r <= bus_rom_grant;
     end
 
+  // a completed fill for each core l2 (one per l2 miss), and a window used by bfsl2
+  assign bus_l2_fill = bus_valid & (bus_cycle_r == 7) & ~bus_nack &
+                       (bus_cmd == `CMD_FILL) & (bus_tag[4:3] == `BUSID_L2);
+  assign bus_l2_1_fill = bus_valid & (bus_cycle_r == 7) & ~bus_nack &
+                         (bus_cmd == `CMD_FILL) & (bus_tag[4:3] == `BUSID_L2_1);
+  assign bus_bfs_win = bfs_grant_r & (bus_cycle_r == 7);
+
   // output muxes
   always @(*) begin
-    bus_valid = l2_grant_r | bfs_grant_r | dramctl_grant_r | rom_grant_r;
+    bus_valid = l2_grant_r | bfs_grant_r | l2_1_grant_r | dramctl_grant_r | rom_grant_r;
     // asserted during request by cache to inhibit dramctl response (cache-to-cache transfer)
-    bus_hit = l2_bus_hit | bfs_bus_hit;
+    bus_hit = l2_bus_hit | bfs_bus_hit | l2_1_bus_hit;
     // asserted during request to indicate that it should be tried again later
-    bus_nack = l2_bus_nack | bfs_bus_nack | dramctl_bus_nack | rom_bus_nack;
+    bus_nack = l2_bus_nack | bfs_bus_nack | l2_1_bus_nack | dramctl_bus_nack | rom_bus_nack;
 
     bus_cmd = 0;
     bus_tag = 0;
@@ -173,6 +202,12 @@ module bus(
       bus_addr = bus_addr | bfs_bus_addr;
       bus_data = bus_data | bfs_bus_data;
     end
+    if(l2_1_grant_r) begin
+      bus_cmd = bus_cmd | l2_1_bus_cmd;
+      bus_tag = bus_tag | l2_1_bus_tag;
+      bus_addr = bus_addr | l2_1_bus_addr;
+      bus_data = bus_data | l2_1_bus_data;
+    end
     if(dramctl_grant_r) begin
       bus_cmd = bus_cmd | dramctl_bus_cmd;
       bus_tag = bus_tag | dramctl_bus_tag;
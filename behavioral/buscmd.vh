@@ -11,6 +11,7 @@
 `define BUSID_L2   2'b00
 `define BUSID_BFS  2'b01
 `define BUSID_DRAM 2'b10
+`define BUSID_L2_1 2'b11 // hart 1 l2 (CPU_CORES=2)
 
 // cache operations
 `define OP_RD   2'b01
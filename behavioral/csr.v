@@ -1,5 +1,8 @@
 // csr (control and status register) unit
-module csr(
+module csr #(
+  // mhartid; the harness traces hart 0 only
+  parameter HARTID = 0
+  )(
   input         clk,
   input         rst,
 
@@ -23,30 +26,58 @@ module csr(
   // rob interface
   input         rob_flush,
   input         rob_ret_valid,
+  input         rob_ret_valid_1,
   input         rob_ret_csr,
+  input         rob_ret_mret,
   input         rob_csr_valid,
+  input         rob_csr_irq,
   input [31:2]  rob_csr_epc,
   input [4:0]   rob_csr_ecause,
   input [31:0]  rob_csr_tval,
   output [31:2] csr_tvec,
+  output        csr_irq,
 
   // bfs interface
   output        csr_bfs_valid,
-  output [3:0]  csr_bfs_addr,
+  output [4:0]  csr_bfs_addr,
   output        csr_bfs_wen,
   output [31:0] csr_bfs_wdata,
   input         bfs_csr_valid,
   input         bfs_csr_error,
   input [31:0]  bfs_csr_rdata,
+  input         bfs_csr_irq,
+
+  // hash interface
+  output        csr_hash_valid,
+  output [4:0]  csr_hash_addr,
+  output        csr_hash_wen,
+  output [31:0] csr_hash_wdata,
+  input         hash_csr_valid,
+  input         hash_csr_error,
+  input [31:0]  hash_csr_rdata,
 
   // l2fifo interface
-  input         l2fifo_l2_req);
+  input         l2fifo_l2_req,
+
+  // stores not yet visible to the other agents on the bus
+  input         core_st_pending,
+
+  // performance monitor events
+  input [7:0]   cpu_hpm_events);
 
   localparam
+    MSTATUS   = 12'h300,
+    MIE       = 12'h304,
+    MTVEC     = 12'h305,
+    MSCRATCH  = 12'h340,
+    MEPC      = 12'h341,
+    MCAUSE    = 12'h342,
+    MIP       = 12'h344,
     MCYCLE    = 12'hB00,
     MINSTRET  = 12'hB02,
     MCYCLEH   = 12'hB80,
     MINSTRETH = 12'hB82,
+    MHARTID   = 12'hF14,
     MUARTSTAT = 12'hFC0,
     MUARTRX   = 12'hFC1,
     MUARTTX   = 12'h7C0,
@@ -64,12 +95,40 @@ module csr(
     MUARTSTAT_TXEMPTY = 32'h00000004,
     MUARTSTAT_TXFULL  = 32'h00000008;
 
+  // mstatus/mie/mip bits
+  localparam
+    MSTATUS_MIE = 3,
+    MSTATUS_MPIE = 7,
+    MIP_MBFSIP = 16;
+
+  // interrupt cause codes
+  localparam
+    IRQ_MBFS = 5'd16;
+
   // Supported CSRs
   reg [31:0] mcycle;
   reg [31:0] mcycleh;
   reg [31:0] minstret;
   reg [31:0] minstreth;
   reg [7:0]  muarttx;
+  reg        mstatus_mie;
+  reg        mstatus_mpie;
+  reg        mie_mbfsie;
+  reg [31:2] mtvec;
+  reg [31:0] mscratch;
+  reg [31:2] mepc;
+  reg        mcause_irq;
+  reg [4:0]  mcause_code;
+  reg [31:0] mhpmcounter [0:3]; // mhpmcounter3-6
+  reg [31:0] mhpmcounterh [0:3];
+  reg [2:0]  mhpmevent [0:3];
+
+  // Derived CSR values
+  wire [31:0] mstatus, mie, mip, mcause;
+  assign mstatus = {19'b0,2'b11,3'b0,mstatus_mpie,3'b0,mstatus_mie,3'b0};
+  assign mie = {15'b0,mie_mbfsie,16'b0};
+  assign mip = {15'b0,bfs_csr_irq,16'b0};
+  assign mcause = {mcause_irq,26'b0,mcause_code};
 
   // Updated CSR value
   reg [31:0] mcycle_n; 
@@ -79,6 +138,7 @@ module csr(
 
   reg valid;
   reg [2:0] op;
+  reg fence;
   reg [6:0] robid;
   reg [5:0] rd;
   reg [31:0] op1;
@@ -97,39 +157,83 @@ module csr(
   always @(posedge clk)
     if(~csr_stall & rename_csr_write) begin
       op <= rename_op[2:0];
+      fence <= rename_op[3];
       rd <= rename_rd;
       op1 <= rename_op1;
       robid <= rename_robid;
       addr <= rename_imm[11:0];
     end
 
+  // mret is issued as a csr read of mepc, fence as a read of nothing that
+  // waits for the hart's stores (see insndec)
+  wire mret;
+  assign mret = (op == 3'b100);
+
+  wire fence_stall;
+  assign fence_stall = valid & fence & core_st_pending;
+
+  // mhpmcounter/mhpmcounterh/mhpmevent 3-6 => 0-3
+  wire [1:0] hpm_idx;
+  assign hpm_idx = addr[1:0] - 2'd3;
+
   // address decoder
+  reg sel_mstatus, sel_mie, sel_mtvec, sel_mscratch;
+  reg sel_mepc, sel_mcause, sel_mip;
   reg sel_mcycle, sel_mcycleh;
   reg sel_minstret, sel_minstreth;
+  reg sel_mhpmcounter, sel_mhpmcounterh, sel_mhpmevent;
+  reg sel_mhartid;
   reg sel_muartstat, sel_muartrx, sel_muarttx;
   reg sel_bfs;
+  reg sel_hash;
   reg sel_ml2stat;
   reg sel_none;
   always @(*) begin
+    sel_mstatus = 0;
+    sel_mie = 0;
+    sel_mtvec = 0;
+    sel_mscratch = 0;
+    sel_mepc = 0;
+    sel_mcause = 0;
+    sel_mip = 0;
     sel_mcycle = 0;
     sel_mcycleh = 0;
     sel_minstret = 0;
     sel_minstreth = 0;
+    sel_mhpmcounter = 0;
+    sel_mhpmcounterh = 0;
+    sel_mhpmevent = 0;
+    sel_mhartid = 0;
     sel_muartstat = 0;
     sel_muartrx = 0;
     sel_muarttx = 0;
     sel_bfs = 0;
+    sel_hash = 0;
     sel_ml2stat = 0;
     sel_none = 0;
     casez(addr)
+      MSTATUS: sel_mstatus = 1;
+      MIE: sel_mie = 1;
+      MTVEC: sel_mtvec = 1;
+      MSCRATCH: sel_mscratch = 1;
+      MEPC: sel_mepc = 1;
+      MCAUSE: sel_mcause = 1;
+      MIP: sel_mip = 1;
       MCYCLE: sel_mcycle = 1;
       MCYCLEH: sel_mcycleh = 1;
       MINSTRET: sel_minstret = 1;
       MINSTRETH: sel_minstreth = 1;
+      12'hB03, 12'hB04, 12'hB05, 12'hB06: sel_mhpmcounter = 1;
+      12'hB83, 12'hB84, 12'hB85, 12'hB86: sel_mhpmcounterh = 1;
+      12'h323, 12'h324, 12'h325, 12'h326: sel_mhpmevent = 1;
+      MHARTID: sel_mhartid = 1;
       MUARTSTAT: sel_muartstat = 1;
       MUARTRX: sel_muartrx = 1;
       MUARTTX: sel_muarttx = 1;
       12'h7D?: sel_bfs = 1;
+      12'hFD?: sel_bfs = 1;
+      12'h7F?: sel_hash = 1;
+      12'hFF?: sel_hash = 1;
       ML2STAT: sel_ml2stat = 1;
       default: sel_none = 1;
     endcase
@@ -138,13 +242,26 @@ module csr(
   // read data mux
   always @(*)
     case(1)
+      mret: csr_result = {mepc,2'b0};
+      sel_mstatus: csr_result = mstatus;
+      sel_mie: csr_result = mie;
+      sel_mtvec: csr_result = {mtvec,2'b0};
+      sel_mscratch: csr_result = mscratch;
+      sel_mepc: csr_result = {mepc,2'b0};
+      sel_mcause: csr_result = mcause;
+      sel_mip: csr_result = mip;
       sel_mcycle: csr_result = mcycle;
       sel_mcycleh: csr_result = mcycleh;
       sel_minstret: csr_result = minstret;
       sel_minstreth: csr_result = minstreth;
+      sel_mhpmcounter: csr_result = mhpmcounter[hpm_idx];
+      sel_mhpmcounterh: csr_result = mhpmcounterh[hpm_idx];
+      sel_mhpmevent: csr_result = {29'b0,mhpmevent[hpm_idx]};
+      sel_mhartid: csr_result = HARTID;
       sel_muartstat: csr_result = MUARTSTAT_TXEMPTY | MUARTSTAT_RXEMPTY;
       sel_muarttx: csr_result = {24'b0,muarttx};
       sel_bfs: csr_result = bfs_csr_rdata;
+      sel_hash: csr_result = hash_csr_rdata;
       sel_ml2stat: csr_result = {31'b0,l2fifo_l2_req};
       default: csr_result = 0;
     endcase
@@ -178,6 +295,13 @@ module csr(
     else
       bfs_req_r <= csr_bfs_valid;
 
+  reg hash_req_r;
+  always @(posedge clk)
+    if(rst)
+      hash_req_r <= 0;
+    else
+      hash_req_r <= csr_hash_valid;
+
   wire l2fifo_stall;
   assign l2fifo_stall = wen & sel_ml2stat & l2fifo_l2_req;
 
@@ -190,15 +314,24 @@ module csr(
 
   // csrrs/c not supported
   assign csr_bfs_valid = valid & ~op[1] & sel_bfs & ~bfs_req_r;
-  assign csr_bfs_addr = addr[3:0];
+  // 0x7d? accelerator registers, 0xfd? read-only accelerator counters
+  assign csr_bfs_addr = {addr[11],addr[3:0]};
   assign csr_bfs_wen = wen;
   assign csr_bfs_wdata = op1;
 
-  assign csr_stall = csr_bfs_valid | l2fifo_stall | l2fifo_stall_r;
-  assign csr_error = sel_none | wr_error |
-                     (bfs_req_r & (~bfs_csr_valid | bfs_csr_error));
+  // 0x7f? hash probe registers, 0xff? read-only hash probe counters
+  assign csr_hash_valid = valid & ~op[1] & sel_hash & ~hash_req_r;
+  assign csr_hash_addr = {addr[11],addr[3:0]};
+  assign csr_hash_wen = wen;
+  assign csr_hash_wdata = op1;
+
+  assign csr_stall = csr_bfs_valid | csr_hash_valid | l2fifo_stall | l2fifo_stall_r | fence_stall;
+  assign csr_error = (~mret & ~fence & (sel_none | wr_error)) |
+                     (bfs_req_r & (~bfs_csr_valid | bfs_csr_error)) |
+                     (hash_req_r & (~hash_csr_valid | hash_csr_error));
   assign csr_ecause = 0; // TODO
-  assign csr_tvec = 0;
+  assign csr_tvec = mtvec;
+  assign csr_irq = mstatus_mie & (|(mie & mip));
 
   // CSR latching
   always @(posedge clk) begin
@@ -221,7 +354,7 @@ module csr(
   always @(*) begin
     // Passive updates
     {mcycleh_n, mcycle_n} = {mcycleh, mcycle} + 1;
-    {minstreth_n, minstret_n} = {minstreth, minstret} + {63'b0,inc_minstret};
+    {minstreth_n, minstret_n} = {minstreth, minstret} + {63'b0,inc_minstret} + {63'b0,rob_ret_valid_1};
 
     // Active updates: CSR instructions (overrides passive)
     if(wen)
@@ -233,15 +366,80 @@ module csr(
       endcase
   end
 
+  // mhpmcounter3-6 count the event selected by their mhpmevent
+  integer h;
+  always @(posedge clk)
+    for(h = 0; h < 4; h=h+1)
+      if(rst) begin
+        mhpmcounter[h] <= 0;
+        mhpmcounterh[h] <= 0;
+        mhpmevent[h] <= 0;
+      end else if(wen & sel_mhpmcounter & (hpm_idx == h))
+        mhpmcounter[h] <= wdata;
+      else if(wen & sel_mhpmcounterh & (hpm_idx == h))
+        mhpmcounterh[h] <= wdata;
+      else begin
+        {mhpmcounterh[h],mhpmcounter[h]} <= {mhpmcounterh[h],mhpmcounter[h]} +
+                                            {63'b0,cpu_hpm_events[mhpmevent[h]]};
+        if(wen & sel_mhpmevent & (hpm_idx == h))
+          mhpmevent[h] <= wdata[2:0];
+      end
+
   always @(posedge clk)
     if(rst)
       muarttx <= 0;
     else if(wen & sel_muarttx)
       muarttx <= wdata[7:0];
 
+  // trap state (mip is read-only, pending bits come from the devices)
+  always @(posedge clk)
+    if(rst) begin
+      mstatus_mie <= 0;
+      mstatus_mpie <= 0;
+      mie_mbfsie <= 0;
+      mtvec <= 0;
+      mcause_irq <= 0;
+      mcause_code <= 0;
+    end else begin
+      if(wen & sel_mstatus) begin
+        mstatus_mie <= wdata[MSTATUS_MIE];
+        mstatus_mpie <= wdata[MSTATUS_MPIE];
+      end
+      if(wen & sel_mie)
+        mie_mbfsie <= wdata[MIP_MBFSIP];
+      // direct mode only
+      if(wen & sel_mtvec)
+        mtvec <= wdata[31:2];
+      if(wen & sel_mcause) begin
+        mcause_irq <= wdata[31];
+        mcause_code <= wdata[4:0];
+      end
+
+      if(rob_csr_valid) begin
+        // trap entry
+        mstatus_mie <= 0;
+        mstatus_mpie <= mstatus_mie;
+        mcause_irq <= rob_csr_irq;
+        mcause_code <= rob_csr_irq ? IRQ_MBFS : rob_csr_ecause;
+      end else if(rob_ret_mret) begin
+        // trap return
+        mstatus_mie <= mstatus_mpie;
+        mstatus_mpie <= 1;
+      end
+    end
+
+  always @(posedge clk) begin
+    if(wen & sel_mscratch)
+      mscratch <= wdata;
+    if(rob_csr_valid)
+      mepc <= rob_csr_epc;
+    else if(wen & sel_mepc)
+      mepc <= wdata[31:2];
+  end
+
 `ifndef SYNTHESIS
   always @(posedge clk)
-    if(valid & ~csr_error & wen)
+    if((HARTID == 0) & valid & ~csr_error & wen)
       top.tb_trace_csr_write(
         robid,
         addr,
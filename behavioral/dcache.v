@@ -1,5 +1,14 @@
+// outstanding line misses, set from the build
+`ifndef DCACHE_MSHRS
+`define DCACHE_MSHRS 4
+`endif
+
 // data cache
-module dcache(
+module dcache #(
+  parameter MSHRS = `DCACHE_MSHRS,
+  // the harness traces hart 0 only
+  parameter HARTID = 0
+  )(
   input         clk,
   input         rst,
 
@@ -26,12 +35,22 @@ module dcache(
 
   input         l2_resp_valid,
   input         l2_resp_error,
+  input [31:6]  l2_resp_addr,
+  input [2:0]   l2_resp_beat,
   input [63:0]  l2_resp_rdata,
   output        resp_ready,
 
   input         l2_inv_valid,
   input [31:6]  l2_inv_addr,
-  output        inv_ready);
+  output        inv_ready,
+
+  // a store in s0 that has not reached the l2fifo yet
+  output        dcache_st_pending,
+
+  // a load miss allocated an mshr (one pulse per line fill)
+  output        dcache_miss);
+
+  localparam MSHR_IDX = (MSHRS > 1) ? $clog2(MSHRS) : 1;
 
   // 32KB, 4-way associative, 64B line => 128 sets
   function automatic [6:0] addr2set(
@@ -77,21 +96,28 @@ module dcache(
   // 8B wide, 32KB, 64B line => 4096 entries
   reg [63:0] datamem [0:4095];
 
-  // 1 MSHR
-  reg        mshr_valid;
-  reg        mshr_obsolete;
-  reg [31:6] mshr_addr;
-  reg [3:0]  mshr_way;
-  reg [15:0] mshr_req_valid;
-  reg [31:0] mshr_req_offset;
-  reg [47:0] mshr_req_op;
-  reg [63:0] mshr_req_lsqid;
-  reg        mshr_wen;
-  reg [63:0] mshr_wmask;
+  // MSHRS line misses, each merging further reads/writes to its line;
+  // fills are matched to their mshr by l2_resp_addr, in any order, and
+  // their beats arrive critical word first (l2_resp_beat)
+  reg [MSHRS-1:0] mshr_valid;
+  reg [MSHRS-1:0] mshr_obsolete;
+  reg [31:6]      mshr_addr [0:MSHRS-1];
+  reg [3:0]       mshr_way [0:MSHRS-1];
+  reg [15:0]      mshr_req_valid [0:MSHRS-1];
+  reg [31:0]      mshr_req_offset [0:MSHRS-1];
+  reg [47:0]      mshr_req_op [0:MSHRS-1];
+  reg [63:0]      mshr_req_lsqid [0:MSHRS-1];
+  reg [MSHRS-1:0] mshr_wen;
+  reg [63:0]      mshr_wmask [0:MSHRS-1];
 
   // read buffer
-  // latches response data from l2
+  // latches response data from l2 for one mshr at a time (rbuf_mshr); the
+  // next line's response waits until this one is filled into datamem.
+  // rbuf_data/valid/filled are indexed by line beat, rbuf_head/tail count
+  // beats from the first one received (rbuf_first)
   reg        rbuf_started;
+  reg [MSHR_IDX-1:0] rbuf_mshr;
+  reg [2:0]  rbuf_first;
   reg [7:0]  rbuf_valid;
   reg [7:0]  rbuf_filled;
   reg [3:0]  rbuf_head;
@@ -107,7 +133,7 @@ module dcache(
   reg [31:0] s0_wdata_r;
 
   // cycle counter for burst transactions (lbcmp)
-  reg [1:0]  s0_cycle_r;
+  reg [2:0]  s0_cycle_r;
 
   // stage 0 signals
   reg        s0_stall;
@@ -125,12 +151,20 @@ module dcache(
   reg [3:0]  s0_taghits;
   reg        s0_tagmiss;
   reg        s0_mshrhit;
+  reg [MSHR_IDX-1:0] s0_mshr;
+  reg        s0_mshr_rbuf;
+  reg [3:0]  s0_mshr_resv;
   reg        s0_rd_forward;
   reg        s0_rd_merge;
   reg        s0_wr_merge;
   wire       s0_mshr_alloc;
+  wire       s0_mshr_free;
+  wire [MSHRS-1:0] s0_mshr_free_sel;
+  reg [MSHR_IDX-1:0] s0_mshr_free_idx;
   wire       s0_invalid_way_avail;
   wire [3:0] s0_invalid_way_sel;
+  wire       s0_unresv_way_avail;
+  wire [3:0] s0_unresv_way_sel;
   reg [3:0]  s0_mshr_alloc_way;
 
   // pma checker
@@ -141,8 +175,10 @@ module dcache(
   reg [31:0] s0_wdata_aligned;
 
   // beat transaction signals (lbcmp)
+  // lbcmp64 bursts from the addressed beat to the end of its line
   wire [2:0] s0_op;
   wire       s0_burst;
+  wire       s0_wide;
   wire       s0_last;
   wire       s0_burst_beat;
 
@@ -164,6 +200,9 @@ module dcache(
   reg [3:0]  s1_lsqid_r;
   reg [2:0]  s1_offset_r;
   reg [7:0]  s1_op2_r;
+  reg        s1_wide_r;
+  reg        s1_first_r;
+  reg [2:0]  s1_beat_r;
 
   // stage 1 signals
   wire       s1_stall;
@@ -186,16 +225,24 @@ module dcache(
   reg [3:0]  s2_lsqid_r;
   reg [2:0]  s2_offset_r;
   reg [7:0]  s2_op2_r;
+  reg        s2_wide_r;
+  reg        s2_first_r;
+  reg [2:0]  s2_beat_r;
   reg [63:0] s2_rdata_r;
 
   // shift register holding intermediate results during lbcmp (burst)
   reg [23:0] s2_bcmp_r;
 
+  // lbcmp64 result so far: {empty, none, line offset}
+  reg [7:0]  s2_bcmp64_r;
+
   // stage 2 signals
   wire       s2_burst;
   wire       s2_last;
 
   reg [7:0]  s2_bcmp_result;
+  reg [7:0]  s2_bcmp_empty;
+  reg [7:0]  s2_bcmp64_result;
 
   // encoded from rdata and op (lw/lh/lb/lhu/lbu)
   reg [31:0] s2_rdata_muxed;
@@ -206,12 +253,23 @@ module dcache(
   wire l2_req_beat;
   assign l2_req_beat = dcache_l2fifo_req & l2fifo_dc_ready;
 
-  wire l2_resp_beat;
-  assign l2_resp_beat = l2_resp_valid & resp_ready;
+  wire l2_resp_take;
+  assign l2_resp_take = l2_resp_valid & resp_ready;
 
-  // mshr_req_* fields are shifted right by 2 on each l2_resp_beat
+  // mshr the l2 response is for
+  reg [MSHR_IDX-1:0] resp_mshr;
+  integer n;
+  always @(*) begin
+    resp_mshr = 0;
+    for(n = 0; n < MSHRS; n=n+1)
+      if(mshr_valid[n] & (mshr_addr[n] == l2_resp_addr))
+        resp_mshr = n;
+  end
+
+  // mshr_req_* fields are indexed by word, each l2_resp_beat forwards the
+  // reads waiting on its two words (early restart)
   wire [1:0] l2req_fwd_valid;
-  assign l2req_fwd_valid = mshr_obsolete ? 0 : mshr_req_valid[1:0];
+  assign l2req_fwd_valid = mshr_obsolete[resp_mshr] ? 0 : mshr_req_valid[resp_mshr][l2_resp_beat*2+:2];
 
   // must stall when there is a higher priority input to stage 2 present
   assign s1_stall = (s1_req_r | s1_forward_r) & l2_resp_valid & (|l2req_fwd_valid);
@@ -221,18 +279,25 @@ module dcache(
   assign dcache_lsq_valid = s2_req_r & s2_last & ~lsq_dc_flush;
   assign dcache_lsq_error = s2_error_r;
   assign dcache_lsq_lsqid = s2_lsqid_r;
-  assign dcache_lsq_rdata = s2_burst ? {s2_bcmp_result,s2_bcmp_r} : s2_rdata_extended;
+  assign dcache_lsq_rdata = ~s2_burst ? s2_rdata_extended :
+                            s2_wide_r ? {24'b0,s2_bcmp64_result} :
+                            {s2_bcmp_result,s2_bcmp_r};
 
   // l2 interface
   assign dcache_l2fifo_req = s0_req_r & ~s0_inv_r & pma_valid &
-                             ((~s0_op_r[0] & s0_tagmiss & ~mshr_valid) |
+                             ((~s0_op_r[0] & s0_tagmiss & ~s0_mshrhit &
+                               s0_mshr_free & s0_unresv_way_avail) |
                               (s0_op_r[0] & (~s0_mshrhit | s0_wr_merge)));
-  assign dcache_l2fifo_addr = ~s0_op_r[0] ? {s0_addr_r[31:6],4'b0} : s0_addr_r[31:2];
+  // a line read names the word that missed, the l2 sends its beat first
+  assign dcache_l2fifo_addr = s0_addr_r[31:2];
   assign dcache_l2fifo_wen = s0_op_r[0];
+  assign dcache_st_pending = s0_req_r & ~s0_inv_r & s0_op_r[0];
+  assign dcache_miss = s0_mshr_alloc & ~s0_inv_r;
   assign dcache_l2fifo_wmask = s0_wmask;
   assign dcache_l2fifo_wdata = s0_wdata_aligned;
 
-  assign resp_ready = ~&l2req_fwd_valid;
+  // another mshr's response waits until the rbuf is filled into datamem
+  assign resp_ready = ~&l2req_fwd_valid & ~(rbuf_started & (rbuf_mshr != resp_mshr));
   assign inv_ready = ~s0_stall;
 
   // s0 input latches
@@ -271,53 +336,91 @@ module dcache(
     s0_tagmiss = ~|s0_taghits;
   end
 
-  // s0_rd_forward, s0_rd_merge, s0_wr_merge
+  // s0_mshrhit, s0_mshr: the mshr holding this line
+  // s0_mshr_rbuf: its fill has started (and is in the rbuf)
+  // s0_mshr_resv: ways in this set that mshrs will fill
+  integer p;
+  always @(*) begin
+    s0_mshrhit = 0;
+    s0_mshr = 0;
+    s0_mshr_resv = 0;
+    for(p = 0; p < MSHRS; p=p+1) begin
+      if(mshr_valid[p] & (mshr_addr[p] == s0_addr_r[31:6])) begin
+        s0_mshrhit = 1;
+        s0_mshr = p;
+      end
+      if(mshr_valid[p] & (addr2set({mshr_addr[p],4'b0}) == s0_set))
+        s0_mshr_resv = s0_mshr_resv | mshr_way[p];
+    end
+    s0_mshr_rbuf = rbuf_started & (rbuf_mshr == s0_mshr);
+  end
+
+  // s0_rd_forward, s0_rd_merge, s0_wr_merge (mshr: the one at s0_mshr)
   //
   // reads
-  // mshrmiss: 0, tagmiss: x => stall if mshr_valid & (mshr_wen | (~rbuf_valid[i] & (rbuf_started | mshr_req_valid[i] | mshr_obsolete)))
-  //                            forward from rbuf if mshr_valid & rbuf_valid[i]
+  // mshrmiss: 0, tagmiss: x => stall if mshr_wen | (~rbuf_valid[i] & (rbuf started | mshr_req_valid[i] | mshr_obsolete))
+  //                            forward from rbuf if rbuf started & rbuf_valid[i]
   //                            merge into mshr otherwise
   // mshrmiss: 1, tagmiss: 0 => read datamem
-  // mshrmiss: 1, tagmiss: 1 => stall if mshr_valid
+  // mshrmiss: 1, tagmiss: 1 => stall if no mshr or victim way is free
   //                            write mshr otherwise
   //
   // writes
   // mshrmiss: 0, tagmiss: x => send to L2
-  //                            stall if mshr_valid & rbuf_filled[i]
-  //                            merge into mshr/datamem if mshr_valid
+  //                            stall if rbuf started & rbuf_filled[i]
+  //                            merge into mshr/datamem otherwise
   // mshrmiss: 1, tagmiss: 0 => send to L2
   //                            write into datamem
   // mshrmiss: 1, tagmiss: 1 => send to L2
   always @(*) begin
-    s0_mshrhit = mshr_valid & (mshr_addr == s0_addr_r[31:6]);
-
     // Can we forward read data, or merge a read?
     s0_rd_merge = 0;
     s0_rd_forward = 0;
     // check mshr_wen since we can't forward/merge the read if there is pending wdata
-    if(~s0_op_r[0] & s0_mshrhit & ~mshr_wen)
+    if(~s0_op_r[0] & s0_mshrhit & ~mshr_wen[s0_mshr])
       // is there pending rdata in the rbuf for this addr?
-      if(rbuf_valid[s0_addr_r[5:3]])
+      if(s0_mshr_rbuf & rbuf_valid[s0_addr_r[5:3]])
         // forward the data from the rbuf
         s0_rd_forward = 1;
       else
         // merge into the mshr if the slot is free and there hasn't been a flush
-        s0_rd_merge = ~l2_resp_valid & ~rbuf_started & ~mshr_req_valid[s0_addr_r[5:2]] &
-                      ~mshr_obsolete & ~s0_burst;
+        s0_rd_merge = ~l2_resp_valid & ~s0_mshr_rbuf &
+                      ~mshr_req_valid[s0_mshr][s0_addr_r[5:2]] &
+                      ~mshr_obsolete[s0_mshr] & ~s0_burst;
 
     // can we merge a write?
-    s0_wr_merge = ~s0_inv_r & s0_op_r[0] & s0_mshrhit & ~rbuf_filled[s0_addr_r[5:3]];
+    s0_wr_merge = ~s0_inv_r & s0_op_r[0] & s0_mshrhit &
+                  ~(s0_mshr_rbuf & rbuf_filled[s0_addr_r[5:3]]);
   end
 
-  assign s0_mshr_alloc = s0_req_r & ~s0_op_r[0] & pma_valid & s0_tagmiss
-                         & l2fifo_dc_ready & ~mshr_valid;
+  assign s0_mshr_alloc = s0_req_r & ~s0_op_r[0] & pma_valid & s0_tagmiss & ~s0_mshrhit
+                         & l2fifo_dc_ready & s0_mshr_free & s0_unresv_way_avail;
+
+  // s0_mshr_free_*
+  priarb #(MSHRS) free_mshr_arb(
+    .req(~mshr_valid),
+    .grant_valid(s0_mshr_free),
+    .grant(s0_mshr_free_sel));
 
-  // invalid_way_*
+  integer r;
+  always @(*) begin
+    s0_mshr_free_idx = 0;
+    for(r = 0; r < MSHRS; r=r+1)
+      if(s0_mshr_free_sel[r])
+        s0_mshr_free_idx = r;
+  end
+
+  // invalid_way_*, unresv_way_*: ways other mshrs are not filling
   priarb #(4) invalid_way_arb(
-    .req(~s0_tagmem_valid),
+    .req(~s0_tagmem_valid & ~s0_mshr_resv),
     .grant_valid(s0_invalid_way_avail),
     .grant(s0_invalid_way_sel));
 
+  priarb #(4) unresv_way_arb(
+    .req(~s0_mshr_resv),
+    .grant_valid(s0_unresv_way_avail),
+    .grant(s0_unresv_way_sel));
+
   // s0_mshr_alloc_way
   always @(*)
     // if there are any invalid ways, use those instead of lru bits
@@ -332,6 +435,9 @@ module dcache(
         3'b10?: s0_mshr_alloc_way[2] = 1;
         3'b11?: s0_mshr_alloc_way[3] = 1;
       endcase
+      // skip a way another mshr is already filling
+      if(|(s0_mshr_alloc_way & s0_mshr_resv))
+        s0_mshr_alloc_way = s0_unresv_way_sel;
     end
 
   // s0_stall
@@ -346,7 +452,7 @@ module dcache(
         if(s0_mshrhit)
           s0_stall = (~s0_rd_forward | s1_stall) & ~s0_rd_merge;
         else if(s0_tagmiss)
-          s0_stall = pma_valid & (~l2fifo_dc_ready | mshr_valid);
+          s0_stall = pma_valid & (~l2fifo_dc_ready | ~s0_mshr_free | ~s0_unresv_way_avail);
         else
           s0_stall = s1_stall;
       else
@@ -357,7 +463,7 @@ module dcache(
 
   wire s0_wen;
   assign s0_wen = s0_req_r & ~s0_inv_r & s0_op_r[0] &
-                  (~s0_tagmiss | (s0_mshrhit & ~rbuf_filled[s0_addr_r[5:3]])) &
+                  (~s0_tagmiss | (s0_mshrhit & ~(s0_mshr_rbuf & rbuf_filled[s0_addr_r[5:3]]))) &
                   l2fifo_dc_ready;
 
   pmacheck pmacheck(
@@ -385,7 +491,8 @@ module dcache(
 
   // beat transaction signals
   assign s0_burst = (s0_op_r[2:0] == 3'b110);
-  assign s0_last = ~s0_burst | (&s0_cycle_r);
+  assign s0_wide = s0_burst & s0_op_r[3];
+  assign s0_last = ~s0_burst | (s0_wide ? &s0_addr_r[5:3] : &s0_cycle_r[1:0]);
   assign s0_burst_beat = s0_req_r & s0_burst & pma_valid &
                          (s0_rd_forward | (~s0_mshrhit & ~s0_tagmiss)) &
                          ~s1_stall;
@@ -395,7 +502,7 @@ module dcache(
     if(rst | lsq_dc_flush)
       s0_cycle_r <= 0;
     else if(s0_burst_beat)
-      s0_cycle_r <= s0_cycle_r + 1;
+      s0_cycle_r <= s0_last ? 3'd0 : s0_cycle_r + 1;
 
   // s1 input latches
   always @(posedge clk)
@@ -411,31 +518,38 @@ module dcache(
       s1_lsqid_r <= s0_lsqid_r;
       s1_raddr_r <= {s0_set,oh2idx(s0_taghits),s0_addr_r[5:3]};
       s1_op2_r <= s0_wdata_r[7:0];
+      s1_wide_r <= s0_wide;
+      s1_first_r <= (s0_cycle_r == 0);
+      s1_beat_r <= s0_addr_r[5:3];
     end
 
   always @(posedge clk)
     if(s0_wen) begin
       s1_wen_r <= 1;
       s1_waddr_r <= {s0_set,
-        s0_mshrhit ? oh2idx(mshr_way) : oh2idx(s0_taghits),
+        s0_mshrhit ? oh2idx(mshr_way[s0_mshr]) : oh2idx(s0_taghits),
         s0_addr_r[5:3]};
       s1_wmask_r <= {4'b0,s0_wmask} << (s0_addr_r[2] * 4);
       s1_wdata_r <= {2{s0_wdata_aligned}};
     end else if(fill_wen) begin
       s1_wen_r <= 1;
       s1_waddr_r <= fill_index;
-      s1_wmask_r <= ~mshr_wmask[rbuf_head[2:0]*8+:8];
+      s1_wmask_r <= ~mshr_wmask[rbuf_mshr][fill_beat*8+:8];
       s1_wdata_r <= fill_data;
     end else
       s1_wen_r <= 0;
 
   // fill_*
+  // fill_done: the last beat is written (stores to s1 take priority)
+  wire [2:0] fill_beat;
+  assign fill_beat = rbuf_head[2:0] + rbuf_first;
+
   always @(*) begin
     fill_wen = rbuf_head != rbuf_tail;
-    fill_done = fill_wen & (&rbuf_head[2:0]);
-    fill_index = {addr2set({mshr_addr,4'b0}),oh2idx(mshr_way),rbuf_head[2:0]};
+    fill_done = fill_wen & ~s0_wen & (&rbuf_head[2:0]);
+    fill_index = {addr2set({mshr_addr[rbuf_mshr],4'b0}),oh2idx(mshr_way[rbuf_mshr]),fill_beat};
 
-    fill_data = rbuf_data[rbuf_head[2:0]];
+    fill_data = rbuf_data[fill_beat];
   end
 
   // s2 input latches
@@ -446,16 +560,16 @@ module dcache(
       if(l2_resp_valid & l2req_fwd_valid[0]) begin
         s2_req_r <= 1;
         s2_error_r <= 0;
-        s2_offset_r <= {1'b0,mshr_req_offset[1:0]};
-        s2_lsqid_r <= mshr_req_lsqid[3:0];
-        s2_op_r <= mshr_req_op[2:0];
+        s2_offset_r <= {1'b0,mshr_req_offset[resp_mshr][l2_resp_beat*4+:2]};
+        s2_lsqid_r <= mshr_req_lsqid[resp_mshr][l2_resp_beat*8+:4];
+        s2_op_r <= mshr_req_op[resp_mshr][l2_resp_beat*6+:3];
         s2_rdata_r <= l2_resp_rdata;
       end else if(l2_resp_valid & l2req_fwd_valid[1]) begin
         s2_req_r <= 1;
         s2_error_r <= 0;
-        s2_offset_r <= {1'b1,mshr_req_offset[3:2]};
-        s2_lsqid_r <= mshr_req_lsqid[7:4];
-        s2_op_r <= mshr_req_op[5:3];
+        s2_offset_r <= {1'b1,mshr_req_offset[resp_mshr][l2_resp_beat*4+2+:2]};
+        s2_lsqid_r <= mshr_req_lsqid[resp_mshr][l2_resp_beat*8+4+:4];
+        s2_op_r <= mshr_req_op[resp_mshr][l2_resp_beat*6+3+:3];
         s2_rdata_r <= l2_resp_rdata;
       end else if(s1_forward_r | s1_req_r) begin
         s2_req_r <= 1;
@@ -464,6 +578,9 @@ module dcache(
         s2_lsqid_r <= s1_lsqid_r;
         s2_op_r <= s1_op_r;
         s2_op2_r <= s1_op2_r;
+        s2_wide_r <= s1_wide_r;
+        s2_first_r <= s1_first_r;
+        s2_beat_r <= s1_beat_r;
         s2_rdata_r <= s1_forward_r ? rbuf_data[s1_raddr_r[2:0]] : datamem[s1_raddr_r];
       end else
         s2_req_r <= 0;
@@ -480,8 +597,31 @@ module dcache(
   // s2_bcmp_result
   integer l;
   always @(*)
-    for(l = 0; l < 8; l=l+1)
+    for(l = 0; l < 8; l=l+1) begin
       s2_bcmp_result[l] = s2_rdata_r[l*8+:8] == s2_op2_r;
+      s2_bcmp_empty[l] = s2_rdata_r[l*8+:8] == 8'h00;
+    end
+
+  // s2_bcmp64_r
+  always @(posedge clk)
+    if(s2_req_r & s2_burst & s2_wide_r)
+      s2_bcmp64_r <= s2_bcmp64_result;
+
+  // s2_bcmp64_result: first byte at or after the address (in the first beat)
+  // that matches or is empty, carried over from earlier beats
+  reg [7:0] s2_bcmp64_cand;
+  integer m;
+  always @(*) begin
+    s2_bcmp64_cand = (s2_bcmp_result | s2_bcmp_empty) &
+                     (s2_first_r ? 8'hff << s2_offset_r : 8'hff);
+    s2_bcmp64_result = 8'h40;
+    if(~s2_first_r & ~s2_bcmp64_r[6])
+      s2_bcmp64_result = s2_bcmp64_r;
+    else
+      for(m = 7; m >= 0; m=m-1)
+        if(s2_bcmp64_cand[m])
+          s2_bcmp64_result = {s2_bcmp_empty[m],1'b0,s2_beat_r,m[2:0]};
+  end
 
   /*verilator lint_off WIDTH*/
   // s2_rdata_*
@@ -514,9 +654,9 @@ module dcache(
     else begin
       // valid bits
       if(fill_done)
-        tagmem_valid[addr2set({mshr_addr,4'b0})][oh2idx(mshr_way)] <= 1;
+        tagmem_valid[addr2set({mshr_addr[rbuf_mshr],4'b0})][oh2idx(mshr_way[rbuf_mshr])] <= 1;
       else if((~s0_wen | s0_stall) & fill_wen)
-        tagmem_valid[addr2set({mshr_addr,4'b0})][oh2idx(mshr_way)] <= 0;
+        tagmem_valid[addr2set({mshr_addr[rbuf_mshr],4'b0})][oh2idx(mshr_way[rbuf_mshr])] <= 0;
       else if(s0_req_r & s0_inv_r & ~s0_mshrhit & ~s0_tagmiss)
         tagmem_valid[addr2set(s0_addr_r[31:2])][oh2idx(s0_taghits)] <= 0;
 
@@ -530,7 +670,8 @@ module dcache(
 
       // tag bits
       if(fill_done)
-        tagmem_tag[addr2set({mshr_addr,4'b0})][oh2idx(mshr_way)*19+:19] <= addr2tag({mshr_addr,4'b0});
+        tagmem_tag[addr2set({mshr_addr[rbuf_mshr],4'b0})][oh2idx(mshr_way[rbuf_mshr])*19+:19] <=
+          addr2tag({mshr_addr[rbuf_mshr],4'b0});
     end
 
   // datamem write
@@ -547,87 +688,94 @@ module dcache(
       mshr_valid <= 0;
     else begin
       if(s0_mshr_alloc) begin
-        mshr_valid <= 1;
-        mshr_obsolete <= 0;
-        mshr_addr <= s0_addr_r[31:6];
-        mshr_way <= s0_mshr_alloc_way;
-        mshr_req_valid <= ~s0_burst ? (1 << s0_addr_r[5:2]) : 0;
-        mshr_req_offset[s0_addr_r[5:2]*2+:2] <= s0_addr_r[1:0];
-        mshr_req_op[s0_addr_r[5:2]*3+:3] <= s0_op_r[3:1];
-        mshr_req_lsqid[s0_addr_r[5:2]*4+:4] <= s0_lsqid_r;
-        mshr_wen <= 0;
-        mshr_wmask <= 0;
+        mshr_valid[s0_mshr_free_idx] <= 1;
+        mshr_obsolete[s0_mshr_free_idx] <= 0;
+        mshr_addr[s0_mshr_free_idx] <= s0_addr_r[31:6];
+        mshr_way[s0_mshr_free_idx] <= s0_mshr_alloc_way;
+        mshr_req_valid[s0_mshr_free_idx] <= ~s0_burst ? (1 << s0_addr_r[5:2]) : 0;
+        mshr_req_offset[s0_mshr_free_idx][s0_addr_r[5:2]*2+:2] <= s0_addr_r[1:0];
+        mshr_req_op[s0_mshr_free_idx][s0_addr_r[5:2]*3+:3] <= s0_op_r[3:1];
+        mshr_req_lsqid[s0_mshr_free_idx][s0_addr_r[5:2]*4+:4] <= s0_lsqid_r;
+        mshr_wen[s0_mshr_free_idx] <= 0;
+        mshr_wmask[s0_mshr_free_idx] <= 0;
       end
 
       if(s0_req_r & s0_rd_merge) begin
-        mshr_req_valid[s0_addr_r[5:2]] <= 1;
-        mshr_req_offset[s0_addr_r[5:2]*2+:2] <= s0_addr_r[1:0];
-        mshr_req_op[s0_addr_r[5:2]*3+:3] <= s0_op_r[3:1];
-        mshr_req_lsqid[s0_addr_r[5:2]*4+:4] <= s0_lsqid_r;
+        mshr_req_valid[s0_mshr][s0_addr_r[5:2]] <= 1;
+        mshr_req_offset[s0_mshr][s0_addr_r[5:2]*2+:2] <= s0_addr_r[1:0];
+        mshr_req_op[s0_mshr][s0_addr_r[5:2]*3+:3] <= s0_op_r[3:1];
+        mshr_req_lsqid[s0_mshr][s0_addr_r[5:2]*4+:4] <= s0_lsqid_r;
       end
 
       if(s0_req_r & s0_wr_merge) begin
-        mshr_wen <= 1;
-        mshr_wmask[s0_addr_r[5:2]*4+:4] <= mshr_wmask[s0_addr_r[5:2]*4+:4] | s0_wmask;
+        mshr_wen[s0_mshr] <= 1;
+        mshr_wmask[s0_mshr][s0_addr_r[5:2]*4+:4] <=
+          mshr_wmask[s0_mshr][s0_addr_r[5:2]*4+:4] | s0_wmask;
       end
 
+      // not ready: one word was forwarded, or the rbuf is busy
       if(l2_resp_valid) begin
-        if(resp_ready) begin
-          mshr_req_valid <= {2'b0,mshr_req_valid[15:2]};
-          mshr_req_offset <= {4'b0,mshr_req_offset[31:4]};
-          mshr_req_op <= {6'b0,mshr_req_op[47:6]};
-          mshr_req_lsqid <= {8'b0,mshr_req_lsqid[63:8]};
-        end else
-          mshr_req_valid[0] <= 0;
+        if(resp_ready)
+          mshr_req_valid[resp_mshr][l2_resp_beat*2+:2] <= 0;
+        else if(l2req_fwd_valid[0])
+          mshr_req_valid[resp_mshr][l2_resp_beat*2] <= 0;
+        else if(l2req_fwd_valid[1])
+          mshr_req_valid[resp_mshr][l2_resp_beat*2+1] <= 0;
       end
 
       if(fill_done)
-        mshr_valid <= 0;
+        mshr_valid[rbuf_mshr] <= 0;
 
       if(lsq_dc_flush)
-        mshr_obsolete <= 1;
+        mshr_obsolete <= {MSHRS{1'b1}};
     end
 
   // rbuf write
   always @(posedge clk)
     if(rst) begin
+      rbuf_started <= 0;
       rbuf_head <= 0;
       rbuf_tail <= 0;
       rbuf_valid <= 0;
       rbuf_filled <= 0;
     end else begin
-      if(s0_mshr_alloc) begin
-        rbuf_started <= 0;
-        rbuf_valid <= 0;
-        rbuf_filled <= 0;
-      end
-
-      if(l2_resp_beat) begin
+      // the first beat of a line claims the rbuf for its mshr
+      if(l2_resp_take) begin
         rbuf_started <= 1;
         rbuf_tail <= rbuf_tail + 1;
-        rbuf_valid <= {rbuf_valid[6:0],1'b1};
-        rbuf_data[rbuf_tail[2:0]] <= l2_resp_rdata;
+        rbuf_data[l2_resp_beat] <= l2_resp_rdata;
+        if(~rbuf_started) begin
+          rbuf_mshr <= resp_mshr;
+          rbuf_first <= l2_resp_beat;
+          rbuf_valid <= 8'b1 << l2_resp_beat;
+          rbuf_filled <= 0;
+        end else
+          rbuf_valid[l2_resp_beat] <= 1;
       end
 
       if((~s0_wen | s0_stall) & fill_wen) begin
         rbuf_head <= rbuf_head + 1;
-        rbuf_filled <= {rbuf_filled[6:0],1'b1};
+        rbuf_filled[fill_beat] <= 1;
       end
+
+      if(fill_done)
+        rbuf_started <= 0;
     end
 
   // testbench callbacks
-  always @(posedge clk) begin
-    if(lsq_dc_req & dcache_lsq_ready)
-      top.tb_log_dcache_req(
-        lsq_dc_lsqid,
-        lsq_dc_op,
-        lsq_dc_addr,
-        lsq_dc_wdata);
-    if(dcache_lsq_valid)
-      top.tb_log_dcache_resp(
-        dcache_lsq_lsqid,
-        dcache_lsq_error,
-        dcache_lsq_rdata);
-  end
+  always @(posedge clk)
+    if(HARTID == 0) begin
+      if(lsq_dc_req & dcache_lsq_ready)
+        top.tb_log_dcache_req(
+          lsq_dc_lsqid,
+          lsq_dc_op,
+          lsq_dc_addr,
+          lsq_dc_wdata);
+      if(dcache_lsq_valid)
+        top.tb_log_dcache_resp(
+          dcache_lsq_lsqid,
+          dcache_lsq_error,
+          dcache_lsq_rdata);
+    end
 
 endmodule
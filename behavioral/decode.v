@@ -1,5 +1,9 @@
-// RISC-V instruction decoder
-module decode(
+// RISC-V instruction decoder: two lanes, the second taking the instruction
+// after the first when it only needs exers (see insndec)
+module decode #(
+  // the harness traces hart 0 only
+  parameter HARTID = 0
+  )(
   input         clk,
   input         rst,
 
@@ -10,8 +14,17 @@ module decode(
   input [31:0]  fetch_de_insn,
   input [15:0]  fetch_de_bptag,
   input         fetch_de_bptaken,
+  input [31:2]  fetch_de_jtarget,
   output        decode_stall,
 
+  input         fetch_de_valid_1,
+  input         fetch_de_error_1,
+  input [31:1]  fetch_de_addr_1,
+  input [31:0]  fetch_de_insn_1,
+  input [15:0]  fetch_de_bptag_1,
+  input         fetch_de_bptaken_1,
+  output        decode_stall_1,
+
   // rob interface
   output        decode_rob_valid,
   output        decode_error,
@@ -19,16 +32,33 @@ module decode(
   output [6:0]  decode_retop,
   output [15:0] decode_bptag,
   output        decode_bptaken,
+  output [31:2] decode_jtarget,
+  output        decode_call,
+  output        decode_return,
   input         rob_flush,
   input         rob_full,
   input [6:0]   rob_robid,
 
+  output        decode_rob_valid_1,
+  output        decode_error_1,
+  output [1:0]  decode_ecause_1,
+  output [6:0]  decode_retop_1,
+  output [15:0] decode_bptag_1,
+  output        decode_bptaken_1,
+  output        decode_call_1,
+  input         rob_full_1,
+  input [6:0]   rob_robid_1,
+
   // common rob/rename signals
   output [5:0]  decode_rd,
   output [31:2] decode_addr,
   output        decode_forward,
   output [31:2] decode_target,
 
+  output [5:0]  decode_rd_1,
+  output [31:2] decode_addr_1,
+  output [31:2] decode_target_1,
+
   // rename interface
   output        decode_rename_valid,
   output [4:0]  decode_rsop,
@@ -43,7 +73,18 @@ module decode(
   output [4:0]  decode_rs1,
   output [4:0]  decode_rs2,
   output [31:0] decode_imm,
-  input         rename_stall);
+  input         rename_stall,
+
+  output        decode_rename_valid_1,
+  output [4:0]  decode_rsop_1,
+  output [6:0]  decode_robid_1,
+  output        decode_uses_rs1_1,
+  output        decode_uses_rs2_1,
+  output        decode_uses_imm_1,
+  output        decode_uses_pc_1,
+  output [4:0]  decode_rs1_1,
+  output [4:0]  decode_rs2_1,
+  output [31:0] decode_imm_1);
 
   reg        valid;
   reg        error;
@@ -51,231 +92,152 @@ module decode(
   reg [31:0] insn;
   reg [15:0] bptag;
   reg        bptaken;
+  reg [31:2] jtarget;
 
-  reg        fmt_r, fmt_i, fmt_s, fmt_b, fmt_u, fmt_j, fmt_inv;
-  reg [31:0] imm;
-  reg [4:0]  rsop;
-
-  localparam
-    ERR_IALIGN   = 0,
-    ERR_IFAULT   = 1,
-    ERR_IILLEGAL = 2;
+  reg        valid_1;
+  reg        error_1;
+  reg [31:1] addr_1;
+  reg [31:0] insn_1;
+  reg [15:0] bptag_1;
+  reg        bptaken_1;
 
   localparam
     OPC_LOAD      = 5'b00000,
-    OPC_LOADFP    = 5'b00001,
     OPC_CUSTOM0   = 5'b00010,
     OPC_MISCMEM   = 5'b00011,
-    OPC_OPIMM     = 5'b00100,
-    OPC_AUIPC     = 5'b00101,
-    OPC_OPIMM32   = 5'b00110,
-    OPC_48B0      = 5'b00111,
     OPC_STORE     = 5'b01000,
-    OPC_STOREFP   = 5'b01001,
-    OPC_CUSTOM1   = 5'b01010,
-    OPC_AMO       = 5'b01011,
-    OPC_OP        = 5'b01100,
-    OPC_LUI       = 5'b01101,
-    OPC_OP32      = 5'b01110,
-    OPC_64B       = 5'b01111,
-    OPC_MADD      = 5'b10000,
-    OPC_MSUB      = 5'b10001,
-    OPC_NMSUB     = 5'b10010,
-    OPC_NMADD     = 5'b10011,
-    OPC_OPFP      = 5'b10100,
-    OPC_RESERVED0 = 5'b10101,
-    OPC_CUSTOM2   = 5'b10110,
-    OPC_48B1      = 5'b10111,
-    OPC_BRANCH    = 5'b11000,
     OPC_JALR      = 5'b11001,
-    OPC_RESERVED1 = 5'b11010,
-    OPC_JAL       = 5'b11011,
-    OPC_SYSTEM    = 5'b11100,
-    OPC_RESERVED2 = 5'b11101,
-    OPC_CUSTOM3   = 5'b11110,
-    OPC_80B       = 5'b11111;
-
-  // derived signals
-  wire [2:0] funct3;
-  assign funct3 = insn[14:12];
-
-  wire insn_load, insn_jalr, insn_auipc, insn_csr, insn_lbcmp, insn_aluext;
-  assign insn_load = (insn[6:2] == OPC_LOAD);
-  assign insn_jalr = (insn[6:2] == OPC_JALR);
-  assign insn_auipc = (insn[6:2] == OPC_AUIPC);
-  assign insn_csr = (insn[6:2] == OPC_SYSTEM) & (funct3[1:0] != 0);
-  assign insn_lbcmp = (insn[6:2] == OPC_CUSTOM0) & (funct3[1:0] == 2'b11);
-  assign insn_aluext = (insn[6:2] == OPC_CUSTOM1);
-
-  wire insn_complex;
-  assign insn_complex = fmt_r & insn[25];
-
-  wire [2:0] brop;
-  assign brop = {~|funct3[2:1],funct3[2:1]};
-
-  // SRLI alternation: special case
-  wire altop;
-  assign altop = (fmt_r | (funct3 == 3'b101)) & insn[30];
-
-  wire [4:0] rs1, rs2, rd;
-  assign rs1 = insn[19:15];
-  assign rs2 = insn[24:20];
-  assign rd = insn[11:7];
-
-  wire [2:0] csrop;
-  assign csrop = (funct3[1] & (rs1 == 0)) ? 3'b000 : funct3;
-
-  wire uses_rd, uses_rs1, uses_rs2;
-  assign uses_rd = (fmt_r | fmt_i | fmt_u | fmt_j) & (rd != 0);
-  assign uses_rs1 = fmt_r | (fmt_i & (~insn_csr | ~funct3[2])) | fmt_s | fmt_b;
-  assign uses_rs2 = fmt_r | fmt_s | fmt_b;
-
-  wire target_ntaken;
-  assign target_ntaken = (fmt_b & bptaken) | insn_jalr;
-
-  // TODO misaligned target?
-  wire [31:1] target;
-  assign target = {addr[31:2],1'b0} + (target_ntaken ? 31'd2 : imm[31:1]);
+    OPC_SYSTEM    = 5'b11100;
+
+  // the second lane only takes what rename dispatches to exers and what
+  // retires without side effects beyond the register file: no loads,
+  // stores, lbcmp, fences, csr/system insns or jalr
+  wire [4:0] opc_1;
+  assign opc_1 = fetch_de_insn_1[6:2];
+
+  wire pair_ok;
+  assign pair_ok = (opc_1 != OPC_LOAD) & (opc_1 != OPC_CUSTOM0) & (opc_1 != OPC_MISCMEM) &
+                   (opc_1 != OPC_STORE) & (opc_1 != OPC_JALR) & (opc_1 != OPC_SYSTEM);
+
+  // a pair needs two rob entries
+  wire rob_stall;
+  assign rob_stall = valid_1 ? rob_full_1 : rob_full;
+
+  wire [31:0] imm, imm_1;
+
+  insndec dec(
+    .error(error),
+    .addr(addr),
+    .insn(insn),
+    .bptaken(bptaken),
+    .dec_error(decode_error),
+    .ecause(decode_ecause),
+    .retop(decode_retop),
+    .is_call(decode_call),
+    .is_return(decode_return),
+    .rd(decode_rd),
+    .forward(decode_forward),
+    .target(decode_target),
+    .rsop(decode_rsop),
+    .uses_rs1(decode_uses_rs1),
+    .uses_rs2(decode_uses_rs2),
+    .uses_imm(decode_uses_imm),
+    .uses_memory(decode_uses_memory),
+    .uses_pc(decode_uses_pc),
+    .csr_access(decode_csr_access),
+    .inhibit(decode_inhibit),
+    .rs1(decode_rs1),
+    .rs2(decode_rs2),
+    .rs_imm(decode_imm),
+    .imm(imm));
+
+  insndec dec_1(
+    .error(error_1),
+    .addr(addr_1),
+    .insn(insn_1),
+    .bptaken(bptaken_1),
+    .dec_error(decode_error_1),
+    .ecause(decode_ecause_1),
+    .retop(decode_retop_1),
+    .is_call(decode_call_1),
+    .is_return(),
+    .rd(decode_rd_1),
+    .forward(),
+    .target(decode_target_1),
+    .rsop(decode_rsop_1),
+    .uses_rs1(decode_uses_rs1_1),
+    .uses_rs2(decode_uses_rs2_1),
+    .uses_imm(decode_uses_imm_1),
+    .uses_memory(),
+    .uses_pc(decode_uses_pc_1),
+    .csr_access(),
+    .inhibit(),
+    .rs1(decode_rs1_1),
+    .rs2(decode_rs2_1),
+    .rs_imm(decode_imm_1),
+    .imm(imm_1));
 
   // fetch interface
-  assign decode_stall = rob_full | rename_stall;
+  assign decode_stall = rob_stall | rename_stall;
+  assign decode_stall_1 = decode_stall | ~pair_ok;
 
   // rob interface
-  assign decode_rob_valid = valid & ~rename_stall;
-  assign decode_error = error | fmt_inv;
-  assign decode_ecause = error ? (addr[1] ? ERR_IALIGN : ERR_IFAULT) : ERR_IILLEGAL;
-  assign decode_retop = {fmt_b,insn_csr,insn_jalr,fmt_s,funct3};
+  assign decode_rob_valid = valid & ~rename_stall & ~rob_stall;
   assign decode_bptag = bptag;
   assign decode_bptaken = bptaken;
+  assign decode_jtarget = jtarget;
+
+  assign decode_rob_valid_1 = valid_1 & ~rename_stall & ~rob_stall;
+  assign decode_bptag_1 = bptag_1;
+  assign decode_bptaken_1 = bptaken_1;
 
   // common rob/rename signals
-  assign decode_rd = {~uses_rd,rd};
   assign decode_addr = addr[31:2];
-  assign decode_forward = insn_jalr;
-  assign decode_target = target[31:2];
+  assign decode_addr_1 = addr_1[31:2];
 
   // rename interface
-  assign decode_rename_valid = valid & ~decode_error & ~rob_full;
-  assign decode_rsop = rsop;
+  assign decode_rename_valid = valid & ~decode_error & ~rob_stall;
   assign decode_robid = rob_robid;
-  assign decode_uses_rs1 = uses_rs1;
-  assign decode_uses_rs2 = uses_rs2;
-  assign decode_uses_imm = ~fmt_r & ~fmt_b;
-  assign decode_uses_memory = insn_load | fmt_s | insn_lbcmp;
-  assign decode_uses_pc = fmt_j | insn_auipc;
-  assign decode_csr_access = insn_csr;
-  assign decode_inhibit = insn_jalr;
-  assign decode_rs1 = rs1;
-  assign decode_rs2 = rs2;
-  assign decode_imm = fmt_j ? 4 : imm;
+
+  assign decode_rename_valid_1 = valid_1 & ~decode_error_1 & ~rob_stall;
+  assign decode_robid_1 = rob_robid_1;
 
   always @(posedge clk)
-    if(rst | rob_flush)
+    if(rst | rob_flush) begin
       valid <= 0;
-    else if(~decode_stall) begin
+      valid_1 <= 0;
+    end else if(~decode_stall) begin
       valid <= fetch_de_valid;
+      valid_1 <= fetch_de_valid_1 & pair_ok;
       if(fetch_de_valid) begin
         error <= fetch_de_error;
         addr <= fetch_de_addr;
         insn <= fetch_de_insn;
         bptag <= fetch_de_bptag;
         bptaken <= fetch_de_bptaken;
+        jtarget <= fetch_de_jtarget;
+      end
+      if(fetch_de_valid_1) begin
+        error_1 <= fetch_de_error_1;
+        addr_1 <= fetch_de_addr_1;
+        insn_1 <= fetch_de_insn_1;
+        bptag_1 <= fetch_de_bptag_1;
+        bptaken_1 <= fetch_de_bptaken_1;
       end
     end
 
-  // format decoder
-  always @(*) begin
-    {fmt_r,fmt_i,fmt_s,fmt_b,fmt_u,fmt_j,fmt_inv} = 0;
-
-    if(insn[1:0] != 2'b11)
-      fmt_inv = 1;
-    else case(insn[6:2])
-      // implemented opcodes
-      OPC_OP: fmt_r = 1;
-      OPC_OPIMM: fmt_i = 1;
-
-      OPC_LUI: fmt_u = 1;
-      OPC_AUIPC: fmt_u = 1;
-
-      OPC_LOAD: fmt_i = 1;
-      OPC_STORE: fmt_s = 1;
-
-      OPC_BRANCH: fmt_b = 1;
-      OPC_JAL: fmt_j = 1;
-      OPC_JALR: fmt_i = 1;
-
-      OPC_MISCMEM: fmt_i = 1;
-      OPC_SYSTEM: fmt_i = 1;
-
-      OPC_CUSTOM0: fmt_r = 1;
-      OPC_CUSTOM1: fmt_r = 1;
-
-      // unimplemented opcodes
-      // floating point
-      OPC_OPFP: fmt_inv = 1;
-      OPC_LOADFP: fmt_inv = 1;
-      OPC_STOREFP: fmt_inv = 1;
-      OPC_MADD: fmt_inv = 1;
-      OPC_MSUB: fmt_inv = 1;
-      OPC_NMSUB: fmt_inv = 1;
-      OPC_NMADD: fmt_inv = 1;
-
-      // atomic memory operations
-      OPC_AMO: fmt_inv = 1;
-
-      // RV64 32-bit insns (unused in RV32)
-      OPC_OP32: fmt_inv = 1;
-      OPC_OPIMM32: fmt_inv = 1;
-
-      // custom instructions
-      OPC_CUSTOM2: fmt_inv = 1;
-      OPC_CUSTOM3: fmt_inv = 1;
-
-      // reserved
-      OPC_RESERVED0: fmt_inv = 1;
-      OPC_RESERVED1: fmt_inv = 1;
-      OPC_RESERVED2: fmt_inv = 1;
-      OPC_48B0: fmt_inv = 1;
-      OPC_48B1: fmt_inv = 1;
-      OPC_64B: fmt_inv = 1;
-      OPC_80B: fmt_inv = 1;
-    endcase
-  end
-
-  /*verilator lint_off WIDTH*/
-  // immediate generator
-  always @(*) begin
-    imm = 0;
-    case(1)
-      fmt_i: imm = $signed(insn[31:20]);
-      fmt_s: imm = $signed({insn[31:25],insn[11:7]});
-      fmt_b: imm = $signed({insn[31],insn[7],insn[30:25],insn[11:8],1'b0});
-      fmt_u: imm = {insn[31:12],12'b0};
-      fmt_j: imm = $signed({insn[31],insn[19:12],insn[20],insn[30:21],1'b0});
-    endcase
-  end
-  /*verilator lint_off WIDTH*/
-
-  // rsop
-  always @(*)
-    case(1)
-      decode_uses_memory:
-        rsop = {1'b0,fmt_s,funct3};
-      fmt_j, insn_jalr, fmt_u:
-        rsop = 5'b00000;
-      fmt_b:
-        rsop = {2'b01,brop};
-      insn_csr:
-        rsop = {2'b00,csrop};
-      default:
-        rsop = {insn_complex|insn_aluext,insn_complex|altop,funct3};
-    endcase
-
   always @(posedge clk)
-    if(valid & ~decode_stall)
-      top.tb_trace_decode(
-        decode_robid,
-        insn,
-        imm);
+    if((HARTID == 0) & ~decode_stall) begin
+      if(valid)
+        top.tb_trace_decode(
+          decode_robid,
+          insn,
+          imm);
+      if(valid_1)
+        top.tb_trace_decode(
+          decode_robid_1,
+          insn_1,
+          imm_1);
+    end
 
 endmodule
@@ -97,6 +97,10 @@ module dramctl(
   reg [4:0]  resp_tag_r;
   reg [31:2] resp_addr_r;
 
+  // a BusRd names the beat to send first in its data lines, kept by tag
+  // until the Fill (dramsim only deals in whole lines)
+  reg [2:0]  first_beat [0:31];
+
   always @(posedge clk)
     if(rst) begin
       dramctl_bus_req <= 0;
@@ -112,6 +116,8 @@ module dramctl(
       cmd_write_r <= cmd_write;
       cmd_tag_r <= bus_tag;
       cmd_addr_r <= mem_addr;
+      if(cmd_relevant & dramsim_ready & ~cmd_write)
+        first_beat[bus_tag] <= bus_data[2:0];
     end else if(bus_cycle_r == 0) begin
       // now that we have gathered any wdata, send request
       if(cmd_valid_r)
@@ -120,6 +126,10 @@ module dramctl(
       // previous cycle
       if(dramctl_bus_req & bus_dramctl_grant) begin
         `RESPDATA(resp_tag_r, resp_addr_r, dram_rdata_r);
+        // rotate the line so the first beat goes out first
+        /*verilator lint_off WIDTH*/
+        dram_rdata_r = {dram_rdata_r,dram_rdata_r} >> (first_beat[resp_tag_r]*64);
+        /*verilator lint_on WIDTH*/
         dramctl_bus_tag <= resp_tag_r;
         /*verilator lint_off WIDTH*/
         dramctl_bus_addr <= (RAM_BASE/16) + resp_addr_r[31:6];
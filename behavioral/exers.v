@@ -14,6 +14,14 @@ module exers #(
   input [31:0]  rename_op1,
   input         rename_op2ready,
   input [31:0]  rename_op2,
+  input         rename_exers_write_1,
+  input [4:0]   rename_op_1,
+  input [6:0]   rename_robid_1,
+  input [5:0]   rename_rd_1,
+  input         rename_op1ready_1,
+  input [31:0]  rename_op1_1,
+  input         rename_op2ready_1,
+  input [31:0]  rename_op2_1,
   output reg    exers_stall,
 
   // common scalu/mcalu signals
@@ -61,6 +69,8 @@ module exers #(
   reg issue_valid;
   reg issue_stall;
   reg[$clog2(RS_ENTRIES)-1:0] insert_idx;
+  reg[$clog2(RS_ENTRIES)-1:0] insert_last_idx;
+  reg[$clog2(RS_ENTRIES)-1:0] insert_idx_1;
   reg rs_full;
   reg is_sc_op;
 
@@ -81,6 +91,20 @@ module exers #(
       find_idx[$clog2(RS_ENTRIES)] = (bit_val ? (| vector) : (& vector));
     end
   endfunction
+
+  // Same, searching from the top (a second entry for the second lane)
+  function automatic [$clog2(RS_ENTRIES):0] find_last_idx
+    (input[RS_ENTRIES-1:0] vector, input bit_val);
+    integer j;
+    begin
+      for (j = RS_ENTRIES-1; j >= 0; j=j-1)
+        if (vector[j] == bit_val) begin
+          find_last_idx[$clog2(RS_ENTRIES)-1:0] = j;
+          j = -1;
+        end
+      find_last_idx[$clog2(RS_ENTRIES)] = (bit_val ? (| vector) : (& vector));
+    end
+  endfunction
   /*verilator lint_on WIDTH*/
 
   always @(posedge clk) begin
@@ -99,6 +123,16 @@ module exers #(
       rs_op2ready[insert_idx] <= rename_op2ready;
       rs_op2[insert_idx] <= rename_op2;
     end
+    if (rename_exers_write_1 & (~exers_stall)) begin
+      rs_valid[insert_idx_1] <= 1'b1;
+      rs_op[insert_idx_1] <= rename_op_1;
+      rs_rd[insert_idx_1] <= rename_rd_1;
+      rs_robid[insert_idx_1] <= rename_robid_1;
+      rs_op1ready[insert_idx_1] <= rename_op1ready_1;
+      rs_op1[insert_idx_1] <= rename_op1_1;
+      rs_op2ready[insert_idx_1] <= rename_op2ready_1;
+      rs_op2[insert_idx_1] <= rename_op2_1;
+    end
     // Dependency resolution: matching tags on valid writeback/uses rd
     for (i = 0; i  < RS_ENTRIES; i = i + 1) begin
       if (resolve_valid & rs_valid[i] & (~rs_op1ready[i]) & (rs_op1[i][6:0] == wb_robid)) begin
@@ -144,9 +178,12 @@ module exers #(
       issue_stall = issue_valid;
 
     {rs_full, insert_idx} = find_idx(rs_valid, 0);
+    {rs_full, insert_last_idx} = find_last_idx(rs_valid, 0);
+    insert_idx_1 = rename_exers_write ? insert_last_idx : insert_idx;
 
-    // Stall combinational
-    exers_stall = rs_full;
+    // Stall combinational: a pair needs two free entries
+    exers_stall = rs_full |
+                  (rename_exers_write & rename_exers_write_1 & (insert_idx == insert_last_idx));
   end
   
 endmodule
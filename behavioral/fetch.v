@@ -1,5 +1,13 @@
-// instruction fetch unit
-module fetch(
+// front end and retirement width (1 or 2), set from the build
+`ifndef CPU_WIDTH
+`define CPU_WIDTH 2
+`endif
+
+// instruction fetch unit: fetches aligned 64-bit blocks and hands decode up
+// to WIDTH instructions per cycle
+module fetch #(
+  parameter WIDTH = `CPU_WIDTH
+  )(
   input         clk,
   input         rst,
 
@@ -10,7 +18,7 @@ module fetch(
   input         icache_ready,
   input         icache_valid,
   input         icache_error,
-  input [31:0]  icache_data,
+  input [63:0]  icache_data,
 
   // brpred interface
   output        fetch_bp_req,
@@ -25,11 +33,30 @@ module fetch(
   output [31:0] fetch_de_insn,
   output [15:0] fetch_de_bptag,
   output        fetch_de_bptaken,
+  output [31:2] fetch_de_jtarget,
   input         decode_stall,
 
+  // second decode lane: the instruction after fetch_de_*
+  output        fetch_de_valid_1,
+  output        fetch_de_error_1,
+  output [31:1] fetch_de_addr_1,
+  output [31:0] fetch_de_insn_1,
+  output [15:0] fetch_de_bptag_1,
+  output        fetch_de_bptaken_1,
+  input         decode_stall_1,
+
   // rob interface
   input         rob_flush,
-  input [31:2]  rob_flush_pc);
+  input [31:2]  rob_flush_pc,
+  input [31:0]  rob_ret_result,
+  input         rob_ret_call,
+  input         rob_ret_return,
+  input         rob_ret_jalr,
+  input [31:2]  rob_ret_addr,
+  input [31:2]  rob_ret_jtarget);
+
+  localparam RAS_SIZE = 8;
+  localparam BTB_SIZE = 16;
 
   reg [31:1] pc;
 
@@ -38,7 +65,8 @@ module fetch(
   reg [31:1] buf_addr [0:15];
   reg [31:0] buf_insn [0:15];
   reg [15:0] buf_bptag [0:15];
-  reg [15:0] buf_bptaken;
+  reg [15:0] buf_bptaken; // for jalr: target predicted
+  reg [31:2] buf_jtarget [0:15];
 
   // buf_tail advanced upon issuing icache requests
   // buf_mid advanced upon receiving icache responses
@@ -49,6 +77,11 @@ module fetch(
 
   reg        bp_req_r;
   reg        insn_jal_r;
+  reg        split_r;
+  reg [3:0]  cf_idx_r;
+  reg [4:0]  cf_end_r;
+  reg        jalr_pred_r;
+  reg [31:2] jalr_target_r;
   reg        jalr_halt_r;
   reg        misalign_err_r;
 
@@ -72,25 +105,118 @@ module fetch(
   assign buf_empty = (buf_head == buf_tail) & (buf_head_pol == buf_tail_pol);
   assign buf_full  = (buf_head == buf_tail) & (buf_head_pol != buf_tail_pol);
 
-  wire [3:0] buf_mid_prev;
-  assign buf_mid_prev = buf_mid - 1;
+  wire [4:0] buf_used;
+  assign buf_used = {buf_tail_pol,buf_tail} - {buf_head_pol,buf_head};
+
+  wire [3:0] buf_head_1, buf_tail_1, buf_mid_1;
+  assign buf_head_1 = buf_head + 1;
+  assign buf_tail_1 = buf_tail + 1;
+  assign buf_mid_1 = buf_mid + 1;
+
+  // a request from the first word of a block takes two entries
+  wire fetch_two;
+  assign fetch_two = (WIDTH > 1) & ~pc[2];
+
+  wire buf_room;
+  assign buf_room = fetch_two ? (buf_used < 15) : ~buf_full;
 
   wire icache_beat;
   assign icache_beat = fetch_ic_req & icache_ready;
 
-  wire decode_beat;
+  wire decode_beat, decode_beat_1;
   assign decode_beat = fetch_de_valid & ~decode_stall;
+  assign decode_beat_1 = fetch_de_valid_1 & ~decode_stall_1;
+
+  // the response fills buf_mid, and buf_mid_1 if that was requested too
+  wire        resp_two;
+  wire [31:0] ic_insn0, ic_insn1;
+  assign resp_two = (WIDTH > 1) & ~buf_addr[buf_mid][2];
+  assign ic_insn0 = buf_addr[buf_mid][2] ? icache_data[63:32] : icache_data[31:0];
+  assign ic_insn1 = icache_data[63:32];
+
+  wire ic_ok;
+  assign ic_ok = icache_valid & ~icache_error;
+
+  wire br0, jal0, jalr0, cf0;
+  assign br0   = ic_ok & (ic_insn0[6:0] == 7'b1100011);
+  assign jal0  = ic_ok & (ic_insn0[6:0] == 7'b1101111);
+  assign jalr0 = ic_ok & (ic_insn0[6:0] == 7'b1100111);
+  assign cf0 = br0 | jal0 | jalr0;
+
+  wire br1, jal1, jalr1, cf1;
+  assign br1   = ic_ok & resp_two & (ic_insn1[6:0] == 7'b1100011);
+  assign jal1  = ic_ok & resp_two & (ic_insn1[6:0] == 7'b1101111);
+  assign jalr1 = ic_ok & resp_two & (ic_insn1[6:0] == 7'b1100111);
+  assign cf1 = br1 | jal1 | jalr1;
+
+  // only the first control transfer of a block is predicted. The word after
+  // a jal/jalr is dropped; one after a branch is kept unless it is a control
+  // transfer too, in which case it is refetched if the branch falls through
+  wire keep1, split;
+  assign keep1 = resp_two & (~cf0 | (br0 & ~cf1));
+  assign split = resp_two & br0 & cf1;
+
+  // the control transfer: its word, entry and the entry following it
+  wire        cf_slot;
+  wire [31:0] cf_insn;
+  wire [3:0]  cf_idx;
+  wire [4:0]  cf_end;
+  assign cf_slot = ~cf0;
+  assign cf_insn = cf_slot ? ic_insn1 : ic_insn0;
+  assign cf_idx = cf_slot ? buf_mid_1 : buf_mid;
+  assign cf_end = {buf_mid_pol,buf_mid} + (cf_slot ? 5'd2 : 5'd1);
 
   wire insn_br, insn_jal, insn_jalr;
-  assign insn_br   = icache_valid & ~icache_error & (icache_data[6:0] == 7'b1100011);
-  assign insn_jal  = icache_valid & ~icache_error & (icache_data[6:0] == 7'b1101111);
-  assign insn_jalr = icache_valid & ~icache_error & (icache_data[6:0] == 7'b1100111);
+  assign insn_br   = br0 | (cf_slot & br1);
+  assign insn_jal  = jal0 | (cf_slot & jal1);
+  assign insn_jalr = jalr0 | (cf_slot & jalr1);
 
   wire br_taken;
   assign br_taken = bp_req_r & brpred_bptaken;
 
   wire setpc;
-  assign setpc = rob_flush | br_taken | insn_jal_r;
+  assign setpc = rob_flush | br_taken | insn_jal_r | jalr_pred_r | split_r;
+
+  // return address stack: speculative copy updated in fetch, committed copy
+  // updated at retirement and copied back on rob_flush
+  reg [31:2] ras [0:RAS_SIZE-1];
+  reg [2:0]  ras_ptr;
+  reg [3:0]  ras_cnt;
+  reg [31:2] cras [0:RAS_SIZE-1];
+  reg [2:0]  cras_ptr, cras_ptr_n;
+  reg [3:0]  cras_cnt, cras_cnt_n;
+
+  // indirect jump target buffer (direct-mapped)
+  reg [BTB_SIZE-1:0] btb_valid;
+  reg [31:6] btb_tag [0:BTB_SIZE-1];
+  reg [31:2] btb_target [0:BTB_SIZE-1];
+
+  // calls link through x1/x5, returns jump through them (see decode)
+  wire ic_rd_link, ic_rs1_link;
+  assign ic_rd_link = (cf_insn[11:7] == 5'd1) | (cf_insn[11:7] == 5'd5);
+  assign ic_rs1_link = (cf_insn[19:15] == 5'd1) | (cf_insn[19:15] == 5'd5);
+
+  wire insn_return;
+  assign insn_return = insn_jalr & ic_rs1_link & ~ic_rd_link;
+
+  wire ras_push, ras_pop;
+  assign ras_push = (insn_jal | insn_jalr) & ic_rd_link & ~setpc;
+  assign ras_pop = insn_return & (ras_cnt != 0) & ~setpc;
+
+  wire [31:2] ic_addr, ic_link;
+  assign ic_addr = buf_addr[cf_idx][31:2];
+  assign ic_link = ic_addr + 1;
+
+  wire [3:0] btb_idx;
+  wire       btb_hit;
+  assign btb_idx = ic_addr[5:2];
+  assign btb_hit = btb_valid[btb_idx] & (btb_tag[btb_idx] == ic_addr[31:6]);
+
+  // jalr with a predicted target redirects like a jal instead of halting
+  wire        jalr_pred;
+  wire [31:2] jalr_target;
+  assign jalr_pred = insn_jalr & (insn_return ? (ras_cnt != 0) : btb_hit);
+  assign jalr_target = insn_return ? ras[ras_ptr] : btb_target[btb_idx];
 
   wire pc_misaligned;
   assign pc_misaligned = pc[1];
@@ -99,13 +225,14 @@ module fetch(
   assign gen_misalign_err = pc_misaligned & ~misalign_err_r & ~buf_full & ~setpc;
 
   // fetch interface
-  assign fetch_ic_req = ~buf_full & ~fetch_ic_flush & ~jalr_halt_r & ~pc_misaligned;
+  assign fetch_ic_req = buf_room & ~fetch_ic_flush & ~jalr_halt_r & ~pc_misaligned;
   assign fetch_ic_addr = pc[31:2];
   assign fetch_ic_flush = setpc | insn_jalr;
 
-  // brpred interface
-  assign fetch_bp_req = insn_br;
-  assign fetch_bp_addr = buf_addr[buf_mid][31:2];
+  // brpred interface: a branch fetched as setpc redirects is on the wrong
+  // path, and its prediction must not reach the speculative history
+  assign fetch_bp_req = insn_br & ~setpc;
+  assign fetch_bp_addr = ic_addr;
 
   // decode interface
   assign fetch_de_valid = ~buf_empty & buf_valid[buf_head];
@@ -114,6 +241,14 @@ module fetch(
   assign fetch_de_insn = buf_insn[buf_head];
   assign fetch_de_bptag = buf_bptag[buf_head];
   assign fetch_de_bptaken = buf_bptaken[buf_head];
+  assign fetch_de_jtarget = buf_jtarget[buf_head];
+
+  assign fetch_de_valid_1 = (WIDTH > 1) & fetch_de_valid & (buf_used > 1) & buf_valid[buf_head_1];
+  assign fetch_de_error_1 = buf_error[buf_head_1];
+  assign fetch_de_addr_1 = buf_addr[buf_head_1];
+  assign fetch_de_insn_1 = buf_insn[buf_head_1];
+  assign fetch_de_bptag_1 = buf_bptag[buf_head_1];
+  assign fetch_de_bptaken_1 = buf_bptaken[buf_head_1];
 
   // pc
   always @(posedge clk)
@@ -122,30 +257,35 @@ module fetch(
     else if(rob_flush)
       pc <= {rob_flush_pc,1'b0};
     else if(br_taken)
-      pc <= br_target(buf_addr[buf_mid_prev][31:2], buf_insn[buf_mid_prev]);
+      pc <= br_target(buf_addr[cf_idx_r][31:2], buf_insn[cf_idx_r]);
     else if(insn_jal_r)
-      pc <= jal_target(buf_addr[buf_mid_prev][31:2], buf_insn[buf_mid_prev]);
+      pc <= jal_target(buf_addr[cf_idx_r][31:2], buf_insn[cf_idx_r]);
+    else if(jalr_pred_r)
+      pc <= {jalr_target_r,1'b0};
+    else if(split_r)
+      pc <= {buf_addr[cf_idx_r][31:2] + 30'd1,1'b0};
     else if(icache_beat)
-      pc <= pc + 2;
+      pc <= fetch_two ? pc + 4 : pc + 2;
 
   // buf_tail
   always @(posedge clk)
     if(rst | rob_flush) begin
       buf_tail <= 0;
       buf_tail_pol <= 0;
-    end else if(setpc) begin
-      buf_tail <= buf_mid;
-      buf_tail_pol <= buf_mid_pol;
-    end else if(icache_beat)
-      {buf_tail_pol,buf_tail} <= {buf_tail_pol,buf_tail} + 1;
+    end else if(setpc)
+      {buf_tail_pol,buf_tail} <= cf_end_r;
+    else if(icache_beat)
+      {buf_tail_pol,buf_tail} <= {buf_tail_pol,buf_tail} + (fetch_two ? 5'd2 : 5'd1);
 
   // buf_mid
   always @(posedge clk)
     if(rst | rob_flush) begin
       buf_mid <= 0;
       buf_mid_pol <= 0;
-    end else if(icache_valid & ~setpc)
-      {buf_mid_pol,buf_mid} <= {buf_mid_pol,buf_mid} + 1;
+    end else if(setpc)
+      {buf_mid_pol,buf_mid} <= cf_end_r;
+    else if(icache_valid)
+      {buf_mid_pol,buf_mid} <= {buf_mid_pol,buf_mid} + (keep1 ? 5'd2 : 5'd1);
 
   // buf_head
   always @(posedge clk)
@@ -153,7 +293,7 @@ module fetch(
       buf_head <= 0;
       buf_head_pol <= 0;
     end else if(decode_beat)
-      {buf_head_pol,buf_head} <= {buf_head_pol,buf_head} + 1;
+      {buf_head_pol,buf_head} <= {buf_head_pol,buf_head} + (decode_beat_1 ? 5'd2 : 5'd1);
 
   // buf
   always @(posedge clk)
@@ -169,19 +309,34 @@ module fetch(
       if(icache_beat) begin
         buf_valid[buf_tail] <= 0;
         buf_addr[buf_tail] <= pc;
+        if(fetch_two) begin
+          buf_valid[buf_tail_1] <= 0;
+          buf_addr[buf_tail_1] <= pc + 2;
+        end
       end
 
+      // branches become valid with their prediction
       if(icache_valid) begin
-        if(~fetch_bp_req)
+        if(~br0)
           buf_valid[buf_mid] <= 1;
         buf_error[buf_mid] <= icache_error;
-        buf_insn[buf_mid] <= icache_data;
+        buf_insn[buf_mid] <= ic_insn0;
+        if(keep1) begin
+          if(~br1)
+            buf_valid[buf_mid_1] <= 1;
+          buf_error[buf_mid_1] <= icache_error;
+          buf_insn[buf_mid_1] <= ic_insn1;
+        end
+        if(insn_jalr) begin
+          buf_bptaken[cf_idx] <= jalr_pred;
+          buf_jtarget[cf_idx] <= jalr_target;
+        end
       end
 
       if(bp_req_r) begin
-        buf_valid[buf_mid_prev] <= 1;
-        buf_bptag[buf_mid_prev] <= brpred_bptag;
-        buf_bptaken[buf_mid_prev] <= brpred_bptaken;
+        buf_valid[cf_idx_r] <= 1;
+        buf_bptag[cf_idx_r] <= brpred_bptag;
+        buf_bptaken[cf_idx_r] <= brpred_bptaken;
       end
     end
 
@@ -199,13 +354,95 @@ module fetch(
     else
       insn_jal_r <= insn_jal;
 
+  // split_r
+  always @(posedge clk)
+    if(rst | setpc)
+      split_r <= 0;
+    else
+      split_r <= split;
+
+  // cf_idx_r, cf_end_r: the control transfer redirecting next cycle
+  always @(posedge clk)
+    if(~setpc) begin
+      cf_idx_r <= cf_idx;
+      cf_end_r <= cf_end;
+    end
+
+  // jalr_pred_r
+  always @(posedge clk)
+    if(rst | setpc)
+      jalr_pred_r <= 0;
+    else
+      jalr_pred_r <= jalr_pred;
+
+  always @(posedge clk)
+    if(jalr_pred)
+      jalr_target_r <= jalr_target;
+
   // jalr_halt_r
   always @(posedge clk)
     if(rst | setpc)
       jalr_halt_r <= 0;
-    else if(insn_jalr)
+    else if(insn_jalr & ~jalr_pred)
       jalr_halt_r <= 1;
 
+  // cras_*_n: committed ras after this cycle's retirement
+  always @(*) begin
+    cras_ptr_n = cras_ptr;
+    cras_cnt_n = cras_cnt;
+    if(rob_ret_call) begin
+      cras_ptr_n = cras_ptr + 1;
+      if(cras_cnt != RAS_SIZE)
+        cras_cnt_n = cras_cnt + 1;
+    end else if(rob_ret_return & (cras_cnt != 0)) begin
+      cras_ptr_n = cras_ptr - 1;
+      cras_cnt_n = cras_cnt - 1;
+    end
+  end
+
+  // cras
+  always @(posedge clk)
+    if(rst) begin
+      cras_ptr <= 0;
+      cras_cnt <= 0;
+    end else begin
+      cras_ptr <= cras_ptr_n;
+      cras_cnt <= cras_cnt_n;
+      if(rob_ret_call)
+        cras[cras_ptr_n] <= rob_ret_result[31:2];
+    end
+
+  // ras
+  integer i;
+  always @(posedge clk)
+    if(rst) begin
+      ras_ptr <= 0;
+      ras_cnt <= 0;
+    end else if(rob_flush) begin
+      for(i = 0; i < RAS_SIZE; i=i+1)
+        ras[i] <= (rob_ret_call & (cras_ptr_n == i)) ? rob_ret_result[31:2] : cras[i];
+      ras_ptr <= cras_ptr_n;
+      ras_cnt <= cras_cnt_n;
+    end else if(ras_push) begin
+      ras[ras_ptr + 3'd1] <= ic_link;
+      ras_ptr <= ras_ptr + 1;
+      if(ras_cnt != RAS_SIZE)
+        ras_cnt <= ras_cnt + 1;
+    end else if(ras_pop) begin
+      ras_ptr <= ras_ptr - 1;
+      ras_cnt <= ras_cnt - 1;
+    end
+
+  // btb: trained by retired jalrs other than returns
+  always @(posedge clk)
+    if(rst)
+      btb_valid <= 0;
+    else if(rob_ret_jalr) begin
+      btb_valid[rob_ret_addr[5:2]] <= 1;
+      btb_tag[rob_ret_addr[5:2]] <= rob_ret_addr[31:6];
+      btb_target[rob_ret_addr[5:2]] <= rob_ret_jtarget;
+    end
+
   // misalign_err_r
   always @(posedge clk)
     if(rst | setpc)
@@ -0,0 +1,379 @@
+`include "buscmd.vh"
+
+// hash probe engine for the open-addressing sets in tests/hashset.c
+// Walks the metadata bytes (0x80 | partial hash, 0 when empty) a line at a
+// time from hash % capacity, checks partial hash matches against the key in
+// arr and returns the matching slot, or the first empty slot on a miss.
+// Batch mode reads {hash, key} pairs from memory and writes one result word
+// per pair, so many lookups share a single start.
+module hash_core(
+  input             clk,
+  input             rst,
+
+  // csr interface
+  input             csr_hash_valid,
+  input [4:0]       csr_hash_addr,
+  input             csr_hash_wen,
+  input [31:0]      csr_hash_wdata,
+  output reg        hash_csr_valid,
+  output reg        hash_csr_error,
+  output reg [31:0] hash_csr_rdata,
+
+  // cache interface
+  output            hash_dc_req,
+  output reg [1:0]  hash_dc_op,
+  output reg [31:0] hash_dc_addr,
+  output reg [7:0]  hash_dc_wmask,
+  output reg [63:0] hash_dc_wdata,
+  input             dc_ready,
+
+  input             dc_valid,
+  input [63:0]      dc_rdata,
+
+  input             dc_rbuf_empty,
+
+  // cpu store interface: stores still on their way to the cpu's l2
+  input             cpu_st_pending);
+
+  // metadata partial hash: 0x80 | ((hash >> PHASH_SHF) & 0x7f)
+  localparam PHASH_SHF = 20;
+
+  localparam
+    H_IDLE     = 4'd0,
+    H_FENCE    = 4'd1,
+    H_KEY_RD   = 4'd2,
+    H_KEY_WAIT = 4'd3,
+    H_SETUP    = 4'd4,
+    H_MD_RD    = 4'd5,
+    H_MD_WAIT  = 4'd6,
+    H_SCAN     = 4'd7,
+    H_ARR_RD   = 4'd8,
+    H_ARR_WAIT = 4'd9,
+    H_CHECK    = 4'd10,
+    H_RES      = 4'd11,
+    H_DRAIN    = 4'd12;
+
+  localparam
+    REG_STAT   = 5'd0,
+    REG_TBASE  = 5'd1,
+    REG_MBASE  = 5'd2,
+    REG_CAP    = 5'd3,
+    REG_HASH   = 5'd4,
+    REG_KEY    = 5'd5,
+    REG_RESULT = 5'd6,
+    REG_BBASE  = 5'd7,
+    REG_RBASE  = 5'd8,
+    REG_COUNT  = 5'd9;
+
+  // performance counters (read-only, cleared on start)
+  localparam
+    REG_CTR_KEYS   = 5'h10,
+    REG_CTR_LINES  = 5'h11,
+    REG_CTR_CMP    = 5'h12,
+    REG_CTR_CYCLES = 5'h13;
+
+  // stat write bits
+  localparam
+    CTL_START = 0,
+    CTL_BATCH = 1;
+
+  // result words: {found, slot}, slot is all ones if the table is full
+  localparam [30:0] NO_SLOT = 31'h7fffffff;
+
+  // lowest set bit of a 64-bit vector as {valid,index}
+  function [6:0] first_set(input [63:0] vec);
+    integer i;
+    begin
+      first_set = 0;
+      for (i = 63; i >= 0; i = i - 1)
+        if (vec[i])
+          first_set = {1'b1, i[5:0]};
+    end
+  endfunction
+
+  reg[2:0] dc_beat;
+  always @(posedge clk)
+    if(rst)
+      dc_beat <= 0;
+    else if(dc_valid)
+      dc_beat <= dc_beat + 1;
+
+  wire dc_last;
+  assign dc_last = dc_valid & (dc_beat == 3'd7);
+
+  reg[31:0] table_base;
+  reg[31:0] mdata_base;
+  reg[31:0] capacity;
+  reg[31:0] hash_val;
+  reg[31:0] key_val;
+  reg[31:0] result;
+  reg[31:0] batch_base;
+  reg[31:0] result_base;
+  reg[31:0] batch_count;
+  reg       batch_mode;
+  reg       found;
+
+  // writing 1 to stat starts a lookup (or a batch of lookups)
+  wire stat_write;
+  assign stat_write = csr_hash_valid & csr_hash_wen & (csr_hash_addr == REG_STAT);
+
+  wire start;
+  assign start = stat_write & csr_hash_wdata[CTL_START];
+
+  reg[3:0]  state;
+  reg[31:0] batch_idx;
+
+  // current lookup
+  reg[31:0] cur_hash;
+  reg[31:0] cur_key;
+  reg[31:0] slot;     // first slot of the metadata window
+  reg[31:0] probed;   // slots scanned so far
+  reg[5:0]  line_off; // offset of slot in the metadata line
+  reg[31:0] line_lim; // slots left before the end of the table
+  reg[63:0] md_match;
+  reg[63:0] md_empty;
+  reg[31:0] cmp_slot;
+  reg[5:0]  cmp_bit;
+  reg       key_hit;
+  reg[31:0] res;
+
+  wire [7:0] phash;
+  assign phash = {1'b1, cur_hash[PHASH_SHF+:7]};
+
+  wire [6:0] cand;
+  assign cand = first_set(md_match | md_empty);
+
+  // slots covered by the current window
+  wire [31:0] window;
+  assign window = (line_lim < 32'd64 - line_off) ? line_lim : 32'd64 - line_off;
+
+  // key line buffer: batch pairs are {key, hash}, eight to a line
+  reg [63:0] kbuf [0:7];
+  reg [31:6] kbuf_line;
+  reg        kbuf_valid;
+
+  wire [31:0] key_addr;
+  assign key_addr = batch_base + {batch_idx[28:0],3'b0};
+
+  wire kbuf_hit;
+  assign kbuf_hit = kbuf_valid & (kbuf_line == key_addr[31:6]);
+
+  wire [31:0] md_addr, arr_addr, res_addr;
+  assign md_addr = mdata_base + slot;
+  assign arr_addr = table_base + {cmp_slot[29:0],2'b0};
+  assign res_addr = result_base + {batch_idx[29:0],2'b0};
+
+  // Cache
+  assign hash_dc_req = ((state == H_KEY_RD) & ~kbuf_hit) | (state == H_MD_RD) |
+                       (state == H_ARR_RD) | ((state == H_RES) & batch_mode);
+
+  always @(*) begin
+    case(state)
+      H_KEY_RD: hash_dc_addr = key_addr;
+      H_MD_RD: hash_dc_addr = md_addr;
+      H_ARR_RD: hash_dc_addr = arr_addr;
+      default: hash_dc_addr = res_addr;
+    endcase
+
+    if (state == H_RES) begin
+      hash_dc_op = `OP_WR4;
+      hash_dc_wmask = hash_dc_addr[2] ? 8'b11110000 : 8'b00001111;
+      hash_dc_wdata = {2{res}};
+    end else begin
+      hash_dc_op = `OP_RD;
+      hash_dc_wmask = 8'b00000000;
+      hash_dc_wdata = 64'b0;
+    end
+  end
+
+  // Key fetch (batch mode)
+  always @(posedge clk)
+    if (rst | start)
+      kbuf_valid <= 0;
+    else if ((state == H_KEY_RD) & ~kbuf_hit & dc_ready) begin
+      kbuf_valid <= 0;
+      kbuf_line <= key_addr[31:6];
+    end else if ((state == H_KEY_WAIT) & dc_last)
+      kbuf_valid <= 1;
+
+  always @(posedge clk)
+    if ((state == H_KEY_WAIT) & dc_valid)
+      kbuf[dc_beat] <= dc_rdata;
+
+  // Metadata window: partial hash matches and empty slots in the line,
+  // from slot up to the end of the line or the table
+  integer k;
+  always @(posedge clk)
+    if ((state == H_MD_WAIT) & dc_valid)
+      for (k = 0; k < 8; k = k + 1) begin
+        md_match[{dc_beat,3'b0} + k] <= ({dc_beat,3'b0} + k >= line_off) &
+                                        ({dc_beat,3'b0} + k - line_off < line_lim) &
+                                        (dc_rdata[8*k+:8] == phash);
+        md_empty[{dc_beat,3'b0} + k] <= ({dc_beat,3'b0} + k >= line_off) &
+                                        ({dc_beat,3'b0} + k - line_off < line_lim) &
+                                        ~dc_rdata[8*k+7];
+      end
+    else if ((state == H_CHECK) & ~key_hit)
+      md_match[cmp_bit] <= 0;
+
+  // Key check
+  always @(posedge clk)
+    if ((state == H_ARR_WAIT) & dc_valid & (dc_beat == arr_addr[5:3]))
+      key_hit <= (arr_addr[2] ? dc_rdata[63:32] : dc_rdata[31:0]) == cur_key;
+
+  // State machine
+  always @(posedge clk)
+    if (rst) begin
+      state <= H_IDLE;
+      found <= 0;
+    end else
+      case(state)
+        H_IDLE:
+          if (start) begin
+            batch_mode <= csr_hash_wdata[CTL_BATCH];
+            batch_idx <= 0;
+            cur_hash <= hash_val;
+            cur_key <= key_val;
+            found <= 0;
+            state <= H_FENCE;
+          end
+        H_FENCE:
+          // table and keys may still be in the cpu's store path
+          if (~cpu_st_pending) begin
+            if (~batch_mode)
+              state <= H_SETUP;
+            else if (batch_count == 0)
+              state <= H_IDLE;
+            else
+              state <= H_KEY_RD;
+          end
+        H_KEY_RD:
+          if (kbuf_hit) begin
+            cur_hash <= kbuf[key_addr[5:3]][31:0];
+            cur_key <= kbuf[key_addr[5:3]][63:32];
+            state <= H_SETUP;
+          end else if (dc_ready)
+            state <= H_KEY_WAIT;
+        H_KEY_WAIT:
+          if (dc_last)
+            state <= H_KEY_RD;
+        H_SETUP: begin
+          slot <= cur_hash & (capacity - 1);
+          probed <= 0;
+          state <= H_MD_RD;
+        end
+        H_MD_RD:
+          if (dc_ready) begin
+            line_off <= md_addr[5:0];
+            line_lim <= capacity - slot;
+            state <= H_MD_WAIT;
+          end
+        H_MD_WAIT:
+          if (dc_last)
+            state <= H_SCAN;
+        H_SCAN:
+          if (~cand[6]) begin
+            // nothing in this window: move on to the next line
+            probed <= probed + window;
+            slot <= (slot + window == capacity) ? 0 : slot + window;
+            if (probed + window >= capacity) begin
+              res <= {1'b0, NO_SLOT};
+              state <= H_RES;
+            end else
+              state <= H_MD_RD;
+          end else if (md_empty[cand[5:0]]) begin
+            res <= {1'b0, slot[30:0] + {25'b0, cand[5:0] - line_off}};
+            state <= H_RES;
+          end else begin
+            cmp_slot <= slot + {26'b0, cand[5:0] - line_off};
+            cmp_bit <= cand[5:0];
+            state <= H_ARR_RD;
+          end
+        H_ARR_RD:
+          if (dc_ready)
+            state <= H_ARR_WAIT;
+        H_ARR_WAIT:
+          if (dc_last)
+            state <= H_CHECK;
+        H_CHECK:
+          if (key_hit) begin
+            res <= {1'b1, cmp_slot[30:0]};
+            state <= H_RES;
+          end else
+            state <= H_SCAN;
+        H_RES:
+          if (~batch_mode) begin
+            result <= res;
+            found <= res[31];
+            state <= H_IDLE;
+          end else if (dc_ready) begin
+            result <= res;
+            found <= res[31];
+            batch_idx <= batch_idx + 1;
+            state <= (batch_idx + 1 == batch_count) ? H_DRAIN : H_KEY_RD;
+          end
+        H_DRAIN:
+          // result writes have reached the l2
+          if (dc_rbuf_empty)
+            state <= H_IDLE;
+        default:
+          state <= H_IDLE;
+      endcase
+
+  // Performance counters
+  reg [31:0] ctr_keys;
+  reg [31:0] ctr_lines;
+  reg [31:0] ctr_cmp;
+  reg [31:0] ctr_cycles;
+
+  always @(posedge clk)
+    if (rst | start) begin
+      ctr_keys <= 0;
+      ctr_lines <= 0;
+      ctr_cmp <= 0;
+      ctr_cycles <= 0;
+    end else begin
+      ctr_keys <= ctr_keys + {31'b0,state == H_SETUP};
+      ctr_lines <= ctr_lines + {31'b0,(state == H_MD_RD) & dc_ready};
+      ctr_cmp <= ctr_cmp + {31'b0,(state == H_ARR_RD) & dc_ready};
+      ctr_cycles <= ctr_cycles + {31'b0,state != H_IDLE};
+    end
+
+  // CSR interface
+  always @(posedge clk) begin
+    hash_csr_valid <= csr_hash_valid;
+    hash_csr_error <= 0;
+    case(csr_hash_addr)
+      REG_STAT: hash_csr_rdata <= {29'b0,batch_mode,state == H_IDLE,found};
+      REG_TBASE: hash_csr_rdata <= table_base;
+      REG_MBASE: hash_csr_rdata <= mdata_base;
+      REG_CAP: hash_csr_rdata <= capacity;
+      REG_HASH: hash_csr_rdata <= hash_val;
+      REG_KEY: hash_csr_rdata <= key_val;
+      REG_RESULT: hash_csr_rdata <= result;
+      REG_BBASE: hash_csr_rdata <= batch_base;
+      REG_RBASE: hash_csr_rdata <= result_base;
+      REG_COUNT: hash_csr_rdata <= batch_count;
+      REG_CTR_KEYS: hash_csr_rdata <= ctr_keys;
+      REG_CTR_LINES: hash_csr_rdata <= ctr_lines;
+      REG_CTR_CMP: hash_csr_rdata <= ctr_cmp;
+      REG_CTR_CYCLES: hash_csr_rdata <= ctr_cycles;
+      default: hash_csr_error <= 1;
+    endcase
+  end
+
+  always @(posedge clk)
+    if(csr_hash_valid & csr_hash_wen)
+      case(csr_hash_addr)
+        REG_TBASE: table_base <= csr_hash_wdata;
+        REG_MBASE: mdata_base <= csr_hash_wdata;
+        REG_CAP: capacity <= csr_hash_wdata;
+        REG_HASH: hash_val <= csr_hash_wdata;
+        REG_KEY: key_val <= csr_hash_wdata;
+        REG_BBASE: batch_base <= csr_hash_wdata;
+        REG_RBASE: result_base <= csr_hash_wdata;
+        REG_COUNT: batch_count <= csr_hash_wdata;
+        default: ;
+      endcase
+
+endmodule
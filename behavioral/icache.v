@@ -1,5 +1,21 @@
-// instruction cache
-module icache(
+// icache geometry, set from the build
+`ifndef ICACHE_SETS
+`define ICACHE_SETS 64
+`endif
+`ifndef ICACHE_WAYS
+`define ICACHE_WAYS 2
+`endif
+
+// instruction cache: returns the aligned 64-bit block holding fetch_ic_addr.
+// SETS x WAYS lines of 64B, filled from the l2 one line at a time. The line
+// being filled is kept in a line buffer, which serves its beats as they
+// arrive, so fetch restarts before the fill completes.
+module icache #(
+  parameter SETS = `ICACHE_SETS,
+  parameter WAYS = `ICACHE_WAYS,
+  // the harness traces hart 0 only
+  parameter HARTID = 0
+  )(
   input         clk,
   input         rst,
 
@@ -10,31 +26,181 @@ module icache(
   output        icache_ready,
   output        icache_valid,
   output        icache_error,
-  output [31:0] icache_data);
+  output [63:0] icache_data,
+
+  // l2 interface
+  output        icache_l2_req,
+  output [31:6] icache_l2_addr,
+  input         l2_icache_ready,
+
+  input         l2_resp_valid,
+  input         l2_resp_ifetch,
+  input [63:0]  l2_resp_rdata,
+
+  // performance events
+  output        icache_miss);
+
+  localparam SET_IDX = $clog2(SETS);
+  localparam WAY_IDX = (WAYS > 1) ? $clog2(WAYS) : 1;
+  localparam TAG_W = 26 - SET_IDX;
 
-  localparam STDERR = 32'h80000002;
+  // indexed by way*SETS+set, data by (way*SETS+set)*8+beat
+  reg [TAG_W-1:0]   tagmem [0:SETS*WAYS-1];
+  reg [SETS*WAYS-1:0] validmem;
+  reg [63:0]        datamem [0:SETS*WAYS*8-1];
+  // fifo replacement
+  reg [WAY_IDX-1:0] victim [0:SETS-1];
 
-  reg        req_s0, req_s1;
+  // stage 0: tag check
+  reg        req_s0;
   reg [31:2] addr_s0;
-  reg [31:0] rdata_raw, rdata_s1;
+
+  // stage 1: response
+  reg        req_s1;
+  reg        error_s1;
+  reg [63:0] rdata_s1;
+
+  // line fill in flight
+  reg         fill_valid_r;
+  reg         fill_req_r;
+  reg [31:6]  fill_addr_r;
+  reg [WAY_IDX-1:0] fill_way_r;
+  reg [2:0]   fill_beat_r;
+  reg [7:0]   lbuf_valid;
+  reg [63:0]  lbuf [0:7];
+
+  // access counters, sent to the harness with each miss
+  reg [9:0]   stat_acc_r;
+  reg [15:0]  stat_wait_r;
+
+  wire [SET_IDX-1:0] set_s0, fill_set;
+  wire [TAG_W-1:0]   tag_s0;
+  assign set_s0 = addr_s0[6+:SET_IDX];
+  assign tag_s0 = addr_s0[31:6+SET_IDX];
+  assign fill_set = fill_addr_r[6+:SET_IDX];
+
+  integer           w;
+  reg               hit_s0;
+  reg [WAY_IDX-1:0] way_s0;
+  always @(*) begin
+    hit_s0 = 0;
+    way_s0 = 0;
+    for(w = 0; w < WAYS; w=w+1)
+      if(validmem[w*SETS+set_s0] & (tagmem[w*SETS+set_s0] == tag_s0)) begin
+        hit_s0 = 1;
+        way_s0 = w;
+      end
+  end
+
+  // the beat has already arrived in the line buffer
+  wire lbuf_hit_s0;
+  assign lbuf_hit_s0 = fill_valid_r & (fill_addr_r == addr_s0[31:6]) &
+                       lbuf_valid[addr_s0[5:3]];
+
+  wire pma_valid_s0;
+  pmacheck pmacheck(
+    .addr(addr_s0[31:6]),
+    .write(1'b0),
+    .valid(pma_valid_s0));
+
+  // a miss waits for the fill of its line, or for the current fill to end
+  wire done_s0, miss_s0, fill_start;
+  assign done_s0 = req_s0 & (hit_s0 | lbuf_hit_s0 | ~pma_valid_s0);
+  assign miss_s0 = req_s0 & ~done_s0;
+  assign fill_start = miss_s0 & ~fill_valid_r;
+
+  wire resp_beat;
+  assign resp_beat = l2_resp_valid & l2_resp_ifetch;
+
+  // fetch interface
+  assign icache_ready = ~req_s0 | done_s0;
+  assign icache_valid = req_s1;
+  assign icache_error = error_s1;
+  assign icache_data = rdata_s1;
+
+  // l2 interface
+  assign icache_l2_req = fill_req_r;
+  assign icache_l2_addr = fill_addr_r;
+
+  // performance events
+  assign icache_miss = fill_start;
+
   always @(posedge clk)
     if(rst | fetch_ic_flush) begin
       req_s0 <= 0;
       req_s1 <= 0;
     end else begin
-      req_s0 <= fetch_ic_req;
-      addr_s0 <= fetch_ic_addr;
+      if(icache_ready) begin
+        req_s0 <= fetch_ic_req;
+        addr_s0 <= fetch_ic_addr;
+      end
 
-      req_s1 <= req_s0;
-      if(req_s0) begin
-        top.tb_mem_read(addr_s0, rdata_raw);
-        rdata_s1 <= rdata_raw;
+      req_s1 <= done_s0;
+      error_s1 <= ~pma_valid_s0;
+      rdata_s1 <= hit_s0 ? datamem[(way_s0*SETS+set_s0)*8+addr_s0[5:3]]
+                         : lbuf[addr_s0[5:3]];
+    end
+
+  // line fill
+  always @(posedge clk)
+    if(rst) begin
+      fill_valid_r <= 0;
+      fill_req_r <= 0;
+      lbuf_valid <= 0;
+    end else if(fill_start) begin
+      fill_valid_r <= 1;
+      fill_req_r <= 1;
+      fill_addr_r <= addr_s0[31:6];
+      fill_way_r <= victim[set_s0];
+      fill_beat_r <= 0;
+      lbuf_valid <= 0;
+    end else begin
+      if(icache_l2_req & l2_icache_ready)
+        fill_req_r <= 0;
+      if(resp_beat) begin
+        lbuf[fill_beat_r] <= l2_resp_rdata;
+        lbuf_valid[fill_beat_r] <= 1;
+        fill_beat_r <= fill_beat_r + 1;
+        if(fill_beat_r == 7)
+          fill_valid_r <= 0;
       end
     end
 
-  assign icache_ready = 1;
-  assign icache_valid = req_s1;
-  assign icache_error = 0;
-  assign icache_data = rdata_s1;
+  // the victim way is invalidated when its fill starts and becomes valid
+  // with the last beat
+  integer i;
+  always @(posedge clk)
+    if(rst) begin
+      validmem <= 0;
+      for(i = 0; i < SETS; i=i+1)
+        victim[i] <= 0;
+    end else if(fill_start) begin
+      validmem[victim[set_s0]*SETS+set_s0] <= 0;
+      /*verilator lint_off WIDTH*/
+      victim[set_s0] <= (victim[set_s0] == WAYS-1) ? 0 : victim[set_s0] + 1;
+      /*verilator lint_on WIDTH*/
+    end else if(resp_beat & (fill_beat_r == 7)) begin
+      validmem[fill_way_r*SETS+fill_set] <= 1;
+      tagmem[fill_way_r*SETS+fill_set] <= fill_addr_r[31:6+SET_IDX];
+    end
+
+  always @(posedge clk)
+    if(resp_beat)
+      datamem[(fill_way_r*SETS+fill_set)*8+fill_beat_r] <= l2_resp_rdata;
+
+  // statistics: lookups and miss stall cycles since the last report
+  always @(posedge clk)
+    if(rst) begin
+      stat_acc_r <= 0;
+      stat_wait_r <= 0;
+    end else if(fill_start | (stat_acc_r == 1023)) begin
+      if(HARTID == 0)
+        top.tb_log_icache({22'b0,stat_acc_r} + done_s0, fill_start, {16'b0,stat_wait_r} + miss_s0);
+      stat_acc_r <= 0;
+      stat_wait_r <= 0;
+    end else begin
+      stat_acc_r <= stat_acc_r + done_s0;
+      stat_wait_r <= stat_wait_r + miss_s0;
+    end
 
 endmodule
@@ -0,0 +1,238 @@
+// RISC-V instruction decoder for one decode lane (see decode)
+module insndec(
+  input         error,
+  input [31:1]  addr,
+  input [31:0]  insn,
+  input         bptaken,
+
+  // rob fields
+  output        dec_error,
+  output [1:0]  ecause,
+  output [6:0]  retop,
+  output        is_call,
+  output        is_return,
+  output [5:0]  rd,
+  output        forward,
+  output [31:2] target,
+
+  // rename fields
+  output reg [4:0] rsop,
+  output        uses_rs1,
+  output        uses_rs2,
+  output        uses_imm,
+  output        uses_memory,
+  output        uses_pc,
+  output        csr_access,
+  output        inhibit,
+  output [4:0]  rs1,
+  output [4:0]  rs2,
+  output [31:0] rs_imm,
+
+  // raw immediate, for tracing
+  output reg [31:0] imm);
+
+  reg        fmt_r, fmt_i, fmt_s, fmt_b, fmt_u, fmt_j, fmt_inv;
+
+  localparam
+    ERR_IALIGN   = 0,
+    ERR_IFAULT   = 1,
+    ERR_IILLEGAL = 2;
+
+  localparam
+    OPC_LOAD      = 5'b00000,
+    OPC_LOADFP    = 5'b00001,
+    OPC_CUSTOM0   = 5'b00010,
+    OPC_MISCMEM   = 5'b00011,
+    OPC_OPIMM     = 5'b00100,
+    OPC_AUIPC     = 5'b00101,
+    OPC_OPIMM32   = 5'b00110,
+    OPC_48B0      = 5'b00111,
+    OPC_STORE     = 5'b01000,
+    OPC_STOREFP   = 5'b01001,
+    OPC_CUSTOM1   = 5'b01010,
+    OPC_AMO       = 5'b01011,
+    OPC_OP        = 5'b01100,
+    OPC_LUI       = 5'b01101,
+    OPC_OP32      = 5'b01110,
+    OPC_64B       = 5'b01111,
+    OPC_MADD      = 5'b10000,
+    OPC_MSUB      = 5'b10001,
+    OPC_NMSUB     = 5'b10010,
+    OPC_NMADD     = 5'b10011,
+    OPC_OPFP      = 5'b10100,
+    OPC_RESERVED0 = 5'b10101,
+    OPC_CUSTOM2   = 5'b10110,
+    OPC_48B1      = 5'b10111,
+    OPC_BRANCH    = 5'b11000,
+    OPC_JALR      = 5'b11001,
+    OPC_RESERVED1 = 5'b11010,
+    OPC_JAL       = 5'b11011,
+    OPC_SYSTEM    = 5'b11100,
+    OPC_RESERVED2 = 5'b11101,
+    OPC_CUSTOM3   = 5'b11110,
+    OPC_80B       = 5'b11111;
+
+  // derived signals
+  wire [2:0] funct3;
+  assign funct3 = insn[14:12];
+
+  wire insn_load, insn_jalr, insn_auipc, insn_csr, insn_mret, insn_fence, insn_lbcmp, insn_aluext;
+  assign insn_load = (insn[6:2] == OPC_LOAD);
+  assign insn_jalr = (insn[6:2] == OPC_JALR);
+  assign insn_auipc = (insn[6:2] == OPC_AUIPC);
+  assign insn_csr = (insn[6:2] == OPC_SYSTEM) & (funct3[1:0] != 0);
+  assign insn_mret = (insn[6:2] == OPC_SYSTEM) & (funct3 == 0) & (insn[31:20] == 12'h302);
+  assign insn_fence = (insn[6:2] == OPC_MISCMEM) & (funct3 == 0);
+  // lbcmp (funct3 011) and lbcmp64 (funct3 111); lq_type carries funct3
+  assign insn_lbcmp = (insn[6:2] == OPC_CUSTOM0) & (funct3[1:0] == 2'b11);
+  assign insn_aluext = (insn[6:2] == OPC_CUSTOM1);
+
+  wire insn_complex;
+  assign insn_complex = fmt_r & insn[25];
+
+  wire [2:0] brop;
+  assign brop = {~|funct3[2:1],funct3[2:1]};
+
+  // SRLI alternation: special case
+  wire altop;
+  assign altop = (fmt_r | (funct3 == 3'b101)) & insn[30];
+
+  wire [4:0] rd_raw;
+  assign rs1 = insn[19:15];
+  assign rs2 = insn[24:20];
+  assign rd_raw = insn[11:7];
+
+  wire [2:0] csrop;
+  assign csrop = (funct3[1] & (rs1 == 0)) ? 3'b000 : funct3;
+
+  wire uses_rd;
+  assign uses_rd = (fmt_r | fmt_i | fmt_u | fmt_j) & (rd_raw != 0);
+  assign uses_rs1 = fmt_r | (fmt_i & (~insn_csr | ~funct3[2])) | fmt_s | fmt_b;
+  assign uses_rs2 = fmt_r | fmt_s | fmt_b;
+
+  // calling convention hints for the return address stack (as in fetch)
+  wire rd_link, rs1_link;
+  assign rd_link = (rd_raw == 1) | (rd_raw == 5);
+  assign rs1_link = (rs1 == 1) | (rs1 == 5);
+
+  wire target_ntaken;
+  assign target_ntaken = (fmt_b & bptaken) | insn_jalr;
+
+  // TODO misaligned target?
+  wire [31:1] target_full;
+  assign target_full = {addr[31:2],1'b0} + (target_ntaken ? 31'd2 : imm[31:1]);
+
+  // rob fields
+  assign dec_error = error | fmt_inv;
+  assign ecause = error ? (addr[1] ? ERR_IALIGN : ERR_IFAULT) : ERR_IILLEGAL;
+  // mret: executed by the csr unit (reads mepc), flushes like a jalr
+  assign retop = {fmt_b,insn_csr|insn_mret,insn_jalr|insn_mret,fmt_s,funct3};
+  assign is_call = (fmt_j | insn_jalr) & rd_link;
+  assign is_return = insn_jalr & rs1_link & ~rd_link;
+  assign rd = {~uses_rd,rd_raw};
+  assign forward = insn_jalr;
+  assign target = target_full[31:2];
+
+  // rename fields
+  assign uses_imm = ~fmt_r & ~fmt_b;
+  assign uses_memory = insn_load | fmt_s | insn_lbcmp;
+  assign uses_pc = fmt_j | insn_auipc;
+  // fence: executed by the csr unit, which holds it until this hart's
+  // stores are visible to the other agents on the bus
+  assign csr_access = insn_csr | insn_mret | insn_fence;
+  assign inhibit = insn_jalr;
+  assign rs_imm = fmt_j ? 4 : imm;
+
+  // format decoder
+  always @(*) begin
+    {fmt_r,fmt_i,fmt_s,fmt_b,fmt_u,fmt_j,fmt_inv} = 0;
+
+    if(insn[1:0] != 2'b11)
+      fmt_inv = 1;
+    else case(insn[6:2])
+      // implemented opcodes
+      OPC_OP: fmt_r = 1;
+      OPC_OPIMM: fmt_i = 1;
+
+      OPC_LUI: fmt_u = 1;
+      OPC_AUIPC: fmt_u = 1;
+
+      OPC_LOAD: fmt_i = 1;
+      OPC_STORE: fmt_s = 1;
+
+      OPC_BRANCH: fmt_b = 1;
+      OPC_JAL: fmt_j = 1;
+      OPC_JALR: fmt_i = 1;
+
+      OPC_MISCMEM: fmt_i = 1;
+      OPC_SYSTEM: fmt_i = 1;
+
+      OPC_CUSTOM0: fmt_r = 1;
+      OPC_CUSTOM1: fmt_r = 1;
+
+      // unimplemented opcodes
+      // floating point
+      OPC_OPFP: fmt_inv = 1;
+      OPC_LOADFP: fmt_inv = 1;
+      OPC_STOREFP: fmt_inv = 1;
+      OPC_MADD: fmt_inv = 1;
+      OPC_MSUB: fmt_inv = 1;
+      OPC_NMSUB: fmt_inv = 1;
+      OPC_NMADD: fmt_inv = 1;
+
+      // atomic memory operations
+      OPC_AMO: fmt_inv = 1;
+
+      // RV64 32-bit insns (unused in RV32)
+      OPC_OP32: fmt_inv = 1;
+      OPC_OPIMM32: fmt_inv = 1;
+
+      // custom instructions
+      OPC_CUSTOM2: fmt_inv = 1;
+      OPC_CUSTOM3: fmt_inv = 1;
+
+      // reserved
+      OPC_RESERVED0: fmt_inv = 1;
+      OPC_RESERVED1: fmt_inv = 1;
+      OPC_RESERVED2: fmt_inv = 1;
+      OPC_48B0: fmt_inv = 1;
+      OPC_48B1: fmt_inv = 1;
+      OPC_64B: fmt_inv = 1;
+      OPC_80B: fmt_inv = 1;
+    endcase
+  end
+
+  /*verilator lint_off WIDTH*/
+  // immediate generator
+  always @(*) begin
+    imm = 0;
+    case(1)
+      fmt_i: imm = $signed(insn[31:20]);
+      fmt_s: imm = $signed({insn[31:25],insn[11:7]});
+      fmt_b: imm = $signed({insn[31],insn[7],insn[30:25],insn[11:8],1'b0});
+      fmt_u: imm = {insn[31:12],12'b0};
+      fmt_j: imm = $signed({insn[31],insn[19:12],insn[20],insn[30:21],1'b0});
+    endcase
+  end
+  /*verilator lint_off WIDTH*/
+
+  // rsop
+  always @(*)
+    case(1)
+      uses_memory:
+        rsop = {1'b0,fmt_s,funct3};
+      fmt_j, insn_jalr, fmt_u:
+        rsop = 5'b00000;
+      fmt_b:
+        rsop = {2'b01,brop};
+      insn_csr:
+        rsop = {2'b00,csrop};
+      insn_mret:
+        rsop = 5'b00100;
+      insn_fence:
+        rsop = 5'b01000;
+      default:
+        rsop = {insn_complex|insn_aluext,insn_complex|altop,funct3};
+    endcase
+
+endmodule
@@ -1,25 +1,48 @@
 `include "buscmd.vh"
 
-// l2 cache
+// l2 banks, set from the build (1, 2 or 4)
+`ifndef L2_BANKS
+`define L2_BANKS 2
+`endif
+
+// critical-word-first reads and fills, set from the build
+`ifndef L2_CWF
+`define L2_CWF 1
+`endif
+
+// l2 cache: BANKS address-interleaved banks, each a full l2tag/l2data/l2trans
+// pipeline holding the lines with addr[31:6] % BANKS == bank and tracking
+// its own miss. Requests go to their bank in order, so one waits only for
+// its own bank; responses, invalidations and bus commands from the banks
+// are merged here. Responses from different banks are not kept in request
+// order, so a requester that matches them in order needs BANKS=1.
 module l2 #(
-  parameter BUSID = `BUSID_L2
+  parameter BUSID = `BUSID_L2,
+  parameter BANKS = `L2_BANKS,
+  parameter CWF = `L2_CWF
   )(
   input         clk,
   input         rst,
 
-  // request interface
+  // request interface; icache fills (req_ifetch) are answered with
+  // l2_resp_ifetch set
   input         req_valid,
+  input         req_pf,
+  input         req_ifetch,
   input [1:0]   req_op,
   input [31:2]  req_addr,
   input [7:0]   req_wmask,
   input [63:0]  req_wdata,
   output        l2_req_ready,
 
-  // response interface
+  // response interface; a read burst starts at the addressed beat when CWF
+  // is set, l2_resp_beat is the line beat of each response
   output        l2_resp_valid,
   output        l2_resp_error,
+  output        l2_resp_ifetch,
   output [1:0]  l2_resp_op,
   output [31:6] l2_resp_addr,
+  output [2:0]  l2_resp_beat,
   output [63:0] l2_resp_rdata,
   input         resp_ready,
 
@@ -30,6 +53,12 @@ module l2 #(
   // status signals
   output        l2_idle,
 
+  // prefetch events
+  output        l2_rd_miss,
+  output        l2_pf_fill,
+  output        l2_pf_hit,
+  output        l2_pf_late,
+
   // bus interface
   output        l2_bus_req,
   output [2:0]  l2_bus_cmd,
@@ -47,187 +76,377 @@ module l2 #(
   input [31:6]  bus_addr,
   input [63:0]  bus_data);
 
-  /*AUTOWIRE*/
-  // Beginning of automatic wires (for undeclared instantiated-module outputs)
-  wire        l2data_flush_hit;
-  wire        l2data_idle;
-  wire [31:6] l2data_req_addr;
-  wire [2:0]  l2data_req_cmd;
-  wire [63:0] l2data_req_data;
-  wire        l2data_req_noinv;
-  wire        l2data_req_ready;
-  wire        l2data_req_valid;
-  wire        l2data_req_wdata_ready;
-  wire [31:6] l2data_snoop_addr;
-  wire [63:0] l2data_snoop_data;
-  wire        l2data_snoop_ready;
-  wire [4:0]  l2data_snoop_tag;
-  wire        l2data_snoop_valid;
-  wire        l2tag_idle;
-  wire [31:6] l2tag_inv_addr;
-  wire        l2tag_inv_valid;
-  wire [31:3] l2tag_req_addr;
-  wire [2:0]  l2tag_req_cmd;
-  wire        l2tag_req_cmd_noinv;
-  wire        l2tag_req_cmd_valid;
-  wire [1:0]  l2tag_req_op;
-  wire        l2tag_req_valid;
-  wire [3:0]  l2tag_req_way;
-  wire [63:0] l2tag_req_wdata;
-  wire [7:0]  l2tag_req_wmask;
-  wire [31:6] l2tag_snoop_addr;
-  wire [4:0]  l2tag_snoop_tag;
-  wire        l2tag_snoop_valid;
-  wire [3:0]  l2tag_snoop_way;
-  wire [63:0] l2tag_snoop_wdata;
-  wire        l2tag_snoop_wen;
-  wire        l2trans_flush_hit;
-  wire        l2trans_idle;
-  wire        l2trans_l2data_req_ready;
-  wire        l2trans_l2data_snoop_ready;
-  wire [2:0]  l2trans_tag;
-  wire        l2trans_upgr_hit;
-  wire        l2trans_valid;
-  // End of automatics
-
-  wire        invfifo_ready;
-
-  assign l2_idle = l2tag_idle & l2data_idle & l2trans_idle;
-
-  l2tag #(BUSID) l2tag(
-    /*AUTOINST*/
-    // Outputs
-    .l2_bus_hit(l2_bus_hit),
-    .l2_bus_nack(l2_bus_nack),
-    .l2_req_ready(l2_req_ready),
-    .l2tag_idle(l2tag_idle),
-    .l2tag_inv_addr(l2tag_inv_addr[31:6]),
-    .l2tag_inv_valid(l2tag_inv_valid),
-    .l2tag_req_addr(l2tag_req_addr[31:3]),
-    .l2tag_req_cmd(l2tag_req_cmd[2:0]),
-    .l2tag_req_cmd_noinv(l2tag_req_cmd_noinv),
-    .l2tag_req_cmd_valid(l2tag_req_cmd_valid),
-    .l2tag_req_op(l2tag_req_op[1:0]),
-    .l2tag_req_valid(l2tag_req_valid),
-    .l2tag_req_way(l2tag_req_way[3:0]),
-    .l2tag_req_wdata(l2tag_req_wdata[63:0]),
-    .l2tag_req_wmask(l2tag_req_wmask[7:0]),
-    .l2tag_snoop_addr(l2tag_snoop_addr[31:6]),
-    .l2tag_snoop_tag(l2tag_snoop_tag[4:0]),
-    .l2tag_snoop_valid(l2tag_snoop_valid),
-    .l2tag_snoop_way(l2tag_snoop_way[3:0]),
-    .l2tag_snoop_wdata(l2tag_snoop_wdata[63:0]),
-    .l2tag_snoop_wen(l2tag_snoop_wen),
-    // Inputs
-    .bus_addr(bus_addr),
-    .bus_cmd(bus_cmd),
-    .bus_data(bus_data),
-    .bus_nack(bus_nack),
-    .bus_tag(bus_tag),
-    .bus_valid(bus_valid),
-    .clk(clk),
-    .invfifo_ready(invfifo_ready),
-    .l2data_flush_hit(l2data_flush_hit),
-    .l2data_req_ready(l2data_req_ready),
-    .l2data_req_wdata_ready(l2data_req_wdata_ready),
-    .l2data_snoop_ready(l2data_snoop_ready),
-    .l2trans_flush_hit(l2trans_flush_hit),
-    .l2trans_tag(l2trans_tag[2:0]),
-    .l2trans_upgr_hit(l2trans_upgr_hit),
-    .l2trans_valid(l2trans_valid),
-    .req_addr(req_addr),
-    .req_op(req_op),
-    .req_valid(req_valid),
-    .req_wdata(req_wdata),
-    .req_wmask(req_wmask),
-    .rst(rst));
-
-  l2data l2data(
-    /*AUTOINST*/
-    // Outputs
-    .l2_resp_addr(l2_resp_addr),
-    .l2_resp_error(l2_resp_error),
-    .l2_resp_op(l2_resp_op),
-    .l2_resp_rdata(l2_resp_rdata),
-    .l2_resp_valid(l2_resp_valid),
-    .l2data_flush_hit(l2data_flush_hit),
-    .l2data_idle(l2data_idle),
-    .l2data_req_addr(l2data_req_addr[31:6]),
-    .l2data_req_cmd(l2data_req_cmd[2:0]),
-    .l2data_req_data(l2data_req_data[63:0]),
-    .l2data_req_noinv(l2data_req_noinv),
-    .l2data_req_ready(l2data_req_ready),
-    .l2data_req_valid(l2data_req_valid),
-    .l2data_req_wdata_ready(l2data_req_wdata_ready),
-    .l2data_snoop_addr(l2data_snoop_addr[31:6]),
-    .l2data_snoop_data(l2data_snoop_data[63:0]),
-    .l2data_snoop_ready(l2data_snoop_ready),
-    .l2data_snoop_tag(l2data_snoop_tag[4:0]),
-    .l2data_snoop_valid(l2data_snoop_valid),
-    // Inputs
-    .clk(clk),
-    .l2tag_inv_addr(l2tag_inv_addr[31:6]),
-    .l2tag_inv_valid(l2tag_inv_valid),
-    .l2tag_req_addr(l2tag_req_addr[31:3]),
-    .l2tag_req_cmd(l2tag_req_cmd[2:0]),
-    .l2tag_req_cmd_noinv(l2tag_req_cmd_noinv),
-    .l2tag_req_cmd_valid(l2tag_req_cmd_valid),
-    .l2tag_req_op(l2tag_req_op[1:0]),
-    .l2tag_req_valid(l2tag_req_valid),
-    .l2tag_req_way(l2tag_req_way[3:0]),
-    .l2tag_req_wdata(l2tag_req_wdata[63:0]),
-    .l2tag_req_wmask(l2tag_req_wmask[7:0]),
-    .l2tag_snoop_addr(l2tag_snoop_addr[31:6]),
-    .l2tag_snoop_tag(l2tag_snoop_tag[4:0]),
-    .l2tag_snoop_valid(l2tag_snoop_valid),
-    .l2tag_snoop_way(l2tag_snoop_way[3:0]),
-    .l2tag_snoop_wdata(l2tag_snoop_wdata[63:0]),
-    .l2tag_snoop_wen(l2tag_snoop_wen),
-    .l2trans_l2data_req_ready(l2trans_l2data_req_ready),
-    .l2trans_l2data_snoop_ready(l2trans_l2data_snoop_ready),
-    .resp_ready(resp_ready),
-    .rst(rst));
-
-  l2trans #(BUSID) l2trans(
-    /*AUTOINST*/
-    // Outputs
-    .l2_bus_addr(l2_bus_addr),
-    .l2_bus_cmd(l2_bus_cmd),
-    .l2_bus_data(l2_bus_data),
-    .l2_bus_req(l2_bus_req),
-    .l2_bus_tag(l2_bus_tag),
-    .l2trans_flush_hit(l2trans_flush_hit),
-    .l2trans_idle(l2trans_idle),
-    .l2trans_l2data_req_ready(l2trans_l2data_req_ready),
-    .l2trans_l2data_snoop_ready(l2trans_l2data_snoop_ready),
-    .l2trans_tag(l2trans_tag[2:0]),
-    .l2trans_upgr_hit(l2trans_upgr_hit),
-    .l2trans_valid(l2trans_valid),
-    // Inputs
-    .bus_l2_grant(bus_l2_grant),
-    .bus_nack(bus_nack),
-    .clk(clk),
-    .l2data_req_addr(l2data_req_addr[31:6]),
-    .l2data_req_cmd(l2data_req_cmd[2:0]),
-    .l2data_req_data(l2data_req_data[63:0]),
-    .l2data_req_noinv(l2data_req_noinv),
-    .l2data_req_valid(l2data_req_valid),
-    .l2data_snoop_addr(l2data_snoop_addr[31:6]),
-    .l2data_snoop_data(l2data_snoop_data[63:0]),
-    .l2data_snoop_tag(l2data_snoop_tag[4:0]),
-    .l2data_snoop_valid(l2data_snoop_valid),
-    .l2tag_inv_addr(l2tag_inv_addr[31:6]),
-    .l2tag_inv_valid(l2tag_inv_valid),
-    .rst(rst));
-
-  fifo #(26,8) invfifo(
-    .clk(clk),
-    .rst(rst),
-    .wr_valid(l2tag_inv_valid),
-    .wr_ready(invfifo_ready),
-    .wr_data(l2tag_inv_addr),
-    .rd_valid(l2_inv_valid),
-    .rd_ready(inv_ready),
-    .rd_data(l2_inv_addr));
+  localparam BANK_IDX = (BANKS > 1) ? $clog2(BANKS) : 1;
+
+  // per-bank outputs, bank b at [b], [b*2+:2], [b*26+:26] etc.
+  wire [BANKS-1:0]    bank_req_ready;
+  wire [BANKS-1:0]    bank_resp_valid;
+  wire [BANKS-1:0]    bank_resp_error;
+  wire [BANKS-1:0]    bank_resp_ifetch;
+  wire [BANKS*2-1:0]  bank_resp_op;
+  wire [BANKS*26-1:0] bank_resp_addr;
+  wire [BANKS*3-1:0]  bank_resp_beat;
+  wire [BANKS*64-1:0] bank_resp_rdata;
+  wire [BANKS-1:0]    bank_inv_valid;
+  wire [BANKS*26-1:0] bank_inv_addr;
+  wire [BANKS-1:0]    bank_idle;
+  wire [BANKS-1:0]    bank_rd_miss;
+  wire [BANKS-1:0]    bank_pf_fill;
+  wire [BANKS-1:0]    bank_pf_hit;
+  wire [BANKS-1:0]    bank_pf_late;
+  wire [BANKS-1:0]    bank_bus_req;
+  wire [BANKS*3-1:0]  bank_bus_cmd;
+  wire [BANKS*5-1:0]  bank_bus_tag;
+  wire [BANKS*26-1:0] bank_bus_addr;
+  wire [BANKS*64-1:0] bank_bus_data;
+  wire [BANKS-1:0]    bank_bus_hit;
+  wire [BANKS-1:0]    bank_bus_nack;
+
+  // merge state
+  reg [BANK_IDX-1:0] resp_bank_r;
+  reg                resp_lock_r;
+  reg [2:0]          resp_beat_r;
+  reg [BANK_IDX-1:0] resp_rr_r;
+  reg [BANK_IDX-1:0] bus_bank_r;
+  reg                bus_win_r;
+  reg [BANK_IDX-1:0] bus_rr_r;
+  reg [2:0]          bus_cycle_r;
+
+  /*verilator lint_off WIDTH*/
+  wire [BANK_IDX-1:0] req_bank;
+  assign req_bank = req_addr[31:6] % BANKS;
+  /*verilator lint_on WIDTH*/
+
+  // round-robin pick among the banks in req, starting at rr
+  function automatic [BANK_IDX-1:0] pick(
+    input [BANKS-1:0]    req,
+    input [BANK_IDX-1:0] rr);
+
+    integer i;
+    reg     found;
+    begin
+      pick = rr;
+      found = 0;
+      for(i = 0; i < BANKS; i=i+1)
+        /*verilator lint_off WIDTH*/
+        if(~found & req[(rr + i) % BANKS]) begin
+          found = 1;
+          pick = (rr + i) % BANKS;
+        end
+        /*verilator lint_on WIDTH*/
+    end
+  endfunction
+
+  // a read response is a burst of 8 beats, sent without interleaving
+  wire [BANK_IDX-1:0] resp_bank;
+  assign resp_bank = resp_lock_r ? resp_bank_r : pick(bank_resp_valid, resp_rr_r);
+
+  // invalidations are single beats, lowest bank first
+  wire [BANK_IDX-1:0] inv_bank;
+  assign inv_bank = pick(bank_inv_valid, 0);
+
+  // the bank sending in the current bus window drives the bus outputs, the
+  // next one is picked for the grant
+  wire [BANK_IDX-1:0] bus_pick, bus_bank;
+  assign bus_pick = pick(bank_bus_req, bus_rr_r);
+  assign bus_bank = bus_win_r ? bus_bank_r : bus_pick;
+
+  // request interface
+  assign l2_req_ready = bank_req_ready[req_bank];
+
+  // response interface
+  assign l2_resp_valid = bank_resp_valid[resp_bank];
+  assign l2_resp_error = bank_resp_error[resp_bank];
+  assign l2_resp_ifetch = bank_resp_ifetch[resp_bank];
+  assign l2_resp_op = bank_resp_op[resp_bank*2+:2];
+  assign l2_resp_addr = bank_resp_addr[resp_bank*26+:26];
+  assign l2_resp_beat = bank_resp_beat[resp_bank*3+:3];
+  assign l2_resp_rdata = bank_resp_rdata[resp_bank*64+:64];
+
+  assign l2_inv_valid = |bank_inv_valid;
+  assign l2_inv_addr = bank_inv_addr[inv_bank*26+:26];
+
+  // status signals
+  assign l2_idle = &bank_idle;
+
+  // prefetch events
+  assign l2_rd_miss = |bank_rd_miss;
+  assign l2_pf_fill = |bank_pf_fill;
+  assign l2_pf_hit = |bank_pf_hit;
+  assign l2_pf_late = |bank_pf_late;
+
+  // bus interface
+  assign l2_bus_req = |bank_bus_req;
+  assign l2_bus_cmd = bank_bus_cmd[bus_bank*3+:3];
+  assign l2_bus_tag = bank_bus_tag[bus_bank*5+:5];
+  assign l2_bus_addr = bank_bus_addr[bus_bank*26+:26];
+  assign l2_bus_data = bank_bus_data[bus_bank*64+:64];
+  assign l2_bus_hit = |bank_bus_hit;
+  assign l2_bus_nack = |bank_bus_nack;
+
+  genvar b;
+  generate
+    for(b = 0; b < BANKS; b=b+1) begin : banks
+      wire        l2data_flush_hit;
+      wire        l2data_idle;
+      wire [31:6] l2data_req_addr;
+      wire [2:0]  l2data_req_beat;
+      wire [2:0]  l2data_req_cmd;
+      wire [63:0] l2data_req_data;
+      wire        l2data_req_noinv;
+      wire        l2data_req_ready;
+      wire        l2data_req_valid;
+      wire        l2data_req_wdata_ready;
+      wire [31:6] l2data_snoop_addr;
+      wire [63:0] l2data_snoop_data;
+      wire        l2data_snoop_ready;
+      wire [4:0]  l2data_snoop_tag;
+      wire        l2data_snoop_valid;
+      wire        l2tag_idle;
+      wire [31:6] l2tag_inv_addr;
+      wire        l2tag_inv_valid;
+      wire [31:3] l2tag_req_addr;
+      wire [2:0]  l2tag_req_beat;
+      wire [2:0]  l2tag_req_cmd;
+      wire        l2tag_req_cmd_noinv;
+      wire        l2tag_req_cmd_valid;
+      wire        l2tag_req_ifetch;
+      wire [1:0]  l2tag_req_op;
+      wire        l2tag_req_valid;
+      wire [3:0]  l2tag_req_way;
+      wire [63:0] l2tag_req_wdata;
+      wire [7:0]  l2tag_req_wmask;
+      wire [31:6] l2tag_snoop_addr;
+      wire [2:0]  l2tag_snoop_beat;
+      wire [4:0]  l2tag_snoop_tag;
+      wire        l2tag_snoop_valid;
+      wire [3:0]  l2tag_snoop_way;
+      wire [63:0] l2tag_snoop_wdata;
+      wire        l2tag_snoop_wen;
+      wire        l2trans_flush_hit;
+      wire        l2trans_idle;
+      wire        l2trans_l2data_req_ready;
+      wire        l2trans_l2data_snoop_ready;
+      wire [2:0]  l2trans_tag;
+      wire        l2trans_upgr_hit;
+      wire        l2trans_valid;
+
+      wire        invfifo_ready;
+
+      assign bank_idle[b] = l2tag_idle & l2data_idle & l2trans_idle;
+
+      l2tag #(BUSID, BANKS, b, CWF) l2tag(
+        // Outputs
+        .l2_bus_hit(bank_bus_hit[b]),
+        .l2_bus_nack(bank_bus_nack[b]),
+        .l2_pf_fill(bank_pf_fill[b]),
+        .l2_pf_hit(bank_pf_hit[b]),
+        .l2_pf_late(bank_pf_late[b]),
+        .l2_rd_miss(bank_rd_miss[b]),
+        .l2_req_ready(bank_req_ready[b]),
+        .l2tag_idle(l2tag_idle),
+        .l2tag_inv_addr(l2tag_inv_addr[31:6]),
+        .l2tag_inv_valid(l2tag_inv_valid),
+        .l2tag_req_addr(l2tag_req_addr[31:3]),
+        .l2tag_req_beat(l2tag_req_beat[2:0]),
+        .l2tag_req_cmd(l2tag_req_cmd[2:0]),
+        .l2tag_req_cmd_noinv(l2tag_req_cmd_noinv),
+        .l2tag_req_cmd_valid(l2tag_req_cmd_valid),
+        .l2tag_req_ifetch(l2tag_req_ifetch),
+        .l2tag_req_op(l2tag_req_op[1:0]),
+        .l2tag_req_valid(l2tag_req_valid),
+        .l2tag_req_way(l2tag_req_way[3:0]),
+        .l2tag_req_wdata(l2tag_req_wdata[63:0]),
+        .l2tag_req_wmask(l2tag_req_wmask[7:0]),
+        .l2tag_snoop_addr(l2tag_snoop_addr[31:6]),
+        .l2tag_snoop_beat(l2tag_snoop_beat[2:0]),
+        .l2tag_snoop_tag(l2tag_snoop_tag[4:0]),
+        .l2tag_snoop_valid(l2tag_snoop_valid),
+        .l2tag_snoop_way(l2tag_snoop_way[3:0]),
+        .l2tag_snoop_wdata(l2tag_snoop_wdata[63:0]),
+        .l2tag_snoop_wen(l2tag_snoop_wen),
+        // Inputs
+        .bus_addr(bus_addr),
+        .bus_cmd(bus_cmd),
+        .bus_data(bus_data),
+        .bus_nack(bus_nack),
+        .bus_tag(bus_tag),
+        .bus_valid(bus_valid),
+        .clk(clk),
+        .invfifo_ready(invfifo_ready),
+        .l2data_flush_hit(l2data_flush_hit),
+        .l2data_req_ready(l2data_req_ready),
+        .l2data_req_wdata_ready(l2data_req_wdata_ready),
+        .l2data_snoop_ready(l2data_snoop_ready),
+        .l2trans_flush_hit(l2trans_flush_hit),
+        .l2trans_tag(l2trans_tag[2:0]),
+        .l2trans_upgr_hit(l2trans_upgr_hit),
+        .l2trans_valid(l2trans_valid),
+        .req_addr(req_addr),
+        .req_ifetch(req_ifetch),
+        .req_op(req_op),
+        .req_pf(req_pf),
+        .req_valid(req_valid & (req_bank == b)),
+        .req_wdata(req_wdata),
+        .req_wmask(req_wmask),
+        .rst(rst));
+
+      l2data l2data(
+        // Outputs
+        .l2_resp_addr(bank_resp_addr[b*26+:26]),
+        .l2_resp_beat(bank_resp_beat[b*3+:3]),
+        .l2_resp_error(bank_resp_error[b]),
+        .l2_resp_ifetch(bank_resp_ifetch[b]),
+        .l2_resp_op(bank_resp_op[b*2+:2]),
+        .l2_resp_rdata(bank_resp_rdata[b*64+:64]),
+        .l2_resp_valid(bank_resp_valid[b]),
+        .l2data_flush_hit(l2data_flush_hit),
+        .l2data_idle(l2data_idle),
+        .l2data_req_addr(l2data_req_addr[31:6]),
+        .l2data_req_beat(l2data_req_beat[2:0]),
+        .l2data_req_cmd(l2data_req_cmd[2:0]),
+        .l2data_req_data(l2data_req_data[63:0]),
+        .l2data_req_noinv(l2data_req_noinv),
+        .l2data_req_ready(l2data_req_ready),
+        .l2data_req_valid(l2data_req_valid),
+        .l2data_req_wdata_ready(l2data_req_wdata_ready),
+        .l2data_snoop_addr(l2data_snoop_addr[31:6]),
+        .l2data_snoop_data(l2data_snoop_data[63:0]),
+        .l2data_snoop_ready(l2data_snoop_ready),
+        .l2data_snoop_tag(l2data_snoop_tag[4:0]),
+        .l2data_snoop_valid(l2data_snoop_valid),
+        // Inputs
+        .clk(clk),
+        .l2tag_inv_addr(l2tag_inv_addr[31:6]),
+        .l2tag_inv_valid(l2tag_inv_valid),
+        .l2tag_req_addr(l2tag_req_addr[31:3]),
+        .l2tag_req_beat(l2tag_req_beat[2:0]),
+        .l2tag_req_cmd(l2tag_req_cmd[2:0]),
+        .l2tag_req_cmd_noinv(l2tag_req_cmd_noinv),
+        .l2tag_req_cmd_valid(l2tag_req_cmd_valid),
+        .l2tag_req_ifetch(l2tag_req_ifetch),
+        .l2tag_req_op(l2tag_req_op[1:0]),
+        .l2tag_req_valid(l2tag_req_valid),
+        .l2tag_req_way(l2tag_req_way[3:0]),
+        .l2tag_req_wdata(l2tag_req_wdata[63:0]),
+        .l2tag_req_wmask(l2tag_req_wmask[7:0]),
+        .l2tag_snoop_addr(l2tag_snoop_addr[31:6]),
+        .l2tag_snoop_beat(l2tag_snoop_beat[2:0]),
+        .l2tag_snoop_tag(l2tag_snoop_tag[4:0]),
+        .l2tag_snoop_valid(l2tag_snoop_valid),
+        .l2tag_snoop_way(l2tag_snoop_way[3:0]),
+        .l2tag_snoop_wdata(l2tag_snoop_wdata[63:0]),
+        .l2tag_snoop_wen(l2tag_snoop_wen),
+        .l2trans_l2data_req_ready(l2trans_l2data_req_ready),
+        .l2trans_l2data_snoop_ready(l2trans_l2data_snoop_ready),
+        .resp_ready(resp_ready & (resp_bank == b)),
+        .rst(rst));
+
+      l2trans #(BUSID, BANKS, b) l2trans(
+        // Outputs
+        .l2_bus_addr(bank_bus_addr[b*26+:26]),
+        .l2_bus_cmd(bank_bus_cmd[b*3+:3]),
+        .l2_bus_data(bank_bus_data[b*64+:64]),
+        .l2_bus_req(bank_bus_req[b]),
+        .l2_bus_tag(bank_bus_tag[b*5+:5]),
+        .l2trans_flush_hit(l2trans_flush_hit),
+        .l2trans_idle(l2trans_idle),
+        .l2trans_l2data_req_ready(l2trans_l2data_req_ready),
+        .l2trans_l2data_snoop_ready(l2trans_l2data_snoop_ready),
+        .l2trans_tag(l2trans_tag[2:0]),
+        .l2trans_upgr_hit(l2trans_upgr_hit),
+        .l2trans_valid(l2trans_valid),
+        // Inputs
+        .bus_l2_grant(bus_l2_grant & (bus_pick == b)),
+        .bus_nack(bus_nack),
+        .clk(clk),
+        .l2data_req_addr(l2data_req_addr[31:6]),
+        .l2data_req_beat(l2data_req_beat[2:0]),
+        .l2data_req_cmd(l2data_req_cmd[2:0]),
+        .l2data_req_data(l2data_req_data[63:0]),
+        .l2data_req_noinv(l2data_req_noinv),
+        .l2data_req_valid(l2data_req_valid),
+        .l2data_snoop_addr(l2data_snoop_addr[31:6]),
+        .l2data_snoop_data(l2data_snoop_data[63:0]),
+        .l2data_snoop_tag(l2data_snoop_tag[4:0]),
+        .l2data_snoop_valid(l2data_snoop_valid),
+        .l2tag_inv_addr(l2tag_inv_addr[31:6]),
+        .l2tag_inv_valid(l2tag_inv_valid),
+        .rst(rst));
+
+      fifo #(26,8) invfifo(
+        .clk(clk),
+        .rst(rst),
+        .wr_valid(l2tag_inv_valid),
+        .wr_ready(invfifo_ready),
+        .wr_data(l2tag_inv_addr),
+        .rd_valid(bank_inv_valid[b]),
+        .rd_ready(inv_ready & (inv_bank == b)),
+        .rd_data(bank_inv_addr[b*26+:26]));
+    end
+  endgenerate
+
+  // response and bus merge
+  always @(posedge clk)
+    if(rst) begin
+      resp_lock_r <= 0;
+      resp_beat_r <= 0;
+      resp_rr_r <= 0;
+    end else if(l2_resp_valid & resp_ready) begin
+      resp_lock_r <= resp_beat_r != 7;
+      resp_bank_r <= resp_bank;
+      resp_beat_r <= resp_beat_r + 1;
+      /*verilator lint_off WIDTH*/
+      if(resp_beat_r == 7)
+        resp_rr_r <= (resp_bank + 1) % BANKS;
+      /*verilator lint_on WIDTH*/
+    end
+
+  always @(posedge clk)
+    if(rst)
+      bus_cycle_r <= 0;
+    else
+      bus_cycle_r <= bus_cycle_r + 1;
+
+  always @(posedge clk)
+    if(rst) begin
+      bus_win_r <= 0;
+      bus_rr_r <= 0;
+    end else if(bus_cycle_r == 7) begin
+      bus_win_r <= l2_bus_req & bus_l2_grant;
+      bus_bank_r <= bus_pick;
+      /*verilator lint_off WIDTH*/
+      if(l2_bus_req & bus_l2_grant)
+        bus_rr_r <= (bus_pick + 1) % BANKS;
+      /*verilator lint_on WIDTH*/
+    end
+
+  // bank statistics: cycles each bank was busy, and cycles a request waited
+  // at the input for its bank, reported every 1024 cycles
+  reg [9:0]  stat_cycle_r;
+  reg [10:0] stat_busy_r [0:BANKS-1];
+  reg [10:0] stat_stall_r [0:BANKS-1];
+  integer    k;
+  always @(posedge clk)
+    if(rst) begin
+      stat_cycle_r <= 0;
+      for(k = 0; k < BANKS; k=k+1) begin
+        stat_busy_r[k] <= 0;
+        stat_stall_r[k] <= 0;
+      end
+    end else begin
+      stat_cycle_r <= stat_cycle_r + 1;
+      /*verilator lint_off WIDTH*/
+      for(k = 0; k < BANKS; k=k+1)
+        if(stat_cycle_r == 1023) begin
+          top.tb_log_l2bank(BUSID, k, {21'b0,stat_busy_r[k]}, {21'b0,stat_stall_r[k]});
+          stat_busy_r[k] <= 0;
+          stat_stall_r[k] <= 0;
+        end else begin
+          stat_busy_r[k] <= stat_busy_r[k] + {10'b0,~bank_idle[k]};
+          stat_stall_r[k] <= stat_stall_r[k] + {10'b0,req_valid & (req_bank == k) & ~l2_req_ready};
+        end
+      /*verilator lint_on WIDTH*/
+    end
 
 endmodule
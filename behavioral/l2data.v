@@ -5,11 +5,13 @@ module l2data(
 
   // l2tag interface
   input         l2tag_req_valid,
+  input         l2tag_req_ifetch,
   input [1:0]   l2tag_req_op,
   input         l2tag_req_cmd_valid,
   input         l2tag_req_cmd_noinv,
   input [2:0]   l2tag_req_cmd,
   input [31:3]  l2tag_req_addr,
+  input [2:0]   l2tag_req_beat,
   input [3:0]   l2tag_req_way,
   input [7:0]   l2tag_req_wmask,
   input [63:0]  l2tag_req_wdata,
@@ -19,6 +21,7 @@ module l2data(
   input         l2tag_snoop_valid,
   input [4:0]   l2tag_snoop_tag,
   input [31:6]  l2tag_snoop_addr,
+  input [2:0]   l2tag_snoop_beat,
   input [3:0]   l2tag_snoop_way,
   input         l2tag_snoop_wen,
   input [63:0]  l2tag_snoop_wdata,
@@ -33,6 +36,7 @@ module l2data(
   output        l2data_req_noinv,
   output [2:0]  l2data_req_cmd,
   output [31:6] l2data_req_addr,
+  output [2:0]  l2data_req_beat,
   output [63:0] l2data_req_data,
   input         l2trans_l2data_req_ready,
 
@@ -45,8 +49,10 @@ module l2data(
   // l2 interface
   output        l2_resp_valid,
   output        l2_resp_error,
+  output        l2_resp_ifetch,
   output [1:0]  l2_resp_op,
   output [31:6] l2_resp_addr,
+  output [2:0]  l2_resp_beat,
   output [63:0] l2_resp_rdata,
   input         resp_ready,
 
@@ -70,6 +76,7 @@ module l2data(
 
   // stage 0 latches
   reg         s0_req_valid_r;
+  reg         s0_req_ifetch_r;
   reg [1:0]   s0_req_op_r;
   reg         s0_req_cmd_valid_r;
   reg         s0_req_cmd_noinv_r;
@@ -80,6 +87,7 @@ module l2data(
   reg [63:0]  s0_req_wdata_r;
 
   reg [2:0]   s0_req_beat_r;
+  reg [2:0]   s0_req_first_r;
 
   reg         s0_snoop_valid_r;
   reg [4:0]   s0_snoop_tag_r;
@@ -89,14 +97,17 @@ module l2data(
   reg [63:0]  s0_snoop_wdata_r;
 
   reg [2:0]   s0_snoop_beat_r;
+  reg [2:0]   s0_snoop_first_r;
 
   // stage 1 latches
   reg         s1_req_valid_r;
+  reg         s1_req_ifetch_r;
   reg [1:0]   s1_req_op_r;
   reg         s1_req_cmd_valid_r;
   reg         s1_req_cmd_noinv_r;
   reg [2:0]   s1_req_cmd_r;
   reg [31:6]  s1_req_addr_r;
+  reg [2:0]   s1_req_beat_r;
   reg [3:0]   s1_req_bank_r;
 
   reg         s1_snoop_valid_r;
@@ -106,11 +117,13 @@ module l2data(
 
   // stage 2 latches
   reg         s2_req_valid_r;
+  reg         s2_req_ifetch_r;
   reg [1:0]   s2_req_op_r;
   reg         s2_req_cmd_valid_r;
   reg         s2_req_cmd_noinv_r;
   reg [2:0]   s2_req_cmd_r;
   reg [31:6]  s2_req_addr_r;
+  reg [2:0]   s2_req_beat_r;
   reg [3:0]   s2_req_bank_r;
 
   reg         s2_snoop_valid_r;
@@ -135,16 +148,22 @@ module l2data(
   assign req_burst = s0_req_cmd_valid_r ? (s0_req_cmd_r == `CMD_FLUSH)
                                         : (s0_req_ren | s0_req_overwrite);
 
+  // line beat of this burst cycle: bursts start at their first beat (the
+  // critical one) and wrap around the line
+  wire [2:0] req_beat, snoop_beat;
+  assign req_beat = s0_req_beat_r + s0_req_first_r;
+  assign snoop_beat = s0_snoop_beat_r + s0_snoop_first_r;
+
   wire [3:0] req_bank_sel, snoop_bank_sel;
-  assign req_bank_sel = 4'b0001 << (req_burst ? s0_req_beat_r[1:0]
+  assign req_bank_sel = 4'b0001 << (req_burst ? req_beat[1:0]
                                               : s0_req_addr_r[4:3]);
-  assign snoop_bank_sel = 4'b0001 << s0_snoop_beat_r[1:0];
+  assign snoop_bank_sel = 4'b0001 << snoop_beat[1:0];
 
   wire [11:0] req_bank_addr, snoop_bank_addr;
   assign req_bank_addr = {oh2idx(s0_req_way_r),s0_req_addr_r[14:6],
-                          req_burst ? s0_req_beat_r[2] : s0_req_addr_r[5]};
+                          req_burst ? req_beat[2] : s0_req_addr_r[5]};
   assign snoop_bank_addr = {oh2idx(s0_snoop_way_r),s0_snoop_addr_r[14:6],
-                            s0_snoop_beat_r[2]};
+                            snoop_beat[2]};
 
   wire [63:0] req_rdata, snoop_rdata;
   assign req_rdata = bank_rdata[oh2idx(s2_req_bank_r)];
@@ -203,6 +222,7 @@ module l2data(
   assign l2data_req_noinv = s1_req_cmd_noinv_r;
   assign l2data_req_cmd = s2_upgr_hit ? `CMD_BUSRDX : s2_req_cmd_r;
   assign l2data_req_addr = s2_req_addr_r;
+  assign l2data_req_beat = s2_req_beat_r;
   assign l2data_req_data = req_rdata;
 
   assign l2data_snoop_valid = s2_snoop_valid_r;
@@ -213,8 +233,10 @@ module l2data(
   // l2 interface
   assign l2_resp_valid = s2_req_valid_r & ~s2_req_cmd_valid_r;
   assign l2_resp_error = 0;
+  assign l2_resp_ifetch = s2_req_ifetch_r;
   assign l2_resp_op = s2_req_op_r;
   assign l2_resp_addr = s2_req_addr_r;
+  assign l2_resp_beat = s2_req_beat_r;
   assign l2_resp_rdata = req_rdata;
 
   assign l2data_idle = ~s0_req_valid_r & ~s1_req_valid_r & ~s2_req_valid_r;
@@ -262,11 +284,13 @@ module l2data(
     else if(l2data_req_ready) begin
       s0_req_valid_r <= l2tag_req_valid;
       if(l2tag_req_valid) begin
+        s0_req_ifetch_r    <= l2tag_req_ifetch;
         s0_req_op_r        <= l2tag_req_op;
         s0_req_cmd_valid_r <= l2tag_req_cmd_valid;
         s0_req_cmd_noinv_r <= l2tag_req_cmd_noinv;
         s0_req_cmd_r       <= l2tag_req_cmd;
         s0_req_addr_r      <= l2tag_req_addr;
+        s0_req_first_r     <= l2tag_req_beat;
         s0_req_way_r       <= l2tag_req_way;
       end
     end else begin
@@ -297,6 +321,7 @@ module l2data(
       if(l2tag_snoop_valid) begin
         s0_snoop_tag_r   <= l2tag_snoop_tag;
         s0_snoop_addr_r  <= l2tag_snoop_addr;
+        s0_snoop_first_r <= l2tag_snoop_beat;
         s0_snoop_way_r   <= l2tag_snoop_way;
         s0_snoop_wen_r   <= l2tag_snoop_wen;
       end
@@ -317,11 +342,13 @@ module l2data(
     else if(~s2_req_stall) begin
       s1_req_valid_r <= s0_req_issue & s0_req_ren;
       if(s0_req_issue & s0_req_ren) begin
+        s1_req_ifetch_r    <= s0_req_ifetch_r;
         s1_req_op_r        <= s0_req_op_r;
         s1_req_cmd_valid_r <= s0_req_cmd_valid_r;
         s1_req_cmd_noinv_r <= s0_req_cmd_noinv_r;
         s1_req_cmd_r       <= s0_upgr_hit ? `CMD_BUSRDX : s0_req_cmd_r;
         s1_req_addr_r      <= s0_req_addr_r[31:6];
+        s1_req_beat_r      <= req_beat;
         s1_req_bank_r      <= req_bank_sel;
       end
     end else if(s1_upgr_hit)
@@ -345,11 +372,13 @@ module l2data(
     else if(~s2_req_stall) begin
       s2_req_valid_r <= s1_req_valid_r;
       if(s1_req_valid_r) begin
+        s2_req_ifetch_r    <= s1_req_ifetch_r;
         s2_req_op_r        <= s1_req_op_r;
         s2_req_cmd_valid_r <= s1_req_cmd_valid_r;
         s2_req_cmd_noinv_r <= s1_req_cmd_noinv_r;
         s2_req_cmd_r       <= s1_upgr_hit ? `CMD_BUSRDX : s1_req_cmd_r;
         s2_req_addr_r      <= s1_req_addr_r;
+        s2_req_beat_r      <= s1_req_beat_r;
         s2_req_bank_r      <= s1_req_bank_r;
       end
     end else if(s2_upgr_hit)
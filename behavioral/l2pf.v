@@ -0,0 +1,283 @@
+// l2 prefetcher: a pc-indexed stride table trained by issued loads and a
+// next-n-line stream detector trained by dcache misses. Predicted lines are
+// queued and sent to the l2 as prefetch reads, which issue a BusRd on a miss
+// but return nothing to the dcache.
+
+// lookahead and throttling, set from the build
+`ifndef L2PF_DEGREE
+`define L2PF_DEGREE 4
+`endif
+`ifndef L2PF_DIST
+`define L2PF_DIST 4
+`endif
+`ifndef L2PF_BUSY_MAX
+`define L2PF_BUSY_MAX 32
+`endif
+
+module l2pf #(
+  // lines fetched ahead of a confirmed stream (0: off)
+  parameter DEGREE = `L2PF_DEGREE,
+  // strides fetched ahead of a confirmed stride (0: off)
+  parameter DIST = `L2PF_DIST,
+  // no prefetches while the bus was busy more than this many of the last
+  // 64 cycles
+  parameter BUSY_MAX = `L2PF_BUSY_MAX,
+  // the harness traces hart 0 only
+  parameter HARTID = 0
+  )(
+  input         clk,
+  input         rst,
+
+  // lsq interface
+  input         lsq_dc_req,
+  input [3:0]   lsq_dc_op,
+  input [31:0]  lsq_dc_addr,
+  input [31:2]  lsq_dc_pc,
+  input         dcache_lsq_ready,
+
+  // dcache interface
+  input         dcache_miss,
+  input [31:2]  dcache_l2fifo_addr,
+
+  // l2 interface
+  output        l2pf_req,
+  output [31:6] l2pf_addr,
+  input         l2_l2pf_ready,
+
+  input         l2_rd_miss,
+  input         l2_pf_fill,
+  input         l2_pf_hit,
+  input         l2_pf_late,
+
+  // bus interface
+  input         bus_valid);
+
+  // stride table: 16 entries indexed by pc[5:2], tagged with pc[13:6]
+  reg [15:0] st_valid;
+  reg [7:0]  st_tag [0:15];
+  reg [31:0] st_last [0:15];
+  reg [31:0] st_stride [0:15];
+  reg [1:0]  st_conf [0:15];
+
+  // stream table: the last line missed by each of 4 streams
+  reg [3:0]  sd_valid;
+  reg [3:0]  sd_conf;
+  reg [3:0]  sd_down;
+  reg [31:6] sd_line [0:3];
+  reg [1:0]  sd_alloc_r;
+
+  // training latches
+  reg        ld_valid_r;
+  reg [31:0] ld_addr_r;
+  reg [31:2] ld_pc_r;
+  reg        miss_valid_r;
+  reg [31:6] miss_line_r;
+
+  // stream burst: lines still to be queued for a stream
+  reg        burst_valid_r;
+  reg [31:6] burst_line_r;
+  reg        burst_down_r;
+  reg [7:0]  burst_left_r;
+
+  // recently queued lines
+  reg [31:6] recent [0:7];
+  reg [7:0]  recent_valid;
+
+  // bus occupancy over the current and the last 64-cycle window
+  reg [5:0]  win_cycle_r;
+  reg [6:0]  win_busy_r;
+  reg [6:0]  busy_r;
+
+  // stride training
+  wire [3:0]  st_idx;
+  wire        st_hit;
+  wire [31:0] st_delta;
+  wire        st_match;
+  assign st_idx = ld_pc_r[5:2];
+  assign st_hit = st_valid[st_idx] & (st_tag[st_idx] == ld_pc_r[13:6]);
+  assign st_delta = ld_addr_r - st_last[st_idx];
+  assign st_match = st_hit & (st_delta == st_stride[st_idx]) & (st_delta != 0);
+
+  // predict once the stride has repeated twice in a row
+  wire        st_pred;
+  wire [31:0] st_target;
+  /*verilator lint_off WIDTH*/
+  assign st_target = ld_addr_r + st_delta * DIST;
+  /*verilator lint_on WIDTH*/
+  assign st_pred = ld_valid_r & (DIST != 0) & st_match & (st_conf[st_idx] != 0) &
+                   (st_target[31:6] != ld_addr_r[31:6]);
+
+  // stream training: a miss on the line after (or before) a stream's last
+  // miss continues it
+  reg       sd_hit;
+  reg [1:0] sd_idx;
+  reg       sd_hit_down;
+  integer   i;
+  always @(*) begin
+    sd_hit = 0;
+    sd_idx = 0;
+    sd_hit_down = 0;
+    for(i = 0; i < 4; i=i+1)
+      if(sd_valid[i] & ~sd_hit)
+        if(miss_line_r == sd_line[i] + 1) begin
+          sd_hit = 1;
+          sd_idx = i;
+        end else if(miss_line_r == sd_line[i] - 1) begin
+          sd_hit = 1;
+          sd_idx = i;
+          sd_hit_down = 1;
+        end
+  end
+
+  wire sd_pred;
+  assign sd_pred = miss_valid_r & (DEGREE != 0) & sd_hit;
+
+  // candidate line for the queue: the burst, else a stride prediction
+  reg        cand_valid;
+  reg [31:6] cand_line;
+  always @(*)
+    if(burst_valid_r) begin
+      cand_valid = 1;
+      cand_line = burst_line_r;
+    end else begin
+      cand_valid = st_pred;
+      cand_line = st_target[31:6];
+    end
+
+  reg     cand_recent;
+  integer j;
+  always @(*) begin
+    cand_recent = 0;
+    for(j = 0; j < 8; j=j+1)
+      if(recent_valid[j] & (recent[j] == cand_line))
+        cand_recent = 1;
+  end
+
+  wire cand_pma_valid;
+  pmacheck pmacheck(
+    .addr(cand_line),
+    .write(1'b0),
+    .valid(cand_pma_valid));
+
+  // full queue: drop the prediction
+  wire pfq_wr_valid, pfq_wr_ready, pfq_rd_valid;
+  assign pfq_wr_valid = cand_valid & ~cand_recent & cand_pma_valid;
+
+  fifo #(26,8) pfq(
+    .clk(clk),
+    .rst(rst),
+    .wr_valid(pfq_wr_valid),
+    .wr_ready(pfq_wr_ready),
+    .wr_data(cand_line),
+    .rd_valid(pfq_rd_valid),
+    .rd_ready(l2_l2pf_ready & (busy_r <= BUSY_MAX)),
+    .rd_data(l2pf_addr));
+
+  assign l2pf_req = pfq_rd_valid & (busy_r <= BUSY_MAX);
+
+  // training latches
+  always @(posedge clk)
+    if(rst) begin
+      ld_valid_r <= 0;
+      miss_valid_r <= 0;
+    end else begin
+      ld_valid_r <= lsq_dc_req & ~lsq_dc_op[0] & dcache_lsq_ready;
+      ld_addr_r <= lsq_dc_addr;
+      ld_pc_r <= lsq_dc_pc;
+      miss_valid_r <= dcache_miss;
+      miss_line_r <= dcache_l2fifo_addr[31:6];
+    end
+
+  // stride table
+  always @(posedge clk)
+    if(rst)
+      st_valid <= 0;
+    else if(ld_valid_r) begin
+      st_last[st_idx] <= ld_addr_r;
+      if(~st_hit) begin
+        st_valid[st_idx] <= 1;
+        st_tag[st_idx] <= ld_pc_r[13:6];
+        st_stride[st_idx] <= 0;
+        st_conf[st_idx] <= 0;
+      end else if(st_match) begin
+        if(st_conf[st_idx] != 3)
+          st_conf[st_idx] <= st_conf[st_idx] + 1;
+      end else if(st_conf[st_idx] != 0)
+        st_conf[st_idx] <= st_conf[st_idx] - 1;
+      else
+        st_stride[st_idx] <= st_delta;
+    end
+
+  // stream table
+  always @(posedge clk)
+    if(rst) begin
+      sd_valid <= 0;
+      sd_alloc_r <= 0;
+    end else if(miss_valid_r)
+      if(sd_hit) begin
+        sd_line[sd_idx] <= miss_line_r;
+        sd_conf[sd_idx] <= 1;
+        sd_down[sd_idx] <= sd_hit_down;
+      end else begin
+        sd_valid[sd_alloc_r] <= 1;
+        sd_line[sd_alloc_r] <= miss_line_r;
+        sd_conf[sd_alloc_r] <= 0;
+        sd_alloc_r <= sd_alloc_r + 1;
+      end
+
+  // stream burst: the first confirming miss queues the next DEGREE lines,
+  // later ones only the line DEGREE ahead, since the rest are queued
+  // already
+  always @(posedge clk)
+    if(rst)
+      burst_valid_r <= 0;
+    else if(sd_pred & ~burst_valid_r) begin
+      burst_valid_r <= 1;
+      burst_down_r <= sd_hit_down;
+      /*verilator lint_off WIDTH*/
+      if(sd_conf[sd_idx] & (sd_down[sd_idx] == sd_hit_down)) begin
+        burst_line_r <= sd_hit_down ? miss_line_r - DEGREE : miss_line_r + DEGREE;
+        burst_left_r <= 0;
+      end else begin
+        burst_line_r <= sd_hit_down ? miss_line_r - 1 : miss_line_r + 1;
+        burst_left_r <= DEGREE - 1;
+      end
+      /*verilator lint_on WIDTH*/
+    end else if(burst_valid_r) begin
+      burst_valid_r <= burst_left_r != 0;
+      burst_line_r <= burst_down_r ? burst_line_r - 1 : burst_line_r + 1;
+      burst_left_r <= burst_left_r - 1;
+    end
+
+  // recently queued lines
+  integer k;
+  always @(posedge clk)
+    if(rst)
+      recent_valid <= 0;
+    else if(pfq_wr_valid & pfq_wr_ready) begin
+      recent_valid <= {recent_valid[6:0],1'b1};
+      recent[0] <= cand_line;
+      for(k = 1; k < 8; k=k+1)
+        recent[k] <= recent[k-1];
+    end
+
+  // bus occupancy
+  always @(posedge clk)
+    if(rst) begin
+      win_cycle_r <= 0;
+      win_busy_r <= 0;
+      busy_r <= 0;
+    end else begin
+      win_cycle_r <= win_cycle_r + 1;
+      if(win_cycle_r == 63) begin
+        win_busy_r <= 0;
+        busy_r <= win_busy_r + bus_valid;
+      end else
+        win_busy_r <= win_busy_r + bus_valid;
+    end
+
+  always @(posedge clk)
+    if((HARTID == 0) & ~rst & ((l2pf_req & l2_l2pf_ready) | l2_rd_miss | l2_pf_fill | l2_pf_hit))
+      top.tb_log_l2pf(l2pf_req & l2_l2pf_ready, l2_rd_miss, l2_pf_fill, l2_pf_hit, l2_pf_late);
+
+endmodule
@@ -1,12 +1,19 @@
 // l2 bus receiver
 module l2tag #(
-  parameter BUSID = `BUSID_L2
+  parameter BUSID = `BUSID_L2,
+  // this pipeline holds the lines with addr[31:6] % BANKS == BANK
+  parameter BANKS = 1,
+  parameter BANK = 0,
+  // reads are answered, and their misses filled, from the requested beat
+  parameter CWF = 0
   )(
   input            clk,
   input            rst,
 
   // l2reqfifo interface
   input            req_valid,
+  input            req_pf,
+  input            req_ifetch,
   input [1:0]      req_op,
   input [31:2]     req_addr,
   input [7:0]      req_wmask,
@@ -23,11 +30,13 @@ module l2tag #(
 
   // l2data interface
   output           l2tag_req_valid,
+  output           l2tag_req_ifetch,
   output [1:0]     l2tag_req_op,
   output           l2tag_req_cmd_valid,
   output           l2tag_req_cmd_noinv,
   output reg [2:0] l2tag_req_cmd,
   output [31:3]    l2tag_req_addr,
+  output [2:0]     l2tag_req_beat,
   output [3:0]     l2tag_req_way,
   output [7:0]     l2tag_req_wmask,
   output [63:0]    l2tag_req_wdata,
@@ -37,6 +46,7 @@ module l2tag #(
   output           l2tag_snoop_valid,
   output [4:0]     l2tag_snoop_tag,
   output [31:6]    l2tag_snoop_addr,
+  output [2:0]     l2tag_snoop_beat,
   output [3:0]     l2tag_snoop_way,
   output           l2tag_snoop_wen,
   output [63:0]    l2tag_snoop_wdata,
@@ -58,14 +68,23 @@ module l2tag #(
 
   output           l2tag_idle,
 
+  // prefetch events
+  output           l2_rd_miss,
+  output           l2_pf_fill,
+  output           l2_pf_hit,
+  output           l2_pf_late,
+
   // bus interface (out)
   output           l2_bus_hit,
   output           l2_bus_nack);
 
+  // the bank bits are the low bits of addr[14:6], the set is the rest
+  localparam SETS = 512 / BANKS;
+
   function automatic [8:0] addr2set(
     input [31:6] addr);
 
-    addr2set = addr[14:6];
+    addr2set = addr[14:6] / BANKS;
   endfunction
 
   function automatic [16:0] addr2tag(
@@ -98,15 +117,19 @@ module l2tag #(
   endfunction
 
   // 3*4 state bits, 3 lru bits, 17*4 tag bits
-  reg [11:0] tagmem_state [0:511];
-  reg [2:0]  tagmem_lru [0:511];
-  reg [67:0] tagmem_tag [0:511];
+  reg [11:0] tagmem_state [0:SETS-1];
+  reg [2:0]  tagmem_lru [0:SETS-1];
+  reg [67:0] tagmem_tag [0:SETS-1];
+  // prefetched lines not yet read by a demand request
+  reg [3:0]  tagmem_pf [0:SETS-1];
 
   // stage 0 latches
   reg [2:0]  s0_req_beat_r;
 
   reg        s0_req_valid_r;
   reg        s0_req_noop_r;
+  reg        s0_req_pf_r;
+  reg        s0_req_ifetch_r;
   reg [1:0]  s0_req_op_r;
   reg [31:2] s0_req_addr_r;
   reg [7:0]  s0_req_wmask_r;
@@ -121,6 +144,9 @@ module l2tag #(
   // stage 1 latches
   reg        s1_req_valid_r;
   reg        s1_req_noop_r;
+  reg        s1_req_pf_r;
+  reg        s1_req_late_r;
+  reg        s1_req_ifetch_r;
   reg [1:0]  s1_req_op_r;
   reg [31:3] s1_req_addr_r;
   reg [7:0]  s1_req_wmask_r;
@@ -147,6 +173,7 @@ module l2tag #(
   reg [11:0] tagmem_states_r;
   reg [2:0]  tagmem_lru_r;
   reg [67:0] tagmem_tags_r;
+  reg [3:0]  tagmem_pfs_r;
 
   // pending BusRd/BusRdX response
   reg        pend_valid_r;
@@ -165,9 +192,11 @@ module l2tag #(
 
   wire       snoop_en, snoop_valid;
   assign snoop_en = bus_cycle_r == 0;
-  assign snoop_valid = bus_valid &
+  /*verilator lint_off WIDTH*/
+  assign snoop_valid = bus_valid & (bus_addr % BANKS == BANK) &
                        ((bus_tag[4:3] != BUSID) |
                         (bus_cmd == `CMD_FILL) | (bus_cmd == `CMD_FLUSH));
+  /*verilator lint_on WIDTH*/
 
   wire [2:0] tagmem_way_state;
   assign tagmem_way_state = tagmem_states_r[oh2idx(tagmem_way_r)*3+:3];
@@ -236,7 +265,8 @@ module l2tag #(
       if(s1_req_noop_r)
         s1_req_stall = s1_req_stall | ~l2data_req_wdata_ready;
       else begin
-        s1_req_stall = s1_req_stall | ~l2data_req_ready;
+        // prefetches only fill the line, they don't read it out
+        s1_req_stall = s1_req_stall | (~l2data_req_ready & ~s1_req_pf_r);
         if(~s1_req_tag_stale_r)
           s1_req_stall = s1_req_stall | tagmiss | upgr_shared;
       end
@@ -280,14 +310,17 @@ module l2tag #(
   assign l2_req_ready = ~s0_req_stall;
 
   // l2data interface
-  assign l2tag_req_valid = (s1_req_valid_r & ~s1_req_stall) |
+  assign l2tag_req_valid = (s1_req_valid_r & ~s1_req_stall & ~s1_req_pf_r) |
                            (s1_req_miss_r & ~pend_valid_r);
+  assign l2tag_req_ifetch = s1_req_ifetch_r;
   assign l2tag_req_op = s1_req_miss_r ? `OP_RD : s1_req_op_r;
   assign l2tag_req_cmd_valid = s1_req_miss_r;
   assign l2tag_req_cmd_noinv = s1_req_overwrite;
   assign l2tag_req_addr = s1_req_evict_r
-                          ? {s1_req_fill_tag_r,addr2set(s1_req_addr_r[31:6]),3'b0}
+                          ? {s1_req_fill_tag_r,s1_req_addr_r[14:6],3'b0}
                           : s1_req_addr_r;
+  // first beat of a read burst, and the beat a BusRd asks to be filled first
+  assign l2tag_req_beat = ((CWF != 0) & ~s1_req_evict_r & ~s1_req_wen) ? s1_req_addr_r[5:3] : 3'd0;
   assign l2tag_req_way = s1_req_evict_r
                          ? s1_req_fill_way_r
                          : ((s1_req_miss_r | s1_req_tag_stale_r | s1_req_noop_r)
@@ -308,6 +341,9 @@ module l2tag #(
   assign l2tag_snoop_valid = flush | fill;
   assign l2tag_snoop_tag = s1_snoop_tag_r;
   assign l2tag_snoop_addr = s1_snoop_addr_r;
+  // a Fill from memory starts at the beat our BusRd asked for, a Flush from
+  // another cache at beat 0
+  assign l2tag_snoop_beat = (fill & (s1_snoop_cmd_r == `CMD_FILL)) ? l2tag_req_beat : 3'd0;
   assign l2tag_snoop_way = flush ? tagmem_way_r : s1_req_fill_way_r;
   assign l2tag_snoop_wen = fill;
   assign l2tag_snoop_wdata = s1_snoop_data_r;
@@ -320,6 +356,18 @@ module l2tag #(
 
   assign l2tag_idle = ~s0_req_valid_r & ~s1_req_valid_r;
 
+  // prefetch events, counted once per read when its tags are first checked
+  wire s1_req_fresh_rd;
+  assign s1_req_fresh_rd = s1_req_valid_r & ~s1_req_noop_r & ~s1_req_miss_r &
+                           ~s1_req_tag_stale_r & ~s1_req_wen;
+
+  assign l2_rd_miss = s1_req_fresh_rd & ~s1_req_pf_r & tagmiss;
+  assign l2_pf_fill = s1_req_fresh_rd & s1_req_pf_r & tagmiss;
+  assign l2_pf_hit = s1_req_fresh_rd & ~s1_req_pf_r & ~tagmiss &
+                     |(tagmem_way_r & tagmem_pfs_r);
+  // the demand read waited in s0 behind the prefetch of its line
+  assign l2_pf_late = l2_pf_hit & s1_req_late_r;
+
   // bus interface
   assign l2_bus_hit = bus_hit_r;
   assign l2_bus_nack = bus_nack_r;
@@ -359,6 +407,8 @@ module l2tag #(
     else if(~s0_req_stall) begin
       s0_req_valid_r <= req_valid;
       s0_req_noop_r <= s0_req_noop;
+      s0_req_pf_r <= req_pf;
+      s0_req_ifetch_r <= req_ifetch;
       s0_req_op_r <= req_op;
       s0_req_addr_r <= req_addr;
       s0_req_wmask_r <= req_wmask;
@@ -387,6 +437,10 @@ module l2tag #(
       s1_req_valid_r <= s0_req_valid_r & ~s0_snoop_valid_r;
       if(s0_req_valid_r & ~s0_snoop_valid_r) begin
         s1_req_noop_r <= s0_req_noop_r;
+        s1_req_pf_r <= s0_req_pf_r;
+        s1_req_ifetch_r <= s0_req_ifetch_r;
+        s1_req_late_r <= s1_req_valid_r & s1_req_pf_r &
+                         (s1_req_addr_r[31:6] == s0_req_addr_r[31:6]);
         s1_req_op_r <= s0_req_op_r;
         s1_req_addr_r <= s0_req_addr_r[31:3];
         s1_req_wmask_r <= s0_req_wmask_r;
@@ -474,6 +528,7 @@ module l2tag #(
       tagmem_states_r <= tagmem_state[tmp_set];
       tagmem_lru_r <= (lru_wset == tmp_set) ? lru_wdata : tagmem_lru[tmp_set];
       tagmem_tags_r <= tagmem_tag[tmp_set];
+      tagmem_pfs_r <= tagmem_pf[tmp_set];
     end
   end
 
@@ -532,7 +587,7 @@ module l2tag #(
   integer k;
   always @(posedge clk)
     if(rst)
-      for(k = 0; k < 512; k=k+1)
+      for(k = 0; k < SETS; k=k+1)
         tagmem_state[k] = 0;
     else if(state_wen)
       tagmem_state[state_wset][oh2idx(state_wway)*3+:3] <= state_wdata;
@@ -567,6 +622,16 @@ module l2tag #(
     if(lru_wen)
       tagmem_lru[lru_wset] <= lru_wdata;
 
+  integer m;
+  always @(posedge clk)
+    if(rst)
+      for(m = 0; m < SETS; m=m+1)
+        tagmem_pf[m] = 0;
+    else if(fill)
+      tagmem_pf[addr2set(s1_snoop_addr_r)][oh2idx(s1_req_fill_way_r)] <= s1_req_pf_r;
+    else if(l2_pf_hit)
+      tagmem_pf[addr2set(s1_req_addr_r[31:6])][oh2idx(tagmem_way_r)] <= 0;
+
   always @(posedge clk)
     if(rst)
       pend_valid_r <= 0;
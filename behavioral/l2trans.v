@@ -1,6 +1,9 @@
 // l2 bus transmitter
 module l2trans #(
-  parameter BUSID = `BUSID_L2
+  parameter BUSID = `BUSID_L2,
+  // banks split the 8 tags, this one counts through 8/BANKS of them
+  parameter BANKS = 1,
+  parameter BANK = 0
   )(
   input             clk,
   input             rst,
@@ -10,6 +13,7 @@ module l2trans #(
   input             l2data_req_noinv,
   input [2:0]       l2data_req_cmd,
   input [31:6]      l2data_req_addr,
+  input [2:0]       l2data_req_beat,
   input [63:0]      l2data_req_data,
   output            l2trans_l2data_req_ready,
 
@@ -45,12 +49,14 @@ module l2trans #(
   // 1. assert bus_req, watch bus_grant
   // 2. while command is on bus, watch bus_nack
   // due to tag size, we support a max of 8 pending commands
+  localparam TAGS = 8 / BANKS;
 
   reg           req_valid_r;
   reg           req_noinv_r;
   reg           req_sent_r;
   reg [2:0]     req_cmd_r;
   reg [31:6]    req_addr_r;
+  reg [2:0]     req_beat_r;
 
   reg           req_data_ready_r;
   reg [2:0]     req_data_index_r;
@@ -129,7 +135,9 @@ module l2trans #(
       l2_bus_cmd = upgr_hit ? `CMD_BUSRDX : req_cmd_r;
       l2_bus_tag = {BUSID,req_tag_r};
       l2_bus_addr = req_addr_r;
-      l2_bus_data = req_data[req_data_index_r];
+      // BusRd/BusRdX carry no data, the data lines name the beat to fill
+      // first
+      l2_bus_data = req_flush ? req_data[req_data_index_r] : {61'b0,req_beat_r};
     end
 
   // bus_cycle_r
@@ -149,6 +157,7 @@ module l2trans #(
       if(l2data_req_valid) begin
         req_cmd_r <= l2data_req_cmd;
         req_addr_r <= l2data_req_addr;
+        req_beat_r <= l2data_req_beat;
       end
     end else begin
       if(req_valid_r & ~snoop_valid_r & bus_l2_grant & (bus_cycle_r == 7))
@@ -175,11 +184,13 @@ module l2trans #(
     if(req_data_wr_beat)
       req_data[req_data_index_r] <= l2data_req_data;
 
+  /*verilator lint_off WIDTH*/
   always @(posedge clk)
     if(rst)
-      req_tag_r <= 0;
+      req_tag_r <= BANK * TAGS;
     else if(req_valid_r & req_sent_r & ~bus_nack & (bus_cycle_r == 7))
-      req_tag_r <= req_tag_r + 1;
+      req_tag_r <= (req_tag_r == BANK * TAGS + TAGS - 1) ? BANK * TAGS : req_tag_r + 1;
+  /*verilator lint_on WIDTH*/
 
   always @(posedge clk)
     if(rst)
@@ -1,5 +1,8 @@
 // load-store queue
-module lsq(
+module lsq #(
+  // the harness traces hart 0 only
+  parameter HARTID = 0
+  )(
   input         clk,
   input         rst,
 
@@ -13,6 +16,7 @@ module lsq(
   input         rename_op2ready,
   input [31:0]  rename_op2,
   input [31:0]  rename_imm,
+  input [31:2]  rename_pc,
   output        lsq_stall,
 
   // dcache interface
@@ -21,6 +25,7 @@ module lsq(
   output [31:0] lsq_dc_addr,
   output [3:0]  lsq_dc_lsqid,
   output [31:0] lsq_dc_wdata,
+  output [31:2] lsq_dc_pc,
   output        lsq_dc_flush,
   input         dcache_lsq_ready,
   input         dcache_lsq_valid,
@@ -46,7 +51,79 @@ module lsq(
 
   // rob interface
   input         rob_flush,
-  input         rob_ret_store);
+  input         rob_ret_store,
+  // a load ran ahead of an older store to the same address, refetch it
+  output        lsq_rob_replay,
+  output [6:0]  lsq_rob_replay_robid,
+
+  // retired stores not yet issued to the dcache
+  output        lsq_st_pending);
+
+  function automatic [3:0] byte_mask(
+    input [1:0] addr,
+    input [1:0] size);
+
+    case(size)
+      2'b00: byte_mask = 4'b0001 << addr;
+      2'b01: byte_mask = 4'b0011 << {addr[1],1'b0};
+      default: byte_mask = 4'b1111;
+    endcase
+  endfunction
+
+  // does the store write any byte the load reads?
+  // lbcmp reads 32 bytes, lbcmp64 reads the whole line
+  function automatic mem_overlap(
+    input [31:0] ld_addr,
+    input [2:0]  ld_type,
+    input [31:0] st_addr,
+    input [2:0]  st_type);
+
+    if(&ld_type)
+      mem_overlap = st_addr[31:6] == ld_addr[31:6];
+    else if(&ld_type[1:0])
+      mem_overlap = st_addr[31:5] == ld_addr[31:5];
+    else
+      mem_overlap = (st_addr[31:2] == ld_addr[31:2]) &
+                    |(byte_mask(ld_addr[1:0], ld_type[1:0]) &
+                      byte_mask(st_addr[1:0], st_type[1:0]));
+  endfunction
+
+  // does the store write every byte the load reads? (never for lbcmp)
+  function automatic mem_cover(
+    input [31:0] ld_addr,
+    input [2:0]  ld_type,
+    input [31:0] st_addr,
+    input [2:0]  st_type);
+
+    mem_cover = ~&ld_type[1:0] & (st_addr[31:2] == ld_addr[31:2]) &
+                ~|(byte_mask(ld_addr[1:0], ld_type[1:0]) &
+                   ~byte_mask(st_addr[1:0], st_type[1:0]));
+  endfunction
+
+  // the load result as the dcache would return it after the store
+  function automatic [31:0] mem_forward(
+    input [1:0]  ld_addr,
+    input [2:0]  ld_type,
+    input [2:0]  st_type,
+    input [31:0] st_data);
+
+    reg [31:0] word, aligned;
+    begin
+      case(st_type[1:0])
+        2'b00: word = {4{st_data[7:0]}};
+        2'b01: word = {2{st_data[15:0]}};
+        default: word = st_data;
+      endcase
+      aligned = word >> (ld_addr * 8);
+      casez(ld_type)
+        3'b000: mem_forward = {{24{aligned[7]}},aligned[7:0]};
+        3'b001: mem_forward = {{16{aligned[15]}},aligned[15:0]};
+        3'b1?0: mem_forward = {24'b0,aligned[7:0]};
+        3'b1?1: mem_forward = {16'b0,aligned[15:0]};
+        default: mem_forward = aligned;
+      endcase
+    end
+  endfunction
 
   // load queue
   reg [15:0]  lq_valid;
@@ -63,6 +140,15 @@ module lsq(
   reg [31:0]  lq_imm [0:15];
   reg [31:0]  lq_addr [0:15];
   reg [31:0]  lq_data [0:15];
+  // trains the l2 prefetcher and the store sets
+  reg [31:2]  lq_pc [0:15];
+  // older stores with unknown addresses the load was issued ahead of; it
+  // is written back once they are all known
+  reg [15:0]  lq_spec [0:15];
+  reg [15:0]  lq_violated;
+  // predicted dependence: wait for the address of store lq_dep_sq
+  reg [15:0]  lq_dep_valid;
+  reg [3:0]   lq_dep_sq [0:15];
   // used for lbcmp
   reg [15:0]  lq_op2_rdy;
   reg [7:0]   lq_op2 [0:15];
@@ -78,6 +164,17 @@ module lsq(
   reg [31:0]  sq_imm [0:15];
   reg [31:0]  sq_addr [0:15];
   reg [31:0]  sq_data [0:15];
+  reg [31:2]  sq_pc [0:15];
+
+  // store sets: the store set id table maps load and store pcs to a set,
+  // the last fetched store table holds each set's youngest store in the sq
+  reg [63:0]  ssit_valid;
+  reg [3:0]   ssit [0:63];
+  reg [15:0]  lfst_valid;
+  reg [3:0]   lfst [0:15];
+  reg [3:0]   ssid_next_r;
+  // cleared periodically so stale dependences don't serialize for good
+  reg [15:0]  ssit_age_r;
 
   // insert at tail, retire at mid, issue/remove at head
   // when a flush occurs, sq_tail <= sq_mid
@@ -102,6 +199,7 @@ module lsq(
   // derived signals
   wire        sq_full;
   assign sq_full = (sq_head == sq_tail) & (sq_head_pol != sq_tail_pol);
+  assign lsq_st_pending = {sq_head_pol,sq_head} != {sq_mid_pol,sq_mid};
 
   wire        sq_insert_rdy;
   wire [15:0] sq_insert_sel;
@@ -113,47 +211,57 @@ module lsq(
   assign lq_insert_beat = rename_lsq_write & ~rename_op[3] & lq_insert_rdy;
   assign sq_insert_beat = rename_lsq_write & rename_op[3] & sq_insert_rdy;
 
-  // lq_sq_wide: enables 32-byte blocks for addr comparison
   integer    i;
-  reg [31:2] lq_sq_addr;
-  reg        lq_sq_wide;
+  reg [31:0] lq_sq_addr;
+  reg [2:0]  lq_sq_type;
+  reg [15:0] lq_sq_unknown;
   reg        lq_sq_hit;
+  reg [3:0]  lq_sq_fwd_idx;
+  reg [3:0]  tmp_sq_idx;
   always @(*) begin
-    // generate lq_sq_addr, lq_sq_wide
+    // generate lq_sq_addr, lq_sq_type
     lq_sq_addr = 0;
-    lq_sq_wide = 0;
+    lq_sq_type = 0;
     for(i = 0; i < 16; i=i+1)
       if(lq_issue_sel[i]) begin
-        lq_sq_addr = lq_sq_addr | lq_addr[i][31:2];
-        lq_sq_wide = lq_sq_wide | (&lq_type[i][1:0]);
+        lq_sq_addr = lq_sq_addr | lq_addr[i];
+        lq_sq_type = lq_sq_type | lq_type[i];
       end
 
-    // check sq entries for conflicting addresses
+    // older stores with unresolved addresses are speculatively bypassed
+    lq_sq_unknown = lq_sq_sel & sq_valid & ~sq_addr_rdy;
+
+    // find the youngest older store with a conflicting address, walking
+    // the sq from its head (oldest) since lq_sq_sel is unordered
     lq_sq_hit = 0;
+    lq_sq_fwd_idx = 0;
     for(i = 0; i < 16; i=i+1) begin
-      if(lq_sq_sel[i] & sq_valid[i]) begin
-        // any stores with unresolved address?
-        if(~sq_addr_rdy[i])
-          lq_sq_hit = 1;
-
-        // any stores with conflicting address?
-        if(sq_addr[i][31:5] == lq_sq_addr[31:5])
-          if(lq_sq_wide | (sq_addr[i][4:2] == lq_sq_addr[4:2]))
-            lq_sq_hit = 1;
+      tmp_sq_idx = sq_head + i;
+      if(lq_sq_sel[tmp_sq_idx] & sq_valid[tmp_sq_idx] & sq_addr_rdy[tmp_sq_idx] &
+         mem_overlap(lq_sq_addr, lq_sq_type, sq_addr[tmp_sq_idx], sq_type[tmp_sq_idx])) begin
+        lq_sq_hit = 1;
+        lq_sq_fwd_idx = tmp_sq_idx;
       end
-
-      // terminate loop if we found a hit
-      if(lq_sq_hit)
-        i = 16;
     end
   end
 
-  wire lq_issue_req, sq_issue_req;
+  // forward from that store if it has its data and covers the whole load,
+  // otherwise (partial overlap) wait for it to reach the dcache
+  wire        lq_sq_fwd;
+  wire [31:0] lq_sq_fwd_data;
+  assign lq_sq_fwd = lq_sq_hit & sq_data_rdy[lq_sq_fwd_idx] &
+                     mem_cover(lq_sq_addr, lq_sq_type, sq_addr[lq_sq_fwd_idx], sq_type[lq_sq_fwd_idx]);
+  assign lq_sq_fwd_data = mem_forward(lq_sq_addr[1:0], lq_sq_type, sq_type[lq_sq_fwd_idx],
+                                      sq_data[lq_sq_fwd_idx]);
+
+  wire lq_issue_req, lq_fwd_req, sq_issue_req;
   assign lq_issue_req = lq_issue_rdy & ~lq_sq_hit & ~rob_flush;
+  assign lq_fwd_req = lq_issue_rdy & lq_sq_fwd & ~rob_flush;
   assign sq_issue_req = sq_valid[sq_head] & sq_addr_rdy[sq_head] & sq_issue_rdy[sq_head] & ~rob_flush;
 
-  wire lq_issue_beat, sq_issue_beat;
+  wire lq_issue_beat, lq_fwd_beat, sq_issue_beat;
   assign lq_issue_beat = lq_issue_req & dcache_lsq_ready;
+  assign lq_fwd_beat = lq_fwd_req;
   assign sq_issue_beat = sq_issue_req & ~lq_issue_req & dcache_lsq_ready;
 
   wire wb_beat;
@@ -170,6 +278,52 @@ module lsq(
   assign sq_addrgen_idx = $clog2(sq_addrgen_sel_r);
   /*verilator lint_on WIDTH*/
 
+  // a store address resolving now exposes any load issued ahead of it
+  // (including one issuing now) that reads the same bytes
+  integer    n;
+  reg [15:0] lq_spec_any;
+  reg [15:0] lq_violation;
+  reg [3:0]  sq_violation_lq;
+  always @(*) begin
+    sq_violation_lq = 0;
+    for(n = 0; n < 16; n=n+1) begin
+      lq_spec_any[n] = |lq_spec[n];
+      lq_violation[n] = sq_addrgen_req_r & lq_valid[n] &
+                        (lq_issued[n] ? lq_spec[n][sq_addrgen_idx]
+                                      : ((lq_issue_beat | lq_fwd_beat) & lq_issue_sel[n] &
+                                         lq_sq_unknown[sq_addrgen_idx])) &
+                        mem_overlap(lq_addr[n], lq_type[n], sq_addrgen_addr, sq_type[sq_addrgen_idx]);
+      if(lq_violation[n])
+        sq_violation_lq = n;
+    end
+  end
+
+  // store sets: a load waits for the youngest store of its set if that
+  // store's address is still unknown
+  wire       rename_ssid_valid;
+  wire [3:0] rename_ssid;
+  wire [3:0] ld_lfst;
+  wire       ld_dep;
+  assign rename_ssid_valid = ssit_valid[rename_pc[7:2]];
+  assign rename_ssid = ssit[rename_pc[7:2]];
+  assign ld_lfst = lfst[rename_ssid];
+  assign ld_dep = rename_ssid_valid & lfst_valid[rename_ssid] &
+                  sq_valid[ld_lfst] & ~sq_addr_rdy[ld_lfst] &
+                  ~(sq_addrgen_req_r & (sq_addrgen_idx == ld_lfst));
+
+  // on a violation, put the load and the store in the same set
+  wire [7:2] viol_ld_pc, viol_st_pc;
+  reg  [3:0] viol_ssid;
+  assign viol_ld_pc = lq_pc[sq_violation_lq][7:2];
+  assign viol_st_pc = sq_pc[sq_addrgen_idx][7:2];
+  always @(*)
+    if(ssit_valid[viol_st_pc])
+      viol_ssid = ssit[viol_st_pc];
+    else if(ssit_valid[viol_ld_pc])
+      viol_ssid = ssit[viol_ld_pc];
+    else
+      viol_ssid = ssid_next_r;
+
   // rename interface
   assign lsq_stall = ~rename_op[3] ? ~lq_insert_rdy : ~sq_insert_rdy;
 
@@ -179,6 +333,7 @@ module lsq(
   assign lsq_dc_addr = lq_issue_req ? lq_addr[lq_issue_idx] : sq_addr[sq_head];
   assign lsq_dc_lsqid = lq_issue_idx;
   assign lsq_dc_wdata = lq_issue_req ? {24'b0,lq_op2[lq_issue_idx]} : sq_data[sq_head];
+  assign lsq_dc_pc = lq_pc[lq_issue_idx];
   assign lsq_dc_flush = rob_flush;
 
   // writeback interface (out)
@@ -189,6 +344,10 @@ module lsq(
   assign lsq_wb_rd = {1'b0,lq_rd[lq_remove_idx]};
   assign lsq_wb_result = lq_data[lq_remove_idx];
 
+  // rob interface
+  assign lsq_rob_replay = wb_beat & lq_violated[lq_remove_idx];
+  assign lsq_rob_replay_robid = lq_robid[lq_remove_idx];
+
   priarb #(16) lq_insert_arb(
     .req(~lq_valid),
     .grant_valid(lq_insert_rdy),
@@ -204,7 +363,7 @@ module lsq(
     .rst(rst),
     .insert_valid(lq_insert_beat),
     .insert_sel(lq_insert_sel),
-    .req(lq_valid & lq_addr_rdy & ~lq_issued),
+    .req(lq_valid & lq_addr_rdy & ~lq_issued & ~lq_dep_valid),
     .grant_valid(lq_issue_rdy),
     .grant(lq_issue_sel));
 
@@ -219,7 +378,7 @@ module lsq(
     .col_sel(lq_sq_sel));
 
   priarb #(16) lq_remove_arb(
-    .req(lq_valid & lq_complete),
+    .req(lq_valid & lq_complete & ~lq_spec_any),
     .grant_valid(lq_remove_rdy),
     .grant(lq_remove_sel));
 
@@ -279,6 +438,8 @@ module lsq(
     if(rst | rob_flush)
       lq_valid <= 0;
     else begin
+      lq_violated <= lq_violated | lq_violation;
+
       if(lq_insert_beat) begin
         lq_valid[lq_insert_idx] <= 1;
         lq_base_rdy[lq_insert_idx] <= rename_op1ready;
@@ -290,6 +451,11 @@ module lsq(
         lq_rd[lq_insert_idx] <= rename_rd[4:0];
         lq_base[lq_insert_idx] <= rename_op1;
         lq_imm[lq_insert_idx] <= rename_imm;
+        lq_pc[lq_insert_idx] <= rename_pc;
+        lq_spec[lq_insert_idx] <= 0;
+        lq_violated[lq_insert_idx] <= 0;
+        lq_dep_valid[lq_insert_idx] <= ld_dep;
+        lq_dep_sq[lq_insert_idx] <= ld_lfst;
         lq_op2_rdy[lq_insert_idx] <= (~&rename_op[1:0]) | rename_op2ready;
         lq_op2[lq_insert_idx] <= rename_op2[7:0];
       end
@@ -299,8 +465,24 @@ module lsq(
         lq_addr[lq_addrgen_idx] <= lq_addrgen_addr;
       end
 
-      if(lq_issue_beat)
+      if(lq_issue_beat | lq_fwd_beat) begin
         lq_issued[lq_issue_idx] <= 1;
+        lq_spec[lq_issue_idx] <= lq_sq_unknown;
+      end
+
+      if(lq_fwd_beat) begin
+        lq_complete[lq_issue_idx] <= 1;
+        lq_error[lq_issue_idx] <= 0;
+        lq_ecause[lq_issue_idx] <= 0;
+        lq_data[lq_issue_idx] <= lq_sq_fwd_data;
+      end
+
+      if(sq_addrgen_req_r)
+        for(j = 0; j < 16; j=j+1) begin
+          lq_spec[j][sq_addrgen_idx] <= 0;
+          if((lq_dep_sq[j] == sq_addrgen_idx) & ~(lq_insert_beat & lq_insert_sel[j]))
+            lq_dep_valid[j] <= 0;
+        end
 
       if(dcache_lsq_valid) begin
         lq_complete[dcache_lsq_lsqid] <= 1;
@@ -318,9 +500,10 @@ module lsq(
             lq_base_rdy[j] <= 1;
             lq_base[j] <= wb_result;
 
-            top.tb_trace_lsq_base(
-              {1'b0,j[3:0]},
-              wb_result);
+            if(HARTID == 0)
+              top.tb_trace_lsq_base(
+                {1'b0,j[3:0]},
+                wb_result);
           end
 
           if(lq_valid[j] & ~lq_op2_rdy[j] & (lq_op2[j][6:0] == wb_robid)) begin
@@ -349,6 +532,7 @@ module lsq(
         sq_base[sq_tail] <= rename_op1;
         sq_imm[sq_tail] <= rename_imm;
         sq_data[sq_tail] <= rename_op2;
+        sq_pc[sq_tail] <= rename_pc;
       end
 
       if(sq_addrgen_req_r) begin
@@ -369,24 +553,55 @@ module lsq(
               sq_base_rdy[k] <= 1;
               sq_base[k] <= wb_result;
 
-              top.tb_trace_lsq_base(
-                {1'b1,k[3:0]},
-                wb_result);
+              if(HARTID == 0)
+                top.tb_trace_lsq_base(
+                  {1'b1,k[3:0]},
+                  wb_result);
             end
 
             if(~sq_data_rdy[k] & (sq_data[k][6:0] == wb_robid)) begin
               sq_data_rdy[k] <= 1;
               sq_data[k] <= wb_result;
 
-              top.tb_trace_lsq_wdata(
-                {1'b1,k[3:0]},
-                wb_result);
+              if(HARTID == 0)
+                top.tb_trace_lsq_wdata(
+                  {1'b1,k[3:0]},
+                  wb_result);
             end
           end
     end
 
+  // store sets
+  always @(posedge clk)
+    if(rst) begin
+      ssit_valid <= 0;
+      lfst_valid <= 0;
+      ssid_next_r <= 0;
+      ssit_age_r <= 0;
+    end else begin
+      ssit_age_r <= ssit_age_r + 1;
+      if(&ssit_age_r) begin
+        ssit_valid <= 0;
+        lfst_valid <= 0;
+      end else begin
+        if(sq_insert_beat & rename_ssid_valid) begin
+          lfst_valid[rename_ssid] <= 1;
+          lfst[rename_ssid] <= sq_tail;
+        end
+
+        if(|lq_violation) begin
+          ssit_valid[viol_ld_pc] <= 1;
+          ssit_valid[viol_st_pc] <= 1;
+          ssit[viol_ld_pc] <= viol_ssid;
+          ssit[viol_st_pc] <= viol_ssid;
+          if(~ssit_valid[viol_st_pc] & ~ssit_valid[viol_ld_pc])
+            ssid_next_r <= ssid_next_r + 1;
+        end
+      end
+    end
+
   always @(posedge clk)
-    if(rename_beat)
+    if((HARTID == 0) & rename_beat)
       top.tb_trace_lsq_dispatch(
         rename_robid,
         rename_op[3] ? {1'b1,sq_tail} : {1'b0,lq_insert_idx},
@@ -395,7 +610,7 @@ module lsq(
         rename_op2);
 
   always @(posedge clk)
-    if(~rst)
+    if((HARTID == 0) & ~rst)
       top.tb_log_lsq_inflight(
         lq_valid,
         sq_valid);
@@ -14,6 +14,17 @@ module rat(
   output            rat_rs2_valid,
   output reg [31:0] rat_rs2_tagval,
 
+  // second rename lane, allocating after the first
+  input [4:0]       rename_rs1_1,
+  input [4:0]       rename_rs2_1,
+  input             rename_alloc_1,
+  input [4:0]       rename_rd_1,
+  input [6:0]       rename_robid_1,
+  output            rat_rs1_valid_1,
+  output reg [31:0] rat_rs1_tagval_1,
+  output            rat_rs2_valid_1,
+  output reg [31:0] rat_rs2_tagval_1,
+
   // wb interface
   input             wb_valid,
   input             wb_error,
@@ -25,7 +36,10 @@ module rat(
   input             rob_flush,
   input             rob_ret_commit,
   input [4:0]       rob_ret_rd,
-  input [31:0]      rob_ret_result);
+  input [31:0]      rob_ret_result,
+  input             rob_ret_commit_1,
+  input [4:0]       rob_ret_rd_1,
+  input [31:0]      rob_ret_result_1);
 
   reg [31:0] rat_valid;
   reg [31:0] rat_committed;
@@ -39,6 +53,12 @@ module rat(
   reg [31:0] spec_val_rs1, spec_val_rs2;
   reg [6:0]  tag_rs1, tag_rs2, tag_wb;
 
+  reg        valid_rs1_1, valid_rs2_1;
+  reg        committed_rs1_1, committed_rs2_1;
+  reg [31:0] comm_val_rs1_1, comm_val_rs2_1;
+  reg [31:0] spec_val_rs1_1, spec_val_rs2_1;
+  reg [6:0]  tag_rs1_1, tag_rs2_1;
+
   wire wb_write;
   assign wb_write = wb_valid & ~wb_error & ~wb_rd[5] & (wb_robid == tag_wb);
 
@@ -46,6 +66,10 @@ module rat(
   assign fwd_rs1 = wb_write & (wb_rd[4:0] == rename_rs1);
   assign fwd_rs2 = wb_write & (wb_rd[4:0] == rename_rs2);
 
+  wire fwd_rs1_1, fwd_rs2_1;
+  assign fwd_rs1_1 = wb_write & (wb_rd[4:0] == rename_rs1_1);
+  assign fwd_rs2_1 = wb_write & (wb_rd[4:0] == rename_rs2_1);
+
   // flag store read
   always @(*) begin
     valid_rs1 = rat_valid[rename_rs1];
@@ -53,6 +77,12 @@ module rat(
 
     valid_rs2 = rat_valid[rename_rs2];
     committed_rs2 = rat_committed[rename_rs2];
+
+    valid_rs1_1 = rat_valid[rename_rs1_1];
+    committed_rs1_1 = rat_committed[rename_rs1_1];
+
+    valid_rs2_1 = rat_valid[rename_rs2_1];
+    committed_rs2_1 = rat_committed[rename_rs2_1];
   end
   // flag store write
   always @(posedge clk) begin
@@ -63,6 +93,10 @@ module rat(
       rat_valid[rename_rd] <= 0;
       rat_committed[rename_rd] <= 0;
     end
+    if(rename_alloc_1) begin
+      rat_valid[rename_rd_1] <= 0;
+      rat_committed[rename_rd_1] <= 0;
+    end
 
     if(rst | rob_flush) begin
       rat_valid <= 32'hFFFFFFFF;
@@ -74,16 +108,23 @@ module rat(
   always @(*) begin
     comm_val_rs1 = rat_comm_val[rename_rs1];
     comm_val_rs2 = rat_comm_val[rename_rs2];
+    comm_val_rs1_1 = rat_comm_val[rename_rs1_1];
+    comm_val_rs2_1 = rat_comm_val[rename_rs2_1];
   end
-  // committed data write
-  always @(posedge clk)
+  // committed data write (the second retirement slot is younger)
+  always @(posedge clk) begin
     if(rob_ret_commit)
       rat_comm_val[rob_ret_rd] <= rob_ret_result;
+    if(rob_ret_commit_1)
+      rat_comm_val[rob_ret_rd_1] <= rob_ret_result_1;
+  end
 
   // speculative data read
   always @(*) begin
     spec_val_rs1 = rat_spec_val[rename_rs1];
     spec_val_rs2 = rat_spec_val[rename_rs2];
+    spec_val_rs1_1 = rat_spec_val[rename_rs1_1];
+    spec_val_rs2_1 = rat_spec_val[rename_rs2_1];
   end
   // speculative data write
   always @(posedge clk)
@@ -95,15 +136,22 @@ module rat(
     tag_rs1 = rat_tag[rename_rs1];
     tag_rs2 = rat_tag[rename_rs2];
     tag_wb = rat_tag[wb_rd[4:0]];
+    tag_rs1_1 = rat_tag[rename_rs1_1];
+    tag_rs2_1 = rat_tag[rename_rs2_1];
   end
 
-  // tag store write
-  always @(posedge clk)
+  // tag store write (the second lane is younger)
+  always @(posedge clk) begin
     if(rename_alloc)
       rat_tag[rename_rd] <= rename_robid;
+    if(rename_alloc_1)
+      rat_tag[rename_rd_1] <= rename_robid_1;
+  end
 
   assign rat_rs1_valid = valid_rs1 | fwd_rs1;
   assign rat_rs2_valid = valid_rs2 | fwd_rs2;
+  assign rat_rs1_valid_1 = valid_rs1_1 | fwd_rs1_1;
+  assign rat_rs2_valid_1 = valid_rs2_1 | fwd_rs2_1;
 
   always @(*) begin
     if(fwd_rs1)
@@ -127,6 +175,28 @@ module rat(
       rat_rs2_tagval = spec_val_rs2;
     else
       rat_rs2_tagval = {25'b0,tag_rs2};
+
+    if(fwd_rs1_1)
+      rat_rs1_tagval_1 = wb_result;
+    else if(rename_rs1_1 == 0)
+      rat_rs1_tagval_1 = 0;
+    else if(committed_rs1_1)
+      rat_rs1_tagval_1 = comm_val_rs1_1;
+    else if(valid_rs1_1)
+      rat_rs1_tagval_1 = spec_val_rs1_1;
+    else
+      rat_rs1_tagval_1 = {25'b0,tag_rs1_1};
+
+    if(fwd_rs2_1)
+      rat_rs2_tagval_1 = wb_result;
+    else if(rename_rs2_1 == 0)
+      rat_rs2_tagval_1 = 0;
+    else if(committed_rs2_1)
+      rat_rs2_tagval_1 = comm_val_rs2_1;
+    else if(valid_rs2_1)
+      rat_rs2_tagval_1 = spec_val_rs2_1;
+    else
+      rat_rs2_tagval_1 = {25'b0,tag_rs2_1};
   end
   
 endmodule
@@ -23,6 +23,19 @@ module rename(
   input [31:0]     decode_imm,
   output reg       rename_stall,  
 
+  input            decode_rename_valid_1,
+  input [31:2]     decode_addr_1,
+  input [4:0]      decode_rsop_1,
+  input [6:0]      decode_robid_1,
+  input [5:0]      decode_rd_1,
+  input            decode_uses_rs1_1,
+  input            decode_uses_rs2_1,
+  input            decode_uses_imm_1,
+  input            decode_uses_pc_1,
+  input [4:0]      decode_rs1_1,
+  input [4:0]      decode_rs2_1,
+  input [31:0]     decode_imm_1,
+
   // rat interface
   output reg [4:0] rename_rs1,
   output reg [4:0] rename_rs2,
@@ -32,9 +45,19 @@ module rename(
   input            rat_rs2_valid,
   input [31:0]     rat_rs2_tagval,
 
+  output reg [4:0] rename_rs1_1,
+  output reg [4:0] rename_rs2_1,
+  output reg       rename_alloc_1,
+  input            rat_rs1_valid_1,
+  input [31:0]     rat_rs1_tagval_1,
+  input            rat_rs2_valid_1,
+  input [31:0]     rat_rs2_tagval_1,
+
   // common rat/dispatch/wb signals
   output reg [5:0]  rename_rd,
   output reg [6:0]  rename_robid,
+  output reg [5:0]  rename_rd_1,
+  output reg [6:0]  rename_robid_1,
 
   // exers/lsq/csr interface
   output reg       rename_exers_write,
@@ -46,6 +69,13 @@ module rename(
   output reg       rename_op2ready,
   output reg [31:0] rename_op2,
   output reg [31:0] rename_imm, 
+  output reg [31:2] rename_pc,
+  output reg       rename_exers_write_1,
+  output reg [4:0] rename_op_1,
+  output reg       rename_op1ready_1,
+  output reg [31:0] rename_op1_1,
+  output reg       rename_op2ready_1,
+  output reg [31:0] rename_op2_1,
   input            exers_stall,
   input            lsq_stall,
   input            csr_stall,
@@ -79,6 +109,25 @@ module rename(
   reg [4:0] rs2;
   reg [31:0] imm;
 
+  // second lane: only insns dispatched to exers (see decode)
+  reg valid_1;
+  reg [6:0] robid_1;
+  reg [31:0] addr_1;
+  reg [4:0] op_1;
+  reg [5:0] rd_1;
+  reg uses_rs1_1;
+  reg uses_rs2_1;
+  reg uses_imm_1;
+  reg uses_pc_1;
+  reg [4:0] rs1_1;
+  reg [4:0] rs2_1;
+  reg [31:0] imm_1;
+
+  // second lane sources written by the first lane: wait for its result
+  reg dep_rs1_1, dep_rs2_1;
+  reg rs1_valid_1, rs2_valid_1;
+  reg [31:0] rs1_tagval_1, rs2_tagval_1;
+
   always @(posedge clk) begin
     if (!rename_stall) begin
       valid <= decode_rename_valid;
@@ -98,11 +147,25 @@ module rename(
       rs1 <= decode_rs1;
       rs2 <= decode_rs2;
       imm <= decode_imm;
+
+      valid_1 <= decode_rename_valid_1;
+      robid_1 <= decode_robid_1;
+      addr_1 <= {decode_addr_1, 2'b00};
+      op_1 <= decode_rsop_1;
+      rd_1 <= decode_rd_1;
+      uses_rs1_1 <= decode_uses_rs1_1;
+      uses_rs2_1 <= decode_uses_rs2_1;
+      uses_imm_1 <= decode_uses_imm_1;
+      uses_pc_1 <= decode_uses_pc_1;
+      rs1_1 <= decode_rs1_1;
+      rs2_1 <= decode_rs2_1;
+      imm_1 <= decode_imm_1;
     end
     
     if (rst | rob_flush) begin
       // invalidate stage
       valid <= 0;
+      valid_1 <= 0;
     end
   end
 
@@ -162,17 +225,79 @@ module rename(
     endcase
 
     rename_imm = imm;
+    rename_pc = addr[31:2];
+
+    // second lane
+    rename_exers_write_1 = valid_1;
+    rename_op_1 = op_1;
+    rename_robid_1 = robid_1;
+    rename_rd_1 = rd_1;
+
+    dep_rs1_1 = valid & ~rd[5] & (rs1_1 == rd[4:0]);
+    dep_rs2_1 = valid & ~rd[5] & (rs2_1 == rd[4:0]);
+    rs1_valid_1 = rat_rs1_valid_1 & ~dep_rs1_1;
+    rs1_tagval_1 = dep_rs1_1 ? {25'b0, robid} : rat_rs1_tagval_1;
+    rs2_valid_1 = rat_rs2_valid_1 & ~dep_rs2_1;
+    rs2_tagval_1 = dep_rs2_1 ? {25'b0, robid} : rat_rs2_tagval_1;
+
+    casez ({uses_rs1_1, uses_pc_1})
+      // LUI
+      2'b00: begin
+        rename_op1ready_1 = 1;
+        rename_op1_1 = imm_1;
+        rename_op2ready_1 = 1;
+        rename_op2_1 = 0;
+      end
+      // AUIPC, JAL
+      2'b01: begin
+        rename_op1ready_1 = 1;
+        rename_op1_1 = addr_1;
+        rename_op2ready_1 = 1;
+        rename_op2_1 = imm_1;
+      end
+      // Most instructions
+      2'b10: begin
+        rename_op1ready_1 = rs1_valid_1;
+        rename_op1_1 = rs1_tagval_1;
+        casez ({uses_rs2_1, uses_imm_1})
+          // OP/I
+          2'b01: begin
+            rename_op2ready_1 = 1;
+            rename_op2_1 = imm_1;
+          end
+          // OP, BR
+          2'b1?: begin
+            rename_op2ready_1 = rs2_valid_1;
+            rename_op2_1 = rs2_tagval_1;
+          end
+          // N/A
+          default: begin
+            rename_op2ready_1 = 1'bx;
+            rename_op2_1 = 32'bx;
+          end
+        endcase
+      end
+      // N/A
+      default: begin
+        rename_op1ready_1 = 1'bx;
+        rename_op1_1 = 32'bx;
+      end
+    endcase
     
-    // stall combinational
+    // stall combinational: the pair dispatches together
     rename_stall = (rename_exers_write & exers_stall) |
+                   (rename_exers_write_1 & exers_stall) |
                    (rename_lsq_write & lsq_stall) |
                    (valid & csr_access & (~rob_rename_ishead | csr_stall));
 
     rename_rs1 = rs1;
     rename_rs2 = rs2;
+    rename_rs1_1 = rs1_1;
+    rename_rs2_1 = rs2_1;
 
     // delay tag allocation until dispatch
     rename_alloc = valid & ~rename_stall & ~rd[5];
+    rename_alloc_1 = valid_1 & ~rename_stall & ~rd_1[5];
 
     // if forwarding, send result to wb during tag allocation
     rename_wb_valid = valid & ~rename_stall & forward;
@@ -1,5 +1,15 @@
-// reorder buffer and retirement unit
-module rob(
+// front end and retirement width (1 or 2), set from the build
+`ifndef CPU_WIDTH
+`define CPU_WIDTH 2
+`endif
+
+// reorder buffer and retirement unit: takes up to two insns from decode and
+// retires up to WIDTH per cycle
+module rob #(
+  parameter WIDTH = `CPU_WIDTH,
+  // the harness traces hart 0 only
+  parameter HARTID = 0
+  )(
   input         clk,
   input         rst,
 
@@ -14,9 +24,25 @@ module rob(
   input         decode_bptaken,
   input         decode_forward,
   input [31:2]  decode_target,
+  input [31:2]  decode_jtarget,
+  input         decode_call,
+  input         decode_return,
   output        rob_full,
   output [6:0]  rob_robid,
 
+  input         decode_rob_valid_1,
+  input         decode_error_1,
+  input [1:0]   decode_ecause_1,
+  input [6:0]   decode_retop_1,
+  input [31:2]  decode_addr_1,
+  input [5:0]   decode_rd_1,
+  input [15:0]  decode_bptag_1,
+  input         decode_bptaken_1,
+  input [31:2]  decode_target_1,
+  input         decode_call_1,
+  output        rob_full_1,
+  output [6:0]  rob_robid_1,
+
   // rename interface
   input         rename_inhibit,
   input [6:0]   rename_robid,
@@ -31,28 +57,43 @@ module rob(
 
   // common signals
   output        rob_flush,
+  output        rob_mispred,
 
   // fetch interface
   output [31:2] rob_flush_pc,
+  output        rob_ret_call,
+  output        rob_ret_return,
+  output        rob_ret_jalr,
+  output [31:2] rob_ret_addr,
+  output [31:2] rob_ret_jtarget,
 
   // rat interface
   output        rob_ret_commit,
   output [4:0]  rob_ret_rd,
   output [31:0] rob_ret_result,
+  output        rob_ret_commit_1,
+  output [4:0]  rob_ret_rd_1,
+  output [31:0] rob_ret_result_1,
 
   // brpred interface
   output        rob_ret_branch,
   output [15:0] rob_ret_bptag,
   output        rob_ret_bptaken,
 
-  // lsq interface (out)
+  // lsq interface
+  input         lsq_rob_replay,
+  input [6:0]   lsq_rob_replay_robid,
   output        rob_ret_store,
 
   // csr interface
   input [31:2]  csr_tvec,
+  input         csr_irq,
   output        rob_ret_valid,
+  output        rob_ret_valid_1,
   output        rob_ret_csr,
+  output        rob_ret_mret,
   output        rob_csr_valid,
+  output        rob_csr_irq,
   output [31:2] rob_csr_epc,
   output [4:0]  rob_csr_ecause,
   output [31:0] rob_csr_tval);
@@ -67,7 +108,11 @@ module rob(
   reg [31:2]  buf_target [0:127];
   reg [15:0]  buf_bptag [0:127];
   reg [127:0] buf_bptaken;
+  reg [31:2]  buf_jtarget [0:127];
+  reg [127:0] buf_call;
+  reg [127:0] buf_return;
   reg [127:0] buf_forwarded;
+  reg [127:0] buf_replay;
 
   // insert at tail, remove at head
   reg [6:0]   buf_head, buf_tail;
@@ -83,7 +128,19 @@ module rob(
   reg [31:2]  ret_target;
   reg [15:0]  ret_bptag;
   reg         ret_bptaken;
+  reg [31:2]  ret_jtarget;
+  reg         ret_call;
+  reg         ret_return;
   reg         ret_forwarded;
+  reg         ret_replay;
+
+  // second retirement slot: the entry after the head, retired with it when
+  // it only writes a register (see ret_valid_1 below)
+  reg         ret_valid_1;
+  reg [6:0]   ret_retop_1;
+  reg [31:2]  ret_addr_1;
+  reg [5:0]   ret_rd_1;
+  reg [31:0]  ret_result_1;
 
   reg         rename_inhibit_r;
 
@@ -93,42 +150,87 @@ module rob(
 
   // forward buf_head when reading consecutive addrs
   wire ret_rd_empty;
-  assign buf_head_next = {buf_head_pol,buf_head} + 1;
+  assign buf_head_next = {buf_head_pol,buf_head} + (ret_valid_1 ? 8'd2 : 8'd1);
   assign ret_rd_addr = ret_valid ? buf_head_next[6:0] : buf_head;
   assign ret_rd_addr_pol = ret_valid ? buf_head_next[7] : buf_head_pol;
   assign ret_rd_empty = (ret_rd_addr == buf_tail) & (ret_rd_addr_pol == buf_tail_pol);
 
+  wire [7:0] ret_rd_next;
+  wire [6:0] ret_rd_addr_1;
+  wire       ret_rd_empty_1;
+  assign ret_rd_next = {ret_rd_addr_pol,ret_rd_addr} + 1;
+  assign ret_rd_addr_1 = ret_rd_next[6:0];
+  assign ret_rd_empty_1 = ret_rd_next == {buf_tail_pol,buf_tail};
+
   // derived signals
   wire buf_full;
   assign buf_full  = (buf_head == buf_tail) & (buf_head_pol != buf_tail_pol);
 
-  wire decode_beat;
+  wire [7:0] buf_used;
+  assign buf_used = {buf_tail_pol,buf_tail} - {buf_head_pol,buf_head};
+
+  wire decode_beat, decode_beat_1;
   assign decode_beat = decode_rob_valid & ~rob_full;
+  assign decode_beat_1 = decode_rob_valid_1 & ~rob_full_1;
+
+  wire [6:0] buf_tail_1;
+  assign buf_tail_1 = buf_tail + 1;
 
   wire br_result;
   assign br_result = ret_result[0] ^ ret_retop[0];
 
+  // interrupts are taken in place of the instruction at the head (csr
+  // instructions have already executed, so they are allowed to retire)
+  wire ret_irq;
+  assign ret_irq = ret_valid & ~ret_error & ~ret_retop[5] & csr_irq;
+
+  // mret is issued to the csr unit and redirects to mepc like a jalr
+  wire ret_mret;
+  assign ret_mret = ret_retop[5] & ret_retop[4];
+
+  // jalr: bptaken is set when fetch predicted jtarget and continued there
+  wire jalr_mispred;
+  assign jalr_mispred = ret_mret | ~ret_bptaken | (ret_result[31:2] != ret_jtarget);
+
+  // a load that read memory ahead of an older store to the same address is
+  // not retired, it is refetched
+  wire ret_reexec;
+  assign ret_reexec = ret_valid & ~ret_error & ~ret_irq & ret_replay;
+
   wire ret_exc, ret_mispred;
-  assign ret_exc = ret_valid & ret_error;
-  assign ret_mispred = ret_valid & (ret_retop[4] | (ret_retop[6] & (br_result ^ ret_bptaken)));
+  assign ret_exc = ret_valid & (ret_error | ret_irq);
+  assign ret_mispred = ret_valid & ~ret_irq & ((ret_retop[4] & jalr_mispred) | (ret_retop[6] & (br_result ^ ret_bptaken)));
 
   // decode interface
   assign rob_full = buf_full;
   assign rob_robid = buf_tail;
+  assign rob_full_1 = buf_used > 126;
+  assign rob_robid_1 = buf_tail_1;
   
   // rename interface: CSR execution
   assign rob_rename_ishead = rename_robid == ret_rd_addr;
 
   // common signals
-  assign rob_flush = ret_exc | ret_mispred;
+  assign rob_flush = ret_exc | ret_mispred | ret_reexec;
+  assign rob_mispred = ret_mispred;
 
   // fetch interface
-  assign rob_flush_pc = ret_error ? csr_tvec : (ret_forwarded ? ret_result[31:2] : ret_target);
+  assign rob_flush_pc = (ret_error | ret_irq) ? csr_tvec :
+                        ret_replay ? ret_addr :
+                        ((ret_forwarded | ret_mret) ? ret_result[31:2] : ret_target);
+  assign rob_ret_call = rob_ret_valid & ret_call;
+  assign rob_ret_return = rob_ret_valid & ret_return;
+  assign rob_ret_jalr = rob_ret_valid & ret_retop[4] & ~ret_mret & ~ret_return;
+  assign rob_ret_addr = ret_addr;
+  assign rob_ret_jtarget = ret_result[31:2];
 
   // csr interface
-  assign rob_ret_valid = ret_valid & ~ret_error;
+  assign rob_ret_valid = ret_valid & ~ret_error & ~ret_irq & ~ret_replay;
+  assign rob_ret_valid_1 = ret_valid_1 & ~rob_flush;
   assign rob_ret_csr = rob_ret_valid & ret_retop[5];
+  assign rob_ret_mret = rob_ret_valid & ret_mret;
   assign rob_csr_valid = ret_exc;
+  assign rob_csr_irq = ret_irq;
   assign rob_csr_epc = ret_addr;
   assign rob_csr_ecause = ret_ecause;
   assign rob_csr_tval = 0; // TODO
@@ -137,6 +239,9 @@ module rob(
   assign rob_ret_commit = rob_ret_valid & ~ret_rd[5];
   assign rob_ret_rd = ret_rd[4:0];
   assign rob_ret_result = ret_forwarded ? {ret_target,2'b0} : ret_result;
+  assign rob_ret_commit_1 = rob_ret_valid_1 & ~ret_rd_1[5];
+  assign rob_ret_rd_1 = ret_rd_1[4:0];
+  assign rob_ret_result_1 = ret_result_1;
 
   // brpred interface
   assign rob_ret_branch =rob_ret_valid & ret_retop[6];
@@ -160,7 +265,7 @@ module rob(
       buf_tail <= 0;
       buf_tail_pol <= 0;
     end else if(decode_beat)
-      {buf_tail_pol,buf_tail} <= {buf_tail_pol,buf_tail} + 1;
+      {buf_tail_pol,buf_tail} <= {buf_tail_pol,buf_tail} + (decode_beat_1 ? 8'd2 : 8'd1);
 
   // rename_inhibit_r
   always @(posedge clk)
@@ -171,9 +276,10 @@ module rob(
 
   // buf read
   always @(posedge clk)
-    if(rst | rob_flush)
+    if(rst | rob_flush) begin
       ret_valid <= 0;
-    else begin
+      ret_valid_1 <= 0;
+    end else begin
       // prevent retirement of stores prior to lsq dispatch
       ret_valid <= buf_executed[ret_rd_addr] & ~ret_rd_empty &
                    (~buf_retop[ret_rd_addr][3] | ~rob_rename_ishead);
@@ -186,7 +292,24 @@ module rob(
       ret_target <= buf_target[ret_rd_addr];
       ret_bptag <= buf_bptag[ret_rd_addr];
       ret_bptaken <= buf_bptaken[ret_rd_addr];
+      ret_jtarget <= buf_jtarget[ret_rd_addr];
+      ret_call <= buf_call[ret_rd_addr];
+      ret_return <= buf_return[ret_rd_addr];
       ret_forwarded <= buf_forwarded[ret_rd_addr];
+      ret_replay <= buf_replay[ret_rd_addr];
+
+      // only what needs no more than a rat update: no errors, branches, csr
+      // insns, jalr, stores, calls or replays
+      ret_valid_1 <= (WIDTH > 1) &
+                     buf_executed[ret_rd_addr] & ~ret_rd_empty &
+                     (~buf_retop[ret_rd_addr][3] | ~rob_rename_ishead) &
+                     buf_executed[ret_rd_addr_1] & ~ret_rd_empty_1 &
+                     ~buf_error[ret_rd_addr_1] & (buf_retop[ret_rd_addr_1][6:3] == 0) &
+                     ~buf_call[ret_rd_addr_1] & ~buf_replay[ret_rd_addr_1];
+      ret_retop_1 <= buf_retop[ret_rd_addr_1];
+      ret_addr_1 <= buf_addr[ret_rd_addr_1];
+      ret_rd_1 <= buf_rd[ret_rd_addr_1];
+      ret_result_1 <= buf_result[ret_rd_addr_1];
     end
 
   // buf write
@@ -201,9 +324,32 @@ module rob(
       buf_target[buf_tail] <= decode_target;
       buf_bptag[buf_tail] <= decode_bptag;
       buf_bptaken[buf_tail] <= decode_bptaken;
+      buf_jtarget[buf_tail] <= decode_jtarget;
+      buf_call[buf_tail] <= decode_call;
+      buf_return[buf_tail] <= decode_return;
       buf_forwarded[buf_tail] <= decode_forward;
+      buf_replay[buf_tail] <= 0;
     end
 
+    if(decode_beat_1) begin
+      buf_executed[buf_tail_1] <= decode_error_1 | decode_retop_1[3];
+      buf_error[buf_tail_1] <= decode_error_1;
+      buf_retop[buf_tail_1] <= decode_retop_1;
+      buf_addr[buf_tail_1] <= decode_addr_1;
+      buf_rd[buf_tail_1] <= decode_rd_1;
+      buf_ecause[buf_tail_1] <= {3'b0,decode_ecause_1};
+      buf_target[buf_tail_1] <= decode_target_1;
+      buf_bptag[buf_tail_1] <= decode_bptag_1;
+      buf_bptaken[buf_tail_1] <= decode_bptaken_1;
+      buf_call[buf_tail_1] <= decode_call_1;
+      buf_return[buf_tail_1] <= 0;
+      buf_forwarded[buf_tail_1] <= 0;
+      buf_replay[buf_tail_1] <= 0;
+    end
+
+    if(lsq_rob_replay)
+      buf_replay[lsq_rob_replay_robid] <= 1;
+
     if(wb_valid & ~rename_inhibit_r) begin
       buf_executed[wb_robid] <= 1;
       buf_error[wb_robid] <= wb_error;
@@ -212,19 +358,32 @@ module rob(
     end
   end
 
-  always @(posedge clk) begin
-    if(ret_valid)
-      top.tb_trace_rob_retire(
-        buf_head,
-        ret_retop,
-        ret_addr,
-        ret_error,
-        ret_mispred,
-        ret_ecause,
-        ret_rd,
-        rob_ret_result);
-    if(rob_flush)
-      top.tb_log_rob_flush();
-  end
+  always @(posedge clk)
+    if(HARTID == 0) begin
+      if(ret_irq)
+        top.tb_log_rob_irq(ret_addr);
+      else if(ret_valid & ~ret_reexec)
+        top.tb_trace_rob_retire(
+          buf_head,
+          ret_retop,
+          ret_addr,
+          ret_error,
+          ret_mispred,
+          ret_ecause,
+          ret_rd,
+          rob_ret_result);
+      if(rob_ret_valid_1)
+        top.tb_trace_rob_retire(
+          buf_head + 7'd1,
+          ret_retop_1,
+          ret_addr_1,
+          1'b0,
+          1'b0,
+          5'd0,
+          ret_rd_1,
+          rob_ret_result_1);
+      if(rob_flush)
+        top.tb_log_rob_flush();
+    end
 
 endmodule
@@ -31,7 +31,8 @@ module rom(
   reg        cmd_valid_r;
   reg [4:0]  cmd_tag_r;
   reg [31:6] cmd_addr_r;
-  reg        resp_valid_r;
+  // the beat to send first, named in the data lines of the BusRd
+  reg [2:0]  cmd_beat_r;
 
   /*verilator lint_off WIDTH*/
   wire cmd_relevant;
@@ -44,14 +45,14 @@ module rom(
   wire [2:0] bus_cycle_n;
   assign bus_cycle_n = bus_cycle_r + 1;
 
-  wire [31:2] mem_addr;
-  assign mem_addr = {rom_bus_addr,bus_cycle_r,1'b0};
-
+  // the line is read once when the response is granted, then sent a beat
+  // per cycle, starting at line_beat_r
+  reg [511:0] line_r;
+  reg [2:0]   line_beat_r;
+  wire [2:0]  out_beat;
+  assign out_beat = bus_cycle_r + line_beat_r;
   always @(*)
-    if(resp_valid_r) begin
-      top.tb_mem_read(mem_addr, rom_bus_data[31:0]);
-      top.tb_mem_read(mem_addr+1, rom_bus_data[63:32]);
-    end
+    rom_bus_data = line_r[out_beat*64+:64];
 
   always @(posedge clk)
     if(rst)
@@ -63,7 +64,6 @@ module rom(
     if(rst) begin
       rom_bus_req <= 0;
       cmd_valid_r <= 0;
-      resp_valid_r <= 0;
     end else if(bus_cycle_r == 0) begin
       rom_bus_req <= cmd_relevant | cmd_valid_r;
       rom_bus_cmd <= `CMD_FILL;
@@ -71,13 +71,16 @@ module rom(
         cmd_valid_r <= 1;
         cmd_tag_r <= bus_tag;
         cmd_addr_r <= bus_addr;
+        cmd_beat_r <= bus_data[2:0];
       end
     end else if(bus_cycle_r == 7)
       if(rom_bus_req & bus_rom_grant) begin
         cmd_valid_r <= 0;
-        resp_valid_r <= cmd_valid_r;
         rom_bus_tag <= cmd_tag_r;
         rom_bus_addr <= cmd_addr_r;
+        line_beat_r <= cmd_beat_r;
+        if(cmd_valid_r)
+          top.tb_mem_read_line(cmd_addr_r, line_r);
       end
 
   assign rom_bus_nack = 0;
@@ -20,6 +20,7 @@
 #define LQ_SIZE 16
 #define SQ_SIZE 16
 #define LSQ_SIZE (LQ_SIZE+SQ_SIZE)
+#define LD_LAT_MAX 32
 
 #define CMD_BUSRD   0
 #define CMD_BUSRDX  1
@@ -42,6 +43,10 @@ static std::unordered_map<uint16_t,std::string> csr_names = {
   {0x305, "mtvec"},
   {0x306, "mcounteren"},
   {0x310, "mstatush"},
+  {0x323, "mhpmevent3"},
+  {0x324, "mhpmevent4"},
+  {0x325, "mhpmevent5"},
+  {0x326, "mhpmevent6"},
   {0x340, "mscratch"},
   {0x341, "mepc"},
   {0x342, "mcause"},
@@ -55,17 +60,41 @@ static std::unordered_map<uint16_t,std::string> csr_names = {
   {0x7d2, "mbfstarg"},
   {0x7d3, "mbfsqbase"},
   {0x7d4, "mbfsqsize"},
+  {0x7d5, "mbfsresult"},
+  {0x7d6, "mbfsnbase"},
+  {0x7d7, "mbfspbase"},
+  {0x7d8, "mbfsobase"},
+  {0x7d9, "mbfsebase"},
+  {0x7da, "mbfsvbase"},
+  {0x7db, "mbfspfcfg"},
   {0x7e0, "ml2stat"},
   {0xb00, "mcycle"},
   {0xb02, "minstret"},
+  {0xb03, "mhpmcounter3"},
+  {0xb04, "mhpmcounter4"},
+  {0xb05, "mhpmcounter5"},
+  {0xb06, "mhpmcounter6"},
   {0xb80, "mcycleh"},
   {0xb82, "minstreth"},
+  {0xb83, "mhpmcounter3h"},
+  {0xb84, "mhpmcounter4h"},
+  {0xb85, "mhpmcounter5h"},
+  {0xb86, "mhpmcounter6h"},
   {0xf11, "mvendorid"},
   {0xf12, "marchid"},
   {0xf13, "mimpid"},
   {0xf14, "mhartid"},
   {0xfc0, "muartstat"},
   {0xfc1, "muartrx"},
+  {0xfd0, "mbfsdeq"},
+  {0xfd1, "mbfsenq"},
+  {0xfd2, "mbfsmarked"},
+  {0xfd3, "mbfsspill"},
+  {0xfd4, "mbfsrestore"},
+  {0xfd5, "mbfsqstall"},
+  {0xfd6, "mbfsdcwait"},
+  {0xfd7, "mbfscycles"},
+  {0xfd8, "mbfsprefetch"},
 };
 
 static VerilatedContext* context;
@@ -82,6 +111,7 @@ static uint32_t mem_rom[ROM_SIZE];
 static FILE* uartfile;
 static FILE* tracefile;
 static FILE* logfile;
+static FILE* brtracefile;
 
 typedef struct {
   uint32_t insn;
@@ -104,6 +134,45 @@ static struct {
   unsigned instret;
   unsigned branches;
   unsigned mispreds;
+  // jalr split into returns (predicted by the ras) and other indirect jumps
+  unsigned returns;
+  unsigned ret_mispreds;
+  unsigned ijumps;
+  unsigned ij_mispreds;
+  unsigned irqs;
+  // accelerator counters, summed over searches
+  unsigned bfs_runs;
+  uint64_t bfs_deq;
+  uint64_t bfs_enq;
+  uint64_t bfs_marked;
+  uint64_t bfs_spill;
+  uint64_t bfs_restore;
+  uint64_t bfs_qstall;
+  uint64_t bfs_dcwait;
+  uint64_t bfs_cycles;
+  uint64_t bfs_pf;
+  // l2 prefetcher: prefetches sent and filled, demand reads that missed, and
+  // demand reads that hit a prefetched line (late: it was still in flight)
+  uint64_t l2pf_issued;
+  uint64_t l2pf_fills;
+  uint64_t l2pf_hits;
+  uint64_t l2pf_late;
+  uint64_t l2_rd_misses;
+  // icache lookups, line misses and cycles fetch waited on them
+  uint64_t ic_accesses;
+  uint64_t ic_misses;
+  uint64_t ic_wait;
+  // l2 banks, by busid and bank: cycles busy, and cycles a request waited
+  // for its bank
+  uint64_t l2bank_busy[4][4];
+  uint64_t l2bank_stall[4][4];
+  // load latency, dcache request to response, by lsqid while in flight
+  uint64_t ld_time[LQ_SIZE];
+  bool ld_pending[LQ_SIZE];
+  uint64_t ld_count;
+  uint64_t ld_total;
+  uint64_t ld_max;
+  unsigned ld_lat_hist[LD_LAT_MAX+1];
   unsigned rob_inflight;
   unsigned rob_inflight_hist[ROB_SIZE+1];
   unsigned lq_inflight_hist[LQ_SIZE+1];
@@ -213,6 +282,57 @@ static void print_stats() {
   printf("Average CPI: %.3f\n", ((double) context->time()) / stats.instret);
   printf("Branch prediction accuracy: %.2f\n",
          1.0 - (((double) stats.mispreds) / stats.branches));
+  if(stats.returns)
+    printf("Return prediction accuracy: %.2f\n",
+           1.0 - (((double) stats.ret_mispreds) / stats.returns));
+  if(stats.ijumps)
+    printf("Indirect jump prediction accuracy: %.2f\n",
+           1.0 - (((double) stats.ij_mispreds) / stats.ijumps));
+  printf("Interrupts taken: %d\n", stats.irqs);
+  if(stats.ic_accesses) {
+    printf("Icache accesses/misses: %ld/%ld\n", stats.ic_accesses, stats.ic_misses);
+    printf("Icache miss rate: %.4f\n",
+           ((double) stats.ic_misses) / stats.ic_accesses);
+    printf("Icache miss wait cycles: %ld\n", stats.ic_wait);
+  }
+  for(int i = 0; i < 4; i++) {
+    for(int j = 0; j < 4; j++) {
+      if(stats.l2bank_busy[i][j])
+        printf("L2 %d bank %d busy/conflict cycles: %ld/%ld\n", i, j,
+               stats.l2bank_busy[i][j], stats.l2bank_stall[i][j]);
+    }
+  }
+  if(stats.bfs_runs) {
+    printf("BFS searches: %d\n", stats.bfs_runs);
+    printf("BFS active cycles: %ld\n", stats.bfs_cycles);
+    printf("BFS nodes dequeued: %ld\n", stats.bfs_deq);
+    printf("BFS edges enqueued: %ld\n", stats.bfs_enq);
+    printf("BFS already-marked hits: %ld\n", stats.bfs_marked);
+    printf("BFS lines spilled/restored: %ld/%ld\n",
+           stats.bfs_spill, stats.bfs_restore);
+    printf("BFS queue stall cycles: %ld\n", stats.bfs_qstall);
+    printf("BFS cache wait cycles: %ld\n", stats.bfs_dcwait);
+    printf("BFS prefetches: %ld\n", stats.bfs_pf);
+  }
+  if(stats.l2pf_issued) {
+    printf("L2 prefetches issued/filled: %ld/%ld\n",
+           stats.l2pf_issued, stats.l2pf_fills);
+    printf("L2 prefetch accuracy: %.2f\n",
+           stats.l2pf_fills ? ((double) stats.l2pf_hits) / stats.l2pf_fills : 0.0);
+    printf("L2 prefetch coverage: %.2f\n",
+           ((double) stats.l2pf_hits) / (stats.l2pf_hits + stats.l2_rd_misses));
+    printf("L2 prefetch timeliness: %.2f\n",
+           stats.l2pf_hits ? 1.0 - ((double) stats.l2pf_late) / stats.l2pf_hits : 0.0);
+  }
+
+  if(stats.ld_count) {
+    printf("Load latency avg/max: %.2f/%ld\n",
+           ((double) stats.ld_total) / stats.ld_count, stats.ld_max);
+    fputs("Load latency histogram: ", stdout);
+    for(int i = 0; i < LD_LAT_MAX+1; i++)
+      printf("%d,", stats.ld_lat_hist[i]);
+    putchar('\n');
+  }
 
   fputs("ROB occupancy histogram: ", stdout);
   for(int i = 0; i < ROB_SIZE+1; i++)
@@ -287,6 +407,7 @@ int main(int argc, char** argv) {
   uartfile = open_argfile("uartfile", "w", stdout);
   tracefile = open_argfile("tracefile", "w", nullptr);
   logfile = open_argfile("logfile", "w", nullptr);
+  brtracefile = open_argfile("brtracefile", "w", nullptr);
 
   // Initialize time vars (must be done before gotos)
   clock_t start = 0;
@@ -380,6 +501,28 @@ void dramsim_respdata(svBitVecVal* tag, svBitVecVal* addr, svBitVecVal* data) {
 }
 
 // testbench functions
+int tb_log_bfs_done(const svBitVecVal* deq, const svBitVecVal* enq,
+                    const svBitVecVal* marked, const svBitVecVal* spill,
+                    const svBitVecVal* restore, const svBitVecVal* qstall,
+                    const svBitVecVal* dcwait, const svBitVecVal* cycles,
+                    const svBitVecVal* prefetches) {
+  stats.bfs_runs++;
+  stats.bfs_deq += *deq;
+  stats.bfs_enq += *enq;
+  stats.bfs_marked += *marked;
+  stats.bfs_spill += *spill;
+  stats.bfs_restore += *restore;
+  stats.bfs_qstall += *qstall;
+  stats.bfs_dcwait += *dcwait;
+  stats.bfs_cycles += *cycles;
+  stats.bfs_pf += *prefetches;
+
+  if(logfile)
+    fprintf(logfile, "%lld bfs done %d %d\n", context->time(), *deq, *cycles);
+
+  return 0;
+}
+
 int tb_log_bus_cycle(svBit nack, svBit hit, const svBitVecVal* cmd,
                      const svBitVecVal* tag, const svBitVecVal* addr) {
   if(!logfile) {return 0;}
@@ -430,6 +573,11 @@ int tb_log_bus_data(const svBitVecVal* index, const svBitVecVal* data) {
 
 int tb_log_dcache_req(const svBitVecVal* lsqid, const svBitVecVal* op,
                       const svBitVecVal* addr, const svBitVecVal* wdata) {
+  if(!(*op & 1)) {
+    stats.ld_time[*lsqid] = context->time();
+    stats.ld_pending[*lsqid] = true;
+  }
+
   if(!logfile) {return 0;}
 
   const char* mnemonic;
@@ -459,9 +607,11 @@ int tb_log_dcache_req(const svBitVecVal* lsqid, const svBitVecVal* op,
     mnemonic = "sw";
     break;
   case 0b0110:
-  case 0b1110:
     mnemonic = "lbcmp";
     break;
+  case 0b1110:
+    mnemonic = "lbcmp64";
+    break;
   default:
     mnemonic = "???";
     break;
@@ -482,6 +632,16 @@ int tb_log_dcache_req(const svBitVecVal* lsqid, const svBitVecVal* op,
 
 int tb_log_dcache_resp(const svBitVecVal* lsqid, svBit error,
                        const svBitVecVal* rdata) {
+  if(stats.ld_pending[*lsqid]) {
+    uint64_t lat = context->time() - stats.ld_time[*lsqid];
+    stats.ld_pending[*lsqid] = false;
+    stats.ld_count++;
+    stats.ld_total += lat;
+    if(lat > stats.ld_max)
+      stats.ld_max = lat;
+    stats.ld_lat_hist[lat < LD_LAT_MAX ? lat : LD_LAT_MAX]++;
+  }
+
   if(!logfile) {return 0;}
 
   fprintf(logfile, "%lld resp %d", context->time(), *lsqid);
@@ -494,6 +654,34 @@ int tb_log_dcache_resp(const svBitVecVal* lsqid, svBit error,
   return 0;
 }
 
+int tb_log_l2pf(svBit issue, svBit rd_miss, svBit pf_fill, svBit pf_hit,
+                svBit pf_late) {
+  stats.l2pf_issued += issue;
+  stats.l2_rd_misses += rd_miss;
+  stats.l2pf_fills += pf_fill;
+  stats.l2pf_hits += pf_hit;
+  stats.l2pf_late += pf_late;
+
+  return 0;
+}
+
+int tb_log_l2bank(const svBitVecVal* busid, const svBitVecVal* bank,
+                  const svBitVecVal* busy, const svBitVecVal* stall) {
+  stats.l2bank_busy[*busid][*bank] += *busy;
+  stats.l2bank_stall[*busid][*bank] += *stall;
+
+  return 0;
+}
+
+int tb_log_icache(const svBitVecVal* accesses, svBit miss,
+                  const svBitVecVal* wait_cycles) {
+  stats.ic_accesses += *accesses;
+  stats.ic_misses += miss;
+  stats.ic_wait += *wait_cycles;
+
+  return 0;
+}
+
 int tb_log_lsq_inflight(const svBitVecVal* lq_valid,
                         const svBitVecVal* sq_valid) {
   int cnt = 0;
@@ -522,11 +710,21 @@ int tb_log_rob_flush() {
   return 0;
 }
 
-int tb_mem_read(const svBitVecVal* addr, svBitVecVal* rdata) {
-  if(*addr >= ROM_BASE && *addr < (ROM_BASE+ROM_SIZE))
-    *rdata = mem_rom[*addr-ROM_BASE];
+int tb_log_rob_irq(const svBitVecVal* addr) {
+  if(logfile)
+    fprintf(logfile, "%lld irq %08lx\n", context->time(), *addr << 2);
+
+  stats.irqs++;
+
+  return 0;
+}
+
+int tb_mem_read_line(const svBitVecVal* addr, svBitVecVal* rdata) {
+  uint32_t base = *addr << 4;
+  if(base >= ROM_BASE && base < (ROM_BASE+ROM_SIZE))
+    memcpy(rdata, &mem_rom[base-ROM_BASE], 16*sizeof(uint32_t));
   else
-    *rdata = 0;
+    memset(rdata, 0, 16*sizeof(uint32_t));
 
   return 0;
 }
@@ -595,11 +793,31 @@ int tb_trace_rob_retire(const svBitVecVal* robid, const svBitVecVal* retop,
     stats.branches++;
     if(mispred)
       stats.mispreds++;
+    // branch address and outcome, for perf/bpeval
+    if(brtracefile && !error)
+      fprintf(brtracefile, "%08lx %d\n", *addr << 2, (int) ((*result ^ *retop) & 1));
+  }
+
+  rob_trace_t& rob_entry = rob_trace[*robid];
+  if(((*retop >> 4) & 0b11) == 0b01) {
+    // jalr: a return reads the link register without writing one
+    uint32_t insn_rd = (rob_entry.insn >> 7) & 0b11111;
+    uint32_t insn_rs1 = (rob_entry.insn >> 15) & 0b11111;
+    bool rd_link = insn_rd == 1 || insn_rd == 5;
+    bool rs1_link = insn_rs1 == 1 || insn_rs1 == 5;
+    if(rs1_link && !rd_link) {
+      stats.returns++;
+      if(mispred)
+        stats.ret_mispreds++;
+    } else {
+      stats.ijumps++;
+      if(mispred)
+        stats.ij_mispreds++;
+    }
   }
   stats.rob_inflight--;
 
   // Generate trace output
-  rob_trace_t& rob_entry = rob_trace[*robid];
   uint32_t memaddr = rob_entry.membase + rob_entry.imm;
   if(tracefile) {
     fprintf(tracefile, "core   0: 3 0x%08lx (0x%08lx)", *addr << 2, rob_entry.insn);
@@ -623,6 +841,11 @@ int tb_trace_rob_retire(const svBitVecVal* robid, const svBitVecVal* retop,
             fprintf(tracefile, " 0x%08lx", rob_entry.memdata);
             break;
           }
+        else if((rob_entry.memop & 0b111) == 0b111) {
+          // lbcmp64 reads to the end of the line
+          for(uint32_t a = (memaddr & ~7) + 8; a & 63; a += 8)
+            fprintf(tracefile, " mem 0x%08lx", a);
+        }
         else if((rob_entry.memop & 0b11) == 0b11) {
           // lbcmp makes multiple sequential accesses
           fprintf(tracefile, " mem 0x%08lx", memaddr+8);
@@ -650,6 +873,7 @@ int tb_trace_rob_retire(const svBitVecVal* robid, const svBitVecVal* retop,
   // HTIF tohost write termination
   if(!error && rob_entry.uses_mem && ((rob_entry.memop >> 3) & 1) &&
      ((memaddr >> 2) == DBG_TOHOST)) {
+    printf("Exit code: %d\n", (int) (rob_entry.memdata >> 1));
     context->gotFinish(true);
   }
 
@@ -9,13 +9,18 @@ module top();
     .rst(rst));
 
 `ifdef VERILATOR
+  import "DPI-C" task tb_log_bfs_done(input bit [31:0] deq, input bit [31:0] enq, input bit [31:0] marked, input bit [31:0] spill, input bit [31:0] restore, input bit [31:0] qstall, input bit [31:0] dcwait, input bit [31:0] cycles, input bit [31:0] prefetches);
   import "DPI-C" task tb_log_bus_cycle(input bit nack, input bit hit, input bit [2:0] cmd, input bit [4:0] tag, input bit [31:6] addr);
   import "DPI-C" task tb_log_bus_data(input bit [2:0] index, input bit [63:0] data);
   import "DPI-C" task tb_log_dcache_req(input bit [3:0] lsqid, input bit [3:0] op, input bit [31:0] addr, input bit [31:0] wdata);
   import "DPI-C" task tb_log_dcache_resp(input bit [3:0] lsqid, input bit error, input bit [31:0] rdata);
+  import "DPI-C" task tb_log_icache(input bit [31:0] accesses, input bit miss, input bit [31:0] wait_cycles);
+  import "DPI-C" task tb_log_l2bank(input bit [1:0] busid, input bit [1:0] bank, input bit [31:0] busy, input bit [31:0] stall);
+  import "DPI-C" task tb_log_l2pf(input bit issue, input bit rd_miss, input bit pf_fill, input bit pf_hit, input bit pf_late);
   import "DPI-C" task tb_log_lsq_inflight(input bit [15:0] lq_valid, input bit [15:0] sq_valid);
   import "DPI-C" task tb_log_rob_flush();
-  import "DPI-C" task tb_mem_read(input bit [31:2] addr, output bit [31:0] rdata);
+  import "DPI-C" task tb_log_rob_irq(input bit [31:2] addr);
+  import "DPI-C" task tb_mem_read_line(input bit [31:6] addr, output bit [511:0] rdata);
   import "DPI-C" task tb_trace_csr_write(input bit [6:0] robid, input bit [11:0] addr, input bit [31:0] data);
   import "DPI-C" task tb_trace_decode(input bit [6:0] robid, input bit [31:0] insn, input bit [31:0] imm);
   import "DPI-C" task tb_trace_lsq_base(input bit [4:0] lsqid, input bit [31:0] base);
@@ -94,14 +99,16 @@ module top();
   initial
     openargfile("uartfile", "w", uartfd, STDOUT);
 
-  task automatic tb_mem_read(
-    input [31:2]      addr,
-    output reg [31:0] rdata);
+  task automatic tb_mem_read_line(
+    input [31:6]       addr,
+    output reg [511:0] rdata);
 
-    if(addr >= ROM_BASE && addr < (ROM_BASE+ROM_SIZE))
-      rdata = mem_rom[addr-ROM_BASE];
-    else
-      rdata = 0;
+    integer i;
+    for(i = 0; i < 16; i=i+1)
+      if({addr,4'b0} >= ROM_BASE && {addr,4'b0} < (ROM_BASE+ROM_SIZE))
+        rdata[i*32+:32] = mem_rom[{addr,4'b0}+i-ROM_BASE];
+      else
+        rdata[i*32+:32] = 0;
   endtask
 
   task tb_uart_tx(
@@ -110,10 +117,11 @@ module top();
     $fwrite(uartfd, "%c", char);
   endtask
 
-  integer tracefd, logfd;
+  integer tracefd, logfd, brtracefd;
   initial begin
     openargfile("tracefile", "w", tracefd, 0);
     openargfile("logfile", "w", logfd, 0);
+    openargfile("brtracefile", "w", brtracefd, 0);
   end
 
   // indexed by robid
@@ -134,6 +142,46 @@ module top();
   integer     trace_instret;
   integer     trace_branches;
   integer     trace_mispreds;
+  // jalr split into returns (predicted by the ras) and other indirect jumps
+  integer     trace_returns;
+  integer     trace_ret_mispreds;
+  integer     trace_ijumps;
+  integer     trace_ij_mispreds;
+  integer     trace_irqs;
+  // accelerator counters, summed over searches
+  integer     trace_bfs_runs;
+  integer     trace_bfs_deq;
+  integer     trace_bfs_enq;
+  integer     trace_bfs_marked;
+  integer     trace_bfs_spill;
+  integer     trace_bfs_restore;
+  integer     trace_bfs_qstall;
+  integer     trace_bfs_dcwait;
+  integer     trace_bfs_cycles;
+  integer     trace_bfs_pf;
+  // l2 prefetcher: prefetches sent and filled, demand reads that missed, and
+  // demand reads that hit a prefetched line (late: it was still in flight)
+  integer     trace_l2pf_issued;
+  integer     trace_l2pf_fills;
+  integer     trace_l2pf_hits;
+  integer     trace_l2pf_late;
+  integer     trace_l2_rd_misses;
+  // icache lookups, line misses and cycles fetch waited on them
+  integer     trace_ic_accesses;
+  integer     trace_ic_misses;
+  integer     trace_ic_wait;
+  // l2 banks, by busid*4+bank: cycles busy, and cycles a request waited
+  // for its bank
+  integer     trace_l2bank_busy [0:15];
+  integer     trace_l2bank_stall [0:15];
+  // load latency, dcache request to response (the last bucket is 32 and
+  // up), by lsqid while in flight
+  integer     trace_ld_time [0:15];
+  reg [15:0]  trace_ld_pending;
+  integer     trace_ld_count;
+  integer     trace_ld_total;
+  integer     trace_ld_max;
+  integer     trace_ld_lat_hist [0:32];
   integer     trace_rob_inflight;
   integer     trace_rob_inflight_hist [0:128];
   integer     trace_lq_inflight_hist [0:16];
@@ -142,6 +190,39 @@ module top();
     trace_instret = 0;
     trace_branches = 0;
     trace_mispreds = 0;
+    trace_returns = 0;
+    trace_ret_mispreds = 0;
+    trace_ijumps = 0;
+    trace_ij_mispreds = 0;
+    trace_irqs = 0;
+    trace_bfs_runs = 0;
+    trace_bfs_deq = 0;
+    trace_bfs_enq = 0;
+    trace_bfs_marked = 0;
+    trace_bfs_spill = 0;
+    trace_bfs_restore = 0;
+    trace_bfs_qstall = 0;
+    trace_bfs_dcwait = 0;
+    trace_bfs_cycles = 0;
+    trace_bfs_pf = 0;
+    trace_l2pf_issued = 0;
+    trace_l2pf_fills = 0;
+    trace_l2pf_hits = 0;
+    trace_l2pf_late = 0;
+    trace_l2_rd_misses = 0;
+    trace_ic_accesses = 0;
+    trace_ic_misses = 0;
+    trace_ic_wait = 0;
+    for(j = 0; j < 16; j=j+1) begin
+      trace_l2bank_busy[j] = 0;
+      trace_l2bank_stall[j] = 0;
+    end
+    trace_ld_pending = 0;
+    trace_ld_count = 0;
+    trace_ld_total = 0;
+    trace_ld_max = 0;
+    for(j = 0; j < 33; j=j+1)
+      trace_ld_lat_hist[j] = 0;
     trace_rob_inflight = 0;
     for(j = 0; j < 129; j=j+1)
       trace_rob_inflight_hist[j] = 0;
@@ -248,6 +329,13 @@ module top();
       12'h7d2: csr_name = "mbfstarg";
       12'h7d3: csr_name = "mbfsqbase";
       12'h7d4: csr_name = "mbfsqsize";
+      12'h7d5: csr_name = "mbfsresult";
+      12'h7d6: csr_name = "mbfsnbase";
+      12'h7d7: csr_name = "mbfspbase";
+      12'h7d8: csr_name = "mbfsobase";
+      12'h7d9: csr_name = "mbfsebase";
+      12'h7da: csr_name = "mbfsvbase";
+      12'h7db: csr_name = "mbfspfcfg";
       12'h7e0: csr_name = "ml2stat";
       12'hb00: csr_name = "mcycle";
       12'hb02: csr_name = "minstret";
@@ -259,6 +347,15 @@ module top();
       12'hf14: csr_name = "mhartid";
       12'hfc0: csr_name = "muartstat";
       12'hfc1: csr_name = "muartrx";
+      12'hfd0: csr_name = "mbfsdeq";
+      12'hfd1: csr_name = "mbfsenq";
+      12'hfd2: csr_name = "mbfsmarked";
+      12'hfd3: csr_name = "mbfsspill";
+      12'hfd4: csr_name = "mbfsrestore";
+      12'hfd5: csr_name = "mbfsqstall";
+      12'hfd6: csr_name = "mbfsdcwait";
+      12'hfd7: csr_name = "mbfscycles";
+      12'hfd8: csr_name = "mbfsprefetch";
       default: csr_name = "<unknown>";
     endcase
   endfunction
@@ -283,6 +380,22 @@ module top();
         trace_branches = trace_branches + 1;
         if(mispred)
           trace_mispreds = trace_mispreds + 1;
+        // branch address and outcome, for perf/bpeval
+        if(brtracefd && !error)
+          $fdisplay(brtracefd, "%x %0d", {addr,2'b0}, result[0] ^ retop[0]);
+      end
+      if(retop[5:4] == 2'b01) begin
+        // jalr: a return reads the link register without writing one
+        if((trace_insn[robid][19:15] == 1 || trace_insn[robid][19:15] == 5) &&
+           !(trace_insn[robid][11:7] == 1 || trace_insn[robid][11:7] == 5)) begin
+          trace_returns = trace_returns + 1;
+          if(mispred)
+            trace_ret_mispreds = trace_ret_mispreds + 1;
+        end else begin
+          trace_ijumps = trace_ijumps + 1;
+          if(mispred)
+            trace_ij_mispreds = trace_ij_mispreds + 1;
+        end
       end
       trace_rob_inflight = trace_rob_inflight - 1;
 
@@ -329,6 +442,7 @@ module top();
 
       // htif tohost write termination
       if(~error & trace_uses_mem[robid] & trace_memop[robid][3] & (memaddr[31:2] == DBG_TOHOST)) begin
+        $display("Exit code: %0d", trace_memdata[robid] >> 1);
         printstats();
         $finish;
       end
@@ -353,6 +467,49 @@ module top();
       $display("Instructions retired: %0d", trace_instret);
       $display("Average CPI: %.3f", $itor(trace_cycles) / $itor(trace_instret));
       $display("Branch prediction accuracy: %.2f", 1.0 - ($itor(trace_mispreds) / $itor(trace_branches)));
+      if(trace_returns)
+        $display("Return prediction accuracy: %.2f", 1.0 - ($itor(trace_ret_mispreds) / $itor(trace_returns)));
+      if(trace_ijumps)
+        $display("Indirect jump prediction accuracy: %.2f", 1.0 - ($itor(trace_ij_mispreds) / $itor(trace_ijumps)));
+      $display("Interrupts taken: %0d", trace_irqs);
+      if(trace_ic_accesses) begin
+        $display("Icache accesses/misses: %0d/%0d", trace_ic_accesses, trace_ic_misses);
+        $display("Icache miss rate: %.4f", $itor(trace_ic_misses) / $itor(trace_ic_accesses));
+        $display("Icache miss wait cycles: %0d", trace_ic_wait);
+      end
+      for(j = 0; j < 16; j=j+1)
+        if(trace_l2bank_busy[j])
+          $display("L2 %0d bank %0d busy/conflict cycles: %0d/%0d", j / 4, j % 4,
+                   trace_l2bank_busy[j], trace_l2bank_stall[j]);
+      if(trace_bfs_runs) begin
+        $display("BFS searches: %0d", trace_bfs_runs);
+        $display("BFS active cycles: %0d", trace_bfs_cycles);
+        $display("BFS nodes dequeued: %0d", trace_bfs_deq);
+        $display("BFS edges enqueued: %0d", trace_bfs_enq);
+        $display("BFS already-marked hits: %0d", trace_bfs_marked);
+        $display("BFS lines spilled/restored: %0d/%0d", trace_bfs_spill, trace_bfs_restore);
+        $display("BFS queue stall cycles: %0d", trace_bfs_qstall);
+        $display("BFS cache wait cycles: %0d", trace_bfs_dcwait);
+        $display("BFS prefetches: %0d", trace_bfs_pf);
+      end
+      if(trace_l2pf_issued) begin
+        $display("L2 prefetches issued/filled: %0d/%0d", trace_l2pf_issued, trace_l2pf_fills);
+        $display("L2 prefetch accuracy: %.2f",
+          trace_l2pf_fills ? $itor(trace_l2pf_hits) / $itor(trace_l2pf_fills) : 0.0);
+        $display("L2 prefetch coverage: %.2f",
+          $itor(trace_l2pf_hits) / $itor(trace_l2pf_hits + trace_l2_rd_misses));
+        $display("L2 prefetch timeliness: %.2f",
+          trace_l2pf_hits ? 1.0 - ($itor(trace_l2pf_late) / $itor(trace_l2pf_hits)) : 0.0);
+      end
+
+      if(trace_ld_count) begin
+        $display("Load latency avg/max: %.2f/%0d",
+          $itor(trace_ld_total) / $itor(trace_ld_count), trace_ld_max);
+        $write("Load latency histogram: ");
+        for(k = 0; k < 33; k=k+1)
+          $write("%0d,", trace_ld_lat_hist[k]);
+        $display();
+      end
 
       $write("ROB occupancy histogram: ");
       for(k = 0; k < 129; k=k+1)
@@ -378,28 +535,34 @@ module top();
     input [31:0] wdata);
 
     reg [5*8-1:0] mnemonic;
-    if(logfd) begin
-      casez(op)
-        4'b000_0: mnemonic = "lb";
-        4'b001_0: mnemonic = "lh";
-        4'b010_0: mnemonic = "lw";
-        4'b100_0: mnemonic = "lbu";
-        4'b101_0: mnemonic = "lhu";
-        4'b000_1: mnemonic = "sb";
-        4'b001_1: mnemonic = "sh";
-        4'b010_1: mnemonic = "sw";
-        4'b?11_0: mnemonic = "lbcmp";
-        default: mnemonic = "???";
-      endcase
-      $fwrite(logfd, "%0d %0s %x", $stime, mnemonic, addr);
-      if(op[0])
-        $fwrite(logfd, " %x", wdata);
-      else begin
-        if(mnemonic == "lbcmp")
-          $fwrite(logfd, " %2x", wdata[7:0]);
-        $fwrite(logfd, " %0d", lsqid);
+    begin
+      if(~op[0]) begin
+        trace_ld_time[lsqid] = $stime;
+        trace_ld_pending[lsqid] = 1;
+      end
+      if(logfd) begin
+        casez(op)
+          4'b000_0: mnemonic = "lb";
+          4'b001_0: mnemonic = "lh";
+          4'b010_0: mnemonic = "lw";
+          4'b100_0: mnemonic = "lbu";
+          4'b101_0: mnemonic = "lhu";
+          4'b000_1: mnemonic = "sb";
+          4'b001_1: mnemonic = "sh";
+          4'b010_1: mnemonic = "sw";
+          4'b?11_0: mnemonic = "lbcmp";
+          default: mnemonic = "???";
+        endcase
+        $fwrite(logfd, "%0d %0s %x", $stime, mnemonic, addr);
+        if(op[0])
+          $fwrite(logfd, " %x", wdata);
+        else begin
+          if(mnemonic == "lbcmp")
+            $fwrite(logfd, " %2x", wdata[7:0]);
+          $fwrite(logfd, " %0d", lsqid);
+        end
+        $fdisplay(logfd);
       end
-      $fdisplay(logfd);
     end
   endtask
 
@@ -408,13 +571,25 @@ module top();
     input        error,
     input [31:0] rdata);
 
-    if(logfd) begin
-      $fwrite(logfd, "%0d resp %0d", $stime, lsqid);
-      if(error)
-        $fwrite(logfd, " error");
-      else
-        $fwrite(logfd, " %x", rdata);
-      $fdisplay(logfd);
+    integer lat;
+    begin
+      if(trace_ld_pending[lsqid]) begin
+        lat = $stime - trace_ld_time[lsqid];
+        trace_ld_pending[lsqid] = 0;
+        trace_ld_count = trace_ld_count + 1;
+        trace_ld_total = trace_ld_total + lat;
+        if(lat > trace_ld_max)
+          trace_ld_max = lat;
+        trace_ld_lat_hist[(lat < 32) ? lat : 32] = trace_ld_lat_hist[(lat < 32) ? lat : 32] + 1;
+      end
+      if(logfd) begin
+        $fwrite(logfd, "%0d resp %0d", $stime, lsqid);
+        if(error)
+          $fwrite(logfd, " error");
+        else
+          $fwrite(logfd, " %x", rdata);
+        $fdisplay(logfd);
+      end
     end
   endtask
 
@@ -426,6 +601,43 @@ module top();
     end
   endtask
 
+  task tb_log_rob_irq(
+    input [31:2] addr);
+
+    begin
+      trace_irqs = trace_irqs + 1;
+      if(logfd)
+        $fdisplay(logfd, "%0d irq %x", $stime, {addr,2'b0});
+    end
+  endtask
+
+  task tb_log_bfs_done(
+    input [31:0] deq,
+    input [31:0] enq,
+    input [31:0] marked,
+    input [31:0] spill,
+    input [31:0] restore,
+    input [31:0] qstall,
+    input [31:0] dcwait,
+    input [31:0] cycles,
+    input [31:0] prefetches);
+
+    begin
+      trace_bfs_runs = trace_bfs_runs + 1;
+      trace_bfs_deq = trace_bfs_deq + deq;
+      trace_bfs_enq = trace_bfs_enq + enq;
+      trace_bfs_marked = trace_bfs_marked + marked;
+      trace_bfs_spill = trace_bfs_spill + spill;
+      trace_bfs_restore = trace_bfs_restore + restore;
+      trace_bfs_qstall = trace_bfs_qstall + qstall;
+      trace_bfs_dcwait = trace_bfs_dcwait + dcwait;
+      trace_bfs_cycles = trace_bfs_cycles + cycles;
+      trace_bfs_pf = trace_bfs_pf + prefetches;
+      if(logfd)
+        $fdisplay(logfd, "%0d bfs done %0d %0d", $stime, deq, cycles);
+    end
+  endtask
+
   reg [63:0] bus_data [0:7];
 
   task tb_log_bus_data(
@@ -468,6 +680,46 @@ module top();
     end
   endtask
 
+  task tb_log_l2pf(
+    input issue,
+    input rd_miss,
+    input pf_fill,
+    input pf_hit,
+    input pf_late);
+
+    begin
+      trace_l2pf_issued = trace_l2pf_issued + issue;
+      trace_l2_rd_misses = trace_l2_rd_misses + rd_miss;
+      trace_l2pf_fills = trace_l2pf_fills + pf_fill;
+      trace_l2pf_hits = trace_l2pf_hits + pf_hit;
+      trace_l2pf_late = trace_l2pf_late + pf_late;
+    end
+  endtask
+
+  task tb_log_icache(
+    input [31:0] accesses,
+    input        miss,
+    input [31:0] wait_cycles);
+
+    begin
+      trace_ic_accesses = trace_ic_accesses + accesses;
+      trace_ic_misses = trace_ic_misses + miss;
+      trace_ic_wait = trace_ic_wait + wait_cycles;
+    end
+  endtask
+
+  task tb_log_l2bank(
+    input [1:0]  busid,
+    input [1:0]  bank,
+    input [31:0] busy,
+    input [31:0] stall);
+
+    begin
+      trace_l2bank_busy[busid*4+bank] = trace_l2bank_busy[busid*4+bank] + busy;
+      trace_l2bank_stall[busid*4+bank] = trace_l2bank_stall[busid*4+bank] + stall;
+    end
+  endtask
+
   task tb_log_lsq_inflight(
     input [15:0] lq_valid,
     input [15:0] sq_valid);
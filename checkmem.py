@@ -6,7 +6,7 @@ RAMBASE = 0x20000000//4
 RAMSIZE = 0x8000000//4
 
 # two categories of entry:
-# 1. read (lw/lh/lb/lhu/lbu/lbcmp)
+# 1. read (lw/lh/lb/lhu/lbu/lbcmp/lbcmp64)
 # 2. write (sw/sh/sb)
 class MemoryEntry:
     def __init__(self, line: int, time: int, category: str, addr: int, wdata: int = None):
@@ -54,6 +54,14 @@ def getCmpResult(entry: MemoryEntry, ram: list) -> int:
         base += 1
     return result
 
+def getCmp64Result(entry: MemoryEntry, ram: list) -> int:
+    byte = entry.wdata & 0xff
+    for addr in range(entry.addr, (entry.addr | 63) + 1):
+        value = (ram[addr//4-RAMBASE] >> ((addr & 3) * 8)) & 0xff
+        if value == byte or value == 0:
+            return (0x80 if value == 0 else 0) | (addr & 63)
+    return 0x40
+
 class MemoryTrace:
     def __init__(self, logfile: str):
         self.logfile = logfile
@@ -68,9 +76,9 @@ class MemoryTrace:
                 time = int(fields[0])
                 category = fields[1]
                 if category[0] == "l":
-                    # lw/lh/lb/lhu/lbu/lbcmp (read request)
+                    # lw/lh/lb/lhu/lbu/lbcmp/lbcmp64 (read request)
                     addr = int(fields[2], 16)
-                    if category == "lbcmp":
+                    if category.startswith("lbcmp"):
                         op2 = int(fields[3], 16)
                         lsqid = int(fields[4])
                     else:
@@ -127,6 +135,8 @@ class MemoryTrace:
                 memValue = memory[memAddr]
                 if entry.category == "lbcmp":
                     result = getCmpResult(entry, memory)
+                elif entry.category == "lbcmp64":
+                    result = getCmp64Result(entry, memory)
                 else:
                     result = getLoadResult(entry, memValue)
                 if entry.rdata != result:
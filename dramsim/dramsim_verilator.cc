@@ -1,5 +1,6 @@
 #include "dramsim_verilator.h"
 #include <cstdio>
+#include <cstring>
 
 DRAM::DRAM(VerilatedContext* context, int timeunit) {
   // get plusarg for dram cfgfile
@@ -88,3 +89,11 @@ void DRAM::respdata(resp_t* resp) {
   *resp = read_queue.front();
   read_queue.pop();
 }
+
+void DRAM::memwrite(uint64_t addr, const void* data, size_t size) {
+  memcpy(((uint8_t*) memory) + addr, data, size);
+}
+
+void DRAM::memread(uint64_t addr, void* data, size_t size) {
+  memcpy(data, ((uint8_t*) memory) + addr, size);
+}
@@ -34,6 +34,10 @@ public:
   bool respready();
   void respdata(resp_t* resp);
 
+  // backdoor access to memory contents (addr is an offset from RAM_BASE)
+  void memwrite(uint64_t addr, const void* data, size_t size);
+  void memread(uint64_t addr, void* data, size_t size);
+
 private:
   dramsim3::MemorySystem* dramsim;
   uint64_t *memory;
@@ -0,0 +1,210 @@
+// Trace-driven branch predictor evaluator. Replays the retired branch
+// outcomes written by the simulator (+brtracefile=<file>, one
+// "<addr> <taken>" line per conditional branch) through models of the
+// predictors in behavioral/brpred.v and behavioral/brpred_tage.v, plus
+// variants, and prints their accuracy. Histories are updated in retirement
+// order, which is what the hardware predictors see after flush repair.
+//
+// Build: g++ -O2 -o bpeval bpeval.cc
+// Usage: bpeval <brtrace> [predictor...]
+#include <bitset>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+static uint32_t bits(uint32_t v, int hi, int lo) {
+  return (v >> lo) & ((1u << (hi - lo + 1)) - 1);
+}
+
+class Predictor {
+public:
+  virtual ~Predictor() {}
+  virtual bool predict(uint32_t pc) = 0;
+  virtual void update(uint32_t pc, bool taken) = 0;
+};
+
+// brpred.v: bhr xor pc[16:3] into a table of 2-bit counters
+class Gshare : public Predictor {
+public:
+  Gshare(int hist_bits) : hist_bits(hist_bits), bhr(0), pht(1 << hist_bits, 0) {}
+
+  bool predict(uint32_t pc) {
+    return pht[index(pc)] >> 1;
+  }
+
+  void update(uint32_t pc, bool taken) {
+    uint8_t& c = pht[index(pc)];
+    if(taken && c < 3) c++;
+    if(!taken && c > 0) c--;
+    bhr = ((bhr << 1) | taken) & ((1 << hist_bits) - 1);
+  }
+
+private:
+  uint32_t index(uint32_t pc) {
+    return (bhr ^ (pc >> 3)) & ((1 << hist_bits) - 1);
+  }
+
+  int hist_bits;
+  uint32_t bhr;
+  std::vector<uint8_t> pht;
+};
+
+// brpred_tage.v generalized: a 4K bimodal base table and one tagged table
+// of 2^row_bits entries per history length
+class Tage : public Predictor {
+public:
+  static const int MAX_HIST = 256;
+
+  Tage(std::vector<int> hist_len, int row_bits, int tag_bits)
+    : hist_len(hist_len), row_bits(row_bits), tag_bits(tag_bits),
+      base(4096, 0), tabs(hist_len.size(), std::vector<Entry>(1 << row_bits)) {}
+
+  bool predict(uint32_t pc) {
+    lookup(pc);
+    return pred;
+  }
+
+  void update(uint32_t pc, bool taken) {
+    // predict() has just run for this branch, as in the hardware where the
+    // tag carries provider/altpred/pred to retirement
+    int ntab = hist_len.size();
+    if(prov) {
+      Entry& e = tabs[prov - 1][idx[prov - 1]];
+      sat(e.ctr, taken, 7);
+      if(pred != alt)
+        sat(e.u, pred == taken, 3);
+    } else
+      sat(base[bits(pc, 13, 2)], taken, 3);
+
+    if(pred != taken && prov != ntab) {
+      int t;
+      for(t = prov; t < ntab; t++) {
+        Entry& e = tabs[t][idx[t]];
+        if(!e.valid || e.u == 0)
+          break;
+      }
+      if(t < ntab)
+        tabs[t][idx[t]] = {true, tag[t], (uint8_t) (taken ? 4 : 3), 0};
+      else
+        for(t = prov; t < ntab; t++)
+          sat(tabs[t][idx[t]].u, false, 3);
+    }
+
+    hist <<= 1;
+    hist[0] = taken;
+  }
+
+private:
+  struct Entry {
+    bool valid;
+    uint32_t tag;
+    uint8_t ctr;
+    uint8_t u;
+  };
+
+  static void sat(uint8_t& c, bool up, uint8_t max) {
+    if(up && c < max) c++;
+    if(!up && c > 0) c--;
+  }
+
+  uint32_t fold(int len, int w) {
+    uint32_t r = 0;
+    for(int i = 0; i < len; i++)
+      r ^= (uint32_t) hist[i] << (i % w);
+    return r;
+  }
+
+  void lookup(uint32_t pc) {
+    int ntab = hist_len.size();
+    idx.resize(ntab);
+    tag.resize(ntab);
+    prov = 0;
+    pred = base[bits(pc, 13, 2)] >> 1;
+    alt = pred;
+    for(int t = 0; t < ntab; t++) {
+      idx[t] = (bits(pc, row_bits + 1, 2) ^ bits(pc, 2 * row_bits + 1, row_bits + 2) ^
+                fold(hist_len[t], row_bits)) & ((1 << row_bits) - 1);
+      tag[t] = (bits(pc, 10 + tag_bits - 1, 10) ^ fold(hist_len[t], tag_bits) ^
+                (fold(hist_len[t], tag_bits - 1) << 1)) & ((1 << tag_bits) - 1);
+      Entry& e = tabs[t][idx[t]];
+      if(e.valid && e.tag == tag[t]) {
+        prov = t + 1;
+        alt = pred;
+        pred = e.ctr >> 2;
+      }
+    }
+  }
+
+  std::vector<int> hist_len;
+  int row_bits, tag_bits;
+  std::vector<uint8_t> base;
+  std::vector<std::vector<Entry>> tabs;
+  std::bitset<MAX_HIST> hist;
+
+  // last lookup
+  std::vector<uint32_t> idx, tag;
+  int prov;
+  bool alt, pred;
+};
+
+static std::unique_ptr<Predictor> make_predictor(const std::string& name) {
+  if(name == "gshare")
+    return std::unique_ptr<Predictor>(new Gshare(14));
+  if(name == "gshare16")
+    return std::unique_ptr<Predictor>(new Gshare(16));
+  if(name == "tage")
+    return std::unique_ptr<Predictor>(new Tage({5, 12, 28, 64}, 9, 8));
+  if(name == "tage6")
+    return std::unique_ptr<Predictor>(new Tage({4, 8, 16, 32, 64, 128}, 10, 10));
+  return nullptr;
+}
+
+int main(int argc, char** argv) {
+  if(argc < 2) {
+    fprintf(stderr, "Usage: %s <brtrace> [gshare|gshare16|tage|tage6]...\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<std::string> names;
+  for(int i = 2; i < argc; i++)
+    names.push_back(argv[i]);
+  if(names.empty())
+    names = {"gshare", "gshare16", "tage", "tage6"};
+
+  std::vector<std::unique_ptr<Predictor>> preds;
+  for(const std::string& name : names) {
+    preds.push_back(make_predictor(name));
+    if(!preds.back()) {
+      fprintf(stderr, "Unknown predictor %s\n", name.c_str());
+      return 1;
+    }
+  }
+
+  FILE* trace = fopen(argv[1], "r");
+  if(!trace) {
+    fprintf(stderr, "Cannot open file %s\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<uint64_t> mispreds(preds.size(), 0);
+  uint64_t branches = 0;
+  uint32_t pc, taken;
+  while(fscanf(trace, "%x %u\n", &pc, &taken) == 2) {
+    branches++;
+    for(size_t i = 0; i < preds.size(); i++) {
+      if(preds[i]->predict(pc) != (bool) taken)
+        mispreds[i]++;
+      preds[i]->update(pc, taken);
+    }
+  }
+  fclose(trace);
+
+  printf("%-10s %10s %10s %9s\n", "predictor", "branches", "mispreds", "accuracy");
+  for(size_t i = 0; i < preds.size(); i++)
+    printf("%-10s %10lu %10lu %9.4f\n", names[i].c_str(), branches, mispreds[i],
+           branches ? 1.0 - ((double) mispreds[i]) / branches : 0.0);
+  return 0;
+}
@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+# Reads the JSON records printed by tests/hashbench.c from one or more
+# simulation logs (one log per design variant), prints them as a table and
+# plots mean lookup cycles against table size.
+import json
+import sys
+from pathlib import Path
+import matplotlib.pyplot as plt
+
+FIELDS = ["mean", "min", "max", "p99", "instret", "dc_miss"]
+
+def get_records (filename):
+  records = []
+  for line in Path(filename).read_text().splitlines():
+    if not line.startswith('{'):
+      continue
+    records.append(json.loads(line))
+  return records
+
+def print_table (name, records):
+  print(name)
+  print("{:>8} {:>4} {:>8} ".format("size", "lf", "variant") +
+        " ".join("{:>9}".format(f) for f in FIELDS))
+  for r in records:
+    print("{:>8} {:>4} {:>8} ".format(r["size"], r["lf"], r["variant"]) +
+          " ".join("{:>9}".format(r[f]) for f in FIELDS))
+  print()
+
+def graph_stats (logs, lf):
+  plt.figure(figsize=(8.8, 6.6))
+  for name, records in logs.items():
+    variants = sorted({r["variant"] for r in records})
+    for variant in variants:
+      points = [(r["size"], r["mean"]) for r in records
+                if r["variant"] == variant and r["lf"] == lf]
+      if points:
+        plt.plot(*zip(*points), label="{} {}".format(name, variant))
+
+  plt.xlabel("Table Size")
+  plt.ylabel("Average Execution Time")
+  plt.xscale("log", base=2)
+  plt.yscale("log", base=2)
+  plt.title("Hashset Lookups (LF: {})".format(lf))
+  plt.legend()
+  plt.savefig("hashbench_lf{}.png".format(lf), dpi=100)
+  plt.close()
+
+if __name__ == '__main__':
+  if len(sys.argv) < 2:
+    print("Usage: hashbench.py <log>...")
+    exit(1)
+
+  logs = {Path(f).stem: get_records(f) for f in sys.argv[1:]}
+  for name, records in logs.items():
+    print_table(name, records)
+  lfs = sorted({r["lf"] for records in logs.values() for r in records})
+  for lf in lfs:
+    graph_stats(logs, lf)
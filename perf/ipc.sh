@@ -0,0 +1,99 @@
+#!/bin/sh
+# Runs the test suite on the behavioral model built at each front end width
+# (CPU_WIDTH in behavioral/Makefile, default: 1 and 2) and prints cycles,
+# instructions retired and IPC for each test and width, then a table of IPC
+# per test with the speedup of the last column over the first and their
+# geometric means. With -b, the tree at git revision rev (e.g. the commit
+# before the 2-wide front end) is built and run first as the "base" column.
+#
+# Usage: ipc.sh [-b rev] [width...]
+
+DIR=$(cd "$(dirname $0)/.." && pwd)
+DRAMCFG=$DIR/dramsim/DDR4_4Gb_x16_2666_2.ini
+TIMEOUT=100000
+
+BASE=
+if [ "$1" = -b ]; then
+    BASE=$2
+    shift 2
+fi
+WIDTHS=${*:-1 2}
+
+OUT=$(mktemp)
+trap 'rm -f $OUT; [ -n "$BASEDIR" ] && git -C $DIR worktree remove --force $BASEDIR' EXIT
+
+# run_tree dir label [make options]: appends "test label cycles instret"
+run_tree() {
+    TREE=$1
+    LABEL=$2
+    shift 2
+    TESTS="$(basename -s .s $TREE/tests/*.s) $(basename -s .c $TREE/tests/*.c) $(basename -s .cpp $TREE/tests/*.cpp)"
+
+    make -C $TREE/tests > /dev/null || exit $?
+    make -C $TREE/behavioral clean > /dev/null
+    make -C $TREE/behavioral "$@" > /dev/null || exit $?
+
+    for TEST in $TESTS; do
+        if [ $TEST = startup -o $TEST = stdlib ]; then continue; fi
+
+        timeout $TIMEOUT $TREE/behavioral/build/top +dramcfg=$DRAMCFG \
+            +memfile=$TREE/tests/$TEST.hex +uartfile=/dev/null 2>&1 |
+        awk -v test=$TEST -v label=$LABEL '
+            /^Cycles elapsed:/ { cycles = $3 }
+            /^Instructions retired:/ { instret = $3 }
+            END {
+                if (cycles && instret)
+                    printf "%-16s %5s %10d %10d %6.3f\n", test, label, cycles, instret, instret / cycles
+                else
+                    printf "%-16s %5s %10s %10s %6s\n", test, label, "-", "-", "-"
+            }' | tee -a $OUT
+    done
+}
+
+printf "%-16s %5s %10s %10s %6s\n" test width cycles instret ipc
+
+if [ -n "$BASE" ]; then
+    BASEDIR=$(mktemp -d -u)
+    git -C $DIR worktree add --detach $BASEDIR $BASE > /dev/null || exit $?
+    run_tree $BASEDIR base
+fi
+
+for WIDTH in $WIDTHS; do
+    run_tree $DIR $WIDTH CPU_WIDTH=$WIDTH
+done
+
+# ipc per test and column; tests that failed in any column are left out of
+# the means
+echo
+awk '
+    !($2 in seen) { seen[$2] = 1; cols[ncol++] = $2 }
+    !($1 in tseen) { tseen[$1] = 1; tests[ntest++] = $1 }
+    { ipc[$1, $2] = $5 }
+    END {
+        printf "%-16s", "ipc"
+        for (c = 0; c < ncol; c++) printf " %7s", cols[c]
+        printf " %7s\n", "speedup"
+        n = 0
+        for (t = 0; t < ntest; t++) {
+            ok = 1
+            printf "%-16s", tests[t]
+            for (c = 0; c < ncol; c++) {
+                v = ipc[tests[t], cols[c]]
+                printf " %7s", v
+                if (v == "-") ok = 0
+            }
+            first = ipc[tests[t], cols[0]]
+            last = ipc[tests[t], cols[ncol-1]]
+            if (ok) {
+                printf " %7.3f\n", last / first
+                for (c = 0; c < ncol; c++) logsum[c] += log(ipc[tests[t], cols[c]])
+                n++
+            } else
+                printf " %7s\n", "-"
+        }
+        if (n) {
+            printf "%-16s", "geomean"
+            for (c = 0; c < ncol; c++) printf " %7.3f", exp(logsum[c] / n)
+            printf " %7.3f\n", exp((logsum[ncol-1] - logsum[0]) / n)
+        }
+    }' $OUT
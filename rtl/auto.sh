@@ -5,7 +5,7 @@ exec emacs -Q --batch --eval="(progn $(tail -n+6 $0))" "$@"
 
 (setq vc-follow-symlinks nil)
 (require 'verilog-mode)
-(dolist (path '("../src" "../src/bfs"))
+(dolist (path '("../src" "../src/bfs" "../src/hash"))
   (push path verilog-library-directories))
 
 (dolist (file command-line-args-left)
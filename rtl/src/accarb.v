@@ -0,0 +1 @@
+../../behavioral/accarb.v
\ No newline at end of file
@@ -1,6 +1,9 @@
 `include "rtldefs.vh"
 // csr (control and status register) unit
-module csr(
+module csr #(
+  // mhartid; the harness traces hart 0 only
+  parameter HARTID = 0
+  )(
   input         clk,
   input         rst,
 
@@ -40,14 +43,27 @@ module csr(
   input         bfs_csr_error,
   input [31:0]  bfs_csr_rdata,
 
+  // hash interface
+  output        csr_hash_valid,
+  output [4:0]  csr_hash_addr,
+  output        csr_hash_wen,
+  output [31:0] csr_hash_wdata,
+  input         hash_csr_valid,
+  input         hash_csr_error,
+  input [31:0]  hash_csr_rdata,
+
   // l2fifo interface
-  input         l2fifo_l2_req);
+  input         l2fifo_l2_req,
+
+  // performance monitor events
+  input [7:0]   cpu_hpm_events);
 
   localparam
     MCYCLE    = 12'hB00,
     MINSTRET  = 12'hB02,
     MCYCLEH   = 12'hB80,
     MINSTRETH = 12'hB82,
+    MHARTID   = 12'hF14,
     MUARTSTAT = 12'hFC0,
     MUARTRX   = 12'hFC1,
     MUARTTX   = 12'h7C0,
@@ -70,7 +86,11 @@ module csr(
   wire [31:0] mcycleh;
   wire [31:0] minstret;
   wire [31:0] minstreth;
+  wire [127:0] mhpmcounter; // mhpmcounter3-6
+  wire [127:0] mhpmcounterh;
+  wire [11:0]  mhpmevent;
   wire [7:0] muarttx;
+  wire [31:0] mhartid = HARTID;
 
   // Updated CSR value
   wire [31:0] mcycle_n; 
@@ -112,20 +132,36 @@ module csr(
   wire sel_mcycleh    = ~|(addr ^ MCYCLEH);
   wire sel_minstret   = ~|(addr ^ MINSTRET);
   wire sel_minstreth  = ~|(addr ^ MINSTRETH);
+  // mhpmcounter/mhpmcounterh/mhpmevent 3-6
+  wire [3:0] hpm_sel = {~|(addr[2:0] ^ 3'd6), ~|(addr[2:0] ^ 3'd5),
+                        ~|(addr[2:0] ^ 3'd4), ~|(addr[2:0] ^ 3'd3)};
+  wire sel_mhpmcounter  = ~|(addr[11:3] ^ 9'h160) & |hpm_sel;
+  wire sel_mhpmcounterh = ~|(addr[11:3] ^ 9'h170) & |hpm_sel;
+  wire sel_mhpmevent    = ~|(addr[11:3] ^ 9'h064) & |hpm_sel;
+  wire sel_mhartid    = ~|(addr ^ MHARTID);
   wire sel_muartstat  = ~|(addr ^ MUARTSTAT);
   wire sel_muartrx    = ~|(addr ^ MUARTRX);
   wire sel_muarttx    = ~|(addr ^ MUARTTX);
   wire sel_bfs       = ~|(addr[11:4] ^ 8'h7D);
+  wire sel_hash      = &addr[10:4];
   wire sel_ml2stat    = ~|(addr ^ ML2STAT);
   wire sel_none = ~(sel_mcycle | sel_mcycleh | sel_minstret | sel_minstreth |
-      sel_muartstat | sel_muartrx | sel_muarttx | sel_bfs | sel_ml2stat);
+      sel_mhpmcounter | sel_mhpmcounterh | sel_mhpmevent | sel_mhartid | sel_muartstat | sel_muartrx | sel_muarttx | sel_bfs | sel_hash | sel_ml2stat);
 
   // read-data mux
-  premux #(32, 8) csr_result_mux (
-      .sel ({sel_mcycle, sel_mcycleh, sel_minstret, sel_minstreth, sel_muartstat, 
-             sel_muarttx, sel_bfs, sel_ml2stat}),
-      .in  ({mcycle, mcycleh, minstret, minstreth, (MUARTSTAT_TXEMPTY | MUARTSTAT_RXEMPTY), 
-            {24'b0, muarttx}, bfs_csr_rdata, {31'b0,l2fifo_l2_req}}),
+  wire [31:0] hpm_counter, hpm_counterh;
+  wire [2:0] hpm_event;
+  premux #(32, 4) hpm_counter_mux (.sel(hpm_sel), .in(mhpmcounter), .out(hpm_counter));
+  premux #(32, 4) hpm_counterh_mux (.sel(hpm_sel), .in(mhpmcounterh), .out(hpm_counterh));
+  premux #(3, 4) hpm_event_mux (.sel(hpm_sel), .in(mhpmevent), .out(hpm_event));
+
+  premux #(32, 13) csr_result_mux (
+      .sel ({sel_mcycle, sel_mcycleh, sel_minstret, sel_minstreth, sel_mhpmcounter,
+             sel_mhpmcounterh, sel_mhpmevent, sel_mhartid, sel_muartstat, sel_muarttx,
+             sel_bfs, sel_hash, sel_ml2stat}),
+      .in  ({mcycle, mcycleh, minstret, minstreth, hpm_counter, hpm_counterh,
+            {29'b0, hpm_event}, mhartid, (MUARTSTAT_TXEMPTY | MUARTSTAT_RXEMPTY), {24'b0, muarttx},
+            bfs_csr_rdata, hash_csr_rdata, {31'b0,l2fifo_l2_req}}),
       .out (csr_result)
   );
 
@@ -146,6 +182,11 @@ module csr(
   flop #(1) bfs_req_r_flop (.clk(clk), .set(1'b0), .rst(rst), .enable(1'b1),
       .d(csr_bfs_valid), .q(bfs_req_r));
 
+  // set hash req
+  wire hash_req_r;
+  flop #(1) hash_req_r_flop (.clk(clk), .set(1'b0), .rst(rst), .enable(1'b1),
+      .d(csr_hash_valid), .q(hash_req_r));
+
   // l2 fifo
   wire l2fifo_stall = wen & sel_ml2stat & l2fifo_l2_req;
   wire l2fifo_stall_r;
@@ -158,9 +199,16 @@ module csr(
   assign csr_bfs_wen = wen;
   assign csr_bfs_wdata = op1;
 
-  assign csr_stall = csr_bfs_valid | l2fifo_stall | l2fifo_stall_r;
+  // 0x7f? hash probe registers, 0xff? read-only hash probe counters
+  assign csr_hash_valid = valid & ~op[1] & sel_hash & ~hash_req_r;
+  assign csr_hash_addr = {addr[11],addr[3:0]};
+  assign csr_hash_wen = wen;
+  assign csr_hash_wdata = op1;
+
+  assign csr_stall = csr_bfs_valid | csr_hash_valid | l2fifo_stall | l2fifo_stall_r;
   assign csr_error = sel_none | wr_error |
-                     (bfs_req_r & (~bfs_csr_valid | bfs_csr_error));
+                     (bfs_req_r & (~bfs_csr_valid | bfs_csr_error)) |
+                     (hash_req_r & (~hash_csr_valid | hash_csr_error));
   assign csr_ecause = 0; // TODO
   assign csr_tvec = 0;
 
@@ -205,6 +253,39 @@ module csr(
        .in ({wdata, minstret64_n[63:32]}),
        .out (minstreth_n));
 
+  // mhpmcounter3-6 count the event selected by their mhpmevent
+  genvar h;
+  generate
+    for(h = 0; h < 4; h=h+1) begin : hpm_gen
+      wire hpm_inc;
+      mux #(1, 8) hpm_inc_mux (
+          .sel(mhpmevent[h*3+:3]),
+          .in(cpu_hpm_events),
+          .out(hpm_inc));
+
+      wire [63:0] hpm64_n;
+      `ADD (64, hpm64_n, {mhpmcounterh[h*32+:32], mhpmcounter[h*32+:32]}, {63'b0, hpm_inc});
+
+      wire [31:0] hpm_n, hpmh_n;
+      mux #(32, 2) hpm_n_mux (
+          .sel(sel_mhpmcounter & hpm_sel[h] & wen),
+          .in({wdata, hpm64_n[31:0]}),
+          .out(hpm_n));
+      mux #(32, 2) hpmh_n_mux (
+          .sel(sel_mhpmcounterh & hpm_sel[h] & wen),
+          .in({wdata, hpm64_n[63:32]}),
+          .out(hpmh_n));
+
+      flop #(32) hpm_flop (.clk(clk), .set(1'b0), .rst(rst), .enable(1'b1),
+          .d(hpm_n), .q(mhpmcounter[h*32+:32]));
+      flop #(32) hpmh_flop (.clk(clk), .set(1'b0), .rst(rst), .enable(1'b1),
+          .d(hpmh_n), .q(mhpmcounterh[h*32+:32]));
+      flop #(3) hpm_event_flop (.clk(clk), .set(1'b0), .rst(rst),
+          .enable(sel_mhpmevent & hpm_sel[h] & wen),
+          .d(wdata[2:0]), .q(mhpmevent[h*3+:3]));
+    end
+  endgenerate
+
   // UART
   flop #(8) muarttx_flop (.clk(clk), .set(1'b0), .rst(rst), .enable(wen & sel_muarttx),
       .d(wdata[7:0]), .q(muarttx));
@@ -212,7 +293,7 @@ module csr(
 `ifndef SYNTHESIS
   /* TRACE */
   always @(posedge clk)
-    if(valid & ~csr_error & wen)
+    if((HARTID == 0) & valid & ~csr_error & wen)
       top.tb_trace_csr_write(
         robid,
         addr,
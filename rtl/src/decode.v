@@ -1,5 +1,8 @@
 // RISC-V instruction decoder
-module decode(
+module decode #(
+  // the harness traces hart 0 only
+  parameter HARTID = 0
+  )(
   input         clk,
   input         rst,
 
@@ -207,7 +210,7 @@ module decode(
 
 `ifndef SYNTHESIS
   always @(posedge clk)
-    if(valid & ~decode_stall)
+    if((HARTID == 0) & valid & ~decode_stall)
       top.tb_trace_decode(
         decode_robid,
         insn,
@@ -10,7 +10,7 @@ module fetch(
   input         icache_ready,
   input         icache_valid,
   input         icache_error,
-  input [31:0]  icache_data,
+  input [63:0]  icache_data,
 
   // brpred interface
   output        fetch_bp_req,
@@ -80,10 +80,13 @@ module fetch(
   wire icache_beat = fetch_ic_req & icache_ready;
   wire decode_beat = fetch_de_valid & ~decode_stall;
 
+  // the icache returns the aligned 64-bit block; this is the word at buf_mid
+  wire [31:0] ic_insn;
+
   wire insn_br, insn_jal, insn_jalr;
-  assign insn_br   = icache_valid & ~icache_error & (icache_data[6:0] == 7'b1100011);
-  assign insn_jal  = icache_valid & ~icache_error & (icache_data[6:0] == 7'b1101111);
-  assign insn_jalr = icache_valid & ~icache_error & (icache_data[6:0] == 7'b1100111);
+  assign insn_br   = icache_valid & ~icache_error & (ic_insn[6:0] == 7'b1100011);
+  assign insn_jal  = icache_valid & ~icache_error & (ic_insn[6:0] == 7'b1101111);
+  assign insn_jalr = icache_valid & ~icache_error & (ic_insn[6:0] == 7'b1100111);
 
   wire br_taken = bp_req_r & brpred_bptaken;
 
@@ -111,6 +114,8 @@ module fetch(
   premux #(31, 16) buf_addr_mid_mux (.sel(buf_mid_oh), .in(buf_addr), .out(buf_addr_mid));
   premux #(31, 16) buf_addr_head_mux (.sel(buf_head_oh), .in(buf_addr), .out(buf_addr_head));
   premux #(31, 16) buf_addr_mid_prev_mux (.sel(buf_mid_prev_oh), .in(buf_addr), .out(buf_addr_mid_prev));
+
+  assign ic_insn = buf_addr_mid[2] ? icache_data[63:32] : icache_data[31:0];
   
   // buf insn
   wire [31:0] buf_insn_head, buf_insn_mid_prev;
@@ -223,7 +228,7 @@ module fetch(
   // buf insn
   wire [15:0] buf_insn_en = {16{icache_valid}} & buf_mid_oh;
   flop #(32) buf_insn_flop [15:0] (.clk(clk), .rst(1'b0), .set(1'b0),
-    .enable(buf_insn_en), .d(icache_data), .q(buf_insn));
+    .enable(buf_insn_en), .d(ic_insn), .q(buf_insn));
 
   // buf bptaken
   wire [15:0] buf_bp_en = {16{bp_req_r}} & buf_mid_prev_oh;
@@ -0,0 +1 @@
+../../../behavioral/hash/hash_core.v
\ No newline at end of file
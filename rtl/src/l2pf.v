@@ -0,0 +1 @@
+../../behavioral/l2pf.v
\ No newline at end of file
@@ -1,5 +1,8 @@
 // load-store queue
-module lsq(
+module lsq #(
+  // the harness traces hart 0 only
+  parameter HARTID = 0
+  )(
   input         clk,
   input         rst,
 
@@ -13,6 +16,7 @@ module lsq(
   input         rename_op2ready,
   input [31:0]  rename_op2,
   input [31:0]  rename_imm,
+  input [31:2]  rename_pc,
   output        lsq_stall,
 
   // dcache interface
@@ -21,6 +25,7 @@ module lsq(
   output [31:0] lsq_dc_addr,
   output [3:0]  lsq_dc_lsqid,
   output [31:0] lsq_dc_wdata,
+  output [31:2] lsq_dc_pc,
   output        lsq_dc_flush,
   input         dcache_lsq_ready,
   input         dcache_lsq_valid,
@@ -46,7 +51,10 @@ module lsq(
 
   // rob interface
   input         rob_flush,
-  input         rob_ret_store);
+  input         rob_ret_store,
+
+  // retired stores not yet issued to the dcache
+  output        lsq_st_pending);
 
   // load queue
   wire [15:0]        lq_valid;
@@ -63,6 +71,7 @@ module lsq(
   wire [(32*16)-1:0] lq_imm;
   wire [(32*16)-1:0] lq_addr;
   wire [(32*16)-1:0] lq_data;
+  wire [(30*16)-1:0] lq_pc;
   wire [15:0]        lq_op2_rdy;
   wire [(8*16)-1:0]  lq_op2;
 
@@ -114,6 +123,7 @@ module lsq(
   wire rst_flush = rst | rob_flush;
 
   wire sq_full = (|(sq_head & sq_tail)) & (sq_head_pol ^ sq_tail_pol);
+  assign lsq_st_pending = ~(|(sq_head & sq_mid)) | (sq_head_pol ^ sq_mid_pol);
 
   wire wb_en = wb_valid & ~wb_error;
   wire wb_beat = lsq_wb_valid & ~wb_lsq_stall;
@@ -134,6 +144,9 @@ module lsq(
   premux #(32,16) lq_addr_out_mux(lq_issue_sel, lq_addr, lq_addr_out);
   premux #(32,16) sq_addr_out_mux(sq_head, sq_addr, sq_addr_out);
 
+  // trains the l2 prefetcher
+  premux #(30,16) lq_pc_out_mux(lq_issue_sel, lq_pc, lsq_dc_pc);
+
   wire [7:0] lq_op2_out;
   wire [31:0] sq_data_out;
   premux #(8,16) lq_data_out_mux(lq_issue_sel, lq_op2, lq_op2_out);
@@ -230,7 +243,7 @@ module lsq(
     .d(1'b0),
     .q(lq_valid));
 
-  // lq_type, lq_robid, lq_rd, lq_imm
+  // lq_type, lq_robid, lq_rd, lq_imm, lq_pc
   flop #(3) lq_type_r[15:0](
     .clk(clk),
     .rst(1'b0),
@@ -263,6 +276,14 @@ module lsq(
     .d(rename_imm),
     .q(lq_imm));
 
+  flop #(30) lq_pc_r[15:0](
+    .clk(clk),
+    .rst(1'b0),
+    .set(1'b0),
+    .enable(lq_insert_en),
+    .d(rename_pc),
+    .q(lq_pc));
+
   // lq_base
   wire [(32*16)-1:0] lq_base_next;
 
@@ -421,21 +442,26 @@ module lsq(
   premux #(32,16) lq_sq_addr_mux(lq_issue_sel, lq_addr, lq_sq_addr);
   premux #(3,16) lq_sq_type_mux(lq_issue_sel, lq_type, lq_sq_type);
 
-  wire [15:0] lq_sq_addr_hit_hi, lq_sq_addr_hit_lo;
+  wire [15:0] lq_sq_addr_hit_hi, lq_sq_addr_hit_mid, lq_sq_addr_hit_lo;
   generate
     for(i = 0; i < 16; i=i+1) begin
-      assign lq_sq_addr_hit_hi[i] = ~|(sq_addr[(i*32)+31:(i*32)+5] ^ lq_sq_addr[31:5]);
+      assign lq_sq_addr_hit_hi[i] = ~|(sq_addr[(i*32)+31:(i*32)+6] ^ lq_sq_addr[31:6]);
+      assign lq_sq_addr_hit_mid[i] = ~(sq_addr[(i*32)+5] ^ lq_sq_addr[5]);
       assign lq_sq_addr_hit_lo[i] = ~|(sq_addr[(i*32)+4:(i*32)+2] ^ lq_sq_addr[4:2]);
     end
   endgenerate
 
   // lq_sq_wide: enables 32-byte blocks for addr comparison (lbcmp)
+  // lq_sq_line: enables 64-byte blocks for addr comparison (lbcmp64)
   wire [15:0] lq_sq_en = lq_sq_sel & sq_valid;
   wire lq_sq_wide = &lq_sq_type[1:0];
+  wire lq_sq_line = &lq_sq_type;
 
   wire [15:0] lq_sq_hits = lq_sq_en & (~sq_addr_rdy |
                                        (lq_sq_addr_hit_hi &
-                                        ({16{lq_sq_wide}} | lq_sq_addr_hit_lo)));
+                                        ({16{lq_sq_line}} |
+                                         (lq_sq_addr_hit_mid &
+                                          ({16{lq_sq_wide}} | lq_sq_addr_hit_lo)))));
   assign lq_sq_hit = |lq_sq_hits;
 
   // -----------------------------------------------------------------store queue
@@ -669,7 +695,7 @@ module lsq(
 `ifndef SYNTHESIS
   /*verilator lint_off WIDTH*/
   always @(posedge clk)
-    if(rename_lsq_write & ~lsq_stall)
+    if((HARTID == 0) & rename_lsq_write & ~lsq_stall)
       top.tb_trace_lsq_dispatch(
         rename_robid,
         rename_op[3] ? ($clog2(sq_tail) | (1 << 4)) : $clog2(lq_insert_sel),
@@ -679,7 +705,7 @@ module lsq(
 
   integer j;
   always @(posedge clk)
-    if(lq_base_fwd_en != 0)
+    if((HARTID == 0) & (lq_base_fwd_en != 0))
       for(j = 0; j < 16; j=j+1)
         if(lq_base_fwd_en[j])
           top.tb_trace_lsq_base(
@@ -688,7 +714,7 @@ module lsq(
 
   integer k;
   always @(posedge clk)
-    if(sq_base_fwd_en != 0)
+    if((HARTID == 0) & (sq_base_fwd_en != 0))
       for(k = 0; k < 16; k=k+1)
         if(sq_base_fwd_en[k])
           top.tb_trace_lsq_base(
@@ -697,7 +723,7 @@ module lsq(
 
   integer l;
   always @(posedge clk)
-    if(sq_data_fwd_en != 0)
+    if((HARTID == 0) & (sq_data_fwd_en != 0))
       for(l = 0; l < 16; l=l+1)
         if(sq_data_fwd_en[l])
           top.tb_trace_lsq_wdata(
@@ -705,7 +731,7 @@ module lsq(
             wb_result);
 
   always @(posedge clk)
-    if(~rst)
+    if((HARTID == 0) & ~rst)
       top.tb_log_lsq_inflight(
         lq_valid,
         sq_valid);
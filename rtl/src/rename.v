@@ -46,6 +46,7 @@ module rename(
   output           rename_op2ready,
   output [31:0]    rename_op2,
   output [31:0]    rename_imm,
+  output [31:2]    rename_pc,
   input            exers_stall,
   input            lsq_stall,
   input            csr_stall,
@@ -124,6 +125,7 @@ module rename(
       {1'b0, op2_ready_intermediate, 1'b1, 1'b1}, rename_op2ready);
 
   assign rename_imm = imm;
+  assign rename_pc = addr[31:2];
 
   // stall combinational
   assign rename_stall = (rename_exers_write & exers_stall) |
@@ -1,5 +1,8 @@
 // reorder buffer and retirement unit
-module rob (
+module rob #(
+    // the harness traces hart 0 only
+    parameter HARTID = 0
+    )(
     input         clk,
     input         rst,
 
@@ -31,6 +34,7 @@ module rob (
 
     // common signals
     output        rob_flush,
+    output        rob_mispred,
 
     // fetch interface
     output [31:2] rob_flush_pc,
@@ -115,6 +119,7 @@ module rob (
 
   // common signals
   assign rob_flush = ret_exc | ret_mispred;
+  assign rob_mispred = ret_mispred;
 
   // fetch interface
   mux #(30, 4) rob_flush_pc_mux({ret_error, ret_forwarded},
@@ -224,12 +229,13 @@ module rob (
   flop ret_forwarded_flop       (clk, 0, 0, 1, read_forwarded, ret_forwarded);
 
 `ifndef SYNTHESIS
-  always @(posedge clk) begin
-    if (ret_valid)
-      top.tb_trace_rob_retire(buf_head, ret_retop, ret_addr, ret_error, ret_mispred, ret_ecause,
-                              ret_rd, rob_ret_result);
-    if (rob_flush) top.tb_log_rob_flush();
-  end
+  always @(posedge clk)
+    if (HARTID == 0) begin
+      if (ret_valid)
+        top.tb_trace_rob_retire(buf_head, ret_retop, ret_addr, ret_error, ret_mispred, ret_ecause,
+                                ret_rd, rob_ret_result);
+      if (rob_flush) top.tb_log_rob_flush();
+    end
 `endif
 
 endmodule
@@ -10,5 +10,5 @@ DIR=$(dirname $0)
 exec spike --isa=RV32IM \
     -m0x10000000:0x1000000,0x20000000:0x8000000,0x30000000:0x1000 \
     --extension=hashset \
-    --csrmask=mbfsstat,mbfsroot,mbfstarg,mbfsqbase,mbfsqsize,mbfsresult,mcycle,minstret,mcycleh,minstreth,ml2stat \
+    --csrmask=mip,mbfsstat,mbfsroot,mbfstarg,mbfsqbase,mbfsqsize,mbfsresult,mbfsnbase,mbfspbase,mbfsobase,mbfsebase,mbfsvbase,mbfspfcfg,mbfsdeq,mbfsenq,mbfsmarked,mbfsspill,mbfsrestore,mbfsqstall,mbfsdcwait,mbfscycles,mbfsprefetch,mhashstat,mhashtbase,mhashmbase,mhashcap,mhashval,mhashkey,mhashresult,mhashbbase,mhashrbase,mhashcount,mhashkeys,mhashlines,mhashcmp,mhashcycles,mcycle,minstret,mcycleh,minstreth,mhpmcounter3,mhpmcounter4,mhpmcounter5,mhpmcounter6,mhpmcounter3h,mhpmcounter4h,mhpmcounter5h,mhpmcounter6h,mhpmevent3,mhpmevent4,mhpmevent5,mhpmevent6,ml2stat \
     "$@"
@@ -14,42 +14,79 @@ HEXFILE=$DIR/tests/$TEST.hex
 ELFFILE=$DIR/tests/$TEST.elf
 LOGFILE=$DIR/tests/$TEST.log
 UARTFILE=$DIR/tests/$TEST.out
+SIMFILE=$DIR/tests/$TEST.sim
+
+# tests spike cannot follow run on the model alone, and pass when they exit
+# with status 0. Some also need model build options.
+COSIM=1
+CHECKMEM=1
+MAKEOPTS=
+case $TEST in
+    # spike does not model the bfs completion interrupt
+    bfs_irq) COSIM=0 ;;
+    # the hashset extension in spike has no lbcmp64 (checkmem models it)
+    lbcmp64|hashset|hashbench) COSIM=0 ;;
+    # two harts; only hart 0 is traced and logged, so checkmem cannot follow
+    # the memory either
+    smp) COSIM=0; CHECKMEM=0; MAKEOPTS="CPU_CORES=2" ;;
+    # the cpu reads back parents the accelerator wrote, which neither spike
+    # nor checkmem sees
+    graph_pt|graph500) COSIM=0; CHECKMEM=0 ;;
+    # the cpu checks the batch results the hash probe engine wrote
+    hashprobe) COSIM=0; CHECKMEM=0 ;;
+esac
 
 make -C $DIR/tests || exit $?
-make -C $DIR/$MODEL || exit $?
+make -C $DIR/$MODEL $MAKEOPTS || exit $?
 
 rm -f simtrace
 
 TIMEOUT=100000
 
-mkfifo simtrace
-timeout $TIMEOUT $DIR/$MODEL/build/top +dramcfg=$DRAMCFG +memfile=$HEXFILE +tracefile=simtrace +uartfile=$UARTFILE +logfile=$LOGFILE &
-SIMPID=$!
+ERROR=0
 
-timeout $TIMEOUT $DIR/runspike.sh --log-commits --cosim=simtrace $ELFFILE 2>/dev/null &
-SPIKEPID=$!
+if [ $COSIM -eq 0 ]; then
+    timeout $TIMEOUT $DIR/$MODEL/build/top +dramcfg=$DRAMCFG +memfile=$HEXFILE +uartfile=$UARTFILE +logfile=$LOGFILE > $SIMFILE
+    SIMSTATUS=$?
+    cat $SIMFILE
+    if [ $SIMSTATUS -eq 124 ]; then
+        echo "ERROR: rtl timed out"
+        ERROR=1
+    elif ! grep -q "^Exit code: 0$" $SIMFILE; then
+        echo "ERROR: test exited with non-zero status"
+        ERROR=1
+    fi
+else
+    mkfifo simtrace
+    timeout $TIMEOUT $DIR/$MODEL/build/top +dramcfg=$DRAMCFG +memfile=$HEXFILE +tracefile=simtrace +uartfile=$UARTFILE +logfile=$LOGFILE &
+    SIMPID=$!
 
-ERROR=0
+    timeout $TIMEOUT $DIR/runspike.sh --log-commits --cosim=simtrace $ELFFILE 2>/dev/null &
+    SPIKEPID=$!
 
-wait $SIMPID
-if [ $? -eq 124 ]; then
-    echo "ERROR: rtl timed out"
-    ERROR=1
-fi
+    wait $SIMPID
+    if [ $? -eq 124 ]; then
+        echo "ERROR: rtl timed out"
+        ERROR=1
+    fi
+
+    wait $SPIKEPID; SPIKESTATUS=$?
+    if [ $SPIKESTATUS -eq 124 ]; then
+        echo "ERROR: spike timed out"
+        ERROR=1
+    elif [ $SPIKESTATUS -ne 0 ]; then
+        echo "ERROR: spike exited with non-zero status"
+        ERROR=1
+    fi
 
-wait $SPIKEPID; SPIKESTATUS=$?
-if [ $SPIKESTATUS -eq 124 ]; then
-    echo "ERROR: spike timed out"
-    ERROR=1
-elif [ $SPIKESTATUS -ne 0 ]; then
-    echo "ERROR: spike exited with non-zero status"
-    ERROR=1
+    rm -f simtrace
 fi
 
-rm -f simtrace
-$DIR/checkmem.py $LOGFILE
-if [ $? -ne 0 ]; then
-    ERROR=1
+if [ $CHECKMEM -ne 0 ]; then
+    $DIR/checkmem.py $LOGFILE
+    if [ $? -ne 0 ]; then
+        ERROR=1
+    fi
 fi
 
 if [ $ERROR -ne 0 ]; then
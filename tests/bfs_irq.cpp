@@ -0,0 +1,138 @@
+#include "graph.h"
+
+#define G_SIZE 1024
+#define EDGE_CT (G_SIZE*2)
+#define SEARCHES 4
+#define WORK_SIZE 512
+#define WORK_ITERS 4
+
+// Set by the completion interrupt handler. Spike does not model it, so
+// runtest.sh runs this test on the model alone.
+static volatile bool irq_done;
+static volatile uint32_t irq_stat;
+
+extern "C" void trap_handler(uint32_t mcause, uint32_t mepc) {
+  if (mcause != (MCAUSE_IRQ | IRQ_MBFS)) {exit(128 + (mcause & 0x1f));}
+
+  // Acknowledge the interrupt (without restarting the search)
+  irq_stat = read_csr(CSR_MBFSSTAT);
+  write_csr(CSR_MBFSSTAT, 0);
+  irq_done = true;
+}
+
+// Independent work for the core to do while the accelerator runs
+static uint32_t work_buf[WORK_SIZE];
+
+uint32_t work() {
+  uint32_t sum = 0;
+  for (int i = 0; i < WORK_ITERS; i++) {
+    for (int j = 0; j < WORK_SIZE; j++) {
+      work_buf[j] = (work_buf[j] * 1103515245) + 12345 + sum;
+      sum += work_buf[j] >> 16;
+    }
+  }
+  return sum;
+}
+
+void bfs_start(Graph* graph, Node* root, uint32_t target) {
+  graph->unmark();
+
+  // Set BFS parameters
+  write_csr(CSR_MBFSROOT, (uint32_t) root);
+  write_csr(CSR_MBFSTARG, target);
+  write_csr(CSR_MBFSQBASE, (uint32_t) BFSQBASE);
+  write_csr(CSR_MBFSQSIZE, BFSQSIZE);
+
+  // Start BFS
+  write_csr(CSR_MBFSSTAT, 1);
+}
+
+Node* bfs_result(uint32_t stat) {
+  if (stat & MBFSSTAT_FOUND) {return (Node*) read_csr(CSR_MBFSRESULT);}
+  return nullptr;
+}
+
+// Start, poll for completion, then do the work
+Node* run_polled(Graph* graph, Node* root, uint32_t target, uint32_t timeout,
+                 uint32_t* sum) {
+  clear_csr(CSR_MIE, MIP_MBFSIP);
+  bfs_start(graph, root, target);
+  if (!bfs_wait_acc(timeout)) {return (Node*) -1;}
+  Node* result = bfs_result(read_csr(CSR_MBFSSTAT));
+  *sum = work();
+  return result;
+}
+
+// Start, do the work, then wait for the completion interrupt
+Node* run_overlapped(Graph* graph, Node* root, uint32_t target,
+                     uint32_t timeout, uint32_t* sum) {
+  irq_done = false;
+  bfs_start(graph, root, target);
+  set_csr(CSR_MIE, MIP_MBFSIP);
+  *sum = work();
+
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+  while (!irq_done) {
+    if ((read_csr(CSR_MCYCLE) - time_begin) >= timeout) {return (Node*) -1;}
+  }
+  clear_csr(CSR_MIE, MIP_MBFSIP);
+  return bfs_result(irq_stat);
+}
+
+int main (void) {
+  puts("Creating structures...");
+  Graph graph(G_SIZE);
+  Queue queue(G_SIZE);
+
+  puts("Adding edges...");
+  uint32_t numEdges = 0;
+  while (numEdges < EDGE_CT) {
+    Node* from = graph.getRandomNode();
+    Node* to = graph.getRandomNode();
+    if (!from->addEdge(to)) {continue;}
+    numEdges++;
+  }
+
+  set_csr(CSR_MSTATUS, MSTATUS_MIE);
+
+  puts("Running BFS...");
+  uint32_t total_polled = 0;
+  uint32_t total_overlapped = 0;
+  for (int i = 0; i < SEARCHES; i++) {
+    Node* root = graph.getRandomNode();
+    Node* target = graph.getRandomNode();
+    uint32_t targetVal = target->value;
+
+    uint32_t time;
+    Node* result = bfs(&graph, &queue, root, targetVal, &time);
+
+    uint32_t sum_polled, sum_overlapped;
+    uint32_t time_begin = read_csr(CSR_MCYCLE);
+    Node* result_polled = run_polled(&graph, root, targetVal, time*2,
+                                     &sum_polled);
+    uint32_t time_polled = read_csr(CSR_MCYCLE) - time_begin;
+
+    time_begin = read_csr(CSR_MCYCLE);
+    Node* result_overlapped = run_overlapped(&graph, root, targetVal, time*2,
+                                             &sum_overlapped);
+    uint32_t time_overlapped = read_csr(CSR_MCYCLE) - time_begin;
+
+    if (result_polled == (Node*) -1 || result_overlapped == (Node*) -1) {
+      puts("ERROR: accelerator timed out.");
+      return 1;
+    } else if (result_polled != result || result_overlapped != result) {
+      puts("ERROR: accelerator returned incorrect result.");
+      return 1;
+    }
+
+    printf("Polled: %ld cycles, overlapped: %ld cycles\n",
+           time_polled, time_overlapped);
+    total_polled += time_polled;
+    total_overlapped += time_overlapped;
+  }
+
+  printf("Total polled: %ld cycles, overlapped: %ld cycles, saved: %ld\n",
+         total_polled, total_overlapped, total_polled - total_overlapped);
+
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+// Exercises the return address stack and indirect target buffer: shallow
+// calls that fit the stack, recursion that overflows it, and calls through
+// a function pointer table whose targets repeat and change.
+#define ITERS 1000
+
+__attribute__((noinline)) uint32_t leaf (uint32_t x) {
+  return x * 3 + 1;
+}
+
+__attribute__((noinline)) uint32_t mid (uint32_t x) {
+  return leaf(x) + leaf(x + 1);
+}
+
+__attribute__((noinline)) uint32_t deep (uint32_t n) {
+  if (n == 0) {
+    return 1;
+  }
+  return deep(n - 1) + n;
+}
+
+__attribute__((noinline)) uint32_t op_add (uint32_t x) { return x + 7; }
+__attribute__((noinline)) uint32_t op_xor (uint32_t x) { return x ^ 0x55; }
+__attribute__((noinline)) uint32_t op_shl (uint32_t x) { return x << 1; }
+
+uint32_t (* volatile ops[3]) (uint32_t) = {op_add, op_xor, op_shl};
+
+int main () {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < ITERS; i++) {
+    sum += mid(i);
+  }
+  if (sum != 3002000) {
+    printf("ERROR: nested calls %lu\n", sum);
+    return 1;
+  }
+
+  // twice the stack depth each way
+  for (uint32_t n = 0; n <= 16; n++) {
+    uint32_t r = deep(n);
+    if (r != n * (n + 1) / 2 + 1) {
+      printf("ERROR: deep(%lu) = %lu\n", n, r);
+      return 1;
+    }
+  }
+
+  // one target per site for a while, then rotating targets
+  uint32_t x = 0;
+  for (uint32_t i = 0; i < ITERS; i++) {
+    x = ops[0](x);
+  }
+  for (uint32_t i = 0; i < ITERS; i++) {
+    x = ops[i % 3](x);
+  }
+  printf("calls %lu\n", x);
+  return 0;
+}
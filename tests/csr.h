@@ -1,10 +1,30 @@
 #ifndef CSR_H
 #define CSR_H
 
+#define CSR_MSTATUS   "0x300"
+#define CSR_MIE       "0x304"
+#define CSR_MTVEC     "0x305"
+#define CSR_MSCRATCH  "0x340"
+#define CSR_MEPC      "0x341"
+#define CSR_MCAUSE    "0x342"
+#define CSR_MIP       "0x344"
 #define CSR_MCYCLE    "0xb00"
 #define CSR_MINSTRET  "0xb02"
 #define CSR_MCYCLEH   "0xb80"
 #define CSR_MINSTRETH "0xb82"
+#define CSR_MHARTID   "0xf14"
+#define CSR_MHPMCOUNTER3  "0xb03"
+#define CSR_MHPMCOUNTER4  "0xb04"
+#define CSR_MHPMCOUNTER5  "0xb05"
+#define CSR_MHPMCOUNTER6  "0xb06"
+#define CSR_MHPMCOUNTER3H "0xb83"
+#define CSR_MHPMCOUNTER4H "0xb84"
+#define CSR_MHPMCOUNTER5H "0xb85"
+#define CSR_MHPMCOUNTER6H "0xb86"
+#define CSR_MHPMEVENT3    "0x323"
+#define CSR_MHPMEVENT4    "0x324"
+#define CSR_MHPMEVENT5    "0x325"
+#define CSR_MHPMEVENT6    "0x326"
 #define CSR_MUARTSTAT "0xfc0"
 #define CSR_MUARTRX   "0xfc1"
 #define CSR_MUARTTX   "0x7c0"
@@ -14,7 +34,53 @@
 #define CSR_MBFSQBASE "0x7d3"
 #define CSR_MBFSQSIZE "0x7d4"
 #define CSR_MBFSRESULT "0x7d5"
+#define CSR_MBFSNBASE "0x7d6"
+#define CSR_MBFSPBASE "0x7d7"
+#define CSR_MBFSOBASE "0x7d8"
+#define CSR_MBFSEBASE "0x7d9"
+#define CSR_MBFSVBASE "0x7da"
+#define CSR_MBFSPFCFG "0x7db"
 #define CSR_ML2STAT   "0x7e0"
+#define CSR_MHASHSTAT   "0x7f0"
+#define CSR_MHASHTBASE  "0x7f1"
+#define CSR_MHASHMBASE  "0x7f2"
+#define CSR_MHASHCAP    "0x7f3"
+#define CSR_MHASHVAL    "0x7f4"
+#define CSR_MHASHKEY    "0x7f5"
+#define CSR_MHASHRESULT "0x7f6"
+#define CSR_MHASHBBASE  "0x7f7"
+#define CSR_MHASHRBASE  "0x7f8"
+#define CSR_MHASHCOUNT  "0x7f9"
+#define CSR_MBFSDEQ     "0xfd0"
+#define CSR_MBFSENQ     "0xfd1"
+#define CSR_MBFSMARKED  "0xfd2"
+#define CSR_MBFSSPILL   "0xfd3"
+#define CSR_MBFSRESTORE "0xfd4"
+#define CSR_MBFSQSTALL  "0xfd5"
+#define CSR_MBFSDCWAIT  "0xfd6"
+#define CSR_MBFSCYCLES  "0xfd7"
+#define CSR_MBFSPREFETCH "0xfd8"
+#define CSR_MHASHKEYS   "0xff0"
+#define CSR_MHASHLINES  "0xff1"
+#define CSR_MHASHCMP    "0xff2"
+#define CSR_MHASHCYCLES "0xff3"
+
+#define MSTATUS_MIE (0x00000008)
+
+#define MIP_MBFSIP (0x00010000)
+
+#define MCAUSE_IRQ  (0x80000000)
+#define IRQ_MBFS    (16)
+
+// mhpmevent selectors
+#define HPMEVENT_NONE      (0)
+#define HPMEVENT_DC_MISS   (1) // dcache line fills
+#define HPMEVENT_L2_MISS   (2) // core l2 fills from the bus
+#define HPMEVENT_MISPRED   (3) // retired branches/jumps that redirect fetch
+#define HPMEVENT_ROB_FULL  (4) // cycles
+#define HPMEVENT_LSQ_FULL  (5) // cycles a memory op waits for an lsq entry
+#define HPMEVENT_IC_MISS   (6) // icache line fills
+#define HPMEVENT_BFS_BUS   (7) // bus windows granted to the accelerator l2
 
 #define MUARTSTAT_RXEMPTY (0x00000001)
 #define MUARTSTAT_RXFULL  (0x00000002)
@@ -23,6 +89,25 @@
 
 #define MBFSSTAT_FOUND (0x00000001)
 #define MBFSSTAT_DONE  (0x00000002)
+#define MBFSSTAT_IRQ   (0x00000004)
+
+#define MBFSCTL_START   (0x00000001)
+#define MBFSCTL_PARENTS (0x00000100)
+#define MBFSCTL_CSR     (0x00000200)
+
+#define MHASHSTAT_FOUND (0x00000001)
+#define MHASHSTAT_DONE  (0x00000002)
+
+#define MHASHCTL_START (0x00000001)
+#define MHASHCTL_BATCH (0x00000002)
+
+// hash probe result words: {found, slot}; no slot when the table is full
+#define MHASHRES_FOUND  (0x80000000)
+#define MHASHRES_NOSLOT (0x7fffffff)
+
+// prefetch distance (entries) and throttle (bus busy cycles out of 64
+// above which prefetches hold off, 0: unthrottled)
+#define MBFSPFCFG(dist, busy_max) (((busy_max) << 8) | (dist))
 
 #define read_csr(reg) ({ unsigned long __tmp;     \
     asm volatile ("csrr %0, " reg : "=r"(__tmp)); \
@@ -32,4 +117,12 @@
     __tmp = val;                                       \
     asm volatile ("csrw " reg ", %0" : : "r"(__tmp)); })
 
+#define set_csr(reg, bits) ({ unsigned long __tmp;   \
+    __tmp = bits;                                      \
+    asm volatile ("csrs " reg ", %0" : : "r"(__tmp)); })
+
+#define clear_csr(reg, bits) ({ unsigned long __tmp; \
+    __tmp = bits;                                      \
+    asm volatile ("csrc " reg ", %0" : : "r"(__tmp)); })
+
 #endif
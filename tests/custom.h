@@ -0,0 +1,49 @@
+#ifndef CUSTOM_H
+#define CUSTOM_H
+
+#include <stdint.h>
+
+// Intrinsics for the custom instructions. The loads name the bytes they read
+// as a memory operand instead of clobbering all memory, and the alu ops are
+// plain expressions, so the compiler can schedule and combine them freely.
+
+// lbcmp: bit i is set when byte i of the 32 bytes at addr (8-byte aligned)
+// equals val
+static inline uint32_t lbcmp(const void* addr, uint8_t val) {
+  uint32_t rd;
+  asm (".insn r CUSTOM_0, 3, 0, %0, %1, %2"
+       : "=r"(rd)
+       : "r"(addr), "r"(val), "m"(*(const uint8_t (*)[32]) addr));
+  return rd;
+}
+
+// lbcmp64: line offset of the first byte from addr to the end of its 64-byte
+// line that equals val or is zero, with LBCMP64_EMPTY set when it is zero;
+// LBCMP64_NONE when there is no such byte
+#define LBCMP64_EMPTY (0x80)
+#define LBCMP64_NONE  (0x40)
+static inline uint32_t lbcmp64(const void* addr, uint8_t val) {
+  uint32_t rd;
+  asm (".insn r CUSTOM_0, 7, 0, %0, %1, %2"
+       : "=r"(rd)
+       : "r"(addr), "r"(val),
+         "m"(*(const uint8_t (*)[64]) ((uintptr_t) addr & ~63)));
+  return rd;
+}
+
+// pfd: index of the lowest bit set in vec & ~mask; PFD_NONE if there is none
+#define PFD_NONE (0x80000000)
+static inline uint32_t pfd(uint32_t vec, uint32_t mask) {
+  uint32_t rd;
+  asm (".insn r CUSTOM_1, 0, 0, %0, %1, %2" : "=r"(rd) : "r"(vec), "r"(mask));
+  return rd;
+}
+
+// pcr: vec with the lowest bit set in vec & ~mask cleared
+static inline uint32_t pcr(uint32_t vec, uint32_t mask) {
+  uint32_t rd;
+  asm (".insn r CUSTOM_1, 1, 0, %0, %1, %2" : "=r"(rd) : "r"(vec), "r"(mask));
+  return rd;
+}
+
+#endif
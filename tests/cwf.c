@@ -0,0 +1,68 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "csr.h"
+
+// Critical-word-first fills: walks a pointer chain over a region larger
+// than the l2, one node per line, first with the pointer in the first word
+// of each line and then, over a second region, in the last word, and prints
+// cycles per node. With critical-word-first fills both take about as long;
+// filling from beat 0 (L2_CWF=0), the last word waits for the whole line.
+#define REGION (256 * 1024)
+#define LINE 64
+#define WORDS (LINE / 4)
+#define NODES (REGION / LINE)
+
+typedef struct Line {
+  uint32_t word[WORDS];
+} Line;
+
+// one random cycle through all lines, linked through word w of each
+static Line* build (uint32_t* order, uint32_t w) {
+  Line* lines = (Line*) malloc((NODES + 1) * LINE);
+  lines = (Line*) (((uint32_t) lines + LINE - 1) & ~(LINE - 1));
+  for (uint32_t i = 0; i < NODES; i++) {
+    lines[order[i]].word[w] = (uint32_t) &lines[order[(i + 1) % NODES]].word[w];
+  }
+  return lines;
+}
+
+int main () {
+  uint32_t* order = (uint32_t*) malloc(NODES * sizeof(uint32_t));
+  srand(1);
+  for (uint32_t i = 0; i < NODES; i++) {
+    order[i] = i;
+  }
+  for (uint32_t i = NODES - 1; i > 0; i--) {
+    uint32_t j = rand() % (i + 1);
+    uint32_t t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+
+  // building the second region evicts the first from the l2, and walking
+  // the first evicts the second
+  Line* regions[2];
+  regions[0] = build(order, 0);
+  regions[1] = build(order, WORDS - 1);
+
+  for (uint32_t r = 0; r < 2; r++) {
+    uint32_t w = r ? WORDS - 1 : 0;
+    uint32_t* start = &regions[r][order[0]].word[w];
+    uint32_t* p = start;
+
+    uint32_t time_begin = read_csr(CSR_MCYCLE);
+    for (uint32_t s = 0; s < NODES; s++) {
+      p = (uint32_t*) *p;
+    }
+    uint32_t cycles = read_csr(CSR_MCYCLE) - time_begin;
+
+    if (p != start) {
+      printf("ERROR: word %lu: chain ended at %lx, expected %lx\n",
+             w, (uint32_t) p, (uint32_t) start);
+      return 1;
+    }
+    printf("word %lu: %lu cycles/node\n", w, cycles / NODES);
+  }
+  return 0;
+}
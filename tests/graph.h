@@ -0,0 +1,372 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include "csr.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#define N_MAX 14
+
+// Line flags: the last edge slot holds the address of an EdgeBlock with
+// further edges, and numEdges counts the N_MAX-1 edges before it
+#define LINE_OVERFLOW 0x01
+
+// BFS memory region
+#define BFSQBASE (0x20000000 + (96ul*1024*1024)) // RAM_BASE + HEAP_MAX
+#define BFSQSIZE (8ul*1024*1024)
+
+static inline void putint(uint32_t val) {
+  char buf[10];
+
+  int len = 0;
+  do {
+    buf[len++] = '0' + (val % 10);
+    val /= 10;
+  } while(val);
+
+  do {
+    putchar(buf[--len]);
+  } while(len);
+}
+
+static inline void puthex32(uint32_t val) {
+  for(int i=28;i>=0;i-=4) {
+    char c = '0' + ((val >> i) & 0xf);
+    if(c > '9') {c += ('a' - '9') - 1;}
+    putchar(c);
+  }
+}
+
+struct Node;
+
+// Overflow edges of a high-degree node: one 64-byte line with the same
+// header and edge slots as a node, so blocks chain the same way
+struct EdgeBlock {
+  static EdgeBlock* create() {
+    char* mem = new char[sizeof(EdgeBlock) + 63];
+    EdgeBlock* block = (EdgeBlock*) ((((uintptr_t) mem) + 63) & ~63);
+    block->mem = mem;
+    block->numEdges = 0;
+    block->flags = 0;
+    return block;
+  }
+
+  // original unaligned ptr, used during free (not read by the accelerator)
+  char* mem;
+  struct {
+    uint16_t numEdges;
+    uint8_t flags;
+    uint8_t _unused;
+  };
+  Node* edges[N_MAX];
+};
+
+// Next block of a node or block line
+template<class L>
+static inline EdgeBlock* nextBlock(const L* line) {
+  return (line->flags & LINE_OVERFLOW) ? (EdgeBlock*) line->edges[N_MAX-1] : nullptr;
+}
+
+// Append to the last line of an edge list, moving the last slot into a
+// new block when it is full
+template<class L>
+static inline void appendEdge(L* line, Node* dest) {
+  EdgeBlock* next = nextBlock(line);
+  if(next) {
+    appendEdge(next, dest);
+  } else if(line->numEdges < N_MAX) {
+    line->edges[line->numEdges++] = dest;
+  } else {
+    EdgeBlock* block = EdgeBlock::create();
+    block->edges[block->numEdges++] = line->edges[N_MAX-1];
+    block->edges[block->numEdges++] = dest;
+    line->edges[N_MAX-1] = (Node*) block;
+    line->numEdges = N_MAX-1;
+    line->flags |= LINE_OVERFLOW;
+  }
+}
+
+struct Node {
+  Node(uint32_t value) : value(value) {numEdges = 0; flags = 0; marked = 0;}
+  Node() {numEdges = 0; flags = 0;}
+  ~Node() {
+    EdgeBlock* block = nextBlock(this);
+    while(block) {
+      EdgeBlock* next = nextBlock(block);
+      delete[] block->mem;
+      block = next;
+    }
+  }
+
+  uint32_t getDegree() const {
+    uint32_t degree = numEdges;
+    for(const EdgeBlock* b = nextBlock(this); b; b = nextBlock(b)) {degree += b->numEdges;}
+    return degree;
+  }
+
+  Node* getEdge(uint32_t index) const {
+    if(index < numEdges) {return edges[index];}
+    index -= numEdges;
+    const EdgeBlock* b = nextBlock(this);
+    while(index >= b->numEdges) {
+      index -= b->numEdges;
+      b = nextBlock(b);
+    }
+    return b->edges[index];
+  }
+
+  bool isNeighbor(Node* dest) const {
+    for(uint32_t i = 0; i < numEdges; i++) {
+      if(edges[i] == dest) {return true;}
+    }
+    for(const EdgeBlock* b = nextBlock(this); b; b = nextBlock(b)) {
+      for(uint32_t i = 0; i < b->numEdges; i++) {
+        if(b->edges[i] == dest) {return true;}
+      }
+    }
+    return false;
+  }
+
+  bool addEdge(Node* dest) {
+    if(isNeighbor(dest)) {return false;}
+
+    appendEdge(this, dest);
+    return true;
+  }
+
+  uint32_t value;
+  struct {
+    uint16_t numEdges;
+    uint8_t flags;
+    uint8_t marked;
+  };
+  Node* edges[N_MAX];
+};
+
+class Graph {
+public:
+  Graph(uint32_t size) : size(size) {
+    // Alloc space for all nodes
+    mem = new char[(size*sizeof(Node)) + 63];
+    // Align to 64-byte boundary
+    nodes = (Node*) ((((uintptr_t) mem) + 63) & ~63);
+    // Initialize nodes
+    for(uint32_t i = 0; i < size; i++) {
+      nodes[i] = Node(i);
+    }
+  }
+  ~Graph() {
+    for(uint32_t i = 0; i < size; i++) {
+      nodes[i].~Node();
+    }
+    delete[] mem;
+  }
+
+  uint32_t getSize() const {return size;}
+  Node* getNode(uint32_t index) const {return &nodes[index];}
+
+  Node* getRandomNode() const {
+    return getNode(rand() % size);
+  }
+
+  void unmark() {
+    for(uint32_t i = 0; i < size; i++) {
+      nodes[i].marked = 0;
+    }
+  }
+
+  void print() const {
+    puts("digraph {");
+    for (uint32_t i = 0; i < size; i++) {
+      uint32_t degree = nodes[i].getDegree();
+      if (degree == 0) {continue;}
+
+      fputs("  \"", stdout);
+      putint(nodes[i].value);
+      fputs("\" ->", stdout);
+      for (uint32_t j = 0; j < degree; j++) {
+        if (j != 0) {putchar(',');}
+        fputs(" \"", stdout);
+        putint(nodes[i].getEdge(j)->value);
+        putchar('"');
+      }
+      putchar('\n');
+    }
+    puts("}");
+  }
+
+private:
+  uint32_t size;
+  // aligned to 64-byte boundary
+  Node* nodes;
+  // original unaligned ptr, used during free
+  char* mem;
+
+  Graph(const Graph& other) = delete;
+  Graph& operator=(const Graph& other) = delete;
+};
+
+class Queue {
+public:
+  Queue(uint32_t size) : size(size) {
+    buf = new Node*[size];
+  }
+  ~Queue() {delete[] buf;}
+
+  bool enqueue(Node* node) {
+    uint32_t tail_next = tail + 1;
+    if(tail_next == size) {tail_next = 0;}
+    if(tail_next == head) {return false;}
+    buf[tail] = node;
+    tail = tail_next;
+    return true;
+  }
+
+  Node* dequeue() {
+    if(head == tail) {return nullptr;}
+    Node* node = buf[head++];
+    if(head == size) {head = 0;}
+    return node;
+  }
+
+  void flush() {
+    head = 0;
+    tail = 0;
+  }
+
+private:
+  uint32_t size;
+  uint32_t head, tail;
+  Node** buf;
+
+  Queue(const Queue& other) = delete;
+  Queue& operator=(const Queue& other) = delete;
+};
+
+// Compressed sparse row graph: the edges of vertex v are
+// edges[offsets[v]] .. edges[offsets[v+1]-1]
+class CsrGraph {
+public:
+  CsrGraph(uint32_t size, uint32_t numEdges) : size(size), numEdges(numEdges) {
+    offsets = (uint32_t*) alloc(&offsetsMem, (size+1)*sizeof(uint32_t));
+    edges = (uint32_t*) alloc(&edgesMem, numEdges*sizeof(uint32_t));
+    visited = (uint8_t*) alloc(&visitedMem, size);
+  }
+  ~CsrGraph() {
+    delete[] offsetsMem;
+    delete[] edgesMem;
+    delete[] visitedMem;
+  }
+
+  // Build from an edge list (counting sort by source vertex)
+  void build(const uint32_t* from, const uint32_t* to) {
+    for(uint32_t i = 0; i <= size; i++) {offsets[i] = 0;}
+    for(uint32_t i = 0; i < numEdges; i++) {offsets[from[i]+1]++;}
+    for(uint32_t i = 0; i < size; i++) {offsets[i+1] += offsets[i];}
+    for(uint32_t i = 0; i < numEdges; i++) {
+      edges[offsets[from[i]]++] = to[i];
+    }
+    // Offsets were advanced to the end of each list, shift them back
+    for(uint32_t i = size; i > 0; i--) {offsets[i] = offsets[i-1];}
+    offsets[0] = 0;
+  }
+
+  uint32_t getSize() const {return size;}
+  uint32_t getDegree(uint32_t v) const {return offsets[v+1] - offsets[v];}
+
+  void unmark() {
+    for(uint32_t i = 0; i < size; i++) {
+      visited[i] = 0;
+    }
+  }
+
+  uint32_t size;
+  uint32_t numEdges;
+  // aligned to 64-byte boundaries
+  uint32_t* offsets;
+  uint32_t* edges;
+  uint8_t* visited;
+
+private:
+  // original unaligned ptrs, used during free
+  char* offsetsMem;
+  char* edgesMem;
+  char* visitedMem;
+
+  static void* alloc(char** mem, uint32_t bytes) {
+    *mem = new char[bytes + 63];
+    return (void*) ((((uintptr_t) *mem) + 63) & ~63);
+  }
+
+  CsrGraph(const CsrGraph& other) = delete;
+  CsrGraph& operator=(const CsrGraph& other) = delete;
+};
+
+static inline Node* bfs(Graph* graph, Queue* queue, Node* root, uint32_t target, uint32_t *time) {
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+
+  queue->flush();
+  queue->enqueue(root);
+  graph->unmark();
+  root->marked = 1;
+
+  Node* cur_node;
+  // Remove front of queue
+  while ((cur_node = queue->dequeue())) {
+    if (cur_node->value == target) {break;}
+
+    // Edges in the node's line, then in each overflow block
+    uint32_t numEdges = cur_node->numEdges;
+    Node* const* edges = cur_node->edges;
+    const EdgeBlock* next = nextBlock(cur_node);
+    while (true) {
+      for (uint32_t i = 0; i < numEdges; i++) {
+        Node* neighbor = edges[i];
+        if (neighbor->marked) {continue;}
+
+        // Mark node as visited
+        neighbor->marked = 1;
+        queue->enqueue(neighbor);
+      }
+      if (!next) {break;}
+      numEdges = next->numEdges;
+      edges = next->edges;
+      next = nextBlock(next);
+    }
+  }
+
+  uint32_t time_diff = read_csr(CSR_MCYCLE) - time_begin;
+  *time = time_diff;
+  if (cur_node) {
+    printf("Found target in %ld cycles\n", time_diff);
+  } else {
+    printf("Target not found in %ld cycles\n", time_diff);
+  }
+
+  return cur_node;
+}
+
+static inline bool bfs_wait_acc(uint32_t timeout) {
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+  while ((read_csr(CSR_MCYCLE) - time_begin) < timeout) {
+    if (read_csr(CSR_MBFSSTAT) & MBFSSTAT_DONE) {return true;}
+  }
+  return false;
+}
+
+// Print the accelerator counters for the last search
+static inline void bfs_print_counters() {
+  uint32_t cycles = read_csr(CSR_MBFSCYCLES);
+  uint32_t edges = read_csr(CSR_MBFSENQ);
+  printf("  dequeued %ld, enqueued %ld, already marked %ld\n",
+         read_csr(CSR_MBFSDEQ), edges, read_csr(CSR_MBFSMARKED));
+  printf("  spilled %ld, restored %ld lines\n",
+         read_csr(CSR_MBFSSPILL), read_csr(CSR_MBFSRESTORE));
+  printf("  %ld active cycles: %ld queue stall, %ld cache wait\n",
+         cycles, read_csr(CSR_MBFSQSTALL), read_csr(CSR_MBFSDCWAIT));
+  // edges per 1000 cycles (MTEPS at 1GHz)
+  if (cycles) {printf("  %ld edges/kcycle\n", (uint32_t) ((1000ull * edges) / cycles));}
+}
+
+#endif
@@ -0,0 +1,203 @@
+#include "rmat.h"
+
+// Graph500-style benchmark: R-MAT graph, 64 random roots, full traversals.
+// Vertex ids must fit the 16-bit parent entries (SCALE <= 16).
+// Both accelerator layouts are held to the level-strict validator; the
+// R-MAT hubs overflow their node lines, so the node run covers the block
+// reads that the accelerator has to keep in level order.
+#define SCALE 10
+#define EDGE_FACTOR 16
+#define G_SIZE (1u << SCALE)
+#define SEARCHES 64
+#define SEED 1
+#define ACC_TIMEOUT 10000000
+
+#define UNREACHED (~0u)
+
+// Accessors shared by the node and CSR layouts
+static uint32_t degree(const Graph* graph, uint32_t v) {
+  return graph->getNode(v)->getDegree();
+}
+static uint32_t neighbor(const Graph* graph, uint32_t v, uint32_t i) {
+  return graph->getNode(v)->getEdge(i)->value;
+}
+static uint32_t degree(const CsrGraph* graph, uint32_t v) {
+  return graph->getDegree(v);
+}
+static uint32_t neighbor(const CsrGraph* graph, uint32_t v, uint32_t i) {
+  return graph->edges[graph->offsets[v] + i];
+}
+
+// Reference BFS levels from root, returns the number of edges traversed
+template<class G>
+uint32_t ref_levels(const G* graph, uint32_t root, uint32_t* levels, uint32_t* queue) {
+  for (uint32_t v = 0; v < G_SIZE; v++) {levels[v] = UNREACHED;}
+
+  uint32_t head = 0, tail = 0, edges = 0;
+  levels[root] = 0;
+  queue[tail++] = root;
+  while (head != tail) {
+    uint32_t v = queue[head++];
+    edges += degree(graph, v);
+    for (uint32_t i = 0; i < degree(graph, v); i++) {
+      uint32_t n = neighbor(graph, v, i);
+      if (levels[n] != UNREACHED) {continue;}
+      levels[n] = levels[v] + 1;
+      queue[tail++] = n;
+    }
+  }
+  return edges;
+}
+
+// Graph500 validation: the parents form a BFS tree of the reachable set
+template<class G>
+bool validate(const G* graph, uint32_t root, const uint32_t* levels, const uint32_t* parents) {
+  for (uint32_t v = 0; v < G_SIZE; v++) {
+    uint32_t p = parents[v];
+    if (levels[v] == UNREACHED || v == root) {
+      if (p != (levels[v] == UNREACHED ? UNREACHED : root)) {
+        printf("ERROR: vertex %lu has parent %lu\n", v, p);
+        return false;
+      }
+      continue;
+    }
+
+    if (p >= G_SIZE || levels[p] + 1 != levels[v]) {
+      printf("ERROR: vertex %lu at level %lu has parent %lu\n", v, levels[v], p);
+      return false;
+    }
+    bool edge = false;
+    for (uint32_t i = 0; i < degree(graph, p); i++) {
+      edge |= (neighbor(graph, p, i) == v);
+    }
+    if (!edge) {
+      printf("ERROR: vertex %lu has parent %lu but no edge\n", v, p);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Full traversal with parent writes; -1 on timeout
+int32_t bfs_acc_parents(Graph* graph, CsrGraph* csr, uint32_t root,
+                        uint32_t* parents, uint32_t* time) {
+  if (!bfs_wait_acc(ACC_TIMEOUT)) {return -1;}
+
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+  for (uint32_t v = 0; v < G_SIZE; v++) {parents[v] = UNREACHED;}
+  if (csr) {csr->unmark();} else {graph->unmark();}
+
+  write_csr(CSR_MBFSTARG, UNREACHED);
+  write_csr(CSR_MBFSQBASE, (uint32_t) BFSQBASE);
+  write_csr(CSR_MBFSQSIZE, BFSQSIZE);
+  write_csr(CSR_MBFSPBASE, (uint32_t) parents);
+  if (csr) {
+    write_csr(CSR_MBFSROOT, root);
+    write_csr(CSR_MBFSOBASE, (uint32_t) csr->offsets);
+    write_csr(CSR_MBFSEBASE, (uint32_t) csr->edges);
+    write_csr(CSR_MBFSVBASE, (uint32_t) csr->visited);
+    write_csr(CSR_MBFSSTAT, MBFSCTL_CSR | MBFSCTL_PARENTS | MBFSCTL_START);
+  } else {
+    write_csr(CSR_MBFSROOT, (uint32_t) graph->getNode(root));
+    write_csr(CSR_MBFSNBASE, (uint32_t) graph->getNode(0));
+    write_csr(CSR_MBFSSTAT, MBFSCTL_PARENTS | MBFSCTL_START);
+  }
+
+  if (!bfs_wait_acc(ACC_TIMEOUT)) {return -1;}
+  *time = read_csr(CSR_MCYCLE) - time_begin;
+  return 0;
+}
+
+// Accumulates time/edges for the harmonic mean (16.16 fixed point)
+struct Teps {
+  uint64_t inv_sum = 0;
+  uint32_t n = 0;
+
+  void add(uint32_t edges, uint32_t time) {
+    if (!edges) {return;}
+    inv_sum += ((uint64_t) time << 16) / edges;
+    n++;
+  }
+
+  // harmonic mean of edges per 1000 cycles (MTEPS at 1GHz)
+  void print(const char* name) const {
+    uint32_t hm = inv_sum ? (uint32_t) (((1000ull * n) << 16) / inv_sum) : 0;
+    printf("%s: %lu edges/kcycle (harmonic mean of %lu)\n", name, hm, n);
+  }
+};
+
+int main (void) {
+  printf("Generating R-MAT graph: scale %lu, edge factor %lu\n",
+         (uint32_t) SCALE, (uint32_t) EDGE_FACTOR);
+  uint32_t* from = new uint32_t[G_SIZE*EDGE_FACTOR];
+  uint32_t* to = new uint32_t[G_SIZE*EDGE_FACTOR];
+  uint32_t numEdges = rmat_edges(SCALE, EDGE_FACTOR, SEED, from, to);
+
+  Graph graph(G_SIZE);
+  uint32_t dropped = rmat_build_nodes(&graph, from, to, numEdges);
+  CsrGraph csr(G_SIZE, 2*numEdges);
+  rmat_build_csr(&csr, from, to, numEdges);
+  delete[] from;
+  delete[] to;
+  uint32_t overflows = 0;
+  for (uint32_t v = 0; v < G_SIZE; v++) {
+    overflows += (nextBlock(graph.getNode(v)) != nullptr);
+  }
+  printf("%lu edges, %lu duplicates dropped from the node layout\n",
+         numEdges, dropped);
+  printf("%lu nodes with overflow blocks\n", overflows);
+
+  Queue queue(G_SIZE + 1);
+  uint32_t* levels = new uint32_t[G_SIZE];
+  uint32_t* work = new uint32_t[G_SIZE];
+  uint32_t* parents = new uint32_t[G_SIZE];
+  Teps sw, acc, acc_csr;
+
+  puts("Running BFS...");
+  for (int i = 0; i < SEARCHES; i++) {
+    // Graph500 only starts from vertices with at least one edge
+    uint32_t root;
+    do {root = rand() % G_SIZE;} while (!degree(&graph, root));
+    printf("%d: root %lu\n", i, root);
+
+    // Software, node layout
+    uint32_t edges = ref_levels(&graph, root, levels, work);
+    uint32_t time;
+    bfs(&graph, &queue, graph.getNode(root), UNREACHED, &time);
+    for (uint32_t v = 0; v < G_SIZE; v++) {
+      if (graph.getNode(v)->marked != (levels[v] != UNREACHED)) {
+        printf("ERROR: software BFS visited set differs at %lu\n", v);
+        return 1;
+      }
+    }
+    sw.add(edges, time);
+
+    // Accelerator, node layout
+    if (bfs_acc_parents(&graph, nullptr, root, parents, &time) < 0) {
+      puts("ERROR: accelerator timed out.");
+      return 1;
+    }
+    if (!validate(&graph, root, levels, parents)) {return 1;}
+    acc.add(edges, time);
+    bfs_print_counters();
+
+    // Accelerator, CSR layout
+    edges = ref_levels(&csr, root, levels, work);
+    if (bfs_acc_parents(&graph, &csr, root, parents, &time) < 0) {
+      puts("ERROR: accelerator timed out.");
+      return 1;
+    }
+    if (!validate(&csr, root, levels, parents)) {return 1;}
+    acc_csr.add(edges, time);
+    bfs_print_counters();
+  }
+
+  sw.print("bfs (node)");
+  acc.print("bfs_acc (node)");
+  acc_csr.print("bfs_acc (csr)");
+
+  delete[] levels;
+  delete[] work;
+  delete[] parents;
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include "graph.h"
+
+#define G_SIZE 1024
+#define EDGE_CT (G_SIZE*8)
+#define SEARCHES 8
+
+// Vertex biased towards low ids, giving a few high-degree hubs
+uint32_t getSkewedVertex(uint32_t size) {
+  return ((rand() % size) * (rand() % size)) / size;
+}
+
+bool bfs_csr(CsrGraph* graph, uint32_t* queue, uint32_t root, uint32_t target,
+             uint32_t* time) {
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+
+  uint32_t head = 0, tail = 0;
+  graph->unmark();
+  graph->visited[root] = 1;
+  queue[tail++] = root;
+
+  bool found = false;
+  while (head != tail) {
+    uint32_t v = queue[head++];
+    if (v == target) {found = true; break;}
+
+    for (uint32_t i = graph->offsets[v]; i < graph->offsets[v+1]; i++) {
+      uint32_t neighbor = graph->edges[i];
+      if (graph->visited[neighbor]) {continue;}
+
+      // Mark vertex as visited
+      graph->visited[neighbor] = 1;
+      queue[tail++] = neighbor;
+    }
+  }
+
+  uint32_t time_diff = read_csr(CSR_MCYCLE) - time_begin;
+  *time = time_diff;
+  if (found) {
+    printf("Found target in %ld cycles\n", time_diff);
+  } else {
+    printf("Target not found in %ld cycles\n", time_diff);
+  }
+  return found;
+}
+
+// Returns 1 if found, 0 if not, -1 on timeout
+int bfs_csr_acc(CsrGraph* graph, uint32_t root, uint32_t target, uint32_t timeout) {
+  // Wait for any previous search to complete
+  if (!bfs_wait_acc(10000)) {return -1;}
+
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+  graph->unmark();
+
+  // Set BFS parameters (vertex numbers rather than node addresses)
+  write_csr(CSR_MBFSROOT, root);
+  write_csr(CSR_MBFSTARG, target);
+  write_csr(CSR_MBFSQBASE, (uint32_t) BFSQBASE);
+  write_csr(CSR_MBFSQSIZE, BFSQSIZE);
+  write_csr(CSR_MBFSOBASE, (uint32_t) graph->offsets);
+  write_csr(CSR_MBFSEBASE, (uint32_t) graph->edges);
+  write_csr(CSR_MBFSVBASE, (uint32_t) graph->visited);
+
+  // Start BFS
+  write_csr(CSR_MBFSSTAT, MBFSCTL_CSR | MBFSCTL_START);
+
+  // Wait for search to complete
+  if (!bfs_wait_acc(timeout)) {return -1;}
+
+  uint32_t time_diff = read_csr(CSR_MCYCLE) - time_begin;
+  printf("Accelerator ran in %ld cycles\n", time_diff);
+
+  if (!(read_csr(CSR_MBFSSTAT) & MBFSSTAT_FOUND)) {return 0;}
+  if (read_csr(CSR_MBFSRESULT) != target) {return -1;}
+  return 1;
+}
+
+int main (void) {
+  puts("Creating structures...");
+  uint32_t* from = new uint32_t[EDGE_CT];
+  uint32_t* to = new uint32_t[EDGE_CT];
+  uint32_t* queue = new uint32_t[G_SIZE];
+
+  /* Add edges: duplicates are allowed in CSR */
+  puts("Adding edges...");
+  for (uint32_t i = 0; i < EDGE_CT; i++) {
+    from[i] = getSkewedVertex(G_SIZE);
+    to[i] = rand() % G_SIZE;
+  }
+  CsrGraph graph(G_SIZE, EDGE_CT);
+  graph.build(from, to);
+  delete[] from;
+  delete[] to;
+
+  fputs("Max degree: ", stdout);
+  uint32_t maxDegree = 0;
+  for (uint32_t v = 0; v < G_SIZE; v++) {
+    if (graph.getDegree(v) > maxDegree) {maxDegree = graph.getDegree(v);}
+  }
+  putint(maxDegree);
+  putchar('\n');
+
+  puts("Running BFS...");
+  for (int i = 0; i < SEARCHES; i++) {
+    uint32_t root = rand() % G_SIZE;
+    uint32_t target = rand() % G_SIZE;
+    printf("%lu to %lu: ", root, target);
+
+    uint32_t time;
+    bool found = bfs_csr(&graph, queue, root, target, &time);
+    int found_acc = bfs_csr_acc(&graph, root, target, time*2);
+    if (found_acc < 0) {
+      puts("ERROR: accelerator timed out.");
+      return 1;
+    } else if (found_acc != found) {
+      puts("ERROR: accelerator returned incorrect result.");
+      return 1;
+    }
+  }
+
+  delete[] queue;
+  return 0;
+}
@@ -2,11 +2,18 @@
 #include <time.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include "csr.h"
 
 #define G_SIZE 256
 #define EDGE_CT 1024
 #define SEARCHES 32
 
+// Accelerator graph layout (one 64-byte line per node)
+#define N_MAX 14
+#define BFSQBASE (0x20000000 + (96ul*1024*1024)) // RAM_BASE + HEAP_MAX
+#define BFSQSIZE (8ul*1024*1024)
+#define ACC_TIMEOUT 1000000
+
 typedef struct Node_t {
   struct Node_t** neighbors;
   uint32_t neigh_ct;
@@ -224,6 +231,85 @@ uint32_t bfs_reachable(struct Graph* graph, Node* from, Node* to) {
 }
 
 
+typedef struct AccNode_t {
+  uint32_t value;
+  uint16_t neigh_ct;
+  uint8_t _unused;
+  uint8_t marked;
+  struct AccNode_t* edges[N_MAX];
+} AccNode;
+
+AccNode acc_nodes[G_SIZE] __attribute__((aligned(64)));
+// Written by the accelerator: parent id of each discovered node
+uint32_t acc_parents[G_SIZE];
+
+void create_acc_graph(struct Graph* graph) {
+  for (int i = 0; i < graph->size; i++) {
+    Node* cur_node = graph->nodes + i;
+    acc_nodes[i].value = i;
+    acc_nodes[i].neigh_ct = cur_node->neigh_ct;
+    for (int j = 0; j < cur_node->neigh_ct; j++)
+      acc_nodes[i].edges[j] = acc_nodes + getNodeId(graph, cur_node->neighbors[j]);
+  }
+}
+
+int bfs_wait_acc(uint32_t timeout) {
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+  while ((read_csr(CSR_MCYCLE) - time_begin) < timeout) {
+    if (read_csr(CSR_MBFSSTAT) & MBFSSTAT_DONE)
+      return 1;
+  }
+  return 0;
+}
+
+/* Accelerator BFS, recording parents: returns 1 if found, 0 if not, -1 on timeout */
+int bfs_acc_parents(uint32_t from, uint32_t to) {
+  if (!bfs_wait_acc(ACC_TIMEOUT))
+    return -1;
+
+  for (int i = 0; i < G_SIZE; i++) {
+    acc_nodes[i].marked = 0;
+    acc_parents[i] = ~0u;
+  }
+
+  write_csr(CSR_MBFSROOT, (uint32_t) (acc_nodes + from));
+  write_csr(CSR_MBFSTARG, to);
+  write_csr(CSR_MBFSQBASE, (uint32_t) BFSQBASE);
+  write_csr(CSR_MBFSQSIZE, BFSQSIZE);
+  write_csr(CSR_MBFSNBASE, (uint32_t) acc_nodes);
+  write_csr(CSR_MBFSPBASE, (uint32_t) acc_parents);
+  write_csr(CSR_MBFSSTAT, MBFSCTL_PARENTS | MBFSCTL_START);
+
+  if (!bfs_wait_acc(ACC_TIMEOUT))
+    return -1;
+  return (read_csr(CSR_MBFSSTAT) & MBFSSTAT_FOUND) ? 1 : 0;
+}
+
+/* Follow accelerator parents from to back to from: returns path length or -1 */
+int acc_path_len(struct Graph* graph, uint32_t from, uint32_t to) {
+  uint32_t n = to;
+  int len = 0;
+  while (n != from) {
+    uint32_t p = acc_parents[n];
+    if (p >= G_SIZE || !is_neighbor(graph->nodes + p, graph->nodes + n) || len == G_SIZE)
+      return -1;
+    n = p;
+    len++;
+  }
+  return (acc_parents[from] == from) ? len : -1;
+}
+
+/* Follow software parents from to back to from */
+int sw_path_len(struct Graph* graph, Node* from, Node* to) {
+  Node* n = to;
+  int len = 0;
+  while (n != from) {
+    n = n->parent;
+    len++;
+  }
+  return len;
+}
+
 
 uint32_t getRandNodeId (void) {
   return rand() % G_SIZE;
@@ -242,19 +328,44 @@ int main (void) {
   while (edge_ct < EDGE_CT) {
     uint32_t from = getRandNodeId();
     uint32_t to = getRandNodeId();
+    // Accelerator nodes hold at most N_MAX edges
+    if (graph.nodes[from].neigh_ct == N_MAX)
+      continue;
     if (!is_neighbor(graph.nodes + from, graph.nodes + to)) {
       add_edge(&graph, from, to);
       edge_ct++;
     }
   }
   //print_graph(&graph);
+  create_acc_graph(&graph);
 
   puts("Running BFS...");
   for (int i = 0; i < SEARCHES; i++) {
-    Node* from = graph.nodes + getRandNodeId();
-    Node* to = graph.nodes + getRandNodeId();
+    uint32_t from_id = getRandNodeId();
+    uint32_t to_id = getRandNodeId();
+    Node* from = graph.nodes + from_id;
+    Node* to = graph.nodes + to_id;
     printf("%d: ", i);
-    bfs_reachable(&graph, from, to);
+    uint32_t found = bfs_reachable(&graph, from, to);
+
+    int found_acc = bfs_acc_parents(from_id, to_id);
+    if (found_acc < 0) {
+      puts("ERROR: accelerator timed out.");
+      return 1;
+    } else if (found_acc != found) {
+      puts("ERROR: accelerator returned incorrect result.");
+      return 1;
+    }
+    if (found) {
+      // Both searches are level order, so both paths are shortest
+      int len = sw_path_len(&graph, from, to);
+      int len_acc = acc_path_len(&graph, from_id, to_id);
+      if (len_acc != len) {
+        puts("ERROR: accelerator returned an invalid path.");
+        return 1;
+      }
+      printf("Path length: %d (accelerator: %d)\n", len, len_acc);
+    }
   }
 
   free_graph(&graph);
@@ -0,0 +1,86 @@
+#include "graph.h"
+
+// Back-to-back update+search: each round adds edges and clears the marks
+// from the CPU, then starts the accelerator right away. Rounds alternate
+// between an ML2STAT flush before the start and relying on the accelerator
+// to order itself after the CPU's pending stores.
+#define G_SIZE 4096
+#define EDGE_CT (G_SIZE*2)
+#define UPDATES 64
+#define ROUNDS 16
+#define ACC_TIMEOUT 1000000
+
+// Update the graph and search from root; returns the end-to-end latency
+// (first update to search done) or -1 on timeout
+int32_t update_search(Graph* graph, Node* root, uint32_t target, bool flush,
+                      Node** result) {
+  if (!bfs_wait_acc(ACC_TIMEOUT)) {return -1;}
+
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+  for (uint32_t i = 0; i < UPDATES; i++) {
+    graph->getRandomNode()->addEdge(graph->getRandomNode());
+  }
+  graph->unmark();
+
+  if (flush) {write_csr(CSR_ML2STAT, 1);}
+
+  write_csr(CSR_MBFSROOT, (uint32_t) root);
+  write_csr(CSR_MBFSTARG, target);
+  write_csr(CSR_MBFSQBASE, (uint32_t) BFSQBASE);
+  write_csr(CSR_MBFSQSIZE, BFSQSIZE);
+  write_csr(CSR_MBFSSTAT, 1);
+
+  if (!bfs_wait_acc(ACC_TIMEOUT)) {return -1;}
+  uint32_t time = read_csr(CSR_MCYCLE) - time_begin;
+
+  *result = nullptr;
+  if (read_csr(CSR_MBFSSTAT) & MBFSSTAT_FOUND) {
+    *result = (Node*) read_csr(CSR_MBFSRESULT);
+  }
+  return time;
+}
+
+int main (void) {
+  puts("Creating structures...");
+  Graph graph(G_SIZE);
+  Queue queue(G_SIZE);
+
+  puts("Adding edges...");
+  uint32_t numEdges = 0;
+  while (numEdges < EDGE_CT) {
+    Node* from = graph.getRandomNode();
+    Node* to = graph.getRandomNode();
+    if (!from->addEdge(to)) {continue;}
+    numEdges++;
+  }
+
+  uint32_t time_flush = 0, time_coherent = 0;
+  puts("Running update+search rounds...");
+  for (int i = 0; i < 2*ROUNDS; i++) {
+    bool flush = i & 1;
+    Node* root = graph.getRandomNode();
+    uint32_t target = graph.getRandomNode()->value;
+
+    Node* result_acc;
+    int32_t time = update_search(&graph, root, target, flush, &result_acc);
+    if (time < 0) {
+      puts("ERROR: accelerator timed out.");
+      return 1;
+    }
+    printf("%d: %ld cycles%s\n", i, time, flush ? " with ML2STAT" : "");
+
+    // The software search sees the same (updated) graph
+    uint32_t time_sw;
+    Node* result = bfs(&graph, &queue, root, target, &time_sw);
+    if (result_acc != result) {
+      puts("ERROR: accelerator returned incorrect result.");
+      return 1;
+    }
+
+    if (flush) {time_flush += time;} else {time_coherent += time;}
+  }
+
+  printf("ML2STAT flush: %ld cycles, coherent start: %ld cycles (%lu rounds each)\n",
+         time_flush, time_coherent, (uint32_t) ROUNDS);
+  return 0;
+}
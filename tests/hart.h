@@ -0,0 +1,27 @@
+#ifndef HART_H
+#define HART_H
+
+#include <stdint.h>
+
+// Harts (CPU_CORES in behavioral/Makefile): hart 0 runs main, the others
+// wait in hart_main (stdlib.c) for jobs from hart_start. Each hart has its
+// own stack (startup.S). Only hart 0 may call into newlib (printf, malloc).
+// The bfs and hash accelerators are wired to hart 0 alone: on another hart
+// their csrs (CSR_MBFS*, CSR_MHASH* in csr.h) raise a trap (mcause 0),
+// which the default trap_handler reports through hart_join (exit code 128).
+#define HARTS_MAX 2
+
+// there are no atomics: shared state is handed over through words with a
+// single writer, published after a fence
+static inline void hart_fence(void) {
+  asm volatile ("fence" : : : "memory");
+}
+
+// harts present, found once by waiting for the others to check in
+uint32_t hart_count(void);
+
+// run fn(arg) on hart (1 .. hart_count()-1), and wait for it to return
+void hart_start(uint32_t hart, void (*fn)(void*), void* arg);
+void hart_join(uint32_t hart);
+
+#endif
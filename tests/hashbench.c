@@ -0,0 +1,136 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "csr.h"
+#include "hashset.h"
+
+// Hashset lookup benchmark: sweeps table sizes x load factors x lookup
+// variants (plain C, lbcmp64, hash probe engine) in one run and prints one
+// JSON object per configuration, for perf/hashbench.py. Tables, hash and
+// sampling are the same as hashset.c and hashprobe.c.
+#define ACC_TIMEOUT 100000000
+
+enum {VAR_PLAIN, VAR_LBCMP64, VAR_PROBE, VAR_CT};
+static const char* var_names[VAR_CT] = {"plain", "lbcmp64", "probe"};
+
+bool find_plain (HashSet* set, int32_t val) {
+  uint64_t hash = hash_fn(val);
+  uint32_t hashIdx = hash % set->capacity;
+  while (set->mdata[hashIdx] >> 7) {
+    if ((set->mdata[hashIdx] & 0x7f) == ((hash >> PHASH_SHF) & 0x7f) &&
+        set->arr[hashIdx] == val) {
+      return 1;
+    }
+    hashIdx = (hashIdx + 1) % set->capacity;
+  }
+  return 0;
+}
+
+bool find_probe (int32_t val) {
+  write_csr(CSR_MHASHVAL, (uint32_t) hash_fn(val));
+  write_csr(CSR_MHASHKEY, val);
+  write_csr(CSR_MHASHSTAT, MHASHCTL_START);
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+  while (!(read_csr(CSR_MHASHSTAT) & MHASHSTAT_DONE)) {
+    if ((read_csr(CSR_MCYCLE) - time_begin) >= ACC_TIMEOUT) {
+      puts("ERROR: accelerator timed out.");
+      exit(1);
+    }
+  }
+  return read_csr(CSR_MHASHRESULT) >> 31;
+}
+
+int cmp_u32 (const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+  return (x > y) - (x < y);
+}
+
+// Looks up every key with one variant and prints its JSON record. Cycles are
+// per lookup; instret and dcache misses are totals over all lookups,
+// including the mcycle reads around each one.
+void measure_perf (HashSet* set, int variant, uint32_t lf, int32_t* keys,
+                   bool* expected, uint32_t* times) {
+  uint32_t found_ct = 0;
+  uint64_t total_time = 0;
+
+  uint32_t instret_begin = read_csr(CSR_MINSTRET);
+  uint32_t miss_begin = read_csr(CSR_MHPMCOUNTER3);
+  for (int i = 0; i < SAMPLES; i++) {
+    bool found;
+    uint32_t time_begin = read_csr(CSR_MCYCLE);
+    switch (variant) {
+      case VAR_PLAIN: found = find_plain(set, keys[i]); break;
+      case VAR_LBCMP64: found = findNode(set, keys[i]); break;
+      default:        found = find_probe(keys[i]); break;
+    }
+    times[i] = read_csr(CSR_MCYCLE) - time_begin;
+    if (variant == VAR_PLAIN) {
+      expected[i] = found;
+    } else if (found != expected[i]) {
+      printf("ERROR: %s key %ld: found %d, expected %d\n", var_names[variant], keys[i],
+             found, expected[i]);
+      exit(1);
+    }
+    found_ct += found;
+    total_time += times[i];
+  }
+  uint32_t instret = read_csr(CSR_MINSTRET) - instret_begin;
+  uint32_t misses = read_csr(CSR_MHPMCOUNTER3) - miss_begin;
+
+  qsort(times, SAMPLES, sizeof(uint32_t), cmp_u32);
+  printf("{\"size\": %lu, \"lf\": %lu, \"fill\": %lu, \"variant\": \"%s\", "
+         "\"samples\": %lu, \"found\": %lu, \"mean\": %lu, \"min\": %lu, "
+         "\"max\": %lu, \"p99\": %lu, \"instret\": %lu, \"dc_miss\": %lu}\n",
+         set->capacity, lf, set->size, var_names[variant], (uint32_t) SAMPLES,
+         found_ct, (uint32_t) (total_time / SAMPLES), times[0], times[SAMPLES-1],
+         times[SAMPLES * 99 / 100], instret, misses);
+}
+
+int main () {
+  srand (1);
+
+  int LF_CT = 6;
+  uint32_t TARGET_LF[] = {50, 60, 70, 80, 90, 95};
+
+  int32_t* keys = (int32_t*) malloc(SAMPLES * sizeof(int32_t));
+  bool* expected = (bool*) malloc(SAMPLES * sizeof(bool));
+  uint32_t* times = (uint32_t*) malloc(SAMPLES * sizeof(uint32_t));
+  write_csr(CSR_MHPMEVENT3, HPMEVENT_DC_MISS);
+
+  for (int j = 0; j < TABLE_CT; j++) {
+    uint32_t table_size = TABLE_BASE_SIZE << j;
+    HashSet* set = create_hashset(table_size);
+    int32_t* elems = (int32_t*) malloc (table_size * sizeof(int32_t));
+    int32_t elem_ct = 0;
+    for (int i = 0; i < LF_CT; i++) {
+      uint32_t max_elem_ct = table_size * TARGET_LF[i] / 100 - set->size;
+      for (uint32_t k = 0; k < max_elem_ct; k++) {
+        int32_t elem = rand() % VAL_RANGE;
+        if (insertNode(set, elem)) {
+          elems[elem_ct++] = elem;
+        }
+      }
+
+      // Half hits, half (most probably) misses
+      for (int k = 0; k < SAMPLES; k++) {
+        if (k & 1)  keys[k] = (rand() % VAL_RANGE) + VAL_RANGE;
+        else        keys[k] = elems[rand() % elem_ct];
+      }
+
+      write_csr(CSR_MHASHTBASE, (uint32_t) set->arr);
+      write_csr(CSR_MHASHMBASE, (uint32_t) set->mdata);
+      write_csr(CSR_MHASHCAP, set->capacity);
+      for (int v = 0; v < VAR_CT; v++) {
+        measure_perf(set, v, TARGET_LF[i], keys, expected, times);
+      }
+    }
+    free(elems);
+    free_hashset(set);
+  }
+
+  free(keys);
+  free(expected);
+  free(times);
+  return 0;
+}
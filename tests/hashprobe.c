@@ -0,0 +1,160 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "csr.h"
+#include "hashset.h"
+
+// Same tables, hash and sweep as hashset.c (all in hashset.h), with lookups
+// done in software, by the hash probe engine one key at a time, and by the
+// engine in batch mode (all samples in one start).
+#define ACC_TIMEOUT 100000000
+
+// batch mode input, eight pairs to a line
+typedef struct {
+  uint32_t hash;
+  int32_t key;
+} HashKey;
+
+// Returns the matching slot or the first empty slot, as a result word
+uint32_t find_slot (HashSet* set, int32_t val) {
+  uint64_t hash = hash_fn(val);
+  uint32_t hashIdx = hash % set->capacity;
+  for (uint32_t probed = 0; probed < set->capacity; probed++) {
+    if (!(set->mdata[hashIdx] >> 7)) {
+      return hashIdx;
+    }
+    if ((set->mdata[hashIdx] & 0x7f) == ((hash >> PHASH_SHF) & 0x7f) &&
+        set->arr[hashIdx] == val) {
+      return MHASHRES_FOUND | hashIdx;
+    }
+    hashIdx = (hashIdx + 1) % set->capacity;
+  }
+  return MHASHRES_NOSLOT;
+}
+
+int hash_wait_acc(uint32_t timeout) {
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+  while ((read_csr(CSR_MCYCLE) - time_begin) < timeout) {
+    if (read_csr(CSR_MHASHSTAT) & MHASHSTAT_DONE)
+      return 1;
+  }
+  return 0;
+}
+
+void hash_acc_table (HashSet* set) {
+  write_csr(CSR_MHASHTBASE, (uint32_t) set->arr);
+  write_csr(CSR_MHASHMBASE, (uint32_t) set->mdata);
+  write_csr(CSR_MHASHCAP, set->capacity);
+}
+
+uint32_t hash_acc_find (int32_t val) {
+  write_csr(CSR_MHASHVAL, (uint32_t) hash_fn(val));
+  write_csr(CSR_MHASHKEY, val);
+  write_csr(CSR_MHASHSTAT, MHASHCTL_START);
+  if (!hash_wait_acc(ACC_TIMEOUT)) {
+    puts("ERROR: accelerator timed out.");
+    exit(1);
+  }
+  return read_csr(CSR_MHASHRESULT);
+}
+
+void hash_acc_batch (HashKey* keys, uint32_t* results, uint32_t count) {
+  write_csr(CSR_MHASHBBASE, (uint32_t) keys);
+  write_csr(CSR_MHASHRBASE, (uint32_t) results);
+  write_csr(CSR_MHASHCOUNT, count);
+  write_csr(CSR_MHASHSTAT, MHASHCTL_START | MHASHCTL_BATCH);
+  if (!hash_wait_acc(ACC_TIMEOUT)) {
+    puts("ERROR: accelerator timed out.");
+    exit(1);
+  }
+}
+
+void measure_perf (HashSet* set, int32_t* elems, int32_t elem_ct, uint32_t samples,
+                   HashKey* keys, uint32_t* expected, uint32_t* results) {
+  uint32_t found_ct = 0;
+  uint32_t time_begin;
+  uint64_t sw_time = 0, acc_time = 0;
+
+  for (int i = 0; i < samples; i++) {
+    int32_t search_val;
+    if (i & 1)  search_val = (rand() % VAL_RANGE) + VAL_RANGE;  // value+1: Most probably not found
+    else        search_val = elems[rand() % elem_ct];
+    keys[i].hash = (uint32_t) hash_fn(search_val);
+    keys[i].key = search_val;
+  }
+
+  for (int i = 0; i < samples; i++) {
+    time_begin = read_csr(CSR_MCYCLE);
+    expected[i] = find_slot(set, keys[i].key);
+    sw_time += read_csr(CSR_MCYCLE) - time_begin;
+    found_ct += expected[i] >> 31;
+  }
+
+  hash_acc_table(set);
+  for (int i = 0; i < samples; i++) {
+    time_begin = read_csr(CSR_MCYCLE);
+    uint32_t res = hash_acc_find(keys[i].key);
+    acc_time += read_csr(CSR_MCYCLE) - time_begin;
+    if (res != expected[i]) {
+      printf("ERROR: key %ld: accelerator %lx, expected %lx\n", keys[i].key, res, expected[i]);
+      exit(1);
+    }
+  }
+
+  time_begin = read_csr(CSR_MCYCLE);
+  hash_acc_batch(keys, results, samples);
+  uint32_t batch_time = read_csr(CSR_MCYCLE) - time_begin;
+  for (int i = 0; i < samples; i++) {
+    if (results[i] != expected[i]) {
+      printf("ERROR: batch key %ld: accelerator %lx, expected %lx\n", keys[i].key, results[i], expected[i]);
+      exit(1);
+    }
+  }
+
+  printf("{ Found: %ld / %ld,  Avg Exec Time: sw %ld, probe %ld, batch %ld;  %ld lines, %ld key reads }\n",
+      found_ct, samples, (uint32_t) (sw_time / samples), (uint32_t) (acc_time / samples),
+      batch_time / samples, read_csr(CSR_MHASHLINES), read_csr(CSR_MHASHCMP));
+}
+
+int main () {
+  srand (1);
+
+  uint32_t MAX_ELEM_CT = 0;
+  int LF_CT = 6;
+  float TARGET_LF[] = {0.5, 0.6, 0.7, 0.8, 0.9, 0.95};
+
+  HashKey* keys = (HashKey*) malloc(SAMPLES * sizeof(HashKey));
+  uint32_t* expected = (uint32_t*) malloc(SAMPLES * sizeof(uint32_t));
+  uint32_t* results = (uint32_t*) malloc(SAMPLES * sizeof(uint32_t));
+
+  for (int j = 0; j < TABLE_CT; j++) {
+    int table_size = TABLE_BASE_SIZE << j;
+    HashSet* set = create_hashset(table_size);
+    int32_t* elems = (int32_t*) malloc ((uint32_t)(table_size * sizeof(int32_t)));
+    int32_t elem_ct = 0;
+    printf("Table Size: %d\n", table_size);
+    for (int i = 0; i < LF_CT; i++) {
+      float lf = TARGET_LF[i];
+      MAX_ELEM_CT = ((uint32_t) (table_size * lf)) - set->size;
+      printf("LF: %d ", (int)(lf * 100));
+
+      for (int32_t j = 0; j < MAX_ELEM_CT; j++) {
+        int32_t elem = rand() % VAL_RANGE;
+        if (insertNode(set, elem)) {
+          elems[elem_ct++] = elem;
+        }
+      }
+      printf("(Size: %ld) --> ", set->size);
+      measure_perf(set, elems, elem_ct, SAMPLES, keys, expected, results);
+    }
+    printf("\n");
+    free(elems);
+    free_hashset(set);
+  }
+
+  free(keys);
+  free(expected);
+  free(results);
+  return 0;
+}
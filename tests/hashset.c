@@ -3,12 +3,7 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <time.h>
-
-#define TABLE_BASE_SIZE (1 << 10)
-#define TABLE_CT 9
-#define VAL_RANGE 100000000
-#define SAMPLES 10000
-#define PHASH_SHF 20
+#include "hashset.h"
 
 /* LINKED LIST */
 typedef struct node {
@@ -84,87 +79,6 @@ void destroy(List * list){
 
 
 /* HASHSET */
-typedef struct {
-  int32_t *arr;
-  uint8_t *mdata;
-  uint32_t capacity;
-  uint32_t size;
-  uint8_t *mdata_base;
-  //List *buckets;
-} HashSet;
-
-HashSet* create_hashset(uint32_t cap) {
-  HashSet* set = (HashSet*) malloc(sizeof(HashSet));
-
-  set->capacity = cap;
-  set->size = 0;
-  set->arr = (int32_t*) malloc(cap * sizeof(int32_t));
-  set->mdata_base = (uint8_t*) malloc((cap+31) * sizeof(uint8_t));
-  set->mdata = set->mdata_base + (32 - ((uint32_t)set->mdata_base % 32)) % 32 ; // Align
-  //set->buckets = (List*) malloc(cap * sizeof(List));
-  for (int i = 0; i < cap; i++) {
-    set->mdata[i] = 0;
-    //initlist(set->buckets + i);
-  }
-  return set;
-}
-
-uint64_t hash_fn (int32_t val) {
-  return (val * 2654435761);
-}
-
-bool findNode (HashSet* set, int32_t val) {
-  uint64_t hash = hash_fn(val);
-  uint32_t hashIdx = hash % set->capacity;
-  /*uint32_t lbcmp_e = 0, lbcmp_v = 0;
-  for (int i = 0; i < 32; i++) {
-    int idx = (hashIdx & (~31)) + i;
-    lbcmp_e >>= 1;
-    lbcmp_v >>= 1;
-    if (set->mdata[idx] ==  (0x80 | ((hash >> PHASH_SHF) & 0x7f)))
-      lbcmp_v |= (1 << 31);
-    if (set->mdata[idx] ==  0)
-      lbcmp_e |= (1 << 31);
-  }
-  uint32_t init_idx = hashIdx;
-  printf("idx: %ld, ", init_idx);*/
-  while (set->mdata[hashIdx] >> 7) {
-    // Partial hashes match
-    if ((set->mdata[hashIdx] & 0x7f) == ((hash >> PHASH_SHF) & 0x7f)) {
-      // Actual values match
-      if (set->arr[hashIdx] == val) {
-        //printf("final: %ld, ", hashIdx);
-        return 1;
-      }
-    } 
-    hashIdx = (hashIdx + 1) % set->capacity;
-  }
-  //printf("final: %ld, ", hashIdx);
-  return 0;
-}
-
-bool insertNode (HashSet* set, int32_t val) {
-  uint64_t hash = hash_fn(val);
-  uint32_t hashIdx = hash % set->capacity;
-  // Debugging
-  //add(val, set->buckets + hashIdx);
-
-  // Same as findNode without tombstone
-  while (set->mdata[hashIdx] >> 7) {
-    if ((set->mdata[hashIdx] & 0x7f) == ((hash >> PHASH_SHF) & 0x7f)) {
-      if (set->arr[hashIdx] == val)
-        return false;
-    }
-    hashIdx = (hashIdx + 1) % set->capacity;
-  }
-  // Insert in spot
-  set->mdata[hashIdx] = (1 << 7) | ((hash >> PHASH_SHF) & 0x7f);
-  set->arr[hashIdx] = val;
-  set->size++;
-  return true;
-}
-
-
 void print_buckets (HashSet* set) {
   printf("=== HASHSET BUCKETS ===\n");
   for (int i = 0; i < set->capacity; i++) {
@@ -186,14 +100,6 @@ void print_contents (HashSet* set) {
   printf("==========================\n\n");
 }
 
-void free_hashset (HashSet* set) {
-  free(set->arr);
-  free(set->mdata_base);
-  //for (int i = 0; i < set->capacity; i++) 
-  //  destroy (set->buckets + i);
-  //free(set->buckets);
-  free(set);
-}
 /* END OF HASHSET */
 
 
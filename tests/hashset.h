@@ -0,0 +1,91 @@
+#ifndef HASHSET_H
+#define HASHSET_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "custom.h"
+
+// Open-addressing hashset shared by hashset.c, hashprobe.c and hashbench.c:
+// arr holds the keys, mdata one byte per slot (bit 7: full, bits 6:0: hash
+// tag), probed linearly. The sweep is the same in all three.
+#define TABLE_BASE_SIZE (1 << 10)
+#define TABLE_CT 9
+#define VAL_RANGE 100000000
+#define SAMPLES 10000
+#define PHASH_SHF 20
+
+typedef struct {
+  int32_t *arr;
+  uint8_t *mdata;
+  uint32_t capacity;
+  uint32_t size;
+  uint8_t *mdata_base;
+} HashSet;
+
+static inline HashSet* create_hashset(uint32_t cap) {
+  HashSet* set = (HashSet*) malloc(sizeof(HashSet));
+
+  set->capacity = cap;
+  set->size = 0;
+  set->arr = (int32_t*) malloc(cap * sizeof(int32_t));
+  set->mdata_base = (uint8_t*) malloc((cap+63) * sizeof(uint8_t));
+  set->mdata = set->mdata_base + (64 - ((uint32_t)set->mdata_base % 64)) % 64 ; // Align to a line
+  for (int i = 0; i < cap; i++) {
+    set->mdata[i] = 0;
+  }
+  return set;
+}
+
+static inline void free_hashset (HashSet* set) {
+  free(set->arr);
+  free(set->mdata_base);
+  free(set);
+}
+
+static inline uint64_t hash_fn (int32_t val) {
+  return (val * 2654435761);
+}
+
+// One lbcmp64 per candidate: it returns the first slot from idx to the end
+// of its 64-slot metadata line that matches the tag or is empty, so the
+// probe ends at an empty slot, checks a match against arr, and moves to the
+// next line when neither is left in this one
+static inline bool findNode (HashSet* set, int32_t val) {
+  uint64_t hash = hash_fn(val);
+  uint32_t idx = hash % set->capacity;
+  uint8_t tag = 0x80 | ((hash >> PHASH_SHF) & 0x7f);
+  while (1) {
+    uint32_t res = lbcmp64(set->mdata + idx, tag);
+    if (res & LBCMP64_EMPTY) {
+      return 0;
+    }
+    if (res == LBCMP64_NONE) {
+      idx = ((idx & ~63) + 64) % set->capacity;
+      continue;
+    }
+    idx = (idx & ~63) + res;
+    if (set->arr[idx] == val) {
+      return 1;
+    }
+    idx = (idx + 1) % set->capacity;
+  }
+}
+
+static inline bool insertNode (HashSet* set, int32_t val) {
+  uint64_t hash = hash_fn(val);
+  uint32_t hashIdx = hash % set->capacity;
+  while (set->mdata[hashIdx] >> 7) {
+    if ((set->mdata[hashIdx] & 0x7f) == ((hash >> PHASH_SHF) & 0x7f) &&
+        set->arr[hashIdx] == val) {
+      return false;
+    }
+    hashIdx = (hashIdx + 1) % set->capacity;
+  }
+  set->mdata[hashIdx] = (1 << 7) | ((hash >> PHASH_SHF) & 0x7f);
+  set->arr[hashIdx] = val;
+  set->size++;
+  return true;
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "csr.h"
+
+// Counts each mhpmevent around a region that walks an array twice the
+// dcache size (one load per line) and branches on random data.
+#define ARRAY_SIZE (64 * 1024)
+#define LINE 64
+
+static const char* event_names[] = {
+  "none", "dc_miss", "l2_miss", "mispred", "rob_full", "lsq_full", "ic_miss", "bfs_bus"
+};
+
+uint32_t region (volatile uint8_t* array) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < ARRAY_SIZE; i += LINE) {
+    if (array[i] & 1) {sum += i;}
+  }
+  return sum;
+}
+
+int main () {
+  volatile uint8_t* array = (volatile uint8_t*) malloc(ARRAY_SIZE);
+  srand(1);
+  for (uint32_t i = 0; i < ARRAY_SIZE; i++) {
+    array[i] = rand();
+  }
+
+  // four counters, so two passes over the seven events
+  for (int first = HPMEVENT_DC_MISS; first <= HPMEVENT_BFS_BUS; first += 4) {
+    write_csr(CSR_MHPMEVENT3, first);
+    write_csr(CSR_MHPMEVENT4, first + 1 <= HPMEVENT_BFS_BUS ? first + 1 : HPMEVENT_NONE);
+    write_csr(CSR_MHPMEVENT5, first + 2 <= HPMEVENT_BFS_BUS ? first + 2 : HPMEVENT_NONE);
+    write_csr(CSR_MHPMEVENT6, first + 3 <= HPMEVENT_BFS_BUS ? first + 3 : HPMEVENT_NONE);
+    write_csr(CSR_MHPMCOUNTER3, 0);
+    write_csr(CSR_MHPMCOUNTER4, 0);
+    write_csr(CSR_MHPMCOUNTER5, 0);
+    write_csr(CSR_MHPMCOUNTER6, 0);
+
+    uint32_t sum = region(array);
+
+    uint32_t counts[4] = {
+      read_csr(CSR_MHPMCOUNTER3), read_csr(CSR_MHPMCOUNTER4),
+      read_csr(CSR_MHPMCOUNTER5), read_csr(CSR_MHPMCOUNTER6)
+    };
+    printf("sum %lu:", sum);
+    for (int i = 0; i < 4 && first + i <= HPMEVENT_BFS_BUS; i++) {
+      printf(" %s %lu", event_names[first + i], counts[i]);
+    }
+    printf("\n");
+
+    // every line of the array is new to the dcache
+    if (first == HPMEVENT_DC_MISS && counts[0] < ARRAY_SIZE / LINE) {
+      printf("ERROR: %lu dcache misses for %lu lines\n", counts[0], (uint32_t) (ARRAY_SIZE / LINE));
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,66 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include "csr.h"
+
+// Calls distinct functions through a table, first the first 64, which fit
+// in the default 8KB icache, then all 256, which do not, and prints cycles
+// per call and icache misses.
+#define PASSES 4
+
+#define MIX(x, n) ({ \
+  uint32_t y = (x) * ((n) | 1) + (n); \
+  y ^= y >> 7; \
+  y += y << 3; \
+  y ^= y >> 11; \
+  y * 0x9e3779b1 + (n); \
+})
+
+#define F1(n) __attribute__((noinline)) uint32_t f##n (uint32_t x) {return MIX(x, 0##n);}
+#define F4(n) F1(n##0) F1(n##1) F1(n##2) F1(n##3)
+#define F16(n) F4(n##0) F4(n##1) F4(n##2) F4(n##3)
+#define F64(n) F16(n##0) F16(n##1) F16(n##2) F16(n##3)
+F64(0) F64(1) F64(2) F64(3)
+
+#define P1(n) f##n,
+#define P4(n) P1(n##0) P1(n##1) P1(n##2) P1(n##3)
+#define P16(n) P4(n##0) P4(n##1) P4(n##2) P4(n##3)
+#define P64(n) P16(n##0) P16(n##1) P16(n##2) P16(n##3)
+static uint32_t (*const funcs[256])(uint32_t) = {P64(0) P64(1) P64(2) P64(3)};
+
+// function i is named by the base 4 digits of i, which its body reads as
+// an octal literal (0 followed by the name)
+static uint32_t suffix (uint32_t i) {
+  uint32_t n = 0;
+  for (int d = 3; d >= 0; d--) {
+    n = n * 8 + ((i >> (2 * d)) & 3);
+  }
+  return n;
+}
+
+int main () {
+  for (uint32_t count = 64; count <= 256; count *= 4) {
+    uint32_t expect = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      expect = MIX(expect, suffix(i));
+    }
+
+    write_csr(CSR_MHPMEVENT3, HPMEVENT_IC_MISS);
+    write_csr(CSR_MHPMCOUNTER3, 0);
+    uint32_t time_begin = read_csr(CSR_MCYCLE);
+    for (int pass = 0; pass < PASSES; pass++) {
+      uint32_t x = 0;
+      for (uint32_t i = 0; i < count; i++) {
+        x = funcs[i](x);
+      }
+      if (x != expect) {
+        printf("ERROR: %lu functions pass %d: %lx expected %lx\n", count, pass, x, expect);
+        return 1;
+      }
+    }
+    uint32_t cycles = read_csr(CSR_MCYCLE) - time_begin;
+    uint32_t misses = read_csr(CSR_MHPMCOUNTER3);
+    printf("%lu functions: %lu cycles/call, %lu ic misses\n",
+           count, cycles / (count * PASSES), misses);
+  }
+  return 0;
+}
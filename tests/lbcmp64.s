@@ -0,0 +1,36 @@
+	.macro lbcmp64 rd:req, rs2:req, rs1:req
+	.4byte	0x0000700b | (\rd << 7) | (\rs1 << 15) | (\rs2 << 20)
+	.endm
+
+	# result: bit 7 empty, bit 6 none, bits 5:0 line offset. spike has no
+	# lbcmp64, so runtest.sh runs this on the model alone
+	.text
+	.global main
+main:
+	la	x3, values
+	li	x5, 0x55
+	lbcmp64	4, 5, 3		# match at offset 17
+	li	x6, 0x11
+	xor	a0, x4, x6
+	addi	x7, x3, 18
+	lbcmp64	4, 5, 7		# empty at offset 40
+	li	x6, 0xa8
+	xor	x4, x4, x6
+	or	a0, a0, x4
+	addi	x7, x3, 41
+	lbcmp64	4, 5, 7		# none
+	li	x6, 0x40
+	xor	x4, x4, x6
+	or	a0, a0, x4
+	ret
+
+	.balign 64
+values:
+	.8byte	0xffffffffffffffff
+	.8byte	0xffffffffffffffff
+	.8byte	0xffffffffffff55ff
+	.8byte	0xffffffffffffffff
+	.8byte	0xffffffffffffff00
+	.8byte	0xffffffffffffffff
+	.8byte	0xffffffffffffffff
+	.8byte	0xffffffffffffffff
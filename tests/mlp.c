@@ -0,0 +1,66 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "csr.h"
+
+// Memory-level parallelism: walks 1, 2, 4 and 8 independent pointer chains
+// in lockstep over a region larger than the dcache, one line per node, and
+// prints cycles and dcache misses per node. With one mshr the chains
+// serialize; with more, their misses overlap.
+#define REGION (128 * 1024)
+#define LINE 64
+#define NODES (REGION / LINE)
+#define STEPS (NODES / MAX_CHAINS)
+#define MAX_CHAINS 8
+
+typedef struct Node {
+  struct Node* next;
+  uint8_t pad[LINE - sizeof(struct Node*)];
+} Node;
+
+int main () {
+  Node* nodes = (Node*) malloc((NODES + 1) * LINE);
+  nodes = (Node*) (((uint32_t) nodes + LINE - 1) & ~(LINE - 1));
+
+  // one random cycle through all nodes
+  uint32_t* order = (uint32_t*) malloc(NODES * sizeof(uint32_t));
+  srand(1);
+  for (uint32_t i = 0; i < NODES; i++) {
+    order[i] = i;
+  }
+  for (uint32_t i = NODES - 1; i > 0; i--) {
+    uint32_t j = rand() % (i + 1);
+    uint32_t t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+  for (uint32_t i = 0; i < NODES; i++) {
+    nodes[order[i]].next = &nodes[order[(i + 1) % NODES]];
+  }
+
+  write_csr(CSR_MHPMEVENT3, HPMEVENT_DC_MISS);
+  for (uint32_t chains = 1; chains <= MAX_CHAINS; chains *= 2) {
+    Node* p[MAX_CHAINS];
+    for (uint32_t c = 0; c < chains; c++) {
+      p[c] = &nodes[order[c * (NODES / MAX_CHAINS)]];
+    }
+
+    uint32_t miss_begin = read_csr(CSR_MHPMCOUNTER3);
+    uint32_t time_begin = read_csr(CSR_MCYCLE);
+    for (uint32_t s = 0; s < STEPS; s++) {
+      for (uint32_t c = 0; c < chains; c++) {
+        p[c] = p[c]->next;
+      }
+    }
+    uint32_t cycles = read_csr(CSR_MCYCLE) - time_begin;
+    uint32_t misses = read_csr(CSR_MHPMCOUNTER3) - miss_begin;
+
+    uint32_t sum = 0;
+    for (uint32_t c = 0; c < chains; c++) {
+      sum += (uint32_t) p[c];
+    }
+    printf("chains %lu: %lu cycles/node, %lu misses (%lx)\n", chains,
+           cycles / (STEPS * chains), misses, sum);
+  }
+  return 0;
+}
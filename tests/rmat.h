@@ -0,0 +1,95 @@
+#ifndef RMAT_H
+#define RMAT_H
+
+#include "graph.h"
+
+// R-MAT (Kronecker) generator with the Graph500 initiator
+// A=0.57, B=0.19, C=0.19, D=0.05, in 1/100 units
+#define RMAT_A 57
+#define RMAT_B 19
+#define RMAT_C 19
+
+// xorshift32, so graphs are reproducible independent of rand()
+static inline uint32_t rmat_rand(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// Fill from/to with (1 << scale) * edgeFactor undirected R-MAT edges.
+// Vertex ids are permuted so that hubs are not clustered at low ids.
+static inline uint32_t rmat_edges(uint32_t scale, uint32_t edgeFactor, uint32_t seed,
+                                  uint32_t* from, uint32_t* to) {
+  uint32_t size = 1u << scale;
+  uint32_t numEdges = size * edgeFactor;
+  uint32_t state = seed ? seed : 1;
+
+  for(uint32_t i = 0; i < numEdges; i++) {
+    uint32_t u = 0, v = 0;
+    for(uint32_t bit = 0; bit < scale; bit++) {
+      uint32_t r = rmat_rand(&state) % 100;
+      if(r < RMAT_A) {
+      } else if(r < RMAT_A + RMAT_B) {
+        v |= 1u << bit;
+      } else if(r < RMAT_A + RMAT_B + RMAT_C) {
+        u |= 1u << bit;
+      } else {
+        u |= 1u << bit;
+        v |= 1u << bit;
+      }
+    }
+    from[i] = u;
+    to[i] = v;
+  }
+
+  uint32_t* perm = new uint32_t[size];
+  for(uint32_t i = 0; i < size; i++) {perm[i] = i;}
+  for(uint32_t i = size - 1; i > 0; i--) {
+    uint32_t j = rmat_rand(&state) % (i + 1);
+    uint32_t t = perm[i];
+    perm[i] = perm[j];
+    perm[j] = t;
+  }
+  for(uint32_t i = 0; i < numEdges; i++) {
+    from[i] = perm[from[i]];
+    to[i] = perm[to[i]];
+  }
+  delete[] perm;
+  return numEdges;
+}
+
+// Accelerator node layout: both directions of each edge, dropping
+// duplicates (edges past N_MAX go to overflow blocks). Returns the number
+// dropped.
+static inline uint32_t rmat_build_nodes(Graph* graph, const uint32_t* from,
+                                        const uint32_t* to, uint32_t numEdges) {
+  uint32_t dropped = 0;
+  for(uint32_t i = 0; i < numEdges; i++) {
+    Node* u = graph->getNode(from[i]);
+    Node* v = graph->getNode(to[i]);
+    if(!u->addEdge(v)) {dropped++;}
+    if(u != v && !v->addEdge(u)) {dropped++;}
+  }
+  return dropped;
+}
+
+// CSR layout: both directions of each edge (graph holds 2*numEdges)
+static inline void rmat_build_csr(CsrGraph* graph, const uint32_t* from,
+                                  const uint32_t* to, uint32_t numEdges) {
+  uint32_t* src = new uint32_t[2*numEdges];
+  uint32_t* dst = new uint32_t[2*numEdges];
+  for(uint32_t i = 0; i < numEdges; i++) {
+    src[2*i] = from[i];
+    dst[2*i] = to[i];
+    src[2*i+1] = to[i];
+    dst[2*i+1] = from[i];
+  }
+  graph->build(src, dst);
+  delete[] src;
+  delete[] dst;
+}
+
+#endif
@@ -0,0 +1,315 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "csr.h"
+#include "hart.h"
+
+// Multicore scaling: a level-synchronous BFS over a random graph and lookups
+// in an open-addressing hash set, each run on hart 0 alone and then split
+// across all harts (CPU_CORES=2 in behavioral/Makefile). Prints cycles for
+// both runs, checks the levels against the graph and checks that the runs
+// agree. The harts race to mark nodes; a node found by both is expanded
+// twice, which leaves the levels unchanged. runtest.sh builds the model with
+// two harts for this test, and it fails with fewer.
+#define SCALE 12
+#define NODES (1 << SCALE)
+#define DEGREE 8
+#define EDGES (NODES * DEGREE / 2)
+#define KEYS 4096
+#define SLOTS (4 * KEYS)
+#define LOOKUPS 16384
+#define NONE 0xffffffff
+
+// xorshift32, so runs are reproducible independent of rand()
+static uint32_t next (uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// harts taking part in the current run
+static uint32_t harts;
+
+// barrier: each hart counts its arrivals in its own line
+typedef struct {
+  volatile uint32_t count;
+  uint32_t pad[15];
+} Arrive;
+
+static Arrive arrive[HARTS_MAX] __attribute__((aligned(64)));
+
+static void barrier (uint32_t hart) {
+  hart_fence();
+  uint32_t n = arrive[hart].count + 1;
+  arrive[hart].count = n;
+  for (uint32_t h = 0; h < harts; h++) {
+    while (arrive[h].count < n) {}
+  }
+  hart_fence();
+}
+
+// runs job on hart 0 and n-1 others, returns cycles
+static uint32_t run (void (*job)(void*), uint32_t n) {
+  harts = n;
+  for (uint32_t h = 0; h < HARTS_MAX; h++) {
+    arrive[h].count = 0;
+  }
+
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+  for (uint32_t h = 1; h < n; h++) {
+    hart_start(h, job, (void*) h);
+  }
+  job((void*) 0);
+  for (uint32_t h = 1; h < n; h++) {
+    hart_join(h);
+  }
+  return read_csr(CSR_MCYCLE) - time_begin;
+}
+
+// graph: the neighbors of u are adj[off[u]] .. adj[off[u+1]-1]
+static uint32_t* off;
+static uint32_t* adj;
+static uint32_t* level;
+
+// frontiers, one list per hart, for even and odd levels
+typedef struct {
+  uint32_t* nodes;
+  volatile uint32_t count;
+  uint32_t pad[14];
+} List;
+
+static List lists[2][HARTS_MAX] __attribute__((aligned(64)));
+
+static void build_graph (void) {
+  uint32_t* from = (uint32_t*) malloc(EDGES * sizeof(uint32_t));
+  uint32_t* to = (uint32_t*) malloc(EDGES * sizeof(uint32_t));
+  off = (uint32_t*) calloc(NODES + 1, sizeof(uint32_t));
+  adj = (uint32_t*) malloc(2 * EDGES * sizeof(uint32_t));
+  level = (uint32_t*) malloc(NODES * sizeof(uint32_t));
+
+  uint32_t state = 1;
+  for (uint32_t i = 0; i < EDGES; i++) {
+    from[i] = next(&state) % NODES;
+    to[i] = next(&state) % NODES;
+    off[from[i] + 1]++;
+    off[to[i] + 1]++;
+  }
+  for (uint32_t u = 0; u < NODES; u++) {
+    off[u + 1] += off[u];
+  }
+  uint32_t* fill = (uint32_t*) malloc(NODES * sizeof(uint32_t));
+  for (uint32_t u = 0; u < NODES; u++) {
+    fill[u] = off[u];
+  }
+  for (uint32_t i = 0; i < EDGES; i++) {
+    adj[fill[from[i]]++] = to[i];
+    adj[fill[to[i]]++] = from[i];
+  }
+  free(fill);
+  free(from);
+  free(to);
+
+  for (uint32_t l = 0; l < 2; l++) {
+    for (uint32_t h = 0; h < HARTS_MAX; h++) {
+      lists[l][h].nodes = (uint32_t*) malloc(NODES * sizeof(uint32_t));
+    }
+  }
+}
+
+static void bfs_reset (void) {
+  for (uint32_t u = 0; u < NODES; u++) {
+    level[u] = NONE;
+  }
+  for (uint32_t h = 0; h < HARTS_MAX; h++) {
+    lists[0][h].count = 0;
+    lists[1][h].count = 0;
+  }
+  level[0] = 0;
+  lists[0][0].nodes[0] = 0;
+  lists[0][0].count = 1;
+}
+
+// each hart expands its share of the frontier lists of all harts
+static void bfs_job (void* arg) {
+  uint32_t hart = (uint32_t) arg;
+  for (uint32_t d = 0; ; d++) {
+    List* cur = lists[d & 1];
+    List* nxt = lists[~d & 1];
+
+    uint32_t total = 0;
+    for (uint32_t h = 0; h < harts; h++) {
+      total += cur[h].count;
+    }
+    if (total == 0) {
+      return;
+    }
+
+    uint32_t begin = total * hart / harts;
+    uint32_t end = total * (hart + 1) / harts;
+    uint32_t h = 0;
+    uint32_t base = 0;
+    uint32_t n = 0;
+    for (uint32_t i = begin; i < end; i++) {
+      while (i - base >= cur[h].count) {
+        base += cur[h].count;
+        h++;
+      }
+      uint32_t u = cur[h].nodes[i - base];
+      for (uint32_t e = off[u]; e < off[u + 1]; e++) {
+        uint32_t v = adj[e];
+        if (level[v] == NONE) {
+          level[v] = d + 1;
+          nxt[hart].nodes[n++] = v;
+        }
+      }
+    }
+    nxt[hart].count = n;
+    barrier(hart);
+  }
+}
+
+// every reached node is one level below a neighbor, and no edge spans more
+// than one level or leaves the reached nodes
+static int bfs_valid (void) {
+  if (level[0] != 0) {
+    return 0;
+  }
+  for (uint32_t u = 0; u < NODES; u++) {
+    uint32_t parent = (u == 0);
+    for (uint32_t e = off[u]; e < off[u + 1]; e++) {
+      uint32_t v = adj[e];
+      if ((level[u] == NONE) != (level[v] == NONE)) {
+        return 0;
+      }
+      if (level[u] == NONE) {
+        continue;
+      }
+      if (level[v] + 1 < level[u] || level[u] + 1 < level[v]) {
+        return 0;
+      }
+      parent |= level[v] + 1 == level[u];
+    }
+    if (level[u] != NONE && !parent) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// sum of levels, with the reached nodes in the upper half
+static uint32_t bfs_check (void) {
+  uint32_t sum = 0;
+  for (uint32_t u = 0; u < NODES; u++) {
+    if (level[u] != NONE) {
+      sum += (1 << 16) + level[u];
+    }
+  }
+  return sum;
+}
+
+// hash set: linear probing over nonzero keys, half the queries present
+static uint32_t* slots;
+static uint32_t* queries;
+
+typedef struct {
+  uint32_t found;
+  uint32_t pad[15];
+} Found;
+
+static Found found[HARTS_MAX] __attribute__((aligned(64)));
+
+static void build_hashset (void) {
+  slots = (uint32_t*) calloc(SLOTS, sizeof(uint32_t));
+  queries = (uint32_t*) malloc(LOOKUPS * sizeof(uint32_t));
+
+  uint32_t state = 2;
+  uint32_t* keys = (uint32_t*) malloc(KEYS * sizeof(uint32_t));
+  for (uint32_t i = 0; i < KEYS; i++) {
+    keys[i] = next(&state);
+    uint32_t s = (keys[i] * 0x9e3779b1) % SLOTS;
+    while (slots[s] && slots[s] != keys[i]) {
+      s = (s + 1) % SLOTS;
+    }
+    slots[s] = keys[i];
+  }
+  for (uint32_t i = 0; i < LOOKUPS; i++) {
+    queries[i] = (i & 1) ? keys[next(&state) % KEYS] : next(&state);
+  }
+  free(keys);
+}
+
+static void lookup_job (void* arg) {
+  uint32_t hart = (uint32_t) arg;
+  uint32_t n = 0;
+  for (uint32_t i = LOOKUPS * hart / harts; i < LOOKUPS * (hart + 1) / harts; i++) {
+    uint32_t key = queries[i];
+    uint32_t s = (key * 0x9e3779b1) % SLOTS;
+    while (slots[s] && slots[s] != key) {
+      s = (s + 1) % SLOTS;
+    }
+    n += slots[s] == key;
+  }
+  found[hart].found = n;
+}
+
+static uint32_t lookup_check (void) {
+  uint32_t n = 0;
+  for (uint32_t h = 0; h < harts; h++) {
+    n += found[h].found;
+  }
+  return n;
+}
+
+int main () {
+  // one hart, then all of them
+  uint32_t counts[2] = {1, hart_count()};
+  printf("%lu harts\n", counts[1]);
+  if (counts[1] < 2) {
+    puts("ERROR: smp needs two harts (CPU_CORES=2).");
+    return 1;
+  }
+
+  build_graph();
+  build_hashset();
+
+  uint32_t expect = 0;
+  uint32_t base = 0;
+  for (uint32_t r = 0; r < 2; r++) {
+    uint32_t h = counts[r];
+    bfs_reset();
+    uint32_t cycles = run(bfs_job, h);
+    uint32_t sum = bfs_check();
+    if (!bfs_valid()) {
+      printf("ERROR: bfs %lu harts: invalid levels\n", h);
+      return 1;
+    }
+    if (r == 0) {
+      expect = sum;
+      base = cycles;
+    } else if (sum != expect) {
+      printf("ERROR: bfs %lu harts: %lx expected %lx\n", h, sum, expect);
+      return 1;
+    }
+    printf("bfs %lu harts: %lu nodes, %lu cycles, speedup %lu.%02lu\n",
+           h, sum >> 16, cycles, base / cycles, base * 100 / cycles % 100);
+  }
+
+  for (uint32_t r = 0; r < 2; r++) {
+    uint32_t h = counts[r];
+    uint32_t cycles = run(lookup_job, h);
+    uint32_t hits = lookup_check();
+    if (r == 0) {
+      expect = hits;
+      base = cycles;
+    } else if (hits != expect) {
+      printf("ERROR: hashset %lu harts: %lu found, expected %lu\n", h, hits, expect);
+      return 1;
+    }
+    printf("hashset %lu harts: %lu found, %lu cycles, speedup %lu.%02lu\n",
+           h, hits, cycles, base / cycles, base * 100 / cycles % 100);
+  }
+  return 0;
+}
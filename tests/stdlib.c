@@ -3,8 +3,9 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include "csr.h"
+#include "hart.h"
 
-// 96MB (need room for stack)
+// 96MB (need room for the hart stacks)
 #define HEAP_MAX (96ul*1024*1024)
 
 // The values of these symbols are obtained from the address (e.g. &_sdata, etc.)
@@ -70,3 +71,79 @@ void _exit(int status) {
     asm("ebreak");
     while(1) {}
 }
+
+// Harts: startup.S sends the others here once hart 0 has initialized memory.
+// Each mailbox line is written by hart 0 (fn, arg, start) or by its hart
+// (ready, done, trap), never both.
+#define HART_WAIT 20000 // cycles hart_count waits for a hart to check in
+
+typedef struct {
+    void (*volatile fn)(void*);
+    void* volatile arg;
+    volatile uint32_t start;
+    uint32_t pad0[13];
+    volatile uint32_t ready;
+    volatile uint32_t done;
+    volatile uint32_t trap;
+    uint32_t pad1[13];
+} Mailbox;
+
+static Mailbox mailbox[HARTS_MAX] __attribute__((aligned(64)));
+
+void hart_main(uint32_t hart) {
+    if (hart >= HARTS_MAX) { return; }
+
+    Mailbox* m = &mailbox[hart];
+    uint32_t seen = 0;
+    m->ready = 1;
+    while (1) {
+        while (m->start == seen) {}
+        seen = m->start;
+        m->fn(m->arg);
+        hart_fence();
+        m->done = seen;
+    }
+}
+
+uint32_t hart_count(void) {
+    static uint32_t harts;
+    if (!harts) {
+        harts = 1;
+        uint32_t begin = read_csr(CSR_MCYCLE);
+        while (harts < HARTS_MAX) {
+            while (!mailbox[harts].ready && read_csr(CSR_MCYCLE) - begin < HART_WAIT) {}
+            if (!mailbox[harts].ready) { break; }
+            harts++;
+        }
+    }
+    return harts;
+}
+
+void hart_start(uint32_t hart, void (*fn)(void*), void* arg) {
+    Mailbox* m = &mailbox[hart];
+    m->fn = fn;
+    m->arg = arg;
+    hart_fence();
+    m->start = m->start + 1;
+}
+
+void hart_join(uint32_t hart) {
+    Mailbox* m = &mailbox[hart];
+    while (m->done != m->start) {
+        if (m->trap) { _exit(m->trap); }
+    }
+    hart_fence();
+}
+
+// Traps: programs that enable interrupts provide their own handler. Only
+// hart 0's exit is seen by the harness, so another hart that traps (e.g. on
+// an accelerator csr, see hart.h) leaves its exit code in its mailbox for
+// hart_join and stops.
+__attribute__((weak)) void trap_handler(uint32_t mcause, uint32_t mepc) {
+    uint32_t hart = read_csr(CSR_MHARTID);
+    if (hart != 0 && hart < HARTS_MAX) {
+        mailbox[hart].trap = 128 + (mcause & 0x1f);
+        while (1) {}
+    }
+    _exit(128 + (mcause & 0x1f));
+}
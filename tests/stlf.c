@@ -0,0 +1,82 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include "csr.h"
+
+// Store-to-load forwarding and memory dependence speculation: loads that
+// read back fresh stores of every width (full and partial overlap), and
+// loads that run ahead of a store whose address comes from a divide, first
+// to a different word and then to the same one, which must replay.
+#define ITERS 1000
+
+volatile uint32_t words[16];
+
+__attribute__((noinline)) int32_t widths (uint32_t x) {
+  volatile union {
+    uint32_t w;
+    uint16_t h[2];
+    uint8_t b[4];
+    int8_t sb[4];
+    int16_t sh[2];
+  } u;
+  int32_t sum = 0;
+
+  // word store, narrower loads (covered)
+  u.w = x;
+  sum += u.b[0] + u.b[3] + u.sb[1] + u.h[1] + u.sh[0];
+
+  // byte and half stores, same-width loads (covered)
+  u.b[2] = x >> 3;
+  sum += u.sb[2];
+  u.h[0] = x >> 5;
+  sum += u.sh[0];
+
+  // byte store, word load (partial overlap)
+  u.b[1] = x >> 7;
+  sum += u.w;
+  return sum;
+}
+
+__attribute__((noinline)) uint32_t alias (uint32_t n, uint32_t d) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    // the store address waits on the divide, the load address does not
+    words[(i * d) / d % 16] = i;
+    sum += words[i % 16];
+  }
+  return sum;
+}
+
+int main () {
+  int32_t wsum = 0;
+  int32_t wexpect = 0;
+  for (uint32_t i = 0; i < ITERS; i++) {
+    uint32_t x = i * 0x01010101 + 0x80ff7f01;
+    wsum += widths(x);
+
+    uint32_t w = x;
+    int32_t e = (uint8_t) w + (uint8_t) (w >> 24) + (int8_t) (w >> 8) +
+                (uint16_t) (w >> 16) + (int16_t) w;
+    w = (w & 0xff00ffff) | ((x >> 3) & 0xff) << 16;
+    e += (int8_t) (w >> 16);
+    w = (w & 0xffff0000) | ((x >> 5) & 0xffff);
+    e += (int16_t) w;
+    w = (w & 0xffff00ff) | ((x >> 7) & 0xff) << 8;
+    e += (int32_t) w;
+    wexpect += e;
+  }
+  if (wsum != wexpect) {
+    printf("ERROR: widths %lx expected %lx\n", wsum, wexpect);
+    return 1;
+  }
+
+  uint32_t time_begin = read_csr(CSR_MCYCLE);
+  uint32_t sum = alias(ITERS, 3);
+  uint32_t cycles = read_csr(CSR_MCYCLE) - time_begin;
+  // each load reads the store just before it
+  if (sum != ITERS * (ITERS - 1) / 2) {
+    printf("ERROR: alias %lu\n", sum);
+    return 1;
+  }
+  printf("stlf %lx, alias %lu cycles/iter\n", wsum, cycles / ITERS);
+  return 0;
+}
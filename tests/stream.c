@@ -0,0 +1,48 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "csr.h"
+
+// Streams over a region twice the l2 size, sequentially (one word per
+// line) and with a fixed 4-line stride, and prints cycles per line touched.
+// The l2 prefetcher should catch both: the first as a stream of misses, the
+// second by the stride of the load's pc.
+#define REGION (256 * 1024)
+#define LINE 64
+#define STRIDE (4 * LINE)
+
+uint32_t walk (volatile uint32_t* array, uint32_t stride) {
+  uint32_t sum = 0;
+  for (uint32_t off = 0; off < stride; off += LINE) {
+    for (uint32_t i = off; i < REGION; i += stride) {
+      sum += array[i / sizeof(uint32_t)];
+    }
+  }
+  return sum;
+}
+
+int main () {
+  volatile uint32_t* array = (volatile uint32_t*) malloc(REGION);
+  uint32_t expect = 0;
+  for (uint32_t i = 0; i < REGION / sizeof(uint32_t); i++) {
+    array[i] = i;
+    if (i % (LINE / sizeof(uint32_t)) == 0) {
+      expect += i;
+    }
+  }
+
+  for (uint32_t stride = LINE; stride <= STRIDE; stride *= 4) {
+    // the region is twice the l2, so the timed pass misses all the same
+    walk(array, stride);
+
+    uint32_t time_begin = read_csr(CSR_MCYCLE);
+    uint32_t sum = walk(array, stride);
+    uint32_t cycles = read_csr(CSR_MCYCLE) - time_begin;
+    if (sum != expect) {
+      printf("ERROR: stride %lu sum %lu expected %lu\n", stride, sum, expect);
+      return 1;
+    }
+    printf("stride %lu: %lu cycles/line\n", stride, cycles / (REGION / LINE));
+  }
+  return 0;
+}